@@ -0,0 +1,200 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftarena.cpp
+ *           Overview: This is the implementation file for the Arena class
+ *                     and the debug allocation counter
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "ftarena.h"
+
+#ifdef FT_ALLOC_DEBUG
+#include <atomic>
+
+// Count of every global operator new call in the process
+static std::atomic<long long> allocCount(0);
+
+void *operator new(std::size_t bytes)
+{
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(bytes ? bytes : 1);
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return (p);
+}
+
+void *operator new[](std::size_t bytes)
+{
+    return (operator new(bytes));
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif // FT_ALLOC_DEBUG
+
+namespace FtArena
+{
+    Arena::Arena(std::size_t blockSizeInput)
+        : head(NULL), blockSize(blockSizeInput)
+    {/*Body intentionally empty*/}
+
+    Arena::~Arena()
+    {
+        while (head != NULL)
+        {
+            Block *next = head->next;
+            ::operator delete(head);
+            head = next;
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: alloc
+     *
+     *    Entry: The number of bytes and the alignment, a power of two
+     *
+     *     Exit: Returns aligned memory owned by the arena
+     *
+     *  Purpose: Bump-allocate from the newest block; A request larger than
+     *           the block size gets a block of its own
+     *
+     *
+     *   *   *   *   *   *   */
+    void *Arena::alloc(std::size_t bytes, std::size_t align)
+    {
+        const std::size_t header = (sizeof(Block) + align - 1) & ~(align - 1);
+
+        if (head != NULL)
+        {
+            std::size_t off = (head->used + align - 1) & ~(align - 1);
+            if (off + bytes <= head->size)
+            {
+                head->used = off + bytes;
+                return (reinterpret_cast<char *>(head) + off);
+            }
+        }
+
+        // Start a new block with room for the header and the request
+        std::size_t size = blockSize;
+        if (header + bytes > size)
+        {
+            size = header + bytes;
+        }
+
+        Block *b = static_cast<Block *>(::operator new(size));
+        b->next = head;
+        b->size = size;
+        b->used = header + bytes;
+        head = b;
+
+        return (reinterpret_cast<char *>(b) + header);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: copyStr
+     *
+     *    Entry: A string and its length
+     *
+     *     Exit: Returns a null-terminated copy owned by the arena
+     *
+     *  Purpose: Keep a string for the life of the session
+     *
+     *
+     *   *   *   *   *   *   */
+    char *Arena::copyStr(const char *str, std::size_t len)
+    {
+        char *copy = static_cast<char *>(alloc(len + 1, 1));
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+
+        return (copy);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: reset
+     *
+     *    Entry: None
+     *
+     *     Exit: The arena is empty and holds at most its oldest block
+     *
+     *  Purpose: Reuse the arena without returning its first block
+     *
+     *
+     *   *   *   *   *   *   */
+    void Arena::reset()
+    {
+        while (head != NULL && head->next != NULL)
+        {
+            Block *next = head->next;
+            ::operator delete(head);
+            head = next;
+        }
+
+        if (head != NULL)
+        {
+            head->used = sizeof(Block);
+        }
+    }
+
+    std::size_t Arena::getUsed()
+    {
+        std::size_t used = 0;
+        for (Block *b = head; b != NULL; b = b->next)
+        {
+            used += b->used;
+        }
+
+        return (used);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: heapAllocs
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns the operator new call count or -1
+     *
+     *  Purpose: Let debug builds prove a code path does not allocate
+     *
+     *
+     *   *   *   *   *   *   */
+    long long heapAllocs()
+    {
+#ifdef FT_ALLOC_DEBUG
+        return (allocCount.load(std::memory_order_relaxed));
+#else
+        return (-1);
+#endif
+    }
+} // FtArena
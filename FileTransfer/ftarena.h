@@ -0,0 +1,79 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftarena.h
+ *           Overview: This is the header file for the Arena class, a bump
+ *                     allocator that gives each ftserve session one place to
+ *                     carve its buffers and strings from; Nothing is freed
+ *                     until the arena is reset or destroyed
+ *
+ *                     When built with -DFT_ALLOC_DEBUG the global operator
+ *                     new is replaced with a counting version so the server
+ *                     can check that its chunk loop makes no heap allocations
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTARENA_H
+#define FTARENA_H
+
+#include <cstddef>
+
+namespace FtArena
+{
+    /*
+     * Class for a per-session bump allocator made of chained blocks
+     */
+    class Arena
+    {
+    public:
+        Arena(std::size_t blockSizeInput);
+        /*
+         * Initializes an empty arena; The first block of blockSizeInput
+         * bytes is allocated on first use
+         */
+
+        ~Arena();
+
+        void *alloc(std::size_t bytes, std::size_t align);
+        /*
+         * Returns bytes of memory aligned to align, a power of two, adding
+         * a block if the current one is full
+         */
+
+        char *copyStr(const char *str, std::size_t len);
+        /*
+         * Returns a null-terminated copy of the len chars at str
+         */
+
+        void reset();
+        /*
+         * Frees every block but the first and empties the arena
+         */
+
+        std::size_t getUsed();
+    private:
+        struct Block
+        {
+            Block       *next;
+            std::size_t size;
+            std::size_t used;
+        };
+
+        Block *head;
+        std::size_t blockSize;
+
+        Arena(const Arena &);
+        Arena &operator=(const Arena &);
+    };
+
+    /*
+     * The heapAllocs() function returns the number of global operator new
+     * calls so far, or -1 unless built with -DFT_ALLOC_DEBUG
+     */
+    long long heapAllocs();
+} // FtArena
+#endif // FTARENA_H
@@ -0,0 +1,981 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftbench.cpp
+ *           Overview: This is the loopback benchmark for ftserve. It starts
+ *                     ftserve on a free port in a scratch directory, writes
+ *                     files of each size asked for, and drives "l" and "g"
+ *                     requests through the client library. Each case records
+ *                     MB/s, requests/s, and latency percentiles to a JSON
+ *                     file, and is compared to a baseline from an earlier
+ *                     run; A case slower than the baseline by more than the
+ *                     threshold fails the run
+ *
+ *                     Usage: ./ftbench [-sizes list] [-clients n]
+ *                                      [-names n] [-baseline path]
+ *                                      [-out path] [-threshold pct]
+ *                                      [-server path] [-serveropts opts]
+ *                                      [-dir path]
+ *
+ *                     Options: -sizes      - File sizes, such as 1K,1M,2G
+ *                              -clients    - Requests in flight per case
+ *                              -names      - Empty files added to the
+ *                                            directory for the listings
+ *                              -baseline   - Results to compare against
+ *                              -out        - File for this run's results
+ *                              -threshold  - Percent a case may regress
+ *                              -server     - ftserve to run
+ *                              -serveropts - Options passed to ftserve
+ *                              -dir        - Directory for the files, kept
+ *                                            for the next run
+ *              Input: The command line arguments
+ *
+ *             Output: A table of the cases is output to stdout, and the
+ *                     results are written as JSON
+ *
+ *
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ftco.h"
+#include "ftclientlib.h"
+
+const long long TIMEOUT_MS    = 60000; // Deadline of each wait
+const int       START_WAIT_MS = 5000; // Time allowed for ftserve to listen
+const long long CASE_BYTES    = 64 * 1024 * 1024LL; // Bytes per get case
+const int       MIN_REPS      = 3; // Fewest requests in a case
+const int       MAX_REPS      = 200; // Most requests in a case
+const int       LIST_REPS     = 50; // Requests in a listing case
+const int       WRITE_SIZE    = 1024 * 1024; // Bytes per write of a file
+const int       MAX_LINE      = 1024; // Longest line of a results file
+
+/*
+ * Structure for the options given on the command line
+ */
+struct BenchOpts
+{
+    std::string sizes;
+    std::string baseline;
+    std::string out;
+    std::string server;
+    std::string serverOpts;
+    std::string dir;
+    double      threshold;
+    int         clients;
+    int         names;
+};
+
+/*
+ * Structure for the results of one case; Latencies are in milliseconds
+ */
+struct Case
+{
+    std::string         name;
+    long long           requests;
+    long long           bytes;
+    double              secs;
+    double              mbPerSec;
+    double              reqPerSec;
+    double              p50Ms;
+    double              p90Ms;
+    double              p99Ms;
+    double              maxMs;
+    std::vector<double> latMs;
+};
+
+/*
+ * Structure for the requests of a case shared by its workers; file is NULL
+ * for a listing
+ */
+struct Work
+{
+    FtClient::Client *client;
+    const char       *file;
+    const char       *terms;
+    long long        expect;
+    long long        left;
+    int              outFd;
+    bool             ok;
+    Case             *result;
+};
+
+/*
+ * The parseOptions() function parses the flag and value pairs
+ */
+BenchOpts parseOptions(int argc, char *argv[]);
+
+/*
+ * The printUsage() function prints the correct usage and exits the program
+ */
+void printUsage(const char *prog);
+
+/*
+ * The parseSize() function parses a size such as 64K, 1M, or 2G into bytes;
+ * Returns -1 if it is malformed
+ */
+long long parseSize(const std::string &text);
+
+/*
+ * The monoUs() function returns the monotonic clock in microseconds
+ */
+long long monoUs();
+
+/*
+ * The makeFile() function writes a file of size bytes unless one is there
+ */
+bool makeFile(const std::string &path, long long size);
+
+/*
+ * The freePort() function returns a loopback TCP port no one is using
+ */
+int freePort();
+
+/*
+ * The startServer() function runs ftserve on port in dir; Returns its pid
+ * once it accepts connections, or -1
+ */
+pid_t startServer(const BenchOpts &opts, const std::string &dir, int port);
+
+/*
+ * The runCase() function runs reps requests of one case with the given
+ * number of clients in flight
+ */
+bool runCase(FtCo::Loop &loop, FtClient::Client &client, Case *c,
+             const char *file, const char *terms, long long expect,
+             long long reps, int clients);
+
+/*
+ * The worker() coroutine makes the requests of a case one at a time
+ */
+FtCo::Task<> worker(Work *work);
+
+/*
+ * The summarize() function fills in the rates and percentiles of a case
+ */
+void summarize(Case *c);
+
+/*
+ * The writeResults() function writes the cases as JSON
+ */
+bool writeResults(const std::string &path, const std::vector<Case> &cases);
+
+/*
+ * The readResults() function reads the cases of a results file; Returns
+ * false if it cannot be opened or holds no case
+ */
+bool readResults(const std::string &path, std::vector<Case> *cases);
+
+/*
+ * The compare() function prints each case against the baseline; Returns the
+ * number of cases that regressed
+ */
+int compare(const std::vector<Case> &cases, const std::vector<Case> &base,
+            double threshold);
+
+int main(int argc, char *argv[])
+{
+    BenchOpts opts = parseOptions(argc, argv);
+
+    std::vector<long long> sizes;
+    std::vector<std::string> labels;
+    std::size_t start = 0;
+    while (start <= opts.sizes.size())
+    {
+        std::size_t comma = opts.sizes.find(',', start);
+        if (comma == std::string::npos)
+        {
+            comma = opts.sizes.size();
+        }
+        std::string label = opts.sizes.substr(start, comma - start);
+        long long size = parseSize(label);
+        if (size < 0)
+        {
+            printUsage(argv[0]);
+        }
+        sizes.push_back(size);
+        labels.push_back(label);
+        start = comma + 1;
+    }
+
+    // A baseline that was asked for must be read before the run, or a
+    // missing one would pass without checking anything
+    std::vector<Case> base;
+    if (!opts.baseline.empty() && !readResults(opts.baseline, &base))
+    {
+        std::cerr << "Could not read the baseline " << opts.baseline << "\n";
+        return (1);
+    }
+
+    // Scratch files go in a new directory unless one is kept between runs
+    bool scratch = opts.dir.empty();
+    if (scratch)
+    {
+        char tmpl[] = "/tmp/ftbench.XXXXXX";
+        if (mkdtemp(tmpl) == NULL)
+        {
+            perror("Scratch directory");
+            return (1);
+        }
+        opts.dir = tmpl;
+    }
+    else if (mkdir(opts.dir.c_str(), 0755) == -1 && errno != EEXIST)
+    {
+        perror("Directory");
+        return (1);
+    }
+
+    // ftserve runs in the directory, so its paths must not be relative
+    char *dirPath = realpath(opts.dir.c_str(), NULL);
+    if (dirPath == NULL)
+    {
+        perror("Directory");
+        return (1);
+    }
+    opts.dir = dirPath;
+    free(dirPath);
+
+    std::cout << "Writing files in " << opts.dir << "\n";
+    for (std::size_t i = 0; i < sizes.size(); i++)
+    {
+        if (!makeFile(opts.dir + "/bench-" + labels[i], sizes[i]))
+        {
+            perror("Writing file");
+            return (1);
+        }
+    }
+    for (int i = 0; i < opts.names; i++)
+    {
+        char name[32];
+        snprintf(name, sizeof name, "/name-%05d", i);
+        if (!makeFile(opts.dir + name, 0))
+        {
+            perror("Writing file");
+            return (1);
+        }
+    }
+
+    int port = freePort();
+    pid_t server = (port == -1 ? -1 : startServer(opts, opts.dir, port));
+    if (server == -1)
+    {
+        std::cerr << "ftserve did not start; See " << opts.dir
+                  << "/ftserve.log\n";
+        return (1);
+    }
+    std::cout << "ftserve on port " << port << " " << opts.serverOpts
+              << "\n";
+
+    std::string portText = std::to_string(port);
+    FtCo::Loop loop;
+    FtClient::Client client(loop, "127.0.0.1", portText.c_str(), TIMEOUT_MS);
+    std::vector<Case> cases;
+    bool ok = true;
+
+    Case c;
+    c.name = "l";
+    ok = runCase(loop, client, &c, NULL, NULL, 0, LIST_REPS, opts.clients);
+    cases.push_back(c);
+
+    c = Case();
+    c.name = "l glob=bench-*";
+    ok = ok && runCase(loop, client, &c, NULL, "glob=bench-*", 0, LIST_REPS,
+                       opts.clients);
+    cases.push_back(c);
+
+    for (std::size_t i = 0; ok && i < sizes.size(); i++)
+    {
+        long long reps = CASE_BYTES / std::max(sizes[i], 1LL);
+        reps = std::min(std::max(reps, (long long)MIN_REPS),
+                        (long long)MAX_REPS);
+        std::string file = "bench-" + labels[i];
+
+        c = Case();
+        c.name = "g " + labels[i];
+        ok = runCase(loop, client, &c, file.c_str(), NULL, sizes[i], reps,
+                     opts.clients);
+        cases.push_back(c);
+    }
+
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    if (scratch)
+    {
+        std::string cmd = "rm -rf '" + opts.dir + "'";
+        if (system(cmd.c_str()) != 0)
+        {
+            std::cerr << "Could not remove " << opts.dir << "\n";
+        }
+    }
+    if (!ok)
+    {
+        return (1);
+    }
+
+    bool haveBase = !base.empty();
+    int regressed = compare(cases, base, opts.threshold);
+
+    if (!writeResults(opts.out, cases))
+    {
+        perror("Results");
+        return (1);
+    }
+    std::cout << "Results in " << opts.out << "\n";
+
+    if (!haveBase)
+    {
+        std::cout << "No baseline to compare against\n";
+        return (0);
+    }
+    if (regressed > 0)
+    {
+        std::cout << regressed << " case(s) regressed more than "
+                  << opts.threshold << "% from " << opts.baseline << "\n";
+        return (1);
+    }
+    std::cout << "No case regressed more than " << opts.threshold
+              << "% from " << opts.baseline << "\n";
+    return (0);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: parseOptions()
+ *
+ *    Entry: The command line argument count and array
+ *
+ *     Exit: Returns a BenchOpts struct with the options entered or defaults
+ *
+ *  Purpose: Parse the option flag and value pairs
+ *
+ *
+ *   *   *   *   *   *   */
+BenchOpts parseOptions(int argc, char *argv[])
+{
+    BenchOpts opts;
+    opts.sizes = "1K,64K,1M,16M,256M,2G";
+    opts.out = "ftbench.json";
+    opts.server = "./ftserve";
+    opts.threshold = 20;
+    opts.clients = 1;
+    opts.names = 1000;
+
+    if (argc % 2 != 1)
+    {
+        printUsage(argv[0]);
+    }
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+
+        if (flag == "-sizes")
+        {
+            opts.sizes = value;
+        }
+        else if (flag == "-baseline")
+        {
+            opts.baseline = value;
+        }
+        else if (flag == "-out")
+        {
+            opts.out = value;
+        }
+        else if (flag == "-server")
+        {
+            opts.server = value;
+        }
+        else if (flag == "-serveropts")
+        {
+            opts.serverOpts = value;
+        }
+        else if (flag == "-dir")
+        {
+            opts.dir = value;
+        }
+        else if (flag == "-threshold")
+        {
+            opts.threshold = atof(value.c_str());
+        }
+        else if (flag == "-clients")
+        {
+            opts.clients = atoi(value.c_str());
+        }
+        else if (flag == "-names")
+        {
+            opts.names = atoi(value.c_str());
+        }
+        else
+        {
+            printUsage(argv[0]);
+        }
+    }
+
+    if (opts.threshold <= 0 || opts.clients < 1 || opts.names < 0)
+    {
+        printUsage(argv[0]);
+    }
+
+    return (opts);
+}
+
+void printUsage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " [-sizes list] [-clients n]"
+              << " [-names n] [-baseline path]\n"
+              << "       [-out path] [-threshold pct] [-server path]"
+              << " [-serveropts opts]\n"
+              << "       [-dir path]\n"
+              << "Example: " << prog << " -sizes 1K,1M,1G"
+              << " -baseline bench-baseline.json\n";
+    exit(1);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: parseSize()
+ *
+ *    Entry: A size of digits and an optional K, M, or G
+ *
+ *     Exit: Returns the size in bytes, or -1 if it is malformed
+ *
+ *  Purpose: Read the sizes of -sizes; The suffixes are powers of 1024
+ *
+ *
+ *   *   *   *   *   *   */
+long long parseSize(const std::string &text)
+{
+    char *end;
+    long long size = std::strtoll(text.c_str(), &end, 10);
+    if (end == text.c_str() || size < 0)
+    {
+        return (-1);
+    }
+
+    std::string suffix = end;
+    if (suffix == "K")
+    {
+        size *= 1024;
+    }
+    else if (suffix == "M")
+    {
+        size *= 1024 * 1024;
+    }
+    else if (suffix == "G")
+    {
+        size *= 1024 * 1024 * 1024LL;
+    }
+    else if (!suffix.empty())
+    {
+        return (-1);
+    }
+
+    return (size);
+}
+
+long long monoUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000LL + ts.tv_nsec / 1000);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: makeFile()
+ *
+ *    Entry: A path and a size in bytes
+ *
+ *     Exit: Returns true once the file holds size bytes
+ *
+ *  Purpose: Write a file of pseudo-random bytes; A file of the right size
+ *           from a kept directory is used as it is
+ *
+ *
+ *   *   *   *   *   *   */
+bool makeFile(const std::string &path, long long size)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && st.st_size == size)
+    {
+        return (true);
+    }
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+    if (fd == -1)
+    {
+        return (false);
+    }
+
+    std::vector<char> buf(WRITE_SIZE);
+    unsigned long long x = 88172645463325252ULL;
+    for (std::size_t i = 0; i < buf.size(); i++)
+    {
+        // xorshift64, so the data is not all one byte
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        buf[i] = static_cast<char>(x);
+    }
+
+    long long left = size;
+    while (left > 0)
+    {
+        ssize_t n = write(fd, buf.data(),
+                          std::min(left, (long long)WRITE_SIZE));
+        if (n == -1)
+        {
+            close(fd);
+            return (false);
+        }
+        left -= n;
+    }
+
+    return (close(fd) == 0);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: freePort()
+ *
+ *    Entry: None
+ *
+ *     Exit: Returns a free port on 127.0.0.1, or -1
+ *
+ *  Purpose: Let the kernel pick an ephemeral port for ftserve; The port is
+ *           released before ftserve binds it, which another program could
+ *           take in between, but not on a quiet test host
+ *
+ *
+ *   *   *   *   *   *   */
+int freePort()
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+    {
+        return (-1);
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof addr;
+    int port = -1;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof addr) == 0
+        && getsockname(fd, (struct sockaddr *)&addr, &len) == 0)
+    {
+        port = ntohs(addr.sin_port);
+    }
+    close(fd);
+
+    return (port);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: startServer()
+ *
+ *    Entry: The options, the directory to serve, and the port
+ *
+ *     Exit: Returns ftserve's pid once it accepts connections, or -1
+ *
+ *  Purpose: Run ftserve in the directory with its output in ftserve.log
+ *           there and its control socket beside it
+ *
+ *
+ *   *   *   *   *   *   */
+pid_t startServer(const BenchOpts &opts, const std::string &dir, int port)
+{
+    char *server = realpath(opts.server.c_str(), NULL);
+    if (server == NULL)
+    {
+        perror(opts.server.c_str());
+        return (-1);
+    }
+
+    std::vector<std::string> args;
+    args.push_back(server);
+    args.push_back(std::to_string(port));
+    args.push_back("-ctl");
+    args.push_back(dir + "/ctl.sock");
+    std::size_t start = 0;
+    while (start < opts.serverOpts.size())
+    {
+        std::size_t space = opts.serverOpts.find(' ', start);
+        if (space == std::string::npos)
+        {
+            space = opts.serverOpts.size();
+        }
+        if (space > start)
+        {
+            args.push_back(opts.serverOpts.substr(start, space - start));
+        }
+        start = space + 1;
+    }
+    free(server);
+
+    std::vector<char *> argv;
+    for (std::size_t i = 0; i < args.size(); i++)
+    {
+        argv.push_back(const_cast<char *>(args[i].c_str()));
+    }
+    argv.push_back(NULL);
+
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        return (-1);
+    }
+    if (pid == 0)
+    {
+        std::string log = dir + "/ftserve.log";
+        int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (chdir(dir.c_str()) == -1 || fd == -1)
+        {
+            _exit(127);
+        }
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    // Wait until a connection is accepted; The session it starts ends
+    // when the connection closes without a command
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    for (int waited = 0; waited < START_WAIT_MS; waited += 20)
+    {
+        if (waitpid(pid, NULL, WNOHANG) == pid)
+        {
+            return (-1);
+        }
+
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int rc = connect(fd, (struct sockaddr *)&addr, sizeof addr);
+        close(fd);
+        if (rc == 0)
+        {
+            return (pid);
+        }
+        usleep(20000);
+    }
+
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return (-1);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: runCase()
+ *
+ *    Entry: The event loop, the client, the case to fill, the file to get
+ *           or NULL for a listing, the listing's terms or NULL, the bytes
+ *           each get should return, the number of requests, and the
+ *           number in flight
+ *
+ *     Exit: Returns true with the case filled if every request succeeded
+ *
+ *  Purpose: Time one case from its first request to its last reply
+ *
+ *
+ *   *   *   *   *   *   */
+bool runCase(FtCo::Loop &loop, FtClient::Client &client, Case *c,
+             const char *file, const char *terms, long long expect,
+             long long reps, int clients)
+{
+    std::cout << "Running " << c->name << " x " << reps << "\n";
+    std::cout.flush();
+
+    Work work;
+    work.client = &client;
+    work.file = file;
+    work.terms = terms;
+    work.expect = expect;
+    work.left = reps;
+    // File data is thrown away so only the transfer is measured
+    work.outFd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    work.ok = (work.outFd != -1);
+    work.result = c;
+    c->requests = 0;
+    c->bytes = 0;
+
+    long long startUs = monoUs();
+    for (int i = 0; i < clients; i++)
+    {
+        loop.spawn(worker(&work));
+    }
+    while (loop.getTasks() > 0)
+    {
+        loop.runOnce();
+    }
+    c->secs = (monoUs() - startUs) / 1000000.0;
+    close(work.outFd);
+
+    summarize(c);
+    return (work.ok);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: worker()
+ *
+ *    Entry: The shared work of a case
+ *
+ *     Exit: Returns once no requests are left or one failed
+ *
+ *  Purpose: Make and time requests; A get must return the whole file
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> worker(Work *work)
+{
+    std::vector<std::string> names;
+
+    while (work->ok && work->left > 0)
+    {
+        work->left--;
+        long long startUs = monoUs();
+        FtClient::Result result;
+        long long bytes = 0;
+
+        if (work->file == NULL)
+        {
+            names.clear();
+            result = co_await work->client->list(&names, work->terms);
+            for (std::size_t i = 0; i < names.size(); i++)
+            {
+                bytes += names[i].size();
+            }
+        }
+        else
+        {
+            result = co_await work->client->get(work->file, work->outFd);
+            bytes = result.bytes;
+        }
+
+        if (result.status != FtClient::FT_OK
+            || (work->file != NULL && bytes != work->expect))
+        {
+            std::cerr << work->result->name << " failed: "
+                      << (result.status == FtClient::FT_OK
+                          ? "short transfer" : strerror(result.err)) << "\n";
+            work->ok = false;
+            co_return;
+        }
+
+        work->result->latMs.push_back((monoUs() - startUs) / 1000.0);
+        work->result->requests++;
+        work->result->bytes += bytes;
+    }
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: summarize()
+ *
+ *    Entry: A case with its requests run
+ *
+ *     Exit: The rates and percentiles are set
+ *
+ *  Purpose: Rates are over the whole case, so requests in flight together
+ *           count once; Percentiles are the nearest rank. MB is 10^6 bytes
+ *
+ *
+ *   *   *   *   *   *   */
+void summarize(Case *c)
+{
+    std::vector<double> lat = c->latMs;
+    std::sort(lat.begin(), lat.end());
+    double secs = std::max(c->secs, 1e-9);
+
+    c->mbPerSec = c->bytes / 1e6 / secs;
+    c->reqPerSec = c->requests / secs;
+    c->p50Ms = c->p90Ms = c->p99Ms = c->maxMs = 0;
+    if (lat.empty())
+    {
+        return;
+    }
+
+    std::size_t n = lat.size();
+    c->p50Ms = lat[std::max(std::ceil(0.50 * n), 1.0) - 1];
+    c->p90Ms = lat[std::max(std::ceil(0.90 * n), 1.0) - 1];
+    c->p99Ms = lat[std::max(std::ceil(0.99 * n), 1.0) - 1];
+    c->maxMs = lat[n - 1];
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: writeResults()
+ *
+ *    Entry: The results path and the cases
+ *
+ *     Exit: Returns true once the file is written
+ *
+ *  Purpose: Write one case per line, which readResults() relies on
+ *
+ *
+ *   *   *   *   *   *   */
+bool writeResults(const std::string &path, const std::vector<Case> &cases)
+{
+    FILE *fp = fopen(path.c_str(), "w");
+    if (fp == NULL)
+    {
+        return (false);
+    }
+
+    fprintf(fp, "{\"cases\": [\n");
+    for (std::size_t i = 0; i < cases.size(); i++)
+    {
+        const Case &c = cases[i];
+        fprintf(fp, "{\"name\": \"%s\", \"requests\": %lld, \"bytes\": %lld, "
+                "\"secs\": %.6f, \"mb_s\": %.3f, \"req_s\": %.3f, "
+                "\"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, "
+                "\"max_ms\": %.3f}%s\n", c.name.c_str(), c.requests,
+                c.bytes, c.secs, c.mbPerSec, c.reqPerSec, c.p50Ms, c.p90Ms,
+                c.p99Ms, c.maxMs, i + 1 < cases.size() ? "," : "");
+    }
+    fprintf(fp, "]}\n");
+
+    return (fclose(fp) == 0);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: readResults()
+ *
+ *    Entry: A results path and the list to fill
+ *
+ *     Exit: Returns true with the cases of the file appended, or false if
+ *           it cannot be opened or holds no case
+ *
+ *  Purpose: Read a file from writeResults(); Only the name and the compared
+ *           fields are read
+ *
+ *
+ *   *   *   *   *   *   */
+bool readResults(const std::string &path, std::vector<Case> *cases)
+{
+    FILE *fp = fopen(path.c_str(), "r");
+    if (fp == NULL)
+    {
+        return (false);
+    }
+
+    char line[MAX_LINE];
+    bool found = false;
+    const char *keys[] = {"\"mb_s\": ", "\"req_s\": ", "\"p50_ms\": ",
+                          "\"p99_ms\": "};
+    while (fgets(line, sizeof line, fp) != NULL)
+    {
+        const char *name = strstr(line, "\"name\": \"");
+        if (name == NULL)
+        {
+            continue;
+        }
+        name += strlen("\"name\": \"");
+        const char *nameEnd = strchr(name, '"');
+        if (nameEnd == NULL)
+        {
+            continue;
+        }
+
+        Case c;
+        c.name.assign(name, nameEnd - name);
+        double *fields[] = {&c.mbPerSec, &c.reqPerSec, &c.p50Ms, &c.p99Ms};
+        for (int i = 0; i < 4; i++)
+        {
+            const char *at = strstr(line, keys[i]);
+            *fields[i] = (at != NULL ? atof(at + strlen(keys[i])) : 0);
+        }
+        cases->push_back(c);
+        found = true;
+    }
+    fclose(fp);
+
+    return (found);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: compare()
+ *
+ *    Entry: This run's cases, the baseline's, and the threshold in percent
+ *
+ *     Exit: Prints a table and returns the number of regressed cases
+ *
+ *  Purpose: A case regresses if its requests/s, which for a get is its
+ *           MB/s over the file size, or its median latency is worse than
+ *           the baseline's by more than the threshold. The 99th percentile
+ *           is shown but not judged, since a few slow requests move it
+ *
+ *
+ *   *   *   *   *   *   */
+int compare(const std::vector<Case> &cases, const std::vector<Case> &base,
+            double threshold)
+{
+    int regressed = 0;
+    double slack = threshold / 100;
+
+    printf("%-16s %10s %10s %9s %9s %9s  %s\n", "case", "MB/s", "req/s",
+           "p50 ms", "p90 ms", "p99 ms", "vs baseline");
+    for (std::size_t i = 0; i < cases.size(); i++)
+    {
+        const Case &c = cases[i];
+        printf("%-16s %10.2f %10.2f %9.3f %9.3f %9.3f  ", c.name.c_str(),
+               c.mbPerSec, c.reqPerSec, c.p50Ms, c.p90Ms, c.p99Ms);
+
+        const Case *b = NULL;
+        for (std::size_t j = 0; j < base.size(); j++)
+        {
+            if (base[j].name == c.name)
+            {
+                b = &base[j];
+            }
+        }
+        if (b == NULL || b->reqPerSec <= 0)
+        {
+            printf("%s\n", base.empty() ? "" : "new");
+            continue;
+        }
+
+        double rate = (c.reqPerSec / b->reqPerSec - 1) * 100;
+        double median = (b->p50Ms > 0 ? (c.p50Ms / b->p50Ms - 1) * 100 : 0);
+        bool slow = (c.reqPerSec < b->reqPerSec * (1 - slack)
+                     || c.p50Ms > b->p50Ms * (1 + slack));
+        printf("rate %+.1f%%, p50 %+.1f%%%s\n", rate, median,
+               slow ? "  REGRESSED" : "");
+        if (slow)
+        {
+            regressed++;
+        }
+    }
+    fflush(stdout);
+
+    return (regressed);
+}
@@ -0,0 +1,221 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftchunk.cpp
+ *           Overview: This is the implementation file for the ftserve chunk
+ *                     sizer
+ *
+ *                     The sizer climbs the goodput: after each window it
+ *                     steps the size in the same direction while the goodput
+ *                     rises and turns around when it falls. A smoothed RTT
+ *                     well above the lowest one seen always shrinks the
+ *                     chunks, since a larger chunk would only wait longer
+ *                     in the queue
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <ctime>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "ftchunk.h"
+
+namespace FtChunk
+{
+    const int       WINDOW_CHUNKS = 4; // Fewest chunks per window
+    const long long WINDOW_NS     = 20000000; // Shortest window
+    const double    STEP          = 1.5; // Size change per step
+    const double    GAIN          = 0.05; // Goodput change that counts
+    const double    RTT_RISE      = 2.0; // RTT over the lowest that shrinks
+    const unsigned  RTT_FLOOR_US  = 1000; // Ignore smaller RTT rises
+
+    // Size of every transfer, or 0 to adapt; Set before the fork
+    static int fixedChunk = 0;
+
+    /*
+     * Helpers local to this file
+     */
+    static long long monoNs();
+
+    void initChunks(int fixedSize)
+    {
+        fixedChunk = fixedSize;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: Sizer()
+     *
+     *    Entry: None
+     *
+     *     Exit: Initializes the sizer at START_CHUNK or the fixed size
+     *
+     *  Purpose: Start a transfer at the size ftserve always used
+     *
+     *
+     *   *   *   *   *   *   */
+    Sizer::Sizer()
+        : size(START_CHUNK), resizes(0), direction(1), chunks(0), bytes(0),
+          windowNs(0), lastRate(0), minRtt(0), fixed(fixedChunk != 0)
+    {
+        if (fixed)
+        {
+            size = fixedChunk;
+        }
+        minSize = size;
+        maxSize = size;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: sent()
+     *
+     *    Entry: The data socket and the bytes of the chunk just acked
+     *
+     *     Exit: The chunk is counted in the window, and the window is
+     *           judged once it is long enough
+     *
+     *  Purpose: Measure goodput from the first ack of a window to the last
+     *
+     *
+     *   *   *   *   *   *   */
+    void Sizer::sent(int sock, int bytesInput)
+    {
+        if (fixed)
+        {
+            return;
+        }
+
+        long long now = monoNs();
+        if (windowNs == 0)
+        {
+            // The first ack starts the clock; Its chunk is not counted
+            windowNs = now;
+            return;
+        }
+
+        chunks++;
+        bytes += bytesInput;
+        if (chunks < WINDOW_CHUNKS || now - windowNs < WINDOW_NS)
+        {
+            return;
+        }
+
+        adapt(sock, bytes * 1e9 / (now - windowNs));
+        chunks = 0;
+        bytes = 0;
+        windowNs = now;
+    }
+
+    int Sizer::getMin()
+    {
+        return (minSize);
+    }
+
+    int Sizer::getMax()
+    {
+        return (maxSize);
+    }
+
+    int Sizer::getResizes()
+    {
+        return (resizes);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: adapt()
+     *
+     *    Entry: The data socket and the goodput of the last window in
+     *           bytes per second
+     *
+     *     Exit: The size may be changed for the next window
+     *
+     *  Purpose: Shrink on a rising RTT, otherwise climb the goodput
+     *
+     *
+     *   *   *   *   *   *   */
+    void Sizer::adapt(int sock, double rate)
+    {
+        struct tcp_info info;
+        socklen_t len = sizeof info;
+        unsigned rtt = 0;
+
+        if (getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &len) == 0)
+        {
+            rtt = info.tcpi_rtt;
+            if (minRtt == 0 || rtt < minRtt)
+            {
+                minRtt = rtt;
+            }
+        }
+
+        if (rtt > minRtt * RTT_RISE && rtt > minRtt + RTT_FLOOR_US)
+        {
+            direction = -1;
+            resize(size / STEP);
+        }
+        else if (lastRate == 0 || rate > lastRate * (1 + GAIN))
+        {
+            // Keep going the way that helped
+            resize(direction > 0 ? size * STEP : size / STEP);
+        }
+        else if (rate < lastRate * (1 - GAIN))
+        {
+            direction = -direction;
+            resize(direction > 0 ? size * STEP : size / STEP);
+        }
+
+        lastRate = rate;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: resize()
+     *
+     *    Entry: The new size
+     *
+     *     Exit: The size is set within MIN_CHUNK and MAX_CHUNK
+     *
+     *  Purpose: Change the size and keep its statistics
+     *
+     *
+     *   *   *   *   *   *   */
+    void Sizer::resize(int newSize)
+    {
+        if (newSize < MIN_CHUNK)
+        {
+            newSize = MIN_CHUNK;
+        }
+        if (newSize > MAX_CHUNK)
+        {
+            newSize = MAX_CHUNK;
+        }
+        if (newSize == size)
+        {
+            return;
+        }
+
+        size = newSize;
+        resizes++;
+        if (size < minSize)
+        {
+            minSize = size;
+        }
+        if (size > maxSize)
+        {
+            maxSize = size;
+        }
+    }
+
+    static long long monoNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec * 1000000000LL + ts.tv_nsec);
+    }
+} // FtChunk
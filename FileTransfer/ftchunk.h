@@ -0,0 +1,75 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftchunk.h
+ *           Overview: This is the header file for the ftserve chunk sizer.
+ *                     Every chunk of a transfer waits for the client's ack,
+ *                     so a session sends one chunk per round trip and the
+ *                     chunk size sets its throughput. A Sizer measures the
+ *                     goodput of each window of chunks and reads the data
+ *                     socket's smoothed RTT from TCP_INFO; It grows the
+ *                     chunks while the goodput improves and shrinks them
+ *                     when the RTT climbs above the best seen, which means
+ *                     the chunks are queueing on the way to the client
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTCHUNK_H
+#define FTCHUNK_H
+
+namespace FtChunk
+{
+    const int MIN_CHUNK   = 1024; // Smallest chunk
+    const int MAX_CHUNK   = 9999; // Largest count a 4 character header holds
+    const int START_CHUNK = 4092; // First chunk of each transfer
+
+    /*
+     * The initChunks() function sets a fixed chunk size for every transfer,
+     * or 0 to size them adaptively; It must be called before any fork()
+     */
+    void initChunks(int fixedSize);
+
+    /*
+     * Class for the chunk size of one transfer
+     */
+    class Sizer
+    {
+    public:
+        Sizer();
+
+        int getSize()
+        {
+            return (size);
+        }
+
+        void sent(int sock, int bytes);
+        /*
+         * Records a chunk of bytes acked by the client on the data socket
+         * sock and may change the size of the next one
+         */
+
+        int getMin();
+        int getMax();
+        int getResizes();
+    private:
+        int       size;
+        int       minSize;
+        int       maxSize;
+        int       resizes;
+        int       direction;
+        int       chunks;
+        long long bytes;
+        long long windowNs;
+        double    lastRate;
+        unsigned  minRtt;
+        bool      fixed;
+
+        void adapt(int sock, double rate);
+        void resize(int newSize);
+    };
+} // FtChunk
+#endif // FTCHUNK_H
@@ -3,7 +3,7 @@
 #
 #             Author: Michael Marven
 #       Date Created: 03/04/16
-# Last Date Modified: 03/08/16
+# Last Date Modified: 10/19/26
 #          File Name: ftclient.py
 #           Overview: The program partially satisfies the requirements for 
 #                     Project 2. This is the client program for the project
@@ -11,10 +11,16 @@
 #                     ftclient.py must be made an executable for all users 
 #                     with chmod a+x ftclient.py
 #
-#                     Usage: ./ftclient serv_hostname serv_port# -g | -l [file] data_port#
+#                     Usage: ./ftclient serv_hostname serv_port# -g | -c | -s | -l [file] data_port#
+#                                       [-f terms]
 #
 #                     Commands: -g - Get file, must be used with file name
-#                               -l - List directory contents
+#                               -c - Get file only if it differs from the
+#                                    local copy, which it then replaces
+#                               -s - Get file, keeping its holes sparse
+#                               -l - List directory contents; -f gives
+#                                    filter terms such as "glob=*.log" or
+#                                    "limit=100 after=name" for the server
 #
 #                     This program is adapted from program my submission for 
 #                     Project 1, from examples provided at
@@ -39,6 +45,8 @@ import sys
 import argparse
 import time
 import io
+import os
+import hashlib
 from os import walk
 
 
@@ -88,12 +96,45 @@ def makeRequest():
     # If -g flag was not present, args.g == None
     if args.g == None and args.l == 'l':
         msgTrans = args.l + " " + str(args.d_port)
+        if args.f != None:
+            msgTrans += " " + args.f
+    elif args.c != None:
+        msgTrans = "c " + str(args.d_port) + " " + args.c + " " + localHash(args.c)
+    elif args.s != None:
+        msgTrans = "s " + str(args.d_port) + " " + args.s
     else:
         msgTrans = "g " + str(args.d_port) + " " + args.g
 
     # Send control message 
     sock.send(msgTrans + '\n')
     
+#   #   #   #   #   #   #   #
+#
+# Function: localHash()
+#
+#    Entry: The name of a local file
+#
+#     Exit: Returns the SHA-256 of the file in hex, or "-" if there is none
+#
+#  Purpose: Fingerprint the local copy for a conditional get
+#
+#
+#   #   #   #   #   #   #   #
+
+def localHash(name):
+    
+    if not os.path.isfile(name):
+        return "-"
+    
+    sha = hashlib.sha256()
+    with io.open(name, 'rb') as f:
+        while 1:
+            block = f.read(65536)
+            if block == '':
+                break
+            sha.update(block)
+    return sha.hexdigest()
+    
 #   #   #   #   #   #   #   #
 #
 # Function: receiveFile()
@@ -122,6 +163,7 @@ def receiveFile():
     # Enter loop to receive data
     if args.g == None and args.l == 'l': # Receive directory
         print "Receiving directory\nstructure from\n" + args.host + ":" + str(args.d_port) + "\n"
+        last = None
         while 1:
             # Accept connection from server
             (clientsocket, address) = serversocket.accept()
@@ -132,39 +174,59 @@ def receiveFile():
                 if dir == '':
                     break
                 print dir
+                last = dir
                 
                 # Send ready acknowledgement to server
                 sock.send(ok + '\n')
             break
 
+        # A page cut short continues after its last name
+        if more and last != None:
+            print "More names follow; list again with after=" + last
+        
         # Close the socket
         clientsocket.close()
         serversocket.close()
         sock.close()
     elif args.l == None: # Receive requested file
     
-        # Check for file name in current directory and handle
-        f = []
-        for (dirpath, dirnames, filenames) in walk('./'):
-            f.extend(filenames)
-            break
-        if args.g in f:
-            print ("File name exists in current directory.\n"
-                   "Please choose another file name.\n"
-                  )
-            serversocket.close()
-            sock.close()
-            sys.exit(0)
+        # A conditional get replaces the local copy once it is complete
+        if args.c != None:
+            name = args.c
+            fileName = args.c + ".ftpart"
+            file = io.open(fileName, 'wb')
+        else:
+            if args.s != None:
+                args.g = args.s
+            name = args.g
+            fileName = args.g
             
-        # Open file for writing in append and text mode
-        file = io.open(args.g, 'ab')
+            # Check for file name in current directory and handle
+            f = []
+            for (dirpath, dirnames, filenames) in walk('./'):
+                f.extend(filenames)
+                break
+            if args.g in f:
+                print ("File name exists in current directory.\n"
+                       "Please choose another file name.\n"
+                      )
+                serversocket.close()
+                sock.close()
+                sys.exit(0)
+                
+            # Open file for writing in append and text mode; A sparse get
+            # seeks over holes, which append mode would not allow
+            if args.s != None:
+                file = io.open(args.g, 'wb')
+            else:
+                file = io.open(args.g, 'ab')
         
         # Number of characters read is prepended to the beginning of the 
         # outgoing message and sent to client. Client reads the number, 
         # then receives the message. If the total number of characters
         # received does not match, client will continue to recv()
         
-        print "Receiving \"" + args.g + "\"\nfrom " + args.host + ":" + str(args.d_port) + "\n"
+        print "Receiving \"" + name + "\"\nfrom " + args.host + ":" + str(args.d_port) + "\n"
         while 1:
             # Accept connection from server
             (clientsocket, address) = serversocket.accept()
@@ -174,6 +236,20 @@ def receiveFile():
                 # Receive the packet size - 4 characters long
                 raw_msgLen = clientsocket.recv(HEADER_LENGTH)
                 
+                # A hole record carries the hole's length instead of data
+                if raw_msgLen == HOLE_TAG:
+                    raw_holeLen = ''
+                    while len(raw_holeLen) < HOLE_LEN_LENGTH:
+                        chunk = clientsocket.recv(HOLE_LEN_LENGTH - len(raw_holeLen))
+                        if chunk == '':
+                            break
+                        raw_holeLen += chunk
+                    if chunk == '':
+                        break
+                    file.seek(int(raw_holeLen), io.SEEK_CUR)
+                    sock.send(ok + '\n')
+                    continue
+                
                 # Declare a string for the data to be written
                 data = ''
                 if raw_msgLen != '':
@@ -206,14 +282,20 @@ def receiveFile():
         serversocket.close()
         sock.close()
         
-        # Close the file
+        # Close the file; A file ending in a hole is extended to its size
+        if args.s != None:
+            file.truncate()
         file.close()
+        if args.c != None:
+            os.rename(fileName, name)
     
 MAX_HANDLE_CHAR = 10
 MAX_OUT_MSG_LEN = 512
 MAX_MSG_LENGTH  = 512
 MAX_FILE_CHUNK = 4092
 HEADER_LENGTH = 4
+HOLE_TAG = 'HOLE'
+HOLE_LEN_LENGTH = 20
 
 if __name__ == "__main__":
 
@@ -224,8 +306,14 @@ if __name__ == "__main__":
     group = parser.add_mutually_exclusive_group(required=True)
     group.add_argument("-g", nargs='?', type=str, metavar="FILE",
                         help='get file command')
+    group.add_argument("-c", nargs='?', type=str, metavar="FILE",
+                        help='get file if changed command')
+    group.add_argument("-s", nargs='?', type=str, metavar="FILE",
+                        help='get sparse file command')
     group.add_argument("-l", action='store_const', const='l', 
                        help='list directory command')
+    parser.add_argument("-f", type=str, metavar="TERMS",
+                        help='filter terms for -l, such as "glob=*.log"')
     parser.add_argument('d_port', type=int, help='data_port#')
     args = parser.parse_args()
     
@@ -246,6 +334,7 @@ if __name__ == "__main__":
     
     # Declare potential messages to receive from server
     error = 'FILE NOT FOUND'
+    notModified = 'NOT MODIFIED'
     ok = 'ready'
     
     # Receive control message on the control port
@@ -255,8 +344,15 @@ if __name__ == "__main__":
     if error in recMsg:
         print args.host + ":" + str(args.c_port) + " says\n" + recMsg
         sock.close()
+    elif notModified in recMsg:
+        print "\"" + args.c + "\" is up to date"
+        sock.close()
     elif ok in recMsg:
-        # Server is ready to transmit
+        # Server is ready to transmit; A conditional get may carry the hash
+        fields = recMsg.strip('\0\n').split()
+        more = (args.l == 'l' and fields[1:] == ['more'])
+        if len(fields) > 1 and not more:
+            print "Server hash " + fields[1]
         receiveFile()
     
     # Exit the program
@@ -0,0 +1,1102 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftclientlib.cpp
+ *           Overview: This is the implementation file for the ftserve client
+ *                     library
+ *
+ *                     A request follows the same steps as ftclient: send
+ *                     the command with a data port, read the server's
+ *                     answer, send "ready", accept the server's data
+ *                     connection, and ack each chunk or name on the control
+ *                     connection. Each chunk is received whole into one
+ *                     buffer, since the server sends no more until the ack.
+ *                     A UDP get instead receives datagrams on a UDP socket
+ *                     and sends the server "nack" lines for the packets it
+ *                     is missing. A local request sends the command on the
+ *                     Unix socket and copies from the descriptor passed back
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <charconv>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include "ftclientlib.h"
+#include "ftunix.h"
+
+namespace FtClient
+{
+    const int MAX_MSG      = 512; // Largest control message
+    const int MAX_CHUNK    = 9999; // Largest count the header can hold
+    const int HEADER_SIZE  = 4; // Size of the byte count before each chunk
+    const int HOLE_SIZE    = 24; // Size of a hole record
+    const char HOLE_TAG[]  = "HOLE"; // Header of a hole record
+    const char ERR_MSG[]   = "FILE NOT FOUND";
+    const char NOT_MOD[]   = "NOT MODIFIED";
+    const char OK_MSG[]    = "ready";
+    const char ACK_MSG[]   = "ready\n";
+    const char DONE_MSG[]  = "done\n";
+    const int NACK_MS      = 10; // Interval between reports of new gaps
+    const int UDP_IDLE_MS  = 50; // Quiet time before all gaps are reported
+    const int COPY_SIZE    = 65536; // Buffer of a local copy done in user space
+
+    /*
+     * Helpers local to this file
+     */
+    static bool startsWith(const char *msg, int len, const char *word);
+    static bool writeAll(int fd, const char *buf, int len, long long off);
+    static bool punchHole(int fd, long long off, long long len);
+    static long long copyRange(int inFd, long long inOff, int outFd,
+                               long long outOff, long long len);
+    static Result failed(Result result, int err);
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: Client()
+     *
+     *    Entry: The event loop, the server's host name and port, and the
+     *           deadline of each wait in milliseconds
+     *
+     *     Exit: Initializes the client; A failed lookup is reported by the
+     *           first request
+     *
+     *  Purpose: Resolve the server once for all requests
+     *
+     *
+     *   *   *   *   *   *   */
+    Client::Client(FtCo::Loop &loopInput, const char *host, const char *port,
+                   long long timeoutMsInput)
+        : loop(loopInput), servLen(0), resolveErr(0),
+          timeoutMs(timeoutMsInput), local(false)
+    {
+        struct addrinfo hints, *servinfo;
+
+        memset(&servAddr, 0, sizeof servAddr);
+        memset(&hints, 0, sizeof hints);
+        hints.ai_family = AF_INET; // ftserve connects back over IPv4
+        hints.ai_socktype = SOCK_STREAM;
+
+        if (getaddrinfo(host, port, &hints, &servinfo) != 0)
+        {
+            resolveErr = EHOSTUNREACH;
+            return;
+        }
+        memcpy(&servAddr, servinfo->ai_addr, servinfo->ai_addrlen);
+        servLen = servinfo->ai_addrlen;
+        freeaddrinfo(servinfo);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: Client()
+     *
+     *    Entry: The event loop, the path of the server's -local socket, and
+     *           the deadline of each wait in milliseconds
+     *
+     *     Exit: Initializes the client; A path too long for a Unix socket
+     *           is reported by the first request
+     *
+     *  Purpose: Make requests on the same host without TCP
+     *
+     *
+     *   *   *   *   *   *   */
+    Client::Client(FtCo::Loop &loopInput, const char *localPath,
+                   long long timeoutMsInput)
+        : loop(loopInput), servLen(0), resolveErr(0),
+          timeoutMs(timeoutMsInput), local(true)
+    {
+        struct sockaddr_un addr;
+
+        memset(&servAddr, 0, sizeof servAddr);
+        memset(&addr, 0, sizeof addr);
+        addr.sun_family = AF_UNIX;
+        if (strlen(localPath) >= sizeof addr.sun_path)
+        {
+            resolveErr = ENAMETOOLONG;
+            return;
+        }
+        strcpy(addr.sun_path, localPath);
+        memcpy(&servAddr, &addr, sizeof addr);
+        servLen = sizeof addr;
+    }
+
+    Client::~Client()
+    {
+        for (std::size_t i = 0; i < idle.size(); i++)
+        {
+            close(idle[i]);
+        }
+    }
+
+    FtCo::Task<Result> Client::list(std::vector<std::string> *names,
+                                    const char *filter)
+    {
+        Result result;
+        if (local)
+        {
+            result = co_await localRequest("l", filter, 0, 0, -1, 0, names);
+        }
+        else
+        {
+            result = co_await request("l", NULL, filter, -1, 0, names);
+        }
+        co_return (result);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: get()
+     *
+     *    Entry: The file name, the descriptor to write it to, and the hash
+     *           of the local copy or NULL
+     *
+     *     Exit: Returns the result of the request
+     *
+     *  Purpose: Send "g", or "c" when the caller has a hash; The local
+     *           socket has no conditional get
+     *
+     *
+     *   *   *   *   *   *   */
+    FtCo::Task<Result> Client::get(const char *file, int outFd,
+                                   const char *hash)
+    {
+        Result result;
+        memset(&result, 0, sizeof result);
+        if (local && hash != NULL)
+        {
+            result = failed(result, EOPNOTSUPP);
+        }
+        else if (local)
+        {
+            result = co_await localRequest("g", file, 0, -1, outFd, 0, NULL);
+        }
+        else
+        {
+            const char *command = (hash != NULL ? "c" : "g");
+            result = co_await request(command, file, hash, outFd, 0, NULL);
+        }
+        co_return (result);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: getRange()
+     *
+     *    Entry: The file name, the offset and length to fetch, and the
+     *           descriptor and offset to write them to
+     *
+     *     Exit: Returns the result of the request
+     *
+     *  Purpose: Send "r"; Ranges of one file can be fetched concurrently
+     *           into the same descriptor, and a local client copies the
+     *           range from the whole file's descriptor
+     *
+     *
+     *   *   *   *   *   *   */
+    FtCo::Task<Result> Client::getRange(const char *file, long long offset,
+                                        long long length, int outFd,
+                                        long long outOff)
+    {
+        if (local)
+        {
+            Result result = co_await localRequest("g", file, offset, length,
+                                                  outFd, outOff, NULL);
+            co_return (result);
+        }
+
+        char tail[48];
+        std::to_chars_result r = std::to_chars(tail, tail + 20, offset);
+        *r.ptr++ = ' ';
+        r = std::to_chars(r.ptr, tail + sizeof tail - 1, length);
+        *r.ptr = '\0';
+
+        Result result = co_await request("r", file, tail, outFd, outOff, NULL);
+        co_return (result);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: getSparse()
+     *
+     *    Entry: The file name and the descriptor to write it to
+     *
+     *     Exit: Returns the result of the request
+     *
+     *  Purpose: Send "s"; The server sends each hole as a record, and a
+     *           file that ends in a hole is extended to its full size
+     *
+     *
+     *   *   *   *   *   *   */
+    FtCo::Task<Result> Client::getSparse(const char *file, int outFd)
+    {
+        Result result;
+        memset(&result, 0, sizeof result);
+        if (local)
+        {
+            co_return (failed(result, EOPNOTSUPP));
+        }
+
+        result = co_await request("s", file, NULL, outFd, 0, NULL);
+        struct stat st;
+        if (result.status == FT_OK && fstat(outFd, &st) == 0
+            && st.st_size < result.bytes
+            && ftruncate(outFd, result.bytes) == -1)
+        {
+            result = failed(result, errno);
+        }
+        co_return (result);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: getUdp()
+     *
+     *    Entry: The file name, the descriptor to write it to, and the shim
+     *           or NULL
+     *
+     *     Exit: Returns the result of the request
+     *
+     *  Purpose: Send "u" with the port of a new UDP socket; The control
+     *           connection carries the answer, the "nack" lines, and "done"
+     *
+     *
+     *   *   *   *   *   *   */
+    FtCo::Task<Result> Client::getUdp(const char *file, int outFd,
+                                      const FtUdp::Shim *shim)
+    {
+        Result result;
+        memset(&result, 0, sizeof result);
+        if (local)
+        {
+            co_return (failed(result, EOPNOTSUPP));
+        }
+
+        int ctlFd = co_await openControl();
+        int port = 0;
+        int udpFd = -1;
+        if (ctlFd != -1)
+        {
+            udpFd = openUdp(ctlFd, &port);
+        }
+        if (udpFd == -1)
+        {
+            result = failed(result, errno);
+            if (ctlFd != -1)
+            {
+                close(ctlFd);
+            }
+            co_return (result);
+        }
+
+        result = co_await sendCommand(ctlFd, "u", port, file, NULL);
+        if (result.status == FT_OK)
+        {
+            long sent = co_await FtCo::SendOp(loop, ctlFd, ACK_MSG,
+                                              sizeof ACK_MSG - 1, 0,
+                                              timeoutMs);
+            if (sent == -1)
+            {
+                result = failed(result, errno);
+            }
+        }
+        if (result.status == FT_OK)
+        {
+            FtUdp::Shim none = {0, 0};
+            result = co_await receiveUdp(ctlFd, udpFd, outFd,
+                                         shim != NULL ? *shim : none);
+        }
+
+        close(udpFd);
+        close(ctlFd);
+        co_return (result);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: request()
+     *
+     *    Entry: The command, its file and trailing arguments or NULL, the
+     *           descriptor and offset for file data, and the list for names
+     *
+     *     Exit: Returns the result of the request
+     *
+     *  Purpose: Run one request from connect to the server's close of the
+     *           data connection; The listener is kept for the next request
+     *           unless the request failed part way
+     *
+     *
+     *   *   *   *   *   *   */
+    FtCo::Task<Result> Client::request(const char *command, const char *file,
+                                       const char *tail, int outFd,
+                                       long long outOff,
+                                       std::vector<std::string> *names)
+    {
+        Result result;
+        memset(&result, 0, sizeof result);
+
+        int ctlFd = co_await openControl();
+        int port = 0;
+        int listenFd = -1;
+        if (ctlFd != -1)
+        {
+            listenFd = takeListener(ctlFd, &port);
+        }
+        if (listenFd == -1)
+        {
+            result = failed(result, errno);
+            if (ctlFd != -1)
+            {
+                close(ctlFd);
+            }
+            co_return (result);
+        }
+
+        result = co_await sendCommand(ctlFd, command, port, file, tail);
+        if (result.status != FT_OK)
+        {
+            idle.push_back(listenFd);
+            close(ctlFd);
+            co_return (result);
+        }
+
+        int dataFd = -1;
+        long sent = co_await FtCo::SendOp(loop, ctlFd, ACK_MSG,
+                                          sizeof ACK_MSG - 1, 0, timeoutMs);
+        if (sent != -1)
+        {
+            dataFd = co_await FtCo::AcceptOp(loop, listenFd, NULL, NULL);
+        }
+        if (dataFd == -1)
+        {
+            result = failed(result, errno);
+            close(listenFd);
+            close(ctlFd);
+            co_return (result);
+        }
+
+        // Each chunk or name is acked before the server sends the next
+        char pack[HEADER_SIZE + MAX_CHUNK];
+        int have = 0;
+        while (1)
+        {
+            long n = co_await FtCo::RecvOp(loop, dataFd, pack + have,
+                                           sizeof pack - have, timeoutMs);
+            if (n == -1 || (n == 0 && have > 0))
+            {
+                result = failed(result, (n == 0 ? EPROTO : errno));
+                break;
+            }
+            if (n == 0)
+            {
+                break;
+            }
+            have += n;
+
+            if (names != NULL)
+            {
+                names->push_back(std::string(pack, have));
+                result.bytes++;
+            }
+            else
+            {
+                // Header is the byte count padded with spaces
+                int len = 0;
+                if (have < HEADER_SIZE)
+                {
+                    continue;
+                }
+                const char *digits = pack;
+                const char *digitsEnd = pack + HEADER_SIZE;
+                bool hole = (memcmp(pack, HOLE_TAG, HEADER_SIZE) == 0);
+                if (hole)
+                {
+                    // The hole's length follows the tag
+                    if (have < HOLE_SIZE)
+                    {
+                        continue;
+                    }
+                    digits += HEADER_SIZE;
+                    digitsEnd = pack + HOLE_SIZE;
+                }
+                while (digits < digitsEnd && *digits == ' ')
+                {
+                    digits++;
+                }
+
+                if (hole)
+                {
+                    long long holeLen = 0;
+                    std::from_chars(digits, digitsEnd, holeLen);
+                    if (holeLen <= 0 || have > HOLE_SIZE)
+                    {
+                        result = failed(result, EPROTO);
+                        break;
+                    }
+                    if (!punchHole(outFd, outOff + result.bytes, holeLen))
+                    {
+                        result = failed(result, errno);
+                        break;
+                    }
+                    result.bytes += holeLen;
+                    have = 0;
+                    sent = co_await FtCo::SendOp(loop, ctlFd, ACK_MSG,
+                                                 sizeof ACK_MSG - 1, 0,
+                                                 timeoutMs);
+                    if (sent == -1)
+                    {
+                        result = failed(result, errno);
+                        break;
+                    }
+                    continue;
+                }
+                std::from_chars(digits, digitsEnd, len);
+                if (len <= 0 || len > MAX_CHUNK || have > HEADER_SIZE + len)
+                {
+                    result = failed(result, EPROTO);
+                    break;
+                }
+                if (have < HEADER_SIZE + len)
+                {
+                    continue;
+                }
+
+                if (!writeAll(outFd, pack + HEADER_SIZE, len,
+                              outOff + result.bytes))
+                {
+                    result = failed(result, errno);
+                    break;
+                }
+                result.bytes += len;
+            }
+            have = 0;
+
+            sent = co_await FtCo::SendOp(loop, ctlFd, ACK_MSG,
+                                         sizeof ACK_MSG - 1, 0, timeoutMs);
+            if (sent == -1)
+            {
+                result = failed(result, errno);
+                break;
+            }
+        }
+
+        close(dataFd);
+        close(ctlFd);
+        if (result.status == FT_OK)
+        {
+            idle.push_back(listenFd);
+        }
+        else
+        {
+            close(listenFd);
+        }
+        co_return (result);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: localRequest()
+     *
+     *    Entry: "g" or "l", the file or the listing's filter terms or NULL,
+     *           the range of the file to copy, with a length of -1 for the
+     *           rest of it, the descriptor and offset to copy it to, and the
+     *           list for names
+     *
+     *     Exit: Returns the result of the request
+     *
+     *  Purpose: Ask the -local socket for a descriptor holding the file or
+     *           the listing and read the data from it here; The copy runs
+     *           on the loop thread, as the pwrite() of each chunk does
+     *
+     *
+     *   *   *   *   *   *   */
+    FtCo::Task<Result> Client::localRequest(const char *command,
+                                            const char *arg, long long offset,
+                                            long long length, int outFd,
+                                            long long outOff,
+                                            std::vector<std::string> *names)
+    {
+        Result result;
+        memset(&result, 0, sizeof result);
+
+        int ctlFd = co_await openControl();
+        if (ctlFd == -1)
+        {
+            co_return (failed(result, errno));
+        }
+
+        std::string msg = command;
+        if (arg != NULL)
+        {
+            msg += ' ';
+            msg += arg;
+        }
+        msg += '\n';
+
+        // The answer and its descriptor arrive in one message
+        char inMsg[MAX_MSG + 1];
+        int dataFd = -1;
+        long inLen = co_await FtCo::SendOp(loop, ctlFd, msg.data(),
+                                           msg.size(), 0, timeoutMs);
+        if (inLen != -1)
+        {
+            inLen = co_await FtCo::ReadyOp(loop, ctlFd, timeoutMs);
+        }
+        if (inLen != -1)
+        {
+            inLen = FtUnix::recvFd(ctlFd, inMsg, MAX_MSG, &dataFd);
+        }
+        int err = errno;
+        close(ctlFd);
+
+        // "ready <bytes>", with " more" after a page of a listing
+        long long size = -1;
+        if (inLen <= 0)
+        {
+            result = failed(result, (inLen == 0 ? ECONNRESET : err));
+        }
+        else if (startsWith(inMsg, inLen, ERR_MSG))
+        {
+            result.status = FT_NOT_FOUND;
+        }
+        else if (startsWith(inMsg, inLen, OK_MSG) && dataFd != -1)
+        {
+            inMsg[inLen] = '\0';
+            const char *digits = inMsg + sizeof OK_MSG;
+            std::from_chars_result r = std::from_chars(digits, inMsg + inLen,
+                                                       size);
+            if (r.ec != std::errc() || size < 0)
+            {
+                size = -1;
+            }
+            result.more = (strcmp(r.ptr, " more") == 0);
+        }
+        if (result.status == FT_OK && size == -1)
+        {
+            result = failed(result, EPROTO);
+        }
+
+        if (result.status == FT_OK && names != NULL)
+        {
+            // One name per line, read from the start of the memfd
+            std::string listing(size, '\0');
+            long long have = 0;
+            while (have < size)
+            {
+                ssize_t n = read(dataFd, &listing[have], size - have);
+                if (n == -1 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    result = failed(result, (n == 0 ? EPROTO : errno));
+                    break;
+                }
+                have += n;
+            }
+
+            std::size_t start = 0;
+            std::size_t end;
+            while (result.status == FT_OK
+                   && (end = listing.find('\n', start)) != std::string::npos)
+            {
+                names->push_back(listing.substr(start, end - start));
+                result.bytes++;
+                start = end + 1;
+            }
+        }
+        else if (result.status == FT_OK)
+        {
+            long long len = (offset < size ? size - offset : 0);
+            if (length != -1 && length < len)
+            {
+                len = length;
+            }
+            result.bytes = copyRange(dataFd, offset, outFd, outOff, len);
+            if (result.bytes == -1)
+            {
+                result = failed(result, errno);
+                result.bytes = 0;
+            }
+        }
+
+        if (dataFd != -1)
+        {
+            close(dataFd);
+        }
+        co_return (result);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: openControl()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns the connected control socket, or -1 with errno set
+     *
+     *  Purpose: Connect a new control connection to the server
+     *
+     *
+     *   *   *   *   *   *   */
+    FtCo::Task<int> Client::openControl()
+    {
+        if (resolveErr != 0)
+        {
+            errno = resolveErr;
+            co_return (-1);
+        }
+
+        int ctlFd = socket(servAddr.ss_family,
+                           SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (ctlFd == -1)
+        {
+            co_return (-1);
+        }
+
+        // Each message is one send; Nagle would hold an ack until the
+        // server's delayed ACK of the one before
+        if (!local)
+        {
+            int on = 1;
+            setsockopt(ctlFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+        }
+        long done = co_await FtCo::ConnectOp(loop, ctlFd,
+                                             (struct sockaddr *)&servAddr,
+                                             servLen, timeoutMs);
+        if (done == -1)
+        {
+            int err = errno;
+            close(ctlFd);
+            errno = err;
+            co_return (-1);
+        }
+
+        co_return (ctlFd);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: sendCommand()
+     *
+     *    Entry: The control socket, the command, the data port, and the
+     *           file and trailing arguments or NULL
+     *
+     *     Exit: Returns FT_OK once the server answered "ready", with its
+     *           hash if it sent one, or the status of its other answers
+     *
+     *  Purpose: Send "cmd port [file] [tail]" as ftclient sends it and read
+     *           the answer
+     *
+     *
+     *   *   *   *   *   *   */
+    FtCo::Task<Result> Client::sendCommand(int ctlFd, const char *command,
+                                           int port, const char *file,
+                                           const char *tail)
+    {
+        Result result;
+        memset(&result, 0, sizeof result);
+
+        std::string msg = command;
+        msg += ' ';
+        msg += std::to_string(port);
+        if (file != NULL)
+        {
+            msg += ' ';
+            msg += file;
+        }
+        if (tail != NULL)
+        {
+            msg += ' ';
+            msg += tail;
+        }
+        msg += '\n';
+
+        char inMsg[MAX_MSG + 1];
+        long inLen = co_await FtCo::SendOp(loop, ctlFd, msg.data(),
+                                           msg.size(), 0, timeoutMs);
+        if (inLen != -1)
+        {
+            inLen = co_await FtCo::RecvOp(loop, ctlFd, inMsg, MAX_MSG,
+                                          timeoutMs);
+        }
+        if (inLen <= 0)
+        {
+            result = failed(result, (inLen == 0 ? ECONNRESET : errno));
+        }
+        else if (startsWith(inMsg, inLen, ERR_MSG))
+        {
+            result.status = FT_NOT_FOUND;
+        }
+        else if (startsWith(inMsg, inLen, NOT_MOD))
+        {
+            result.status = FT_NOT_MODIFIED;
+        }
+        else if (!startsWith(inMsg, inLen, OK_MSG))
+        {
+            result = failed(result, EPROTO);
+        }
+        else
+        {
+            // "ready <hash>" names the server's copy, and "ready more"
+            // ends a page of a listing with more names after it
+            inMsg[inLen] = '\0';
+            if (inMsg[sizeof OK_MSG - 1] == ' ')
+            {
+                const char *word = inMsg + sizeof OK_MSG;
+                if (strcmp(command, "l") == 0)
+                {
+                    result.more = (strcmp(word, "more") == 0);
+                }
+                else
+                {
+                    strncat(result.hash, word, HASH_HEX);
+                }
+            }
+        }
+
+        co_return (result);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: receiveUdp()
+     *
+     *    Entry: The control socket, the UDP socket, the descriptor to write
+     *           the file to, and the shim
+     *
+     *     Exit: Returns the result once every packet is stored and "done"
+     *           is sent
+     *
+     *  Purpose: Wake at least every NACK_MS to store datagrams and report
+     *           new gaps; After UDP_IDLE_MS with nothing new, plus twice
+     *           the shim's delay, every missing packet is reported again
+     *
+     *
+     *   *   *   *   *   *   */
+    FtCo::Task<Result> Client::receiveUdp(int ctlFd, int udpFd, int outFd,
+                                          const FtUdp::Shim &shim)
+    {
+        Result result;
+        memset(&result, 0, sizeof result);
+
+        FtUdp::Receiver rx(udpFd, outFd, 0, shim);
+        long long idleUs = (UDP_IDLE_MS + 2LL * shim.delayMs) * 1000;
+        long long now = FtUdp::monoUs();
+        long long lastNew = now;
+        long long lastNack = now;
+        long long lastProgress = now;
+        std::string nack;
+        while (!rx.isComplete())
+        {
+            long ready = co_await FtCo::ReadyOp(loop, udpFd, NACK_MS);
+            if (ready == -1 && errno != ETIMEDOUT)
+            {
+                co_return (failed(result, errno));
+            }
+
+            now = FtUdp::monoUs();
+            int got = rx.poll(now);
+            if (got == -1)
+            {
+                co_return (failed(result, errno));
+            }
+            if (got > 0)
+            {
+                lastNew = now;
+                lastProgress = now;
+            }
+            if (timeoutMs > 0 && now - lastProgress > timeoutMs * 1000)
+            {
+                co_return (failed(result, ETIMEDOUT));
+            }
+
+            nack.clear();
+            if (now - lastNack >= NACK_MS * 1000)
+            {
+                rx.takeNack(false, &nack);
+                lastNack = now;
+            }
+            if (now - lastNew >= idleUs)
+            {
+                rx.takeNack(true, &nack);
+                lastNew = now;
+            }
+            if (!nack.empty())
+            {
+                long sent = co_await FtCo::SendOp(loop, ctlFd, nack.data(),
+                                                  nack.size(), 0, timeoutMs);
+                if (sent == -1)
+                {
+                    co_return (failed(result, errno));
+                }
+            }
+        }
+
+        long sent = co_await FtCo::SendOp(loop, ctlFd, DONE_MSG,
+                                          sizeof DONE_MSG - 1, 0, timeoutMs);
+        if (sent == -1)
+        {
+            co_return (failed(result, errno));
+        }
+        result.bytes = rx.getSize();
+
+        co_return (result);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: takeListener()
+     *
+     *    Entry: The connected control socket and a pointer for the port
+     *
+     *     Exit: Returns a listening socket and stores its port, or -1
+     *
+     *  Purpose: Reuse an idle listener, or open one on an ephemeral port of
+     *           the address the server sees the client at
+     *
+     *
+     *   *   *   *   *   *   */
+    int Client::takeListener(int ctlFd, int *port)
+    {
+        struct sockaddr_storage addr;
+        socklen_t addrLen = sizeof addr;
+        int fd;
+
+        if (!idle.empty())
+        {
+            fd = idle.back();
+            idle.pop_back();
+        }
+        else
+        {
+            if (getsockname(ctlFd, (struct sockaddr *)&addr, &addrLen) == -1)
+            {
+                return (-1);
+            }
+            ((struct sockaddr_in *)&addr)->sin_port = 0;
+
+            fd = socket(addr.ss_family,
+                        SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd == -1)
+            {
+                return (-1);
+            }
+            if (bind(fd, (struct sockaddr *)&addr, addrLen) == -1
+                || listen(fd, 1) == -1)
+            {
+                int err = errno;
+                close(fd);
+                errno = err;
+                return (-1);
+            }
+        }
+
+        addrLen = sizeof addr;
+        if (getsockname(fd, (struct sockaddr *)&addr, &addrLen) == -1)
+        {
+            int err = errno;
+            close(fd);
+            errno = err;
+            return (-1);
+        }
+        *port = ntohs(((struct sockaddr_in *)&addr)->sin_port);
+
+        return (fd);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: openUdp()
+     *
+     *    Entry: The connected control socket and a pointer for the port
+     *
+     *     Exit: Returns a bound UDP socket and stores its port, or -1
+     *
+     *  Purpose: Receive datagrams on the address the server sees the
+     *           client at
+     *
+     *
+     *   *   *   *   *   *   */
+    int Client::openUdp(int ctlFd, int *port)
+    {
+        struct sockaddr_storage addr;
+        socklen_t addrLen = sizeof addr;
+
+        if (getsockname(ctlFd, (struct sockaddr *)&addr, &addrLen) == -1)
+        {
+            return (-1);
+        }
+        ((struct sockaddr_in *)&addr)->sin_port = 0;
+
+        int fd = socket(addr.ss_family,
+                        SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1)
+        {
+            return (-1);
+        }
+        if (bind(fd, (struct sockaddr *)&addr, addrLen) == -1
+            || getsockname(fd, (struct sockaddr *)&addr, &addrLen) == -1)
+        {
+            int err = errno;
+            close(fd);
+            errno = err;
+            return (-1);
+        }
+        *port = ntohs(((struct sockaddr_in *)&addr)->sin_port);
+
+        return (fd);
+    }
+
+    static bool startsWith(const char *msg, int len, const char *word)
+    {
+        int wordLen = strlen(word);
+        return (len >= wordLen && memcmp(msg, word, wordLen) == 0);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: writeAll()
+     *
+     *    Entry: A descriptor, the data and its length, and the offset
+     *
+     *     Exit: Returns false if the data could not all be written
+     *
+     *  Purpose: pwrite() until done, so concurrent ranges never share a
+     *           file offset
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool writeAll(int fd, const char *buf, int len, long long off)
+    {
+        while (len > 0)
+        {
+            ssize_t n = pwrite(fd, buf, len, off);
+            if (n == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return (false);
+            }
+            buf += n;
+            len -= n;
+            off += n;
+        }
+
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: punchHole()
+     *
+     *    Entry: A descriptor and the offset and length of a hole
+     *
+     *     Exit: Returns false if the range may still hold old data
+     *
+     *  Purpose: Free the range instead of writing zeros; Past the end of
+     *           the file there is nothing to free
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool punchHole(int fd, long long off, long long len)
+    {
+        if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off,
+                      len) == 0)
+        {
+            return (true);
+        }
+
+        struct stat st;
+        int err = errno;
+        bool pastEnd = (fstat(fd, &st) == 0 && st.st_size <= off);
+        errno = err;
+        return (pastEnd);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: copyRange()
+     *
+     *    Entry: The descriptor and offset to copy from, the descriptor and
+     *           offset to copy to, and the length
+     *
+     *     Exit: Returns the bytes copied, fewer if the source ends first, or
+     *           -1
+     *
+     *  Purpose: Copy in the kernel with copy_file_range(); Between file
+     *           systems it cannot join, such as a memfd and a disk, copy
+     *           through a buffer instead
+     *
+     *
+     *   *   *   *   *   *   */
+    static long long copyRange(int inFd, long long inOff, int outFd,
+                               long long outOff, long long len)
+    {
+        char buf[COPY_SIZE];
+        bool inKernel = true;
+        long long done = 0;
+
+        while (done < len)
+        {
+            long long want = len - done;
+            ssize_t n;
+            if (inKernel)
+            {
+                loff_t in = inOff + done;
+                loff_t out = outOff + done;
+                n = copy_file_range(inFd, &in, outFd, &out, want, 0);
+                if (n == -1 && (errno == EXDEV || errno == EINVAL
+                                || errno == ENOSYS || errno == EOPNOTSUPP))
+                {
+                    inKernel = false;
+                    continue;
+                }
+            }
+            else
+            {
+                n = pread(inFd, buf, (want < COPY_SIZE ? want : COPY_SIZE),
+                          inOff + done);
+                if (n > 0 && !writeAll(outFd, buf, n, outOff + done))
+                {
+                    return (-1);
+                }
+            }
+
+            if (n == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n == -1)
+            {
+                return (-1);
+            }
+            if (n == 0)
+            {
+                break;
+            }
+            done += n;
+        }
+
+        return (done);
+    }
+
+    static Result failed(Result result, int err)
+    {
+        result.status = FT_FAILED;
+        result.err = err;
+        return (result);
+    }
+} // FtClient
@@ -0,0 +1,158 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftclientlib.h
+ *           Overview: This is the header file for the ftserve client library.
+ *                     A Client runs list, get, conditional get, ranged get,
+ *                     sparse get, and UDP get requests as FtCo coroutines on
+ *                     the caller's Loop, so one thread can keep many
+ *                     transfers in flight. File data is written with pwrite()
+ *                     at the caller's offset, and the data port listeners are
+ *                     kept and reused instead of being opened for every
+ *                     request
+ *
+ *                     A Client made with the path of the server's -local
+ *                     socket runs list, get, and ranged get on the same
+ *                     host instead; The server passes a descriptor for the
+ *                     data and it is copied here, never crossing TCP
+ *
+ *                     Link with libftclient.a; Store the result of a
+ *                     co_await before testing it, as for any FtCo Task
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTCLIENTLIB_H
+#define FTCLIENTLIB_H
+
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include "ftco.h"
+#include "ftudp.h"
+
+namespace FtClient
+{
+    const int HASH_HEX = 64; // Length of a SHA-256 in hex
+
+    /*
+     * Outcomes of a request
+     */
+    enum Status
+    {
+        FT_OK = 0,
+        FT_NOT_FOUND,
+        FT_NOT_MODIFIED,
+        FT_FAILED
+    };
+
+    /*
+     * Structure for the result of a request; bytes counts the file bytes
+     * written, holes included, or the names listed, hash is the server's
+     * SHA-256 of the file when its "ready" carried one, and more is set
+     * when a page of a listing has more names after it
+     */
+    struct Result
+    {
+        Status    status;
+        int       err;
+        long long bytes;
+        char      hash[HASH_HEX + 1];
+        bool      more;
+    };
+
+    /*
+     * Class for a connection point to one ftserve; Requests may run
+     * concurrently on the Loop, and each uses its own control connection
+     */
+    class Client
+    {
+    public:
+        Client(FtCo::Loop &loopInput, const char *host, const char *port,
+               long long timeoutMsInput);
+        /*
+         * Resolves the server once; Every wait of a request fails with
+         * ETIMEDOUT after timeoutMsInput, and 0 waits forever
+         */
+
+        Client(FtCo::Loop &loopInput, const char *localPath,
+               long long timeoutMsInput);
+        /*
+         * Sends requests to the server's -local socket at localPath; A
+         * conditional, sparse, or UDP get fails with EOPNOTSUPP
+         */
+
+        ~Client();
+
+        FtCo::Task<Result> list(std::vector<std::string> *names,
+                                const char *filter = NULL);
+        /*
+         * Appends the names in the server's directory to names; A filter
+         * of terms such as "glob=*.log limit=100" lists only the matching
+         * names, and with a limit the last name of a page is the cursor
+         * for the next, given as "after=name"
+         */
+
+        FtCo::Task<Result> get(const char *file, int outFd,
+                               const char *hash = NULL);
+        /*
+         * Writes file to outFd from offset 0; With the hash of the local
+         * copy, returns FT_NOT_MODIFIED if the server's copy matches
+         */
+
+        FtCo::Task<Result> getRange(const char *file, long long offset,
+                                    long long length, int outFd,
+                                    long long outOff);
+        /*
+         * Writes up to length bytes of file from offset to outFd at outOff;
+         * Fewer bytes are written if the file ends first
+         */
+
+        FtCo::Task<Result> getSparse(const char *file, int outFd);
+        /*
+         * Writes file to outFd from offset 0 with its holes punched instead
+         * of written, and sizes outFd to the file
+         */
+
+        FtCo::Task<Result> getUdp(const char *file, int outFd,
+                                  const FtUdp::Shim *shim = NULL);
+        /*
+         * Writes file to outFd from offset 0 from UDP datagrams; A shim
+         * drops and delays datagrams as they arrive, to test loss and
+         * latency on loopback
+         */
+    private:
+        FtCo::Loop              &loop;
+        struct sockaddr_storage servAddr;
+        socklen_t               servLen;
+        int                     resolveErr;
+        long long               timeoutMs;
+        bool                    local;
+        std::vector<int>        idle;
+
+        FtCo::Task<Result> request(const char *command, const char *file,
+                                   const char *tail, int outFd,
+                                   long long outOff,
+                                   std::vector<std::string> *names);
+        FtCo::Task<Result> localRequest(const char *command,
+                                        const char *arg, long long offset,
+                                        long long length, int outFd,
+                                        long long outOff,
+                                        std::vector<std::string> *names);
+        FtCo::Task<int> openControl();
+        FtCo::Task<Result> sendCommand(int ctlFd, const char *command,
+                                       int port, const char *file,
+                                       const char *tail);
+        FtCo::Task<Result> receiveUdp(int ctlFd, int udpFd, int outFd,
+                                      const FtUdp::Shim &shim);
+        int takeListener(int ctlFd, int *port);
+        int openUdp(int ctlFd, int *port);
+
+        Client(const Client &);
+        Client &operator=(const Client &);
+    };
+} // FtClient
+#endif // FTCLIENTLIB_H
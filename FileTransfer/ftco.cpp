@@ -0,0 +1,525 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftco.cpp
+ *           Overview: This is the implementation file for the ftserve
+ *                     coroutine layer
+ *
+ *                     Every suspended operation has an id in the Loop's
+ *                     waiter table. Its descriptor is armed one-shot in epoll
+ *                     with the id and a generation number, and its deadline,
+ *                     if any, is on the timing wheel under the same id. A
+ *                     ready descriptor retries the operation; An expired
+ *                     deadline fails it. Events and timers left over from an
+ *                     earlier user of an id are told apart and ignored
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include "ftco.h"
+
+namespace FtCo
+{
+    const int MAX_EVENTS       = 64; // Events taken per epoll_wait()
+    const int WHEEL_SLOTS      = 256; // Slots on the deadline wheel
+    const long long TICK_MS    = 10; // Milliseconds per wheel slot
+
+    /*
+     * Coroutine type that runs a spawned Task; It starts at once and frees
+     * itself when the Task finishes
+     */
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    /*
+     * Helpers local to this file
+     */
+    static Detached runTask(Task<void> task, int *tasks);
+
+    IoOp::IoOp(Loop &loopInput, int fdInput, unsigned eventsInput,
+               long long timeoutMsInput)
+        : fd(fdInput), loop(loopInput), events(eventsInput),
+          timeoutMs(timeoutMsInput), deadlineMs(-1), result(-1), err(0),
+          id(-1)
+    {/*Body intentionally empty*/}
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: await_ready
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns true if the operation finished without waiting
+     *
+     *  Purpose: Try the operation first; Most receives and sends on a quiet
+     *           server never suspend
+     *
+     *
+     *   *   *   *   *   *   */
+    bool IoOp::await_ready()
+    {
+        result = attempt();
+        if (result == -1 && errno == EAGAIN)
+        {
+            return (false);
+        }
+
+        err = (result == -1) ? errno : 0;
+        return (true);
+    }
+
+    bool IoOp::await_suspend(std::coroutine_handle<> handle)
+    {
+        waiter = handle;
+        return (loop.arm(this));
+    }
+
+    long IoOp::await_resume()
+    {
+        if (result == -1)
+        {
+            errno = err;
+        }
+
+        return (result);
+    }
+
+    AcceptOp::AcceptOp(Loop &loopInput, int fdInput,
+                       struct sockaddr *addrInput, socklen_t *addrLenInput)
+        : IoOp(loopInput, fdInput, EPOLLIN, 0), addr(addrInput),
+          addrLen(addrLenInput)
+    {/*Body intentionally empty*/}
+
+    long AcceptOp::attempt()
+    {
+        return (accept4(fd, addr, addrLen, SOCK_NONBLOCK | SOCK_CLOEXEC));
+    }
+
+    RecvOp::RecvOp(Loop &loopInput, int fdInput, void *bufInput, int lenInput,
+                   long long timeoutMsInput)
+        : IoOp(loopInput, fdInput, EPOLLIN, timeoutMsInput), buf(bufInput),
+          len(lenInput)
+    {/*Body intentionally empty*/}
+
+    long RecvOp::attempt()
+    {
+        return (recv(fd, buf, len, MSG_DONTWAIT));
+    }
+
+    SendOp::SendOp(Loop &loopInput, int fdInput, const void *bufInput,
+                   int lenInput, int flagsInput, long long timeoutMsInput)
+        : IoOp(loopInput, fdInput, EPOLLOUT, timeoutMsInput),
+          buf(static_cast<const char *>(bufInput)), len(lenInput),
+          flags(flagsInput), sent(0)
+    {/*Body intentionally empty*/}
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: attempt (SendOp)
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns len once every byte is sent, or -1
+     *
+     *  Purpose: Send as much as the socket takes; A full socket buffer
+     *           returns EAGAIN and the rest goes on the next retry
+     *
+     *
+     *   *   *   *   *   *   */
+    long SendOp::attempt()
+    {
+        while (sent < len)
+        {
+            ssize_t n = send(fd, buf + sent, len - sent,
+                             flags | MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n == -1)
+            {
+                return (-1);
+            }
+            sent += n;
+        }
+
+        return (sent);
+    }
+
+    ConnectOp::ConnectOp(Loop &loopInput, int fdInput,
+                         const struct sockaddr *addrInput,
+                         socklen_t addrLenInput, long long timeoutMsInput)
+        : IoOp(loopInput, fdInput, EPOLLOUT, timeoutMsInput), addr(addrInput),
+          addrLen(addrLenInput), started(false)
+    {/*Body intentionally empty*/}
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: attempt (ConnectOp)
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns 0 once connected, or -1
+     *
+     *  Purpose: Start the connection, then check it each time the socket is
+     *           writable; A socket is only connected once it has a peer
+     *
+     *
+     *   *   *   *   *   *   */
+    long ConnectOp::attempt()
+    {
+        if (!started)
+        {
+            started = true;
+            if (connect(fd, addr, addrLen) == 0)
+            {
+                return (0);
+            }
+            if (errno == EINPROGRESS)
+            {
+                errno = EAGAIN;
+            }
+            return (-1);
+        }
+
+        int soErr = 0;
+        socklen_t soLen = sizeof soErr;
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &soErr, &soLen) == -1)
+        {
+            return (-1);
+        }
+        if (soErr != 0)
+        {
+            errno = soErr;
+            return (-1);
+        }
+
+        struct sockaddr_storage peer;
+        socklen_t peerLen = sizeof peer;
+        if (getpeername(fd, (struct sockaddr *)&peer, &peerLen) == -1)
+        {
+            if (errno == ENOTCONN)
+            {
+                errno = EAGAIN;
+            }
+            return (-1);
+        }
+
+        return (0);
+    }
+
+    SendfileOp::SendfileOp(Loop &loopInput, int sockInput, int fileInput,
+                           off_t *offInput, long countInput,
+                           long long timeoutMsInput)
+        : IoOp(loopInput, sockInput, EPOLLOUT, timeoutMsInput),
+          file(fileInput), off(offInput), count(countInput), sent(0)
+    {/*Body intentionally empty*/}
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: attempt (SendfileOp)
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns count once every byte is sent, or -1
+     *
+     *  Purpose: Move file data to the socket in the kernel; A file that ends
+     *           early fails with EIO since the client was promised count
+     *
+     *
+     *   *   *   *   *   *   */
+    long SendfileOp::attempt()
+    {
+        while (sent < count)
+        {
+            ssize_t n = sendfile(fd, file, off, count - sent);
+            if (n == -1)
+            {
+                return (-1);
+            }
+            if (n == 0)
+            {
+                errno = EIO;
+                return (-1);
+            }
+            sent += n;
+        }
+
+        return (sent);
+    }
+
+    ReadyOp::ReadyOp(Loop &loopInput, int fdInput, long long timeoutMsInput)
+        : IoOp(loopInput, fdInput, EPOLLIN, timeoutMsInput), waited(false)
+    {/*Body intentionally empty*/}
+
+    long ReadyOp::attempt()
+    {
+        if (!waited)
+        {
+            waited = true;
+            errno = EAGAIN;
+            return (-1);
+        }
+
+        return (0);
+    }
+
+    SleepOp::SleepOp(Loop &loopInput, long long msInput)
+        : IoOp(loopInput, -1, 0, msInput > 0 ? msInput : 1)
+    {/*Body intentionally empty*/}
+
+    long SleepOp::attempt()
+    {
+        errno = EAGAIN;
+        return (-1);
+    }
+
+    Loop::Loop()
+        : epfd(epoll_create1(EPOLL_CLOEXEC)), tasks(0),
+          wheel(WHEEL_SLOTS, TICK_MS, monoMs())
+    {/*Body intentionally empty*/}
+
+    Loop::~Loop()
+    {
+        close(epfd);
+    }
+
+    void Loop::spawn(Task<void> task)
+    {
+        tasks++;
+        runTask(static_cast<Task<void> &&>(task), &tasks);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: runOnce
+     *
+     *    Entry: The signal mask to wait with, or NULL to keep the
+     *           current one
+     *
+     *     Exit: Operations that became ready or timed out are resumed
+     *
+     *  Purpose: One turn of the event loop; Returns early if a signal
+     *           interrupts the wait so the caller can act on it. A signal
+     *           blocked outside the wait and unblocked by waitMask cannot
+     *           arrive between the caller's check and the wait
+     *
+     *
+     *   *   *   *   *   *   */
+    void Loop::runOnce(const sigset_t *waitMask)
+    {
+        struct epoll_event events[MAX_EVENTS];
+        int timeout = wheel.empty() ? -1 : static_cast<int>(wheel.getTickMs());
+
+        int n = epoll_pwait(epfd, events, MAX_EVENTS, timeout, waitMask);
+        for (int i = 0; i < n; i++)
+        {
+            unsigned id = static_cast<unsigned>(events[i].data.u64);
+            unsigned gen = static_cast<unsigned>(events[i].data.u64 >> 32);
+            if (id < waiters.size() && waiters[id].op != NULL
+                && waiters[id].gen == gen)
+            {
+                retry(waiters[id].op);
+            }
+        }
+
+        long long now = monoMs();
+        expired.clear();
+        wheel.advance(now, expired);
+        for (unsigned i = 0; i < expired.size(); i++)
+        {
+            IoOp *op = waiters[expired[i]].op;
+            if (op != NULL && op->deadlineMs >= 0 && op->deadlineMs <= now)
+            {
+                if (op->fd == -1)
+                {
+                    complete(op, 0, 0);
+                }
+                else
+                {
+                    complete(op, -1, ETIMEDOUT);
+                }
+            }
+        }
+    }
+
+    void Loop::cancel(int fd)
+    {
+        for (unsigned i = 0; i < waiters.size(); i++)
+        {
+            if (waiters[i].op != NULL && waiters[i].op->fd == fd)
+            {
+                complete(waiters[i].op, -1, ECANCELED);
+            }
+        }
+    }
+
+    int Loop::getTasks()
+    {
+        return (tasks);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: arm
+     *
+     *    Entry: A suspended operation
+     *
+     *     Exit: Returns true if the operation has a waiter id, its
+     *           descriptor is armed, and its deadline is on the wheel;
+     *           Otherwise it failed and its coroutine goes on at once
+     *
+     *  Purpose: Register an operation that could not finish at once
+     *
+     *
+     *   *   *   *   *   *   */
+    bool Loop::arm(IoOp *op)
+    {
+        if (freeIds.empty())
+        {
+            Waiter w = {NULL, 0};
+            waiters.push_back(w);
+            freeIds.push_back(waiters.size() - 1);
+        }
+        op->id = freeIds.back();
+        freeIds.pop_back();
+
+        Waiter &w = waiters[op->id];
+        w.op = op;
+        w.gen++;
+
+        if (op->timeoutMs > 0)
+        {
+            op->deadlineMs = monoMs() + op->timeoutMs;
+            wheel.schedule(op->id, op->deadlineMs);
+        }
+
+        if (op->fd == -1)
+        {
+            return (true);
+        }
+
+        // The descriptor stays in the set between operations; Add it the
+        // first time and modify it after that
+        struct epoll_event ev;
+        ev.events = op->events | EPOLLONESHOT;
+        ev.data.u64 = (static_cast<uint64_t>(w.gen) << 32) | op->id;
+        if (epoll_ctl(epfd, EPOLL_CTL_MOD, op->fd, &ev) == -1
+            && (errno != ENOENT
+                || epoll_ctl(epfd, EPOLL_CTL_ADD, op->fd, &ev) == -1))
+        {
+            op->result = -1;
+            op->err = errno;
+            w.op = NULL;
+            freeIds.push_back(op->id);
+            return (false);
+        }
+
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: complete
+     *
+     *    Entry: An armed operation, its result, and its errno
+     *
+     *     Exit: The waiter id is freed and the operation's coroutine resumed
+     *
+     *  Purpose: Finish an operation; The operation may be destroyed by the
+     *           time resume() returns
+     *
+     *
+     *   *   *   *   *   *   */
+    void Loop::complete(IoOp *op, long result, int err)
+    {
+        waiters[op->id].op = NULL;
+        freeIds.push_back(op->id);
+
+        op->result = result;
+        op->err = err;
+        op->waiter.resume();
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: retry
+     *
+     *    Entry: An armed operation whose descriptor is ready
+     *
+     *     Exit: The operation is completed or armed again
+     *
+     *  Purpose: Run the system call again; Readiness can be spurious
+     *
+     *
+     *   *   *   *   *   *   */
+    void Loop::retry(IoOp *op)
+    {
+        long result = op->attempt();
+        if (result == -1 && errno == EAGAIN)
+        {
+            struct epoll_event ev;
+            ev.events = op->events | EPOLLONESHOT;
+            ev.data.u64 = (static_cast<uint64_t>(waiters[op->id].gen) << 32)
+                          | op->id;
+            if (epoll_ctl(epfd, EPOLL_CTL_MOD, op->fd, &ev) == 0)
+            {
+                return;
+            }
+        }
+
+        complete(op, result, result == -1 ? errno : 0);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: monoMs
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns the monotonic clock in milliseconds
+     *
+     *  Purpose: Time source for the deadlines
+     *
+     *
+     *   *   *   *   *   *   */
+    long long monoMs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (ts.tv_sec * 1000LL + ts.tv_nsec / 1000000);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: runTask
+     *
+     *    Entry: A Task and the Loop's task count
+     *
+     *     Exit: The count drops when the Task finishes
+     *
+     *  Purpose: Own a spawned Task for its whole life
+     *
+     *
+     *   *   *   *   *   *   */
+    static Detached runTask(Task<void> task, int *tasks)
+    {
+        co_await task;
+        (*tasks)--;
+    }
+} // FtCo
@@ -0,0 +1,356 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftco.h
+ *           Overview: This is the header file for the ftserve coroutine
+ *                     layer. A Task is a C++20 coroutine that can await
+ *                     other Tasks and the I/O operations below; An operation
+ *                     that would block suspends the Task and the Loop resumes
+ *                     it when its descriptor is ready, so one thread can run
+ *                     many sessions that each read as straight-line code
+ *
+ *                     Store the result of a co_await before testing it;
+ *                     g++ 12 miscompiles a co_await inside an if condition
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTCO_H
+#define FTCO_H
+
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+#include <vector>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "fttimer.h"
+
+namespace FtCo
+{
+    template <typename T> class Task;
+
+    /*
+     * Promise parts shared by every Task; A Task starts suspended and, when
+     * it finishes, resumes the coroutine that awaited it
+     */
+    struct PromiseBase
+    {
+        std::coroutine_handle<> continuation;
+
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return (false); }
+
+            template <typename P>
+            std::coroutine_handle<> await_suspend(
+                std::coroutine_handle<P> done) noexcept
+            {
+                std::coroutine_handle<> next = done.promise().continuation;
+                if (next)
+                {
+                    return (next);
+                }
+                return (std::noop_coroutine());
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    /*
+     * Promise of a Task that returns a value
+     */
+    template <typename T>
+    struct Promise : PromiseBase
+    {
+        T value;
+
+        Task<T> get_return_object();
+        void return_value(T result) { value = result; }
+    };
+
+    /*
+     * Promise of a Task that returns nothing
+     */
+    template <>
+    struct Promise<void> : PromiseBase
+    {
+        Task<void> get_return_object();
+        void return_void() {}
+    };
+
+    /*
+     * Class for a lazily started coroutine; co_await runs it to completion
+     * and returns its result
+     */
+    template <typename T = void>
+    class Task
+    {
+    public:
+        typedef Promise<T> promise_type;
+        typedef std::coroutine_handle<promise_type> Handle;
+
+        explicit Task(Handle handle) : coro(handle) {}
+        Task(Task &&other) noexcept : coro(other.coro) { other.coro = NULL; }
+
+        ~Task()
+        {
+            if (coro)
+            {
+                coro.destroy();
+            }
+        }
+
+        bool await_ready() { return (false); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller)
+        {
+            coro.promise().continuation = caller;
+            return (coro);
+        }
+
+        T await_resume()
+        {
+            if constexpr (!std::is_void<T>::value)
+            {
+                return (coro.promise().value);
+            }
+        }
+    private:
+        Handle coro;
+
+        Task(const Task &);
+        Task &operator=(const Task &);
+    };
+
+    template <typename T>
+    Task<T> Promise<T>::get_return_object()
+    {
+        return (Task<T>(
+            std::coroutine_handle< Promise<T> >::from_promise(*this)));
+    }
+
+    inline Task<void> Promise<void>::get_return_object()
+    {
+        return (Task<void>(
+            std::coroutine_handle< Promise<void> >::from_promise(*this)));
+    }
+
+    class Loop;
+
+    /*
+     * Base class for an awaitable operation on a descriptor; attempt() makes
+     * the non-blocking system call and returns -1 with errno EAGAIN until the
+     * operation can finish; The Loop retries it each time the descriptor is
+     * ready; co_await returns the result, or -1 with errno set, ETIMEDOUT if
+     * timeoutMs passed first, or ECANCELED if the Loop cancelled it
+     */
+    class IoOp
+    {
+    public:
+        IoOp(Loop &loopInput, int fdInput, unsigned eventsInput,
+             long long timeoutMsInput);
+        /*
+         * Initializes an operation waiting for eventsInput on fdInput; A
+         * timeoutMsInput of 0 waits forever
+         */
+
+        virtual ~IoOp() {}
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<> handle);
+        long await_resume();
+    protected:
+        int fd;
+
+        virtual long attempt() = 0;
+    private:
+        friend class Loop;
+
+        Loop                    &loop;
+        unsigned                events;
+        long long               timeoutMs;
+        long long               deadlineMs;
+        long                    result;
+        int                     err;
+        int                     id;
+        std::coroutine_handle<> waiter;
+    };
+
+    /*
+     * Accepts a connection; The new socket is non-blocking
+     */
+    class AcceptOp : public IoOp
+    {
+    public:
+        AcceptOp(Loop &loopInput, int fdInput, struct sockaddr *addrInput,
+                 socklen_t *addrLenInput);
+    protected:
+        long attempt();
+    private:
+        struct sockaddr *addr;
+        socklen_t       *addrLen;
+    };
+
+    /*
+     * Receives up to len bytes
+     */
+    class RecvOp : public IoOp
+    {
+    public:
+        RecvOp(Loop &loopInput, int fdInput, void *bufInput, int lenInput,
+               long long timeoutMsInput);
+    protected:
+        long attempt();
+    private:
+        void *buf;
+        int  len;
+    };
+
+    /*
+     * Sends all len bytes; flags are passed to send()
+     */
+    class SendOp : public IoOp
+    {
+    public:
+        SendOp(Loop &loopInput, int fdInput, const void *bufInput,
+               int lenInput, int flagsInput, long long timeoutMsInput);
+    protected:
+        long attempt();
+    private:
+        const char *buf;
+        int        len;
+        int        flags;
+        int        sent;
+    };
+
+    /*
+     * Connects a non-blocking socket
+     */
+    class ConnectOp : public IoOp
+    {
+    public:
+        ConnectOp(Loop &loopInput, int fdInput,
+                  const struct sockaddr *addrInput, socklen_t addrLenInput,
+                  long long timeoutMsInput);
+    protected:
+        long attempt();
+    private:
+        const struct sockaddr *addr;
+        socklen_t             addrLen;
+        bool                  started;
+    };
+
+    /*
+     * Sends count bytes of a file from *off with sendfile(); *off advances
+     */
+    class SendfileOp : public IoOp
+    {
+    public:
+        SendfileOp(Loop &loopInput, int sockInput, int fileInput,
+                   off_t *offInput, long countInput,
+                   long long timeoutMsInput);
+    protected:
+        long attempt();
+    private:
+        int   file;
+        off_t *off;
+        long  count;
+        long  sent;
+    };
+
+    /*
+     * Waits until fd is readable; co_await returns 0
+     */
+    class ReadyOp : public IoOp
+    {
+    public:
+        ReadyOp(Loop &loopInput, int fdInput, long long timeoutMsInput);
+    protected:
+        long attempt();
+    private:
+        bool waited;
+    };
+
+    /*
+     * Suspends for ms milliseconds; co_await returns 0
+     */
+    class SleepOp : public IoOp
+    {
+    public:
+        SleepOp(Loop &loopInput, long long msInput);
+    protected:
+        long attempt();
+    };
+
+    /*
+     * Class for a single-threaded epoll event loop; Deadlines are kept on a
+     * timing wheel
+     */
+    class Loop
+    {
+    public:
+        Loop();
+        ~Loop();
+
+        void spawn(Task<void> task);
+        /*
+         * Starts task; The Loop owns it until it finishes
+         */
+
+        void runOnce(const sigset_t *waitMask = NULL);
+        /*
+         * Waits for ready descriptors or the next timer tick and resumes
+         * the operations that can finish; The signal mask is waitMask
+         * during the wait if given
+         */
+
+        void cancel(int fd);
+        /*
+         * Completes every operation waiting on fd with ECANCELED
+         */
+
+        int getTasks();
+    private:
+        friend class IoOp;
+
+        /*
+         * A registered operation; gen tells a stale epoll event from one
+         * for the operation now using the id
+         */
+        struct Waiter
+        {
+            IoOp     *op;
+            unsigned gen;
+        };
+
+        int                  epfd;
+        int                  tasks;
+        FtTimer::TimerWheel  wheel;
+        std::vector<Waiter>  waiters;
+        std::vector<int>     freeIds;
+        std::vector<int>     expired;
+
+        bool arm(IoOp *op);
+        void complete(IoOp *op, long result, int err);
+        void retry(IoOp *op);
+
+        Loop(const Loop &);
+        Loop &operator=(const Loop &);
+    };
+
+    /*
+     * The monoMs() function returns the monotonic clock in milliseconds
+     */
+    long long monoMs();
+} // FtCo
+#endif // FTCO_H
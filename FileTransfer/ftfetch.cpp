@@ -0,0 +1,440 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftfetch.cpp
+ *           Overview: This is a command line client built on the ftserve
+ *                     client library
+ *
+ *                     Usage: ./ftfetch serv_hostname serv_port# -l
+ *                                      [term ...]
+ *                            ./ftfetch serv_hostname serv_port# -g file
+ *                                      [streams]
+ *                            ./ftfetch serv_hostname serv_port# -r file
+ *                                      offset length
+ *                            ./ftfetch serv_hostname serv_port# -s file
+ *                            ./ftfetch serv_hostname serv_port# -u file
+ *                                      [loss% [delay_ms]]
+ *                            ./ftfetch -local path -l [term ...]
+ *                            ./ftfetch -local path -g file [streams]
+ *                            ./ftfetch -local path -r file offset length
+ *
+ *                     Commands: -l - List directory contents; Terms such
+ *                                    as glob=*.log or limit=100 filter the
+ *                                    listing on the server, and with a
+ *                                    limit each page is fetched in turn
+ *                               -g - Get file; With streams above 1 the file
+ *                                    is fetched in blocks by that many
+ *                                    concurrent ranged gets
+ *                               -r - Get length bytes of file from offset
+ *                               -s - Get file, keeping its holes sparse
+ *                               -u - Get file over UDP; loss% of the
+ *                                    datagrams are dropped and the rest
+ *                                    delayed by delay_ms as they arrive,
+ *                                    to test on loopback
+ *
+ *                     The data ports are chosen by the library; With
+ *                     -local the requests go to the server's Unix socket
+ *                     at path, which passes back a descriptor to copy from
+ *              Input: The command line arguments
+ *
+ *             Output: The file is saved in the current directory, and the
+ *                     listing and the transfer rate are output to stdout
+ *
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "ftco.h"
+#include "ftclientlib.h"
+#include "ftudp.h"
+
+const long long BLOCK_SIZE  = 256 * 4092LL; // Bytes per ranged get
+const long long TIMEOUT_MS  = 30000; // Deadline of each wait
+const int       MAX_STREAMS = 64; // Most concurrent ranged gets
+
+/*
+ * Structure for a file fetched in blocks by several workers; A block shorter
+ * than BLOCK_SIZE marks the end of the file
+ */
+struct Fetch
+{
+    const char        *file;
+    int               fd;
+    long long         nextBlock;
+    long long         endBlock;
+    long long         size;
+    FtClient::Result  result;
+};
+
+/*
+ * The printUsage() function prints the correct usage and exits the program
+ */
+void printUsage(const char *prog);
+
+/*
+ * The report() function prints the result of a request; Returns false if
+ * it did not succeed
+ */
+bool report(const FtClient::Result &result, const char *file);
+
+/*
+ * The listTask() coroutine prints the server's directory, or the names
+ * passing the filter terms
+ */
+FtCo::Task<> listTask(FtClient::Client &client, const std::string &terms,
+                      bool *ok);
+
+/*
+ * The getTask() coroutine fetches a range, or the whole file if length is
+ * -1, into fd; With a shim the file is fetched over UDP
+ */
+FtCo::Task<> getTask(FtClient::Client &client, const char *file,
+                     long long offset, long long length, bool sparse,
+                     const FtUdp::Shim *udp, int fd, bool *ok);
+
+/*
+ * The blockWorker() coroutine fetches blocks of a file until its end
+ */
+FtCo::Task<> blockWorker(FtClient::Client &client, Fetch *fetch);
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        printUsage(argv[0]);
+    }
+
+    std::string cmd = argv[3];
+    int streams = 1;
+    long long offset = 0;
+    long long length = -1;
+    bool sparse = false;
+    FtUdp::Shim shim = {0, 0};
+    std::string terms;
+    if (cmd == "-l")
+    {
+        // Any arguments are filter terms
+        for (int i = 4; i < argc; i++)
+        {
+            terms += (i > 4 ? " " : "");
+            terms += argv[i];
+        }
+    }
+    else if (cmd == "-s" && argc == 5)
+    {
+        sparse = true;
+    }
+    else if (cmd == "-u" && argc >= 5 && argc <= 7)
+    {
+        if (argc >= 6)
+        {
+            shim.lossRate = atof(argv[5]) / 100;
+        }
+        if (argc == 7)
+        {
+            shim.delayMs = atoi(argv[6]);
+        }
+        if (shim.lossRate < 0 || shim.lossRate >= 1 || shim.delayMs < 0)
+        {
+            printUsage(argv[0]);
+        }
+    }
+    else if (cmd == "-g" && (argc == 5 || argc == 6))
+    {
+        if (argc == 6)
+        {
+            streams = atoi(argv[5]);
+        }
+        if (streams < 1 || streams > MAX_STREAMS)
+        {
+            printUsage(argv[0]);
+        }
+    }
+    else if (cmd == "-r" && argc == 7)
+    {
+        offset = atoll(argv[5]);
+        length = atoll(argv[6]);
+        if (offset < 0 || length < 0)
+        {
+            printUsage(argv[0]);
+        }
+    }
+    else
+    {
+        printUsage(argv[0]);
+    }
+
+    FtCo::Loop loop;
+    FtClient::Client *client;
+    if (strcmp(argv[1], "-local") == 0)
+    {
+        client = new FtClient::Client(loop, argv[2], TIMEOUT_MS);
+    }
+    else
+    {
+        client = new FtClient::Client(loop, argv[1], argv[2], TIMEOUT_MS);
+    }
+    bool ok = true;
+    int fd = -1;
+    long long startMs = FtCo::monoMs();
+    Fetch fetch;
+    const char *name = NULL;
+
+    if (cmd == "-l")
+    {
+        loop.spawn(listTask(*client, terms, &ok));
+    }
+    else
+    {
+        // Save under the file's own name, never over a local file
+        name = strrchr(argv[4], '/');
+        name = (name != NULL ? name + 1 : argv[4]);
+        fd = open(name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd == -1)
+        {
+            std::cout << "File name exists in current directory.\n"
+                      << "Please choose another file name.\n";
+            exit(1);
+        }
+
+        if (streams == 1)
+        {
+            loop.spawn(getTask(*client, argv[4], offset, length, sparse,
+                               cmd == "-u" ? &shim : NULL, fd, &ok));
+        }
+        else
+        {
+            memset(&fetch, 0, sizeof fetch);
+            fetch.file = argv[4];
+            fetch.fd = fd;
+            fetch.endBlock = -1;
+            for (int i = 0; i < streams; i++)
+            {
+                loop.spawn(blockWorker(*client, &fetch));
+            }
+        }
+    }
+
+    while (loop.getTasks() > 0)
+    {
+        loop.runOnce();
+    }
+
+    if (fd != -1 && streams > 1)
+    {
+        ok = report(fetch.result, argv[4]);
+        if (ok && ftruncate(fd, fetch.size) == -1)
+        {
+            perror("ftruncate");
+            ok = false;
+        }
+        if (ok)
+        {
+            double secs = (FtCo::monoMs() - startMs) / 1000.0;
+            std::cout << "Received " << fetch.size << " bytes in " << secs
+                      << " s with " << streams << " streams\n";
+        }
+    }
+    if (fd != -1)
+    {
+        close(fd);
+        if (!ok)
+        {
+            unlink(name);
+        }
+    }
+    delete client;
+
+    return (ok ? 0 : 1);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: printUsage()
+ *
+ *    Entry: The program name
+ *
+ *     Exit: Exits the program
+ *
+ *  Purpose: Explain the command line
+ *
+ *
+ *   *   *   *   *   *   */
+void printUsage(const char *prog)
+{
+    std::cerr << "Usage: " << prog << " serv_hostname serv_port# -l"
+              << " [term ...]\n"
+              << "       " << prog << " serv_hostname serv_port# -g file"
+              << " [streams]\n"
+              << "       " << prog << " serv_hostname serv_port# -r file"
+              << " offset length\n"
+              << "       " << prog << " serv_hostname serv_port# -s file\n"
+              << "       " << prog << " serv_hostname serv_port# -u file"
+              << " [loss% [delay_ms]]\n"
+              << "       " << prog << " -local path -l [term ...]\n"
+              << "       " << prog << " -local path -g file [streams]\n"
+              << "       " << prog << " -local path -r file offset"
+              << " length\n";
+    exit(1);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: report()
+ *
+ *    Entry: The result of a request and the file name
+ *
+ *     Exit: Returns true if the request succeeded
+ *
+ *  Purpose: Print why a request did not succeed
+ *
+ *
+ *   *   *   *   *   *   */
+bool report(const FtClient::Result &result, const char *file)
+{
+    if (result.status == FtClient::FT_NOT_FOUND)
+    {
+        std::cout << "\"" << file << "\": FILE NOT FOUND\n";
+    }
+    else if (result.status == FtClient::FT_FAILED)
+    {
+        std::cout << "Request failed: " << strerror(result.err) << "\n";
+    }
+
+    return (result.status == FtClient::FT_OK);
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: listTask()
+ *
+ *    Entry: The client, the filter terms or an empty string, and a flag
+ *           for success
+ *
+ *     Exit: Prints the names in the server's directory that pass the terms
+ *
+ *  Purpose: Run a listing; A page with more after it is followed by a
+ *           request for the names after its last one, which replaces any
+ *           cursor in the terms
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> listTask(FtClient::Client &client, const std::string &terms,
+                      bool *ok)
+{
+    std::vector<std::string> names;
+    std::string filter = terms;
+    FtClient::Result result;
+
+    do
+    {
+        names.clear();
+        result = co_await client.list(&names, filter.empty() ? NULL
+                                                             : filter.c_str());
+        for (std::size_t i = 0; i < names.size(); i++)
+        {
+            std::cout << names[i] << "\n";
+        }
+        if (!names.empty())
+        {
+            filter = terms + " after=" + names.back();
+        }
+    } while (result.status == FtClient::FT_OK && result.more
+             && !names.empty());
+
+    *ok = report(result, "");
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: getTask()
+ *
+ *    Entry: The client, the file name, the offset and length to fetch, or
+ *           -1 for the whole file, true for a sparse get, the shim of a UDP
+ *           get or NULL, the output file, and a flag for success
+ *
+ *     Exit: Writes the data to fd and prints the transfer rate
+ *
+ *  Purpose: Run one get or ranged get
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> getTask(FtClient::Client &client, const char *file,
+                     long long offset, long long length, bool sparse,
+                     const FtUdp::Shim *udp, int fd, bool *ok)
+{
+    long long startMs = FtCo::monoMs();
+    FtClient::Result result;
+
+    if (udp != NULL)
+    {
+        result = co_await client.getUdp(file, fd, udp);
+    }
+    else if (sparse)
+    {
+        result = co_await client.getSparse(file, fd);
+    }
+    else if (length == -1)
+    {
+        result = co_await client.get(file, fd);
+    }
+    else
+    {
+        result = co_await client.getRange(file, offset, length, fd, 0);
+    }
+
+    *ok = report(result, file);
+    if (*ok)
+    {
+        double secs = (FtCo::monoMs() - startMs) / 1000.0;
+        std::cout << "Received " << result.bytes << " bytes in " << secs
+                  << " s\n";
+    }
+}
+
+/*   *   *   *   *   *   *
+ *
+ * Function: blockWorker()
+ *
+ *    Entry: The client and the shared state of the fetch
+ *
+ *     Exit: Returns once no blocks before the end of the file are left
+ *
+ *  Purpose: Take the next block and fetch it with a ranged get; Blocks
+ *           are a whole number of chunks, so the server reads them in the
+ *           same chunks as a plain get
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> blockWorker(FtClient::Client &client, Fetch *fetch)
+{
+    while (fetch->result.status == FtClient::FT_OK
+           && (fetch->endBlock == -1 || fetch->nextBlock <= fetch->endBlock))
+    {
+        long long block = fetch->nextBlock++;
+        long long off = block * BLOCK_SIZE;
+        FtClient::Result result = co_await client.getRange(fetch->file, off,
+                                                           BLOCK_SIZE,
+                                                           fetch->fd, off);
+        if (result.status != FtClient::FT_OK)
+        {
+            fetch->result = result;
+            co_return;
+        }
+
+        // The first short block is the last one
+        if (result.bytes < BLOCK_SIZE
+            && (fetch->endBlock == -1 || block < fetch->endBlock))
+        {
+            fetch->endBlock = block;
+            fetch->size = off + result.bytes;
+        }
+    }
+}
@@ -0,0 +1,599 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftflight.cpp
+ *           Overview: This is the implementation file for the ftserve
+ *                     single-flight chunk cache
+ *
+ *                     A chunk is named by its file's device, inode, size, and
+ *                     mtime and its offset, so a changed file never matches
+ *                     an old chunk. Chunks are found through a hash table of
+ *                     chains and reused with the clock algorithm; A chunk in
+ *                     use or being filled is never reused
+ *
+ *                     Each process using the pool has a holder slot naming
+ *                     the one chunk it holds a reference on. When the parent
+ *                     reaps a child it marks the child's slot, and the next
+ *                     session to lock the pool drops that reference, or
+ *                     frees the chunk if the child died filling it
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <atomic>
+#include <pthread.h>
+#include <unistd.h>
+#include "ftflight.h"
+#include "ftshm.h"
+
+namespace FtFlight
+{
+    const int POOL_CHUNKS = 4096; // Buffers in the pool
+    const int BUCKETS     = 8192; // Hash chains for finding a chunk
+    const int MAX_HOLDERS = 1024; // Processes using the pool at once
+    const long WAIT_NSEC  = 100000000; // Re-check a chunk's reader this often
+
+    /*
+     * States of a pool buffer
+     */
+    enum State
+    {
+        CHUNK_FREE = 0,
+        CHUNK_FILLING,
+        CHUNK_READY
+    };
+
+    /*
+     * The file version and offset a buffer holds
+     */
+    struct Key
+    {
+        dev_t     dev;
+        ino_t     ino;
+        off_t     size;
+        long long mtimeNs;
+        long long off;
+    };
+
+    /*
+     * A pool buffer; refs counts the sessions copying from it, and used is
+     * the clock algorithm's reference bit
+     */
+    struct Chunk
+    {
+        int   state;
+        int   refs;
+        int   next;
+        int   len;
+        bool  used;
+        Key   key;
+    };
+
+    /*
+     * A process using the pool; chunk is the buffer it holds a reference on,
+     * or -1, and gone is set once the parent has reaped it
+     */
+    struct Holder
+    {
+        std::atomic<pid_t> pid;
+        std::atomic<bool>  gone;
+        int                chunk;
+    };
+
+    /*
+     * The pool shared by the parent and all child processes; The chunk data
+     * follows it in the same mapping
+     */
+    struct Pool
+    {
+        pthread_mutex_t  lock;
+        pthread_cond_t   filled;
+        int              chunkSize;
+        int              hand;
+        std::atomic<int> reaped;
+        int              buckets[BUCKETS];
+        Chunk            chunks[POOL_CHUNKS];
+        Holder           holders[MAX_HOLDERS];
+    };
+
+    // Shared pool and its data; NULL if it could not be set up
+    static Pool *pool = NULL;
+    static char *chunkData = NULL;
+
+    // This process's holder slot; -1 until it first uses the pool
+    static int holder = -1;
+
+    /*
+     * Helpers local to this file
+     */
+    static int readPiece(int fd, const struct stat &st, long long base,
+                         int skip, char *dst, int len);
+    static Key makeKey(const struct stat &st, long long off);
+    static bool sameKey(const Key &a, const Key &b);
+    static int bucketOf(const Key &key);
+    static int findChunk(const Key &key);
+    static void unlinkChunk(int id);
+    static int claimChunk();
+    static bool joinPool();
+    static void holdChunk(int id);
+    static void releaseChunk(int id);
+    static void sweepHolders();
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initFlight()
+     *
+     *    Entry: The chunk size in bytes
+     *
+     *     Exit: Returns true if the shared pool is mapped
+     *
+     *  Purpose: Create the pool before the server forks children; Pages of
+     *           the pool are only backed by memory once they are used
+     *
+     *
+     *   *   *   *   *   *   */
+    bool initFlight(int chunkSize)
+    {
+        std::size_t size = sizeof(Pool)
+                           + static_cast<std::size_t>(POOL_CHUNKS) * chunkSize;
+        void *mem = FtShm::mapShared(size);
+        if (mem == NULL)
+        {
+            return (false);
+        }
+        Pool *p = static_cast<Pool *>(mem);
+        FtShm::initLock(&p->lock);
+        FtShm::initCond(&p->filled);
+
+        p->chunkSize = chunkSize;
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            p->buckets[i] = -1;
+        }
+
+        pool = p;
+        chunkData = static_cast<char *>(mem) + sizeof(Pool);
+        return (true);
+    }
+
+    bool canShare(const struct stat &st)
+    {
+        return (pool != NULL && S_ISREG(st.st_mode));
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: readChunk()
+     *
+     *    Entry: The open file, its stat, an offset, and a buffer for up to
+     *           len bytes
+     *
+     *     Exit: Returns the bytes copied, 0 at the end of the file, or -1
+     *
+     *  Purpose: Copy the range from the pool chunks it spans, so transfers
+     *           share chunks whatever size of piece each one sends
+     *
+     *
+     *   *   *   *   *   *   */
+    int readChunk(int fd, const struct stat &st, long long off, char *dst,
+                  int len)
+    {
+        if (!canShare(st))
+        {
+            return (pread(fd, dst, len, off));
+        }
+
+        int done = 0;
+        while (done < len)
+        {
+            long long pos = off + done;
+            int skip = pos % pool->chunkSize;
+            int want = pool->chunkSize - skip;
+            if (len - done < want)
+            {
+                want = len - done;
+            }
+
+            int n = readPiece(fd, st, pos - skip, skip, dst + done, want);
+            if (n == -1)
+            {
+                return (done > 0 ? done : -1);
+            }
+            done += n;
+            if (n < want)
+            {
+                break;
+            }
+        }
+
+        return (done);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: readPiece()
+     *
+     *    Entry: The open file, its stat, the offset of a pool chunk, and the
+     *           bytes to skip and then copy from it into dst
+     *
+     *     Exit: Returns the bytes copied, 0 at the end of the file, or -1
+     *
+     *  Purpose: Serve a chunk from the pool; The first session to ask for it
+     *           reads it while later ones wait, and a session that finds its
+     *           reader gone reads it itself
+     *
+     *
+     *   *   *   *   *   *   */
+    static int readPiece(int fd, const struct stat &st, long long base,
+                         int skip, char *dst, int len)
+    {
+        Key key = makeKey(st, base);
+        FtShm::lock(&pool->lock);
+        sweepHolders();
+        if (holder == -1 && !joinPool())
+        {
+            // Every holder slot is taken; Read around the pool
+            pthread_mutex_unlock(&pool->lock);
+            return (pread(fd, dst, len, base + skip));
+        }
+        int id = findChunk(key);
+
+        while (id == -1 || pool->chunks[id].state != CHUNK_READY)
+        {
+            if (id == -1)
+            {
+                id = claimChunk();
+                if (id == -1)
+                {
+                    // Every buffer is busy; Read around the pool
+                    pthread_mutex_unlock(&pool->lock);
+                    return (pread(fd, dst, len, base + skip));
+                }
+
+                Chunk *c = &pool->chunks[id];
+                c->state = CHUNK_FILLING;
+                holdChunk(id);
+                c->key = key;
+                c->next = pool->buckets[bucketOf(key)];
+                pool->buckets[bucketOf(key)] = id;
+                pthread_mutex_unlock(&pool->lock);
+
+                long n = pread(fd, chunkData + static_cast<long>(id)
+                               * pool->chunkSize, pool->chunkSize, base);
+                int err = errno;
+
+                FtShm::lock(&pool->lock);
+                if (n == -1)
+                {
+                    pool->holders[holder].chunk = -1;
+                    unlinkChunk(id);
+                    pthread_cond_broadcast(&pool->filled);
+                    pthread_mutex_unlock(&pool->lock);
+                    errno = err;
+                    return (-1);
+                }
+                c->len = n;
+                c->state = CHUNK_READY;
+                pthread_cond_broadcast(&pool->filled);
+
+                // Drop the fill's reference; The copy below takes its own
+                releaseChunk(id);
+                continue;
+            }
+
+            // Another session is reading it; If the parent reaps it first,
+            // the sweep frees the chunk and this session reads it instead
+            FtShm::timedWait(&pool->filled, &pool->lock, WAIT_NSEC);
+            sweepHolders();
+            id = findChunk(key);
+        }
+
+        Chunk *c = &pool->chunks[id];
+        holdChunk(id);
+        c->used = true;
+        pthread_mutex_unlock(&pool->lock);
+
+        int n = c->len - skip;
+        if (n < 0)
+        {
+            n = 0;
+        }
+        if (len < n)
+        {
+            n = len;
+        }
+        memcpy(dst, chunkData + static_cast<long>(id) * pool->chunkSize + skip,
+               n);
+
+        FtShm::lock(&pool->lock);
+        releaseChunk(id);
+        pthread_mutex_unlock(&pool->lock);
+
+        return (n);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: reapChild()
+     *
+     *    Entry: The pid of a child the parent has reaped
+     *
+     *     Exit: The child's holder slot is marked for the next sweep
+     *
+     *  Purpose: Let the pool take back what a killed child held without
+     *           locking it in a signal handler; The slot is matched before
+     *           the pid can be reused, so a new child is never mistaken for it
+     *
+     *
+     *   *   *   *   *   *   */
+    void reapChild(pid_t pid)
+    {
+        if (pool == NULL || pid <= 0)
+        {
+            return;
+        }
+
+        for (int h = 0; h < MAX_HOLDERS; h++)
+        {
+            Holder *hd = &pool->holders[h];
+            if (hd->pid.load() == pid && !hd->gone.load())
+            {
+                hd->gone.store(true);
+                pool->reaped++;
+                return;
+            }
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: makeKey()
+     *
+     *    Entry: A file's stat and a chunk offset
+     *
+     *     Exit: Returns the key of that chunk of that version of the file
+     *
+     *  Purpose: Name a chunk
+     *
+     *
+     *   *   *   *   *   *   */
+    static Key makeKey(const struct stat &st, long long off)
+    {
+        Key key;
+        memset(&key, 0, sizeof key);
+        key.dev = st.st_dev;
+        key.ino = st.st_ino;
+        key.size = st.st_size;
+        key.mtimeNs = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        key.off = off;
+        return (key);
+    }
+
+    static bool sameKey(const Key &a, const Key &b)
+    {
+        return (a.off == b.off && a.ino == b.ino && a.dev == b.dev
+                && a.size == b.size && a.mtimeNs == b.mtimeNs);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: bucketOf()
+     *
+     *    Entry: A chunk key
+     *
+     *     Exit: Returns its hash chain
+     *
+     *  Purpose: Spread the chunks of one file over the chains
+     *
+     *
+     *   *   *   *   *   *   */
+    static int bucketOf(const Key &key)
+    {
+        unsigned long long h = static_cast<unsigned long long>(key.ino);
+        h = h * 0x9e3779b97f4a7c15ULL + key.dev;
+        h = h * 0x9e3779b97f4a7c15ULL + key.mtimeNs;
+        h = h * 0x9e3779b97f4a7c15ULL + key.off / pool->chunkSize;
+        return (static_cast<int>((h >> 32) % BUCKETS));
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: findChunk()
+     *
+     *    Entry: A chunk key; The pool lock must be held
+     *
+     *     Exit: Returns the buffer holding or filling the chunk, or -1
+     *
+     *  Purpose: Look up a chunk
+     *
+     *
+     *   *   *   *   *   *   */
+    static int findChunk(const Key &key)
+    {
+        for (int id = pool->buckets[bucketOf(key)]; id != -1;
+             id = pool->chunks[id].next)
+        {
+            if (sameKey(pool->chunks[id].key, key))
+            {
+                return (id);
+            }
+        }
+
+        return (-1);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: unlinkChunk()
+     *
+     *    Entry: A buffer in use; The pool lock must be held
+     *
+     *     Exit: The buffer is off its chain and free
+     *
+     *  Purpose: Drop a chunk from the pool
+     *
+     *
+     *   *   *   *   *   *   */
+    static void unlinkChunk(int id)
+    {
+        int *link = &pool->buckets[bucketOf(pool->chunks[id].key)];
+        while (*link != id)
+        {
+            link = &pool->chunks[*link].next;
+        }
+        *link = pool->chunks[id].next;
+
+        memset(&pool->chunks[id], 0, sizeof(Chunk));
+        pool->chunks[id].next = -1;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: claimChunk()
+     *
+     *    Entry: None; The pool lock must be held
+     *
+     *     Exit: Returns a free buffer, or -1 if all are in use
+     *
+     *  Purpose: Find a buffer with the clock algorithm; A recently used
+     *           chunk gets a second pass before it is reused
+     *
+     *
+     *   *   *   *   *   *   */
+    static int claimChunk()
+    {
+        for (int scan = 0; scan < 2 * POOL_CHUNKS; scan++)
+        {
+            int id = pool->hand;
+            Chunk *c = &pool->chunks[id];
+            pool->hand = (pool->hand + 1) % POOL_CHUNKS;
+
+            if (c->state == CHUNK_FREE)
+            {
+                return (id);
+            }
+            if (c->state == CHUNK_FILLING || c->refs > 0)
+            {
+                continue;
+            }
+            if (c->used)
+            {
+                c->used = false;
+                continue;
+            }
+
+            unlinkChunk(id);
+            return (id);
+        }
+
+        return (-1);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: joinPool()
+     *
+     *    Entry: None; The pool lock must be held
+     *
+     *     Exit: Returns true if this process has a holder slot
+     *
+     *  Purpose: Give the process a slot the first time it uses the pool
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool joinPool()
+    {
+        for (int h = 0; h < MAX_HOLDERS; h++)
+        {
+            Holder *hd = &pool->holders[h];
+            if (hd->pid.load() == 0)
+            {
+                hd->chunk = -1;
+                hd->gone.store(false);
+                hd->pid.store(getpid());
+                holder = h;
+                return (true);
+            }
+        }
+
+        return (false);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: holdChunk()
+     *
+     *    Entry: A buffer; The pool lock must be held and this process must
+     *           hold no other buffer
+     *
+     *     Exit: The buffer has one more reference, owned by this process
+     *
+     *  Purpose: Keep the buffer from being reused while it is filled or
+     *           copied
+     *
+     *
+     *   *   *   *   *   *   */
+    static void holdChunk(int id)
+    {
+        pool->chunks[id].refs++;
+        pool->holders[holder].chunk = id;
+    }
+
+    static void releaseChunk(int id)
+    {
+        pool->chunks[id].refs--;
+        pool->holders[holder].chunk = -1;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: sweepHolders()
+     *
+     *    Entry: None; The pool lock must be held
+     *
+     *     Exit: The slots of reaped children are free again
+     *
+     *  Purpose: Drop the reference each reaped child held, freeing a chunk
+     *           it died filling, and wake the sessions waiting on one
+     *
+     *
+     *   *   *   *   *   *   */
+    static void sweepHolders()
+    {
+        if (pool->reaped.exchange(0) == 0)
+        {
+            return;
+        }
+
+        for (int h = 0; h < MAX_HOLDERS; h++)
+        {
+            Holder *hd = &pool->holders[h];
+            if (!hd->gone.load())
+            {
+                continue;
+            }
+
+            int id = hd->chunk;
+            if (id != -1 && pool->chunks[id].state == CHUNK_FILLING)
+            {
+                unlinkChunk(id);
+            }
+            else if (id != -1 && pool->chunks[id].refs > 0)
+            {
+                pool->chunks[id].refs--;
+            }
+
+            hd->chunk = -1;
+            hd->gone.store(false);
+            hd->pid.store(0);
+        }
+
+        pthread_cond_broadcast(&pool->filled);
+    }
+} // FtFlight
@@ -0,0 +1,55 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftflight.h
+ *           Overview: This is the header file for the ftserve single-flight
+ *                     chunk cache. Chunks of regular files are read into a
+ *                     pool of buffers in memory shared by all of the forked
+ *                     children. When many sessions send the same file, the
+ *                     first to need a chunk reads it from disk while the
+ *                     others wait for it, and every session copies from the
+ *                     one buffer; A buffer is reference counted while it is
+ *                     copied so it cannot be reused underneath a reader, and
+ *                     the references of a child the parent reaps are dropped
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTFLIGHT_H
+#define FTFLIGHT_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace FtFlight
+{
+    /*
+     * The initFlight() function maps the shared buffer pool for chunks of
+     * chunkSize bytes; It must be called by the parent before any fork()
+     */
+    bool initFlight(int chunkSize);
+
+    /*
+     * The canShare() function returns true if reads of the file with the
+     * stat st may go through the pool
+     */
+    bool canShare(const struct stat &st);
+
+    /*
+     * The readChunk() function copies up to len bytes of the file at off into
+     * dst, reading each pool chunk it spans only if no session has; Same
+     * result as pread()
+     */
+    int readChunk(int fd, const struct stat &st, long long off, char *dst,
+                  int len);
+
+    /*
+     * The reapChild() function marks the pool's references of an exited
+     * child for release; Safe to call from a signal handler
+     */
+    void reapChild(pid_t pid);
+} // FtFlight
+#endif // FTFLIGHT_H
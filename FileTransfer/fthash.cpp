@@ -0,0 +1,561 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: fthash.cpp
+ *           Overview: This is the implementation file for the ftserve content
+ *                     hash cache
+ *
+ *                     An entry is keyed by name and carries the inode, size,
+ *                     and mtime it was hashed at; Any change to them makes
+ *                     the entry stale and queues it again. The thread checks
+ *                     the key before and after hashing, so a file written
+ *                     while it is read is never cached with a wrong hash
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <pthread.h>
+#include <semaphore.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "fthash.h"
+#include "ftshm.h"
+
+namespace FtHash
+{
+    const int MAX_ENTRIES = 1024; // Files kept in the cache
+    const int NAME_LEN    = 256; // Longest file name cached
+    const int READ_SIZE   = 65536; // Bytes read per hashing step
+
+    /*
+     * States of a cache entry
+     */
+    enum State
+    {
+        ENTRY_FREE = 0,
+        ENTRY_PENDING,
+        ENTRY_HASHING,
+        ENTRY_READY
+    };
+
+    /*
+     * The file identity a hash is valid for
+     */
+    struct Key
+    {
+        ino_t     ino;
+        off_t     size;
+        long long mtimeNs;
+    };
+
+    /*
+     * A cached file; lastUsed orders entries for eviction
+     */
+    struct Entry
+    {
+        int       state;
+        Key       key;
+        long long lastUsed;
+        char      name[NAME_LEN];
+        char      hex[HASH_HEX + 1];
+    };
+
+    /*
+     * The cache shared by the parent and all child processes; work counts
+     * the queued entries for the hashing thread
+     */
+    struct HashTable
+    {
+        pthread_mutex_t lock;
+        sem_t           work;
+        long long       clock;
+        Entry           entries[MAX_ENTRIES];
+    };
+
+    /*
+     * Running state of a SHA-256
+     */
+    struct Sha256
+    {
+        uint32_t      h[8];
+        uint64_t      bytes;
+        unsigned char block[64];
+        int           used;
+    };
+
+    // SHA-256 round constants
+    static const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b,
+        0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01,
+        0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7,
+        0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152,
+        0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+        0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819,
+        0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08,
+        0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+        0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    // Shared cache; NULL if it could not be set up
+    static HashTable *table = NULL;
+
+    /*
+     * Helpers local to this file
+     */
+    static void *hashThread(void *arg);
+    static bool hashFile(const char *name, const Key &key, char *hex);
+    static Key makeKey(const struct stat &st);
+    static bool sameKey(const Key &a, const Key &b);
+    static void shaInit(Sha256 *sha);
+    static void shaUpdate(Sha256 *sha, const unsigned char *data, long len);
+    static void shaFinish(Sha256 *sha, char *hex);
+    static void shaBlock(Sha256 *sha, const unsigned char *block);
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initHashCache()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns true if the shared cache is mapped and the hashing
+     *           thread is running
+     *
+     *  Purpose: Create the cache before the server forks children
+     *
+     *
+     *   *   *   *   *   *   */
+    bool initHashCache()
+    {
+        void *mem = FtShm::mapShared(sizeof(HashTable));
+        if (mem == NULL)
+        {
+            return (false);
+        }
+        HashTable *t = static_cast<HashTable *>(mem);
+        FtShm::initLock(&t->lock);
+
+        if (sem_init(&t->work, 1, 0) == -1)
+        {
+            munmap(mem, sizeof(HashTable));
+            return (false);
+        }
+
+        table = t;
+        if (!FtShm::startWorker(hashThread, t))
+        {
+            table = NULL;
+            munmap(mem, sizeof(HashTable));
+            return (false);
+        }
+
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: lookup()
+     *
+     *    Entry: The file name, its stat, and a buffer for the hash
+     *
+     *     Exit: Returns true with the hash in hex if the cache holds it for
+     *           this version of the file; Otherwise queues the file
+     *
+     *  Purpose: Answer from the cache without touching the file data; A
+     *           new file takes a free entry or the least recently used one
+     *
+     *
+     *   *   *   *   *   *   */
+    bool lookup(const char *name, const struct stat &st, char *hex)
+    {
+        if (table == NULL || std::strlen(name) >= NAME_LEN)
+        {
+            return (false);
+        }
+
+        Key key = makeKey(st);
+        Entry *victim = NULL;
+        FtShm::lock(&table->lock);
+        table->clock++;
+
+        for (int i = 0; i < MAX_ENTRIES; i++)
+        {
+            Entry *e = &table->entries[i];
+            if (e->state != ENTRY_FREE && strcmp(e->name, name) == 0)
+            {
+                e->lastUsed = table->clock;
+                if (sameKey(e->key, key))
+                {
+                    bool ready = (e->state == ENTRY_READY);
+                    if (ready)
+                    {
+                        memcpy(hex, e->hex, HASH_HEX + 1);
+                    }
+                    pthread_mutex_unlock(&table->lock);
+                    return (ready);
+                }
+
+                // The file changed; A result being hashed will be dropped
+                victim = e;
+                break;
+            }
+
+            // Never evict the entry the thread is reading
+            if (e->state != ENTRY_HASHING
+                && (victim == NULL || e->state == ENTRY_FREE
+                    || (victim->state != ENTRY_FREE
+                        && e->lastUsed < victim->lastUsed)))
+            {
+                victim = e;
+            }
+        }
+
+        if (victim != NULL)
+        {
+            if (strcmp(victim->name, name) != 0)
+            {
+                strcpy(victim->name, name);
+            }
+            victim->key = key;
+            victim->lastUsed = table->clock;
+            victim->state = ENTRY_PENDING;
+            sem_post(&table->work);
+        }
+
+        pthread_mutex_unlock(&table->lock);
+        return (false);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: hashThread()
+     *
+     *    Entry: The shared cache
+     *
+     *     Exit: Never returns
+     *
+     *  Purpose: Hash each queued file outside the lock and publish the
+     *           result unless the entry was queued again meanwhile
+     *
+     *
+     *   *   *   *   *   *   */
+    static void *hashThread(void *arg)
+    {
+        HashTable *t = static_cast<HashTable *>(arg);
+        char name[NAME_LEN];
+        char hex[HASH_HEX + 1];
+
+        while (1)
+        {
+            if (sem_wait(&t->work) == -1)
+            {
+                continue;
+            }
+
+            Entry *e = NULL;
+            Key key;
+            FtShm::lock(&table->lock);
+            for (int i = 0; i < MAX_ENTRIES && e == NULL; i++)
+            {
+                if (t->entries[i].state == ENTRY_PENDING)
+                {
+                    e = &t->entries[i];
+                    e->state = ENTRY_HASHING;
+                    key = e->key;
+                    strcpy(name, e->name);
+                }
+            }
+            pthread_mutex_unlock(&t->lock);
+
+            if (e == NULL)
+            {
+                continue;
+            }
+
+            bool ok = hashFile(name, key, hex);
+
+            // A lookup that saw a newer version has already queued it again
+            FtShm::lock(&table->lock);
+            if (e->state == ENTRY_HASHING)
+            {
+                if (ok)
+                {
+                    memcpy(e->hex, hex, HASH_HEX + 1);
+                    e->state = ENTRY_READY;
+                }
+                else
+                {
+                    e->state = ENTRY_FREE;
+                }
+            }
+            pthread_mutex_unlock(&t->lock);
+        }
+
+        return (NULL);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: hashFile()
+     *
+     *    Entry: The file name, the key it was queued with, and a buffer for
+     *           the hash
+     *
+     *     Exit: Returns true with the hash if the file kept that key while
+     *           it was read
+     *
+     *  Purpose: Compute the SHA-256 of one version of a file
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool hashFile(const char *name, const Key &key, char *hex)
+    {
+        static unsigned char buf[READ_SIZE];
+        struct stat st;
+        Sha256 sha;
+
+        int fd = open(name, O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            return (false);
+        }
+        if (fstat(fd, &st) == -1 || !sameKey(makeKey(st), key))
+        {
+            close(fd);
+            return (false);
+        }
+
+        shaInit(&sha);
+        long n;
+        while ((n = read(fd, buf, READ_SIZE)) > 0)
+        {
+            shaUpdate(&sha, buf, n);
+        }
+
+        bool ok = (n == 0 && fstat(fd, &st) == 0 && sameKey(makeKey(st), key));
+        close(fd);
+
+        if (ok)
+        {
+            shaFinish(&sha, hex);
+        }
+        return (ok);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: makeKey()
+     *
+     *    Entry: A file's stat
+     *
+     *     Exit: Returns its cache key
+     *
+     *  Purpose: Identify one version of a file
+     *
+     *
+     *   *   *   *   *   *   */
+    static Key makeKey(const struct stat &st)
+    {
+        Key key;
+        key.ino = st.st_ino;
+        key.size = st.st_size;
+        key.mtimeNs = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        return (key);
+    }
+
+    static bool sameKey(const Key &a, const Key &b)
+    {
+        return (a.ino == b.ino && a.size == b.size && a.mtimeNs == b.mtimeNs);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: shaInit()
+     *
+     *    Entry: A SHA-256 state
+     *
+     *     Exit: The state holds the initial hash values
+     *
+     *  Purpose: Start a SHA-256
+     *
+     *
+     *   *   *   *   *   *   */
+    static void shaInit(Sha256 *sha)
+    {
+        static const uint32_t H0[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+
+        memcpy(sha->h, H0, sizeof H0);
+        sha->bytes = 0;
+        sha->used = 0;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: shaUpdate()
+     *
+     *    Entry: A SHA-256 state and the next len bytes of the message
+     *
+     *     Exit: Every complete 64 byte block has been processed
+     *
+     *  Purpose: Add data to a SHA-256
+     *
+     *
+     *   *   *   *   *   *   */
+    static void shaUpdate(Sha256 *sha, const unsigned char *data, long len)
+    {
+        sha->bytes += len;
+
+        // Top up a partial block first
+        if (sha->used > 0)
+        {
+            int take = 64 - sha->used;
+            if (len < take)
+            {
+                take = len;
+            }
+            memcpy(sha->block + sha->used, data, take);
+            sha->used += take;
+            data += take;
+            len -= take;
+            if (sha->used < 64)
+            {
+                return;
+            }
+            shaBlock(sha, sha->block);
+            sha->used = 0;
+        }
+
+        while (len >= 64)
+        {
+            shaBlock(sha, data);
+            data += 64;
+            len -= 64;
+        }
+
+        memcpy(sha->block, data, len);
+        sha->used = len;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: shaFinish()
+     *
+     *    Entry: A SHA-256 state and a buffer for HASH_HEX + 1 chars
+     *
+     *     Exit: The padded message is processed and the hash written in hex
+     *
+     *  Purpose: End a SHA-256
+     *
+     *
+     *   *   *   *   *   *   */
+    static void shaFinish(Sha256 *sha, char *hex)
+    {
+        static const char DIGITS[] = "0123456789abcdef";
+        uint64_t bits = sha->bytes * 8;
+
+        // Pad with 0x80, zeros, and the bit length so the last block is full
+        sha->block[sha->used++] = 0x80;
+        if (sha->used > 56)
+        {
+            memset(sha->block + sha->used, 0, 64 - sha->used);
+            shaBlock(sha, sha->block);
+            sha->used = 0;
+        }
+        memset(sha->block + sha->used, 0, 56 - sha->used);
+        for (int i = 0; i < 8; i++)
+        {
+            sha->block[63 - i] = static_cast<unsigned char>(bits >> (8 * i));
+        }
+        shaBlock(sha, sha->block);
+
+        for (int i = 0; i < 8; i++)
+        {
+            for (int j = 0; j < 8; j++)
+            {
+                hex[i * 8 + j] = DIGITS[(sha->h[i] >> (28 - 4 * j)) & 0xf];
+            }
+        }
+        hex[HASH_HEX] = '\0';
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: shaBlock()
+     *
+     *    Entry: A SHA-256 state and a 64 byte block
+     *
+     *     Exit: The block is mixed into the hash values
+     *
+     *  Purpose: Run the SHA-256 compression function
+     *
+     *
+     *   *   *   *   *   *   */
+    static void shaBlock(Sha256 *sha, const unsigned char *block)
+    {
+        uint32_t w[64];
+
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = (static_cast<uint32_t>(block[i * 4]) << 24)
+                   | (static_cast<uint32_t>(block[i * 4 + 1]) << 16)
+                   | (static_cast<uint32_t>(block[i * 4 + 2]) << 8)
+                   | static_cast<uint32_t>(block[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; i++)
+        {
+            uint32_t s0 = ((w[i - 15] >> 7) | (w[i - 15] << 25))
+                          ^ ((w[i - 15] >> 18) | (w[i - 15] << 14))
+                          ^ (w[i - 15] >> 3);
+            uint32_t s1 = ((w[i - 2] >> 17) | (w[i - 2] << 15))
+                          ^ ((w[i - 2] >> 19) | (w[i - 2] << 13))
+                          ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = sha->h[0], b = sha->h[1], c = sha->h[2], d = sha->h[3];
+        uint32_t e = sha->h[4], f = sha->h[5], g = sha->h[6], h = sha->h[7];
+
+        for (int i = 0; i < 64; i++)
+        {
+            uint32_t s1 = ((e >> 6) | (e << 26)) ^ ((e >> 11) | (e << 21))
+                          ^ ((e >> 25) | (e << 7));
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + ch + K[i] + w[i];
+            uint32_t s0 = ((a >> 2) | (a << 30)) ^ ((a >> 13) | (a << 19))
+                          ^ ((a >> 22) | (a << 10));
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        sha->h[0] += a;
+        sha->h[1] += b;
+        sha->h[2] += c;
+        sha->h[3] += d;
+        sha->h[4] += e;
+        sha->h[5] += f;
+        sha->h[6] += g;
+        sha->h[7] += h;
+    }
+} // FtHash
@@ -0,0 +1,40 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: fthash.h
+ *           Overview: This is the header file for the ftserve content hash
+ *                     cache. It maps a file's (inode, size, mtime) to the
+ *                     SHA-256 of its contents in memory shared by all of the
+ *                     forked children. A lookup never reads the file; A miss
+ *                     queues the file for a background thread in the parent,
+ *                     which hashes it for later requests
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTHASH_H
+#define FTHASH_H
+
+#include <sys/stat.h>
+
+namespace FtHash
+{
+    const int HASH_HEX = 64; // Length of a SHA-256 in hex
+
+    /*
+     * The initHashCache() function maps the shared cache and starts the
+     * hashing thread; It must be called by the parent before any fork()
+     */
+    bool initHashCache();
+
+    /*
+     * The lookup() function copies the cached hash of the file name with the
+     * stat st into hex, which holds HASH_HEX + 1 chars, and returns true; On
+     * a miss it queues the file to be hashed and returns false
+     */
+    bool lookup(const char *name, const struct stat &st, char *hex);
+} // FtHash
+#endif // FTHASH_H
@@ -0,0 +1,668 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftio.cpp
+ *           Overview: This is the implementation file for the ftserve I/O
+ *                     backends
+ *
+ *                     The io_uring backend uses the io_uring_setup() and
+ *                     io_uring_enter() system calls directly. Each process
+ *                     has one small ring; Operations are queued on the
+ *                     submission ring and one io_uring_enter() both submits
+ *                     them and waits for their completions. A transfer's
+ *                     descriptors are registered so the chunk operations
+ *                     skip the per-operation file table lookup
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "ftio.h"
+
+namespace FtIo
+{
+    const unsigned RING_ENTRIES = 8; // Submission slots per ring
+    const int MAX_BATCH         = 4; // Operations in one chunk submission
+
+    /*
+     * Indexes of a transfer's descriptors in the registered file table
+     */
+    enum RegFile
+    {
+        REG_FILE = 0,
+        REG_DATA,
+        REG_CTL,
+        REG_PIPE_OUT,
+        REG_PIPE_IN,
+        REG_COUNT
+    };
+
+    /*
+     * A mapped io_uring; The pointers are into the shared ring memory
+     */
+    struct Ring
+    {
+        int                 fd;
+        unsigned            *sqHead;
+        unsigned            *sqTail;
+        unsigned            *sqMask;
+        unsigned            *sqArray;
+        unsigned            *cqHead;
+        unsigned            *cqTail;
+        unsigned            *cqMask;
+        struct io_uring_sqe *sqes;
+        struct io_uring_cqe *cqes;
+        void                *sqMap;
+        size_t              sqMapLen;
+        void                *cqMap;
+        size_t              cqMapLen;
+        size_t              sqesLen;
+        unsigned            queued;
+    };
+
+    // The backend, this process's ring, and the chunk transfer state
+    static Backend backend = IO_CLASSIC;
+    static Ring ring;
+    static bool ringOpen = false;
+    static int pipeFds[2] = { -1, -1 };
+    static int dataFd = -1;
+    static int ctlFd = -1;
+    static bool chunksRegistered = false;
+
+    /*
+     * Helpers local to this file
+     */
+    static bool openRing();
+    static void closeRing();
+    static struct io_uring_sqe *getSqe(int op, int fd, int tag);
+    static bool submitAndWait(int wanted, int *results);
+    static int runOne(int op, int fd, void *buf, int len, int flags);
+    static int drainPipe(int bytes);
+    static void closePipe();
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initIo()
+     *
+     *    Entry: The backend requested at startup
+     *
+     *     Exit: Returns true if the backend is in use; Otherwise the classic
+     *           backend is used
+     *
+     *  Purpose: Set up the parent's ring before any children are forked
+     *
+     *
+     *   *   *   *   *   *   */
+    bool initIo(Backend requested)
+    {
+        backend = IO_CLASSIC;
+        if (requested == IO_CLASSIC)
+        {
+            return (true);
+        }
+
+        if (!openRing())
+        {
+            return (false);
+        }
+
+        backend = IO_URING;
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initChild()
+     *
+     *    Entry: None
+     *
+     *     Exit: The child has a ring of its own
+     *
+     *  Purpose: Drop the ring inherited from the parent; Completions on a
+     *           shared ring could be reaped by the wrong process
+     *
+     *
+     *   *   *   *   *   *   */
+    void initChild()
+    {
+        if (backend != IO_URING)
+        {
+            return;
+        }
+
+        closeRing();
+        if (!openRing())
+        {
+            backend = IO_CLASSIC;
+        }
+    }
+
+    Backend getBackend()
+    {
+        return (backend);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: acceptConn()
+     *
+     *    Entry: The listening socket and the peer address buffer and length
+     *
+     *     Exit: Returns the new socket or -1 with errno set
+     *
+     *  Purpose: Accept a connection through the selected backend
+     *
+     *
+     *   *   *   *   *   *   */
+    int acceptConn(int fd, struct sockaddr *addr, socklen_t *addrLen)
+    {
+        if (backend == IO_CLASSIC)
+        {
+            return (accept(fd, addr, addrLen));
+        }
+
+        struct io_uring_sqe *sqe = getSqe(IORING_OP_ACCEPT, fd, 0);
+        sqe->addr = reinterpret_cast<unsigned long>(addr);
+        sqe->addr2 = reinterpret_cast<unsigned long>(addrLen);
+        sqe->accept_flags = SOCK_CLOEXEC;
+
+        int result;
+        if (!submitAndWait(1, &result))
+        {
+            return (-1);
+        }
+        if (result < 0)
+        {
+            errno = -result;
+            return (-1);
+        }
+
+        return (result);
+    }
+
+    int recvData(int fd, void *buf, int len)
+    {
+        if (backend == IO_CLASSIC)
+        {
+            return (recv(fd, buf, len, 0));
+        }
+
+        return (runOne(IORING_OP_RECV, fd, buf, len, 0));
+    }
+
+    int sendData(int fd, const void *buf, int len)
+    {
+        if (backend == IO_CLASSIC)
+        {
+            return (send(fd, buf, len, 0));
+        }
+
+        return (runOne(IORING_OP_SEND, fd, const_cast<void *>(buf), len, 0));
+    }
+
+    int readFile(int fd, void *buf, int len)
+    {
+        if (backend == IO_CLASSIC)
+        {
+            return (read(fd, buf, len));
+        }
+
+        return (runOne(IORING_OP_READ, fd, buf, len, 0));
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: beginChunks()
+     *
+     *    Entry: The open file, the data socket, and the control socket
+     *
+     *     Exit: Returns true if sendChunk() may be used for this transfer
+     *
+     *  Purpose: Register the transfer's descriptors and a pipe with the ring;
+     *           Only regular files are spliced since their size is known
+     *           before each chunk header is written
+     *
+     *
+     *   *   *   *   *   *   */
+    bool beginChunks(int file, int data, int ctl)
+    {
+        struct stat st;
+        if (backend != IO_URING || fstat(file, &st) == -1 ||
+            !S_ISREG(st.st_mode))
+        {
+            return (false);
+        }
+
+        if (pipeFds[0] == -1 && pipe2(pipeFds, O_CLOEXEC) == -1)
+        {
+            return (false);
+        }
+
+        int files[REG_COUNT];
+        files[REG_FILE] = file;
+        files[REG_DATA] = data;
+        files[REG_CTL] = ctl;
+        files[REG_PIPE_OUT] = pipeFds[0];
+        files[REG_PIPE_IN] = pipeFds[1];
+
+        if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_FILES,
+                    files, REG_COUNT) == -1)
+        {
+            return (false);
+        }
+
+        dataFd = data;
+        ctlFd = ctl;
+        chunksRegistered = true;
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: sendChunk()
+     *
+     *    Entry: The chunk header and its length, the file offset and length
+     *           of the chunk data, and a buffer for the client's ack
+     *
+     *     Exit: Returns the data bytes sent, or -1 if the chunk failed
+     *
+     *  Purpose: Queue the header send, a linked splice from the file into
+     *           the pipe and from the pipe into the data socket, and the ack
+     *           receive, then submit and wait for all four in one call; A
+     *           failed or short operation cancels the rest of the chain, so
+     *           the ack receive never waits on data that was not sent
+     *
+     *
+     *   *   *   *   *   *   */
+    int sendChunk(const char *header, int headerLen, long long off, int len,
+                  void *ackBuf, int ackLen)
+    {
+        // Header goes first; MSG_MORE holds it until the data follows
+        struct io_uring_sqe *sqe = getSqe(IORING_OP_SEND, REG_DATA, 0);
+        sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+        sqe->addr = reinterpret_cast<unsigned long>(header);
+        sqe->len = headerLen;
+        sqe->msg_flags = MSG_MORE | MSG_NOSIGNAL;
+
+        sqe = getSqe(IORING_OP_SPLICE, REG_PIPE_IN, 1);
+        sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+        sqe->splice_fd_in = REG_FILE;
+        sqe->splice_off_in = off;
+        sqe->off = -1;
+        sqe->len = len;
+        sqe->splice_flags = SPLICE_F_FD_IN_FIXED;
+
+        sqe = getSqe(IORING_OP_SPLICE, REG_DATA, 2);
+        sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+        sqe->splice_fd_in = REG_PIPE_OUT;
+        sqe->splice_off_in = -1;
+        sqe->off = -1;
+        sqe->len = len;
+        sqe->splice_flags = SPLICE_F_FD_IN_FIXED;
+
+        // The ack cannot arrive before the data, so it can wait in the ring
+        sqe = getSqe(IORING_OP_RECV, REG_CTL, 3);
+        sqe->flags |= IOSQE_FIXED_FILE;
+        sqe->addr = reinterpret_cast<unsigned long>(ackBuf);
+        sqe->len = ackLen;
+
+        int results[MAX_BATCH];
+        if (!submitAndWait(MAX_BATCH, results))
+        {
+            return (-1);
+        }
+
+        // A short splice into the pipe means the file shrank under us; What
+        // it did move must not start the next chunk
+        if (results[0] != headerLen || results[1] != len)
+        {
+            errno = results[1] < 0 ? -results[1] : EIO;
+            closePipe();
+            return (-1);
+        }
+
+        if (results[2] == len)
+        {
+            if (results[3] <= 0)
+            {
+                errno = results[3] < 0 ? -results[3] : ECONNRESET;
+                return (-1);
+            }
+            return (len);
+        }
+
+        // A socket may take part of the pipe, which cancelled the ack
+        // receive; Move the rest directly, then receive the ack on its own
+        int sent = results[2] < 0 ? 0 : results[2];
+        if (drainPipe(len - sent) == -1)
+        {
+            closePipe();
+            return (-1);
+        }
+
+        int ack = recvData(ctlFd, ackBuf, ackLen);
+        if (ack <= 0)
+        {
+            if (ack == 0)
+            {
+                errno = ECONNRESET;
+            }
+            return (-1);
+        }
+
+        return (len);
+    }
+
+    void endChunks()
+    {
+        if (chunksRegistered)
+        {
+            syscall(__NR_io_uring_register, ring.fd, IORING_UNREGISTER_FILES,
+                    NULL, 0);
+            chunksRegistered = false;
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: openRing()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns true if ring holds a mapped io_uring
+     *
+     *  Purpose: Create a ring and map its submission and completion queues
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool openRing()
+    {
+        struct io_uring_params p;
+        memset(&p, 0, sizeof p);
+        memset(&ring, 0, sizeof ring);
+
+        ring.fd = syscall(__NR_io_uring_setup, RING_ENTRIES, &p);
+        if (ring.fd == -1)
+        {
+            return (false);
+        }
+
+        // Older kernels map the two queues separately
+        ring.sqMapLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        ring.cqMapLen = p.cq_off.cqes +
+                        p.cq_entries * sizeof(struct io_uring_cqe);
+        if (p.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            if (ring.cqMapLen > ring.sqMapLen)
+            {
+                ring.sqMapLen = ring.cqMapLen;
+            }
+            ring.cqMapLen = 0;
+        }
+
+        ring.sqMap = mmap(NULL, ring.sqMapLen, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring.fd,
+                          IORING_OFF_SQ_RING);
+        ring.cqMap = ring.sqMap;
+        if (ring.sqMap != MAP_FAILED && ring.cqMapLen != 0)
+        {
+            ring.cqMap = mmap(NULL, ring.cqMapLen, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ring.fd,
+                              IORING_OFF_CQ_RING);
+        }
+        ring.sqesLen = p.sq_entries * sizeof(struct io_uring_sqe);
+        ring.sqes = static_cast<struct io_uring_sqe *>(
+                        mmap(NULL, ring.sqesLen, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring.fd,
+                             IORING_OFF_SQES));
+
+        if (ring.sqMap == MAP_FAILED || ring.cqMap == MAP_FAILED ||
+            ring.sqes == MAP_FAILED)
+        {
+            ringOpen = true;
+            closeRing();
+            return (false);
+        }
+
+        char *sq = static_cast<char *>(ring.sqMap);
+        char *cq = static_cast<char *>(ring.cqMap);
+        ring.sqHead = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+        ring.sqTail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        ring.sqMask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        ring.sqArray = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        ring.cqHead = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        ring.cqTail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        ring.cqMask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        ring.cqes = reinterpret_cast<struct io_uring_cqe *>(
+                        cq + p.cq_off.cqes);
+
+        ringOpen = true;
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: closeRing()
+     *
+     *    Entry: None
+     *
+     *     Exit: The ring, its mappings, and the splice pipe are released
+     *
+     *  Purpose: Tear down a ring, including one inherited through fork()
+     *
+     *
+     *   *   *   *   *   *   */
+    static void closeRing()
+    {
+        if (!ringOpen)
+        {
+            return;
+        }
+
+        if (ring.sqes != NULL && ring.sqes != MAP_FAILED)
+        {
+            munmap(ring.sqes, ring.sqesLen);
+        }
+        if (ring.cqMap != NULL && ring.cqMap != MAP_FAILED &&
+            ring.cqMap != ring.sqMap)
+        {
+            munmap(ring.cqMap, ring.cqMapLen);
+        }
+        if (ring.sqMap != NULL && ring.sqMap != MAP_FAILED)
+        {
+            munmap(ring.sqMap, ring.sqMapLen);
+        }
+        close(ring.fd);
+        closePipe();
+
+        chunksRegistered = false;
+        ringOpen = false;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: getSqe()
+     *
+     *    Entry: The operation, its descriptor, and a tag for its completion
+     *
+     *     Exit: Returns a cleared submission entry queued on the ring
+     *
+     *  Purpose: Fill the next submission slot; The entry is published to the
+     *           kernel when submitAndWait() advances the tail
+     *
+     *
+     *   *   *   *   *   *   */
+    static struct io_uring_sqe *getSqe(int op, int fd, int tag)
+    {
+        unsigned tail = *ring.sqTail + ring.queued;
+        unsigned index = tail & *ring.sqMask;
+        struct io_uring_sqe *sqe = &ring.sqes[index];
+
+        memset(sqe, 0, sizeof *sqe);
+        sqe->opcode = op;
+        sqe->fd = fd;
+        sqe->user_data = tag;
+        ring.sqArray[index] = index;
+        ring.queued++;
+
+        return (sqe);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: submitAndWait()
+     *
+     *    Entry: The number of queued operations and an array for their
+     *           results, indexed by tag
+     *
+     *     Exit: Returns false if io_uring_enter() failed
+     *
+     *  Purpose: Publish the queued entries and reap a completion for each
+     *           with as few kernel entries as possible, usually one
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool submitAndWait(int wanted, int *results)
+    {
+        unsigned toSubmit = ring.queued;
+        __atomic_store_n(ring.sqTail, *ring.sqTail + ring.queued,
+                         __ATOMIC_RELEASE);
+        ring.queued = 0;
+
+        int reaped = 0;
+        while (reaped < wanted)
+        {
+            long ret = syscall(__NR_io_uring_enter, ring.fd, toSubmit,
+                               wanted - reaped, IORING_ENTER_GETEVENTS,
+                               NULL, 0);
+            if (ret == -1)
+            {
+                if (errno == EINTR)
+                {
+                    // Entries already taken by the kernel stay submitted
+                    toSubmit = 0;
+                    continue;
+                }
+                return (false);
+            }
+            toSubmit = 0;
+
+            unsigned head = *ring.cqHead;
+            unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+            while (head != tail)
+            {
+                struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cqMask];
+                if (cqe->user_data < static_cast<unsigned>(wanted))
+                {
+                    results[cqe->user_data] = cqe->res;
+                }
+                head++;
+                reaped++;
+            }
+            __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+        }
+
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: runOne()
+     *
+     *    Entry: The operation, descriptor, buffer, length, and message flags
+     *
+     *     Exit: Returns the operation's result, or -1 with errno set
+     *
+     *  Purpose: Run a single read, receive, or send through the ring
+     *
+     *
+     *   *   *   *   *   *   */
+    static int runOne(int op, int fd, void *buf, int len, int flags)
+    {
+        struct io_uring_sqe *sqe = getSqe(op, fd, 0);
+        sqe->addr = reinterpret_cast<unsigned long>(buf);
+        sqe->len = len;
+        sqe->msg_flags = flags;
+        if (op == IORING_OP_READ)
+        {
+            sqe->off = -1; // Use and advance the file position
+        }
+
+        int result;
+        if (!submitAndWait(1, &result))
+        {
+            return (-1);
+        }
+        if (result < 0)
+        {
+            errno = -result;
+            return (-1);
+        }
+
+        return (result);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: drainPipe()
+     *
+     *    Entry: The bytes still in the pipe
+     *
+     *     Exit: Returns 0 once the pipe is empty, or -1
+     *
+     *  Purpose: Finish a chunk the socket only partly took
+     *
+     *
+     *   *   *   *   *   *   */
+    static int drainPipe(int bytes)
+    {
+        while (bytes > 0)
+        {
+            ssize_t moved = splice(pipeFds[0], NULL, dataFd, NULL, bytes,
+                                   SPLICE_F_MOVE);
+            if (moved <= 0)
+            {
+                if (moved == -1 && errno == EINTR)
+                {
+                    continue;
+                }
+                return (-1);
+            }
+            bytes -= moved;
+        }
+
+        return (0);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: closePipe()
+     *
+     *    Entry: None
+     *
+     *     Exit: The splice pipe is closed; beginChunks() opens a new one
+     *
+     *  Purpose: Drop a pipe that may still hold part of a failed chunk
+     *
+     *
+     *   *   *   *   *   *   */
+    static void closePipe()
+    {
+        if (pipeFds[0] != -1)
+        {
+            close(pipeFds[0]);
+            close(pipeFds[1]);
+            pipeFds[0] = pipeFds[1] = -1;
+        }
+    }
+} // FtIo
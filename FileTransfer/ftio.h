@@ -0,0 +1,94 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftio.h
+ *           Overview: This is the header file for the ftserve I/O backends.
+ *                     The classic backend makes one blocking system call per
+ *                     operation. The io_uring backend queues operations on a
+ *                     submission ring; A file chunk, its header, and the
+ *                     client's ack are submitted together with one
+ *                     io_uring_enter() and the data is spliced from the file
+ *                     to the socket through a pipe without a user copy
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTIO_H
+#define FTIO_H
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+namespace FtIo
+{
+    /*
+     * The available I/O backends
+     */
+    enum Backend
+    {
+        IO_CLASSIC = 0,
+        IO_URING
+    };
+
+    /*
+     * The initIo() function selects the backend for this process; Returns
+     * false and falls back to the classic backend if io_uring is unavailable
+     */
+    bool initIo(Backend backend);
+
+    /*
+     * The initChild() function gives a forked child its own ring; A ring must
+     * not be shared with the parent
+     */
+    void initChild();
+
+    /*
+     * The getBackend() function returns the backend in use
+     */
+    Backend getBackend();
+
+    /*
+     * The acceptConn() function accepts a connection; Same result as accept()
+     */
+    int acceptConn(int fd, struct sockaddr *addr, socklen_t *addrLen);
+
+    /*
+     * The recvData() function receives up to len bytes; Same result as recv()
+     */
+    int recvData(int fd, void *buf, int len);
+
+    /*
+     * The sendData() function sends len bytes; Same result as send()
+     */
+    int sendData(int fd, const void *buf, int len);
+
+    /*
+     * The readFile() function reads up to len bytes of a file at its current
+     * offset; Same result as read()
+     */
+    int readFile(int fd, void *buf, int len);
+
+    /*
+     * The beginChunks() function registers the file, data socket, and control
+     * socket of a transfer with the ring; Returns false if the transfer must
+     * use the classic chunk loop
+     */
+    bool beginChunks(int fileFd, int dataFd, int ctlFd);
+
+    /*
+     * The sendChunk() function sends the header and len bytes of the file at
+     * off over the data socket and receives the client's ack into ackBuf, all
+     * in one submission; Returns the bytes sent or -1
+     */
+    int sendChunk(const char *header, int headerLen, long long off, int len,
+                  void *ackBuf, int ackLen);
+
+    /*
+     * The endChunks() function unregisters the transfer's descriptors
+     */
+    void endChunks();
+} // FtIo
+#endif // FTIO_H
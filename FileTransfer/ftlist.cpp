@@ -0,0 +1,226 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftlist.cpp
+ *           Overview: This is the implementation file for ftserve listing
+ *                     filters
+ *
+ *                     Globs are matched with fnmatch(). A page is a max-heap
+ *                     of at most limit names; Once it is full, a name is only
+ *                     copied if it sorts before the largest one kept, which
+ *                     it then replaces
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <charconv>
+#include <cstring>
+#include <fnmatch.h>
+#include "ftlist.h"
+
+namespace FtList
+{
+    /*
+     * Helpers local to this file
+     */
+    static bool setText(char *out, const char *value, int len);
+    static bool setCount(long long *out, const char *value, int len);
+
+    void clearFilter(Filter *filter)
+    {
+        filter->glob[0] = '\0';
+        filter->prefix[0] = '\0';
+        filter->after[0] = '\0';
+        filter->minSize = -1;
+        filter->maxSize = -1;
+        filter->newer = -1;
+        filter->older = -1;
+        filter->limit = -1;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: parseTerm()
+     *
+     *    Entry: A term, its length, and the filter to set it in
+     *
+     *     Exit: Returns true with the term set, or false if it is unknown
+     *           or its value is malformed
+     *
+     *  Purpose: Read one "key=value" term; Counts are whole numbers and
+     *           times are seconds since the epoch
+     *
+     *
+     *   *   *   *   *   *   */
+    bool parseTerm(const char *term, int len, Filter *filter)
+    {
+        const char *eq = static_cast<const char *>(memchr(term, '=', len));
+        if (eq == NULL)
+        {
+            return (false);
+        }
+
+        std::string key(term, eq - term);
+        const char *value = eq + 1;
+        int valueLen = term + len - value;
+
+        if (key == "glob")
+        {
+            return (setText(filter->glob, value, valueLen));
+        }
+        else if (key == "prefix")
+        {
+            return (setText(filter->prefix, value, valueLen));
+        }
+        else if (key == "after")
+        {
+            return (setText(filter->after, value, valueLen));
+        }
+        else if (key == "minsize")
+        {
+            return (setCount(&filter->minSize, value, valueLen));
+        }
+        else if (key == "maxsize")
+        {
+            return (setCount(&filter->maxSize, value, valueLen));
+        }
+        else if (key == "newer")
+        {
+            return (setCount(&filter->newer, value, valueLen));
+        }
+        else if (key == "older")
+        {
+            return (setCount(&filter->older, value, valueLen));
+        }
+        else if (key == "limit")
+        {
+            return (setCount(&filter->limit, value, valueLen)
+                    && filter->limit > 0);
+        }
+
+        return (false);
+    }
+
+    bool isActive(const Filter &filter)
+    {
+        return (filter.glob[0] != '\0' || filter.prefix[0] != '\0'
+                || filter.after[0] != '\0' || filter.limit != -1
+                || needsStat(filter));
+    }
+
+    bool needsStat(const Filter &filter)
+    {
+        return (filter.minSize != -1 || filter.maxSize != -1
+                || filter.newer != -1 || filter.older != -1);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: matchName()
+     *
+     *    Entry: A filter and a name
+     *
+     *     Exit: Returns true if the name passes the name terms
+     *
+     *  Purpose: Test the terms that need no system call first; The cursor
+     *           passes only names after it
+     *
+     *
+     *   *   *   *   *   *   */
+    bool matchName(const Filter &filter, const char *name)
+    {
+        if (filter.after[0] != '\0' && strcmp(name, filter.after) <= 0)
+        {
+            return (false);
+        }
+        if (filter.prefix[0] != '\0'
+            && strncmp(name, filter.prefix, strlen(filter.prefix)) != 0)
+        {
+            return (false);
+        }
+        if (filter.glob[0] != '\0' && fnmatch(filter.glob, name, 0) != 0)
+        {
+            return (false);
+        }
+
+        return (true);
+    }
+
+    bool matchStat(const Filter &filter, long long size, long long mtime)
+    {
+        return ((filter.minSize == -1 || size >= filter.minSize)
+                && (filter.maxSize == -1 || size <= filter.maxSize)
+                && (filter.newer == -1 || mtime > filter.newer)
+                && (filter.older == -1 || mtime < filter.older));
+    }
+
+    Page::Page(long long limitInput)
+        : limit(limitInput), cut(false)
+    {
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: add()
+     *
+     *    Entry: A name that passed the filter
+     *
+     *     Exit: The name is kept if it is among the limit smallest so far
+     *
+     *  Purpose: Build a sorted page in one pass without keeping the whole
+     *           directory
+     *
+     *
+     *   *   *   *   *   *   */
+    void Page::add(const char *name)
+    {
+        if ((long long)names.size() < limit)
+        {
+            names.push(name);
+            return;
+        }
+
+        cut = true;
+        if (strcmp(name, names.top().c_str()) < 0)
+        {
+            names.pop();
+            names.push(name);
+        }
+    }
+
+    void Page::take(std::vector<std::string> *out)
+    {
+        std::size_t first = out->size();
+        out->resize(first + names.size());
+        for (std::size_t i = out->size(); i > first; i--)
+        {
+            (*out)[i - 1] = names.top();
+            names.pop();
+        }
+    }
+
+    bool Page::isCut() const
+    {
+        return (cut);
+    }
+
+    static bool setText(char *out, const char *value, int len)
+    {
+        if (len == 0 || len >= TERM_LEN)
+        {
+            return (false);
+        }
+        memcpy(out, value, len);
+        out[len] = '\0';
+        return (true);
+    }
+
+    static bool setCount(long long *out, const char *value, int len)
+    {
+        std::from_chars_result r = std::from_chars(value, value + len, *out);
+        return (r.ec == std::errc() && r.ptr == value + len && *out >= 0);
+    }
+} // FtList
@@ -0,0 +1,111 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftlist.h
+ *           Overview: This is the header file for ftserve listing filters.
+ *                     A listing command may follow its port with terms such
+ *                     as "glob=*.log" or "newer=1700000000"; The server
+ *                     applies them while it reads the directory, so only the
+ *                     matching names are sent. "after=name limit=n" returns
+ *                     one page of the matching names in sorted order, and the
+ *                     last name of a page is the cursor for the next
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTLIST_H
+#define FTLIST_H
+
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace FtList
+{
+    const int TERM_LEN = 256; // Longest glob, prefix, or cursor name
+
+    /*
+     * Structure for the terms of a listing; A count of -1 and an empty
+     * string are unset
+     */
+    struct Filter
+    {
+        char      glob[TERM_LEN];
+        char      prefix[TERM_LEN];
+        char      after[TERM_LEN];
+        long long minSize;
+        long long maxSize;
+        long long newer;
+        long long older;
+        long long limit;
+    };
+
+    /*
+     * The clearFilter() function unsets every term of filter
+     */
+    void clearFilter(Filter *filter);
+
+    /*
+     * The parseTerm() function sets the term in the len chars at term, such
+     * as "limit=100"; Returns false if the term is unknown or malformed. A
+     * later term replaces an earlier one with the same key
+     */
+    bool parseTerm(const char *term, int len, Filter *filter);
+
+    /*
+     * The isActive() function returns true if any term is set
+     */
+    bool isActive(const Filter &filter);
+
+    /*
+     * The needsStat() function returns true if a term tests the size or the
+     * modification time, which only a stat() of the file gives
+     */
+    bool needsStat(const Filter &filter);
+
+    /*
+     * The matchName() function returns true if name passes the glob,
+     * prefix, and cursor terms
+     */
+    bool matchName(const Filter &filter, const char *name);
+
+    /*
+     * The matchStat() function returns true if a file of size bytes last
+     * modified at mtime seconds passes the size and time terms
+     */
+    bool matchStat(const Filter &filter, long long size, long long mtime);
+
+    /*
+     * Class for one page of a listing read in directory order; It keeps the
+     * limit smallest names added, so a page of a huge directory holds only
+     * the page
+     */
+    class Page
+    {
+    public:
+        Page(long long limitInput);
+
+        void add(const char *name);
+        /*
+         * Offers a matching name to the page
+         */
+
+        void take(std::vector<std::string> *out);
+        /*
+         * Moves the page's names to out in sorted order
+         */
+
+        bool isCut() const;
+        /*
+         * Returns true if more names matched than the page holds
+         */
+    private:
+        long long                        limit;
+        bool                             cut;
+        std::priority_queue<std::string> names;
+    };
+} // FtList
+#endif // FTLIST_H
@@ -0,0 +1,51 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftmkpack.cpp
+ *           Overview: This program packs the regular files of a directory
+ *                     into an archive for ftserve -archive. Subdirectories
+ *                     and other special files are skipped. The archive is
+ *                     renamed into place once it is complete, so it can be
+ *                     rebuilt while a server maps the old one; Restart the
+ *                     server with -takeover to serve the new one
+ *
+ *                     Usage: ./ftmkpack directory archive
+ *              Input: The command line arguments
+ *
+ *             Output: The archive, and its size to stdout
+ *
+ *
+ */
+
+#include <iostream>
+#include <cstdio>
+#include "ftpack.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " directory archive\n";
+        return (1);
+    }
+
+    long long files = 0;
+    long long bytes = 0;
+    if (!FtPack::buildArchive(argv[1], argv[2], &files, &bytes))
+    {
+        perror("ftmkpack");
+        return (1);
+    }
+
+    // Check it the way ftserve will
+    if (!FtPack::openArchive(argv[2]))
+    {
+        perror("ftmkpack: archive check");
+        return (1);
+    }
+
+    std::cout << "Packed " << files << " files, " << bytes << " bytes, into "
+              << argv[2] << "\n";
+    return (0);
+}
@@ -0,0 +1,456 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftnuma.cpp
+ *           Overview: This is the implementation file for ftserve CPU and
+ *                     memory placement
+ *
+ *                     A child takes the CPU the kernel reports with
+ *                     SO_INCOMING_CPU when it is listed, so the session runs
+ *                     where its NIC queue's interrupts are handled. Otherwise
+ *                     it takes the next listed CPU on that CPU's node, or the
+ *                     next listed CPU at all, in turn. The memory policies are
+ *                     set with the set_mempolicy() system call directly, and
+ *                     the node of a buffer is read back with get_mempolicy();
+ *                     The node of each CPU comes from the node directories in
+ *                     sysfs, and a kernel without them is one node
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "ftnuma.h"
+
+namespace FtNuma
+{
+    const int MAX_NODES = 64; // Nodes one policy mask holds
+
+    /*
+     * Counters shared by the parent and all child processes
+     */
+    struct Totals
+    {
+        std::atomic<long long> sessions;
+        std::atomic<long long> onNicCpu;
+        std::atomic<long long> onNicNode;
+        std::atomic<long long> noNicCpu;
+        std::atomic<long long> bufLocal;
+        std::atomic<long long> bufRemote;
+        std::atomic<long long> bufUnknown;
+        std::atomic<unsigned>  nextCpu;
+    };
+
+    // Set by the parent before the fork; Only the counters change after
+    static Totals             *totals = NULL;
+    static std::vector<int>   cpus;
+    static int                cpuNode[CPU_SETSIZE];
+    static unsigned long      nodeMask = 0;
+
+    /*
+     * Helpers local to this file
+     */
+    static bool parseList(const char *list, cpu_set_t *set);
+    static void loadNodes();
+    static int nodeOf(int cpu);
+    static int incomingCpu(int sockFd);
+    static int pickCpu(int nicCpu);
+    static void pinTo(int cpu);
+    static long setPolicy(int mode, unsigned long mask);
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initPlacement()
+     *
+     *    Entry: A CPU list of numbers and ranges separated by commas
+     *
+     *     Exit: Returns true with the server kept to the listed CPUs, or
+     *           false with errno set; EINVAL means the list is malformed or
+     *           names a CPU the server may not run on
+     *
+     *  Purpose: Set up placement before the server forks children; The
+     *           parent's interleave policy spreads the shared tables mapped
+     *           after it across the listed nodes, and its threads inherit
+     *           the CPU list
+     *
+     *
+     *   *   *   *   *   *   */
+    bool initPlacement(const char *cpuList)
+    {
+        cpu_set_t set, allowed;
+        if (!parseList(cpuList, &set))
+        {
+            errno = EINVAL;
+            return (false);
+        }
+        if (sched_getaffinity(0, sizeof allowed, &allowed) == -1)
+        {
+            return (false);
+        }
+
+        loadNodes();
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (!CPU_ISSET(cpu, &set))
+            {
+                continue;
+            }
+            if (!CPU_ISSET(cpu, &allowed))
+            {
+                errno = EINVAL;
+                return (false);
+            }
+            cpus.push_back(cpu);
+            nodeMask |= 1UL << cpuNode[cpu];
+        }
+
+        void *mem = mmap(NULL, sizeof(Totals), PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+        {
+            cpus.clear();
+            return (false);
+        }
+
+        // Construct the atomics in place in the shared mapping
+        totals = new (mem) Totals();
+
+        if (sched_setaffinity(0, sizeof set, &set) == -1)
+        {
+            return (false);
+        }
+
+        // Memory is only a preference, so a kernel without NUMA is not fatal
+        setPolicy(MPOL_INTERLEAVE, nodeMask);
+
+        return (true);
+    }
+
+    bool isActive()
+    {
+        return (totals != NULL);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: placeSession()
+     *
+     *    Entry: The connection's socket
+     *
+     *     Exit: The process runs on one CPU and allocates on its node
+     *
+     *  Purpose: Keep a child, its buffers, and its connection's packets on
+     *           one CPU, or failing that one node; A Unix socket reports no
+     *           CPU, so a local session takes the next listed CPU
+     *
+     *
+     *   *   *   *   *   *   */
+    void placeSession(int sockFd)
+    {
+        if (totals == NULL)
+        {
+            return;
+        }
+
+        int cpu = pickCpu(incomingCpu(sockFd));
+        pinTo(cpu);
+        setPolicy(MPOL_PREFERRED, 1UL << cpuNode[cpu]);
+    }
+
+    void placeLoop()
+    {
+        if (totals == NULL)
+        {
+            return;
+        }
+
+        pinTo(cpus[0]);
+        setPolicy(MPOL_PREFERRED, 1UL << cpuNode[cpus[0]]);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: notePlacement()
+     *
+     *    Entry: The session's socket and a buffer it has written
+     *
+     *     Exit: Returns the session's placement; The shared counters
+     *           include it if placement is active
+     *
+     *  Purpose: Measure locality; A session is counted once, after its
+     *           first buffer is in memory
+     *
+     *
+     *   *   *   *   *   *   */
+    Placement notePlacement(int sockFd, const void *buf)
+    {
+        Placement p;
+        p.cpu = sched_getcpu();
+        p.node = nodeOf(p.cpu);
+        p.nicCpu = incomingCpu(sockFd);
+        p.bufNode = -1;
+
+        // With both flags the node holding the page at buf is returned
+        int node;
+        if (syscall(__NR_get_mempolicy, &node, NULL, 0, buf,
+                    MPOL_F_NODE | MPOL_F_ADDR) == 0)
+        {
+            p.bufNode = node;
+        }
+
+        if (totals == NULL)
+        {
+            return (p);
+        }
+
+        totals->sessions++;
+        if (p.nicCpu == -1)
+        {
+            totals->noNicCpu++;
+        }
+        else
+        {
+            if (p.cpu == p.nicCpu)
+            {
+                totals->onNicCpu++;
+            }
+            if (p.node == nodeOf(p.nicCpu))
+            {
+                totals->onNicNode++;
+            }
+        }
+
+        if (p.bufNode == -1 || p.node == -1)
+        {
+            totals->bufUnknown++;
+        }
+        else if (p.bufNode == p.node)
+        {
+            totals->bufLocal++;
+        }
+        else
+        {
+            totals->bufRemote++;
+        }
+
+        return (p);
+    }
+
+    void printTotals()
+    {
+        if (totals == NULL)
+        {
+            return;
+        }
+
+        std::cout << "Placement: " << totals->sessions << " session(s), "
+                  << totals->onNicCpu << " on their NIC queue's CPU, "
+                  << totals->onNicNode << " on its node, "
+                  << totals->noNicCpu << " with no NIC queue CPU; Buffers "
+                  << totals->bufLocal << " local, " << totals->bufRemote
+                  << " remote, " << totals->bufUnknown << " unknown\n";
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: parseList()
+     *
+     *    Entry: A CPU list such as "0-3,8" and the set to fill
+     *
+     *     Exit: Returns true if the list is well formed and not empty
+     *
+     *  Purpose: Read the list format of -cpus and of the sysfs cpulist
+     *           files
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool parseList(const char *list, cpu_set_t *set)
+    {
+        CPU_ZERO(set);
+        const char *cur = list;
+
+        while (*cur != '\0' && *cur != '\n')
+        {
+            char *end;
+            long first = std::strtol(cur, &end, 10);
+            long last = first;
+            if (end == cur || first < 0)
+            {
+                return (false);
+            }
+            if (*end == '-')
+            {
+                cur = end + 1;
+                last = std::strtol(cur, &end, 10);
+                if (end == cur || last < first)
+                {
+                    return (false);
+                }
+            }
+            if (last >= CPU_SETSIZE)
+            {
+                return (false);
+            }
+
+            for (long cpu = first; cpu <= last; cpu++)
+            {
+                CPU_SET(cpu, set);
+            }
+
+            cur = end;
+            if (*cur == ',')
+            {
+                cur++;
+            }
+            else if (*cur != '\0' && *cur != '\n')
+            {
+                return (false);
+            }
+        }
+
+        return (CPU_COUNT(set) > 0);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: loadNodes()
+     *
+     *    Entry: None
+     *
+     *     Exit: cpuNode holds the node of every CPU
+     *
+     *  Purpose: Read each node's CPU list; A CPU no node lists is on node 0
+     *
+     *
+     *   *   *   *   *   *   */
+    static void loadNodes()
+    {
+        memset(cpuNode, 0, sizeof cpuNode);
+
+        for (int node = 0; node < MAX_NODES; node++)
+        {
+            char path[64];
+            snprintf(path, sizeof path,
+                     "/sys/devices/system/node/node%d/cpulist", node);
+            FILE *fp = fopen(path, "r");
+            if (fp == NULL)
+            {
+                continue;
+            }
+
+            char line[4096];
+            cpu_set_t set;
+            if (fgets(line, sizeof line, fp) != NULL && parseList(line, &set))
+            {
+                for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                {
+                    if (CPU_ISSET(cpu, &set))
+                    {
+                        cpuNode[cpu] = node;
+                    }
+                }
+            }
+            fclose(fp);
+        }
+    }
+
+    static int nodeOf(int cpu)
+    {
+        if (cpu < 0 || cpu >= CPU_SETSIZE)
+        {
+            return (-1);
+        }
+        return (cpuNode[cpu]);
+    }
+
+    static int incomingCpu(int sockFd)
+    {
+        int cpu = -1;
+        socklen_t len = sizeof cpu;
+        if (getsockopt(sockFd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == -1)
+        {
+            return (-1);
+        }
+        return (cpu);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: pickCpu()
+     *
+     *    Entry: The CPU that received the connection's packets, or -1
+     *
+     *     Exit: Returns a listed CPU
+     *
+     *  Purpose: Prefer the receiving CPU, then its node, then any listed
+     *           CPU; Sessions sharing a choice take its CPUs in turn
+     *
+     *
+     *   *   *   *   *   *   */
+    static int pickCpu(int nicCpu)
+    {
+        std::vector<int> choices;
+        for (std::size_t i = 0; i < cpus.size(); i++)
+        {
+            if (cpus[i] == nicCpu)
+            {
+                return (nicCpu);
+            }
+            if (nicCpu != -1 && cpuNode[cpus[i]] == nodeOf(nicCpu))
+            {
+                choices.push_back(cpus[i]);
+            }
+        }
+        if (choices.empty())
+        {
+            choices = cpus;
+        }
+
+        return (choices[totals->nextCpu++ % choices.size()]);
+    }
+
+    static void pinTo(int cpu)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof set, &set) == -1)
+        {
+            perror("CPU affinity");
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: setPolicy()
+     *
+     *    Entry: A memory policy mode and a mask of nodes
+     *
+     *     Exit: Returns 0, or -1 with errno set
+     *
+     *  Purpose: Set the calling thread's memory policy; The kernel counts
+     *           one more node than the mask holds
+     *
+     *
+     *   *   *   *   *   *   */
+    static long setPolicy(int mode, unsigned long mask)
+    {
+        return (syscall(__NR_set_mempolicy, mode, &mask,
+                        8 * sizeof mask + 1));
+    }
+} // FtNuma
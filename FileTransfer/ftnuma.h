@@ -0,0 +1,76 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftnuma.h
+ *           Overview: This is the header file for ftserve CPU and memory
+ *                     placement. With -cpus the server keeps to the listed
+ *                     CPUs; Each forked child is pinned to one of them,
+ *                     chosen from the CPU that received the connection's
+ *                     packets, and allocates its buffers on that CPU's NUMA
+ *                     node. The tables shared by every child are spread
+ *                     across the nodes of the list instead. Counters shared
+ *                     by the children record how often each session ran
+ *                     where its packets arrived and where its buffers ended
+ *                     up, so locality can be checked
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTNUMA_H
+#define FTNUMA_H
+
+namespace FtNuma
+{
+    /*
+     * Structure for where one session ran; A value of -1 is unknown
+     */
+    struct Placement
+    {
+        int cpu;     // CPU the session ran on
+        int node;    // Node of that CPU
+        int nicCpu;  // CPU that received the connection's packets
+        int bufNode; // Node holding the session's buffer
+    };
+
+    /*
+     * The initPlacement() function parses a CPU list such as "0-3,8", keeps
+     * the server to those CPUs, and interleaves memory allocated from now on
+     * across their nodes; It must be called by the parent before the shared
+     * tables are mapped and before any fork(). Returns false with errno set
+     */
+    bool initPlacement(const char *cpuList);
+
+    /*
+     * The isActive() function returns true if a CPU list is in use
+     */
+    bool isActive();
+
+    /*
+     * The placeSession() function pins a new child to a CPU for the
+     * connection on sockFd and prefers that CPU's node for its memory; It
+     * must run before the child allocates its buffers
+     */
+    void placeSession(int sockFd);
+
+    /*
+     * The placeLoop() function pins the thread serving every session to the
+     * first listed CPU and prefers its node for its memory
+     */
+    void placeLoop();
+
+    /*
+     * The notePlacement() function returns where the session on sockFd is
+     * running and where buf, a buffer it has written, is held, and adds
+     * them to the shared counters
+     */
+    Placement notePlacement(int sockFd, const void *buf);
+
+    /*
+     * The printTotals() function prints the shared counters
+     */
+    void printTotals();
+} // FtNuma
+#endif // FTNUMA_H
@@ -0,0 +1,448 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftpack.cpp
+ *           Overview: This is the implementation file for ftserve packed
+ *                     archives
+ *
+ *                     An archive is laid out as the header, the data of
+ *                     every file starting at DATA_START, the index, and the
+ *                     names. The data is written first so each entry records
+ *                     the bytes actually copied, and the header last, so an
+ *                     archive cut short is never mistaken for a good one
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ftpack.h"
+
+namespace FtPack
+{
+    const char      MAGIC[8]   = {'F', 'T', 'P', 'A', 'C', 'K', '1', '\0'};
+    const long long DATA_START = 4096; // Data begins on a page
+    const int       COPY_SIZE  = 65536; // Bytes per read while building
+
+    // The mapped archive; Set before the fork and only read after
+    static int          archFd = -1;
+    static const char   *base = NULL;
+    static const Entry  *entries = NULL;
+    static const char   *names = NULL;
+    static int          entryCount = 0;
+
+    /*
+     * Helpers local to this file
+     */
+    static bool writeAll(int fd, const char *buf, std::size_t len);
+    static bool copyFile(int dirFd, const char *fileName, int outFd,
+                         unsigned long long *size);
+    static bool checkArchive(const Header *hdr, unsigned long long fileSize);
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: buildArchive()
+     *
+     *    Entry: The directory to pack, the archive path, and pointers for
+     *           the number of files and data bytes packed
+     *
+     *     Exit: Returns true once the archive is renamed into place
+     *
+     *  Purpose: Pack every regular file of dir; The archive is written to a
+     *           temporary name first, so a running server never sees half of
+     *           it
+     *
+     *
+     *   *   *   *   *   *   */
+    bool buildArchive(const char *dir, const char *path, long long *files,
+                      long long *bytes)
+    {
+        int dirFd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd == -1)
+        {
+            return (false);
+        }
+
+        DIR *dp = fdopendir(dirFd);
+        if (dp == NULL)
+        {
+            close(dirFd);
+            return (false);
+        }
+
+        std::vector<std::string> list;
+        struct dirent *ep;
+        struct stat st;
+        while ((ep = readdir(dp)) != NULL)
+        {
+            if (fstatat(dirFd, ep->d_name, &st, 0) == 0
+                && S_ISREG(st.st_mode))
+            {
+                list.push_back(ep->d_name);
+            }
+        }
+
+        // std::string orders as strcmp() does, which find() relies on
+        std::sort(list.begin(), list.end());
+
+        std::string tmpPath = std::string(path) + ".tmp";
+        int outFd = open(tmpPath.c_str(),
+                         O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (outFd == -1)
+        {
+            closedir(dp);
+            return (false);
+        }
+
+        Header hdr;
+        memset(&hdr, 0, sizeof hdr);
+        memcpy(hdr.magic, MAGIC, sizeof MAGIC);
+        hdr.count = list.size();
+        hdr.dataOff = DATA_START;
+
+        std::vector<Entry> index(list.size());
+        std::string nameBlob;
+        bool ok = (lseek(outFd, DATA_START, SEEK_SET) != -1);
+        unsigned long long off = DATA_START;
+        for (std::size_t i = 0; ok && i < list.size(); i++)
+        {
+            index[i].nameOff = nameBlob.size();
+            index[i].dataOff = off;
+            nameBlob.append(list[i]);
+            nameBlob.push_back('\0');
+            ok = copyFile(dirFd, list[i].c_str(), outFd, &index[i].size);
+            off += index[i].size;
+        }
+        closedir(dp);
+
+        hdr.dataLen = off - DATA_START;
+        hdr.indexOff = (off + 7) & ~7ULL;
+        hdr.namesOff = hdr.indexOff + index.size() * sizeof(Entry);
+        hdr.namesLen = nameBlob.size();
+
+        if (ok)
+        {
+            ok = (pwrite(outFd, "\0\0\0\0\0\0\0", hdr.indexOff - off, off)
+                  != -1
+                  && pwrite(outFd, index.data(), index.size() * sizeof(Entry),
+                            hdr.indexOff) != -1
+                  && pwrite(outFd, nameBlob.data(), nameBlob.size(),
+                            hdr.namesOff) != -1
+                  && fsync(outFd) == 0
+                  && pwrite(outFd, &hdr, sizeof hdr, 0) == sizeof hdr
+                  && fsync(outFd) == 0);
+        }
+
+        int saved = errno;
+        close(outFd);
+        if (!ok || rename(tmpPath.c_str(), path) == -1)
+        {
+            saved = errno;
+            unlink(tmpPath.c_str());
+            errno = saved;
+            return (false);
+        }
+
+        *files = list.size();
+        *bytes = hdr.dataLen;
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: openArchive()
+     *
+     *    Entry: The archive path
+     *
+     *     Exit: Returns true with the archive mapped, or false with errno
+     *           set; EINVAL means the archive is damaged
+     *
+     *  Purpose: Map the archive once for every session, and check every
+     *           offset in it so lookups need no checks of their own
+     *
+     *
+     *   *   *   *   *   *   */
+    bool openArchive(const char *path)
+    {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            return (false);
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) == -1)
+        {
+            close(fd);
+            return (false);
+        }
+        if ((unsigned long long)st.st_size < sizeof(Header))
+        {
+            close(fd);
+            errno = EINVAL;
+            return (false);
+        }
+
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            close(fd);
+            return (false);
+        }
+
+        const Header *hdr = (const Header *)map;
+        if (!checkArchive(hdr, st.st_size))
+        {
+            munmap(map, st.st_size);
+            close(fd);
+            errno = EINVAL;
+            return (false);
+        }
+
+        archFd = fd;
+        base = (const char *)map;
+        entries = (const Entry *)(base + hdr->indexOff);
+        names = base + hdr->namesOff;
+        entryCount = hdr->count;
+        return (true);
+    }
+
+    bool isOpen()
+    {
+        return (base != NULL);
+    }
+
+    int count()
+    {
+        return (entryCount);
+    }
+
+    const char *name(int i)
+    {
+        return (names + entries[i].nameOff);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: find()
+     *
+     *    Entry: A file name
+     *
+     *     Exit: Returns the file's index, or -1 if it is not in the archive
+     *
+     *  Purpose: Binary search the sorted index
+     *
+     *
+     *   *   *   *   *   *   */
+    int find(const char *fileName)
+    {
+        int low = 0;
+        int high = entryCount - 1;
+
+        while (low <= high)
+        {
+            int mid = low + (high - low) / 2;
+            int cmp = strcmp(fileName, name(mid));
+            if (cmp == 0)
+            {
+                return (mid);
+            }
+            else if (cmp < 0)
+            {
+                high = mid - 1;
+            }
+            else
+            {
+                low = mid + 1;
+            }
+        }
+
+        return (-1);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: lowerBound()
+     *
+     *    Entry: A file name, which need not be in the archive
+     *
+     *     Exit: Returns the index of the first name that does not sort
+     *           before it
+     *
+     *  Purpose: Start a walk of the sorted index at a prefix or cursor
+     *
+     *
+     *   *   *   *   *   *   */
+    int lowerBound(const char *fileName)
+    {
+        int low = 0;
+        int high = entryCount;
+
+        while (low < high)
+        {
+            int mid = low + (high - low) / 2;
+            if (strcmp(name(mid), fileName) < 0)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        return (low);
+    }
+
+    long long offset(int i)
+    {
+        return (entries[i].dataOff);
+    }
+
+    long long size(int i)
+    {
+        return (entries[i].size);
+    }
+
+    const char *data(int i)
+    {
+        return (base + entries[i].dataOff);
+    }
+
+    int getFd()
+    {
+        return (archFd);
+    }
+
+    static bool writeAll(int fd, const char *buf, std::size_t len)
+    {
+        while (len > 0)
+        {
+            ssize_t n = write(fd, buf, len);
+            if (n == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return (false);
+            }
+            buf += n;
+            len -= n;
+        }
+
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: copyFile()
+     *
+     *    Entry: The directory, a file in it, the archive, and a pointer for
+     *           the bytes copied
+     *
+     *     Exit: Returns true once the file is appended to the archive
+     *
+     *  Purpose: Copy one file into the data blob
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool copyFile(int dirFd, const char *fileName, int outFd,
+                         unsigned long long *size)
+    {
+        int fd = openat(dirFd, fileName, O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            return (false);
+        }
+
+        static char buf[COPY_SIZE];
+        ssize_t n;
+        bool ok = true;
+        *size = 0;
+        while (ok && (n = read(fd, buf, sizeof buf)) != 0)
+        {
+            if (n == -1)
+            {
+                ok = (errno == EINTR);
+                continue;
+            }
+            ok = writeAll(outFd, buf, n);
+            *size += n;
+        }
+
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return (ok);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: checkArchive()
+     *
+     *    Entry: The mapped header and the size of the archive
+     *
+     *     Exit: Returns true if every offset is inside the archive, every
+     *           name is terminated, and the names are strictly sorted
+     *
+     *  Purpose: Refuse an archive that could send a session outside the
+     *           mapping or break the binary search
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool checkArchive(const Header *hdr, unsigned long long fileSize)
+    {
+        if (memcmp(hdr->magic, MAGIC, sizeof MAGIC) != 0
+            || hdr->dataOff > fileSize
+            || hdr->dataLen > fileSize - hdr->dataOff
+            || hdr->indexOff % sizeof(unsigned long long) != 0
+            || hdr->indexOff > fileSize
+            || hdr->count > (fileSize - hdr->indexOff) / sizeof(Entry)
+            || hdr->count > 0x7fffffff
+            || hdr->namesOff > fileSize
+            || hdr->namesLen > fileSize - hdr->namesOff
+            || (hdr->count > 0 && hdr->namesLen == 0))
+        {
+            return (false);
+        }
+
+        const char *map = (const char *)hdr;
+        const Entry *index = (const Entry *)(map + hdr->indexOff);
+        const char *blob = map + hdr->namesOff;
+        unsigned long long dataEnd = hdr->dataOff + hdr->dataLen;
+
+        // A NUL at the end keeps every name inside the blob
+        if (hdr->count > 0 && blob[hdr->namesLen - 1] != '\0')
+        {
+            return (false);
+        }
+
+        for (unsigned long long i = 0; i < hdr->count; i++)
+        {
+            if (index[i].nameOff >= hdr->namesLen
+                || index[i].dataOff < hdr->dataOff
+                || index[i].dataOff > dataEnd
+                || index[i].size > dataEnd - index[i].dataOff
+                || (i > 0 && strcmp(blob + index[i - 1].nameOff,
+                                    blob + index[i].nameOff) >= 0))
+            {
+                return (false);
+            }
+        }
+
+        return (true);
+    }
+} // FtPack
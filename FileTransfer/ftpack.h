@@ -0,0 +1,110 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftpack.h
+ *           Overview: This is the header file for ftserve packed archives.
+ *                     An archive holds the regular files of a directory as
+ *                     one contiguous data blob, followed by an index sorted
+ *                     by name and the names themselves. ftserve maps the
+ *                     archive once before it forks, so a listing walks the
+ *                     index and a get finds its file by binary search and
+ *                     sends it from the mapping, with no open(), stat(), or
+ *                     readdir() for each request
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTPACK_H
+#define FTPACK_H
+
+namespace FtPack
+{
+    /*
+     * Structure at the start of an archive; Offsets are from the start of
+     * the file, and every number is in the byte order of the host that
+     * built it
+     */
+    struct Header
+    {
+        char               magic[8];
+        unsigned long long count;
+        unsigned long long dataOff;
+        unsigned long long dataLen;
+        unsigned long long indexOff;
+        unsigned long long namesOff;
+        unsigned long long namesLen;
+    };
+
+    /*
+     * Structure for one file in the index; nameOff is from the start of the
+     * names, which are NUL terminated, and dataOff from the start of the file
+     */
+    struct Entry
+    {
+        unsigned long long nameOff;
+        unsigned long long dataOff;
+        unsigned long long size;
+    };
+
+    /*
+     * The buildArchive() function packs the regular files of dir into a new
+     * archive at path; Returns false with errno set on failure
+     */
+    bool buildArchive(const char *dir, const char *path, long long *files,
+                      long long *bytes);
+
+    /*
+     * The openArchive() function maps and checks the archive at path; It
+     * must be called by the parent before any fork()
+     */
+    bool openArchive(const char *path);
+
+    /*
+     * The isOpen() function returns true if requests are served from an
+     * archive
+     */
+    bool isOpen();
+
+    /*
+     * The count() function returns the number of files in the archive
+     */
+    int count();
+
+    /*
+     * The name() function returns the name of file i in sorted order
+     */
+    const char *name(int i);
+
+    /*
+     * The find() function returns the index of the file name, or -1
+     */
+    int find(const char *fileName);
+
+    /*
+     * The lowerBound() function returns the index of the first name not
+     * before fileName, or count() if there is none
+     */
+    int lowerBound(const char *fileName);
+
+    /*
+     * The offset() and size() functions return where file i is in the
+     * archive and its length
+     */
+    long long offset(int i);
+    long long size(int i);
+
+    /*
+     * The data() function returns the mapped contents of file i
+     */
+    const char *data(int i);
+
+    /*
+     * The getFd() function returns the archive's descriptor, which is shared
+     * by every session; Read it only at explicit offsets
+     */
+    int getFd();
+} // FtPack
+#endif // FTPACK_H
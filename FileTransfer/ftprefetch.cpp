@@ -0,0 +1,318 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftprefetch.cpp
+ *           Overview: This is the implementation file for the ftserve
+ *                     prefetcher
+ *
+ *                     The first in-order get of a run queues the next DEPTH
+ *                     files; Each later one queues only the new file at the
+ *                     end of the window, since the rest were queued before.
+ *                     A queued file is warmed with posix_fadvise(WILLNEED),
+ *                     which starts the reads and returns without waiting
+ *                     for them, and only its first PREFETCH_BYTES are asked
+ *                     for; The kernel's own readahead takes over once the
+ *                     transfer reads it in order
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <pthread.h>
+#include <semaphore.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ftprefetch.h"
+#include "ftpack.h"
+#include "ftshm.h"
+
+namespace FtPrefetch
+{
+    const int       MAX_CLIENTS    = 256; // Client hosts tracked
+    const int       HOST_LEN       = 256; // Longest host name tracked
+    const int       NAME_LEN       = 256; // Longest file name tracked
+    const int       QUEUE_LEN      = 64; // Files waiting to be prefetched
+    const long long PREFETCH_BYTES = 8 * 1024 * 1024; // Bytes per file
+
+    /*
+     * A client host and the last file it asked for; lastUsed orders
+     * clients for eviction
+     */
+    struct Client
+    {
+        char      host[HOST_LEN];
+        char      last[NAME_LEN];
+        int       streak;
+        long long lastUsed;
+    };
+
+    /*
+     * The table shared by the parent and all child processes; The queue is
+     * a ring of count names from head, and work counts them for the thread
+     */
+    struct PrefetchTable
+    {
+        pthread_mutex_t lock;
+        sem_t           work;
+        long long       clock;
+        int             head;
+        int             count;
+        Client          clients[MAX_CLIENTS];
+        char            queue[QUEUE_LEN][NAME_LEN];
+    };
+
+    // Shared table; NULL if it could not be set up
+    static PrefetchTable *table = NULL;
+
+    /*
+     * Helpers local to this file
+     */
+    static void *prefetchThread(void *arg);
+    static void warmFile(const char *name);
+    static Client *findClient(const char *host);
+    static void enqueue(const char *name);
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initPrefetch()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns true if the shared table is mapped and the prefetch
+     *           thread is running
+     *
+     *  Purpose: Create the table before the server forks children
+     *
+     *
+     *   *   *   *   *   *   */
+    bool initPrefetch()
+    {
+        void *mem = FtShm::mapShared(sizeof(PrefetchTable));
+        if (mem == NULL)
+        {
+            return (false);
+        }
+        PrefetchTable *t = static_cast<PrefetchTable *>(mem);
+        FtShm::initLock(&t->lock);
+
+        if (sem_init(&t->work, 1, 0) == -1)
+        {
+            munmap(mem, sizeof(PrefetchTable));
+            return (false);
+        }
+
+        table = t;
+        if (!FtShm::startWorker(prefetchThread, t))
+        {
+            table = NULL;
+            munmap(mem, sizeof(PrefetchTable));
+            return (false);
+        }
+
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: noteGet()
+     *
+     *    Entry: The client host, the file it asked for, the name before the
+     *           file or NULL, and the names after it
+     *
+     *     Exit: The file is the host's last one, and the names after it may
+     *           be queued
+     *
+     *  Purpose: Detect a client reading in order; Another get of the same
+     *           file, such as a ranged get of one of its blocks, changes
+     *           nothing
+     *
+     *
+     *   *   *   *   *   *   */
+    void noteGet(const char *host, const char *file, const char *prev,
+                 const char *const *next, int nextCount)
+    {
+        if (table == NULL || strlen(host) >= HOST_LEN
+            || strlen(file) >= NAME_LEN)
+        {
+            return;
+        }
+
+        FtShm::lock(&table->lock);
+        Client *c = findClient(host);
+        if (strcmp(c->last, file) != 0)
+        {
+            bool inOrder = (prev != NULL && strcmp(c->last, prev) == 0);
+            c->streak = (inOrder ? c->streak + 1 : 0);
+            strcpy(c->last, file);
+
+            if (c->streak == 1)
+            {
+                for (int i = 0; i < nextCount; i++)
+                {
+                    enqueue(next[i]);
+                }
+            }
+            else if (c->streak > 1 && nextCount == DEPTH)
+            {
+                enqueue(next[DEPTH - 1]);
+            }
+        }
+        pthread_mutex_unlock(&table->lock);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: prefetchThread()
+     *
+     *    Entry: The shared table
+     *
+     *     Exit: Never returns
+     *
+     *  Purpose: Warm each queued file outside the lock
+     *
+     *
+     *   *   *   *   *   *   */
+    static void *prefetchThread(void *arg)
+    {
+        PrefetchTable *t = static_cast<PrefetchTable *>(arg);
+        char name[NAME_LEN];
+
+        while (1)
+        {
+            if (sem_wait(&t->work) == -1)
+            {
+                continue;
+            }
+
+            FtShm::lock(&table->lock);
+            bool queued = (t->count > 0);
+            if (queued)
+            {
+                strcpy(name, t->queue[t->head]);
+                t->head = (t->head + 1) % QUEUE_LEN;
+                t->count--;
+            }
+            pthread_mutex_unlock(&t->lock);
+
+            if (queued)
+            {
+                warmFile(name);
+            }
+        }
+
+        return (NULL);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: warmFile()
+     *
+     *    Entry: A file name in the served directory or archive
+     *
+     *     Exit: The kernel has been asked to read the start of the file
+     *
+     *  Purpose: Start the disk reads of a file before it is requested; A
+     *           packed file is its range of the archive
+     *
+     *
+     *   *   *   *   *   *   */
+    static void warmFile(const char *name)
+    {
+        if (FtPack::isOpen())
+        {
+            int member = FtPack::find(name);
+            if (member != -1)
+            {
+                long long len = FtPack::size(member);
+                posix_fadvise(FtPack::getFd(), FtPack::offset(member),
+                              len < PREFETCH_BYTES ? len : PREFETCH_BYTES,
+                              POSIX_FADV_WILLNEED);
+            }
+            return;
+        }
+
+        int fd = open(name, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+        if (fd == -1)
+        {
+            return;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        {
+            posix_fadvise(fd, 0, st.st_size < PREFETCH_BYTES ? st.st_size
+                                                             : PREFETCH_BYTES,
+                          POSIX_FADV_WILLNEED);
+        }
+        close(fd);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: findClient()
+     *
+     *    Entry: A host name; The lock is held
+     *
+     *     Exit: Returns the host's entry, which replaces the least recently
+     *           used one if the host is new
+     *
+     *  Purpose: Keep per-client state for a bounded number of hosts
+     *
+     *
+     *   *   *   *   *   *   */
+    static Client *findClient(const char *host)
+    {
+        Client *victim = &table->clients[0];
+        table->clock++;
+
+        for (int i = 0; i < MAX_CLIENTS; i++)
+        {
+            Client *c = &table->clients[i];
+            if (strcmp(c->host, host) == 0)
+            {
+                c->lastUsed = table->clock;
+                return (c);
+            }
+            if (c->lastUsed < victim->lastUsed)
+            {
+                victim = c;
+            }
+        }
+
+        strcpy(victim->host, host);
+        victim->last[0] = '\0';
+        victim->streak = 0;
+        victim->lastUsed = table->clock;
+        return (victim);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: enqueue()
+     *
+     *    Entry: A file name; The lock is held
+     *
+     *     Exit: The name is queued for the thread unless the queue is full
+     *
+     *  Purpose: Prefetches are only hints, so a full queue drops them
+     *
+     *
+     *   *   *   *   *   *   */
+    static void enqueue(const char *name)
+    {
+        if (table->count == QUEUE_LEN || strlen(name) >= NAME_LEN)
+        {
+            return;
+        }
+
+        strcpy(table->queue[(table->head + table->count) % QUEUE_LEN], name);
+        table->count++;
+        sem_post(&table->work);
+    }
+} // FtPrefetch
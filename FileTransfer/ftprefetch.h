@@ -0,0 +1,42 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftprefetch.h
+ *           Overview: This is the header file for the ftserve prefetcher.
+ *                     Clients often get the files of a directory in order,
+ *                     such as part-0001, part-0002, and so on. The last file
+ *                     each client host asked for is kept in memory shared by
+ *                     all of the forked children; When a host asks for the
+ *                     file that follows its last one, the files after it are
+ *                     queued for a thread in the parent, which asks the
+ *                     kernel to read them into the page cache while the
+ *                     current transfer runs
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTPREFETCH_H
+#define FTPREFETCH_H
+
+namespace FtPrefetch
+{
+    const int DEPTH = 2; // Files read ahead of a sequential client
+
+    /*
+     * The initPrefetch() function maps the shared client table and starts
+     * the prefetch thread; It must be called by the parent before any fork()
+     */
+    bool initPrefetch();
+
+    /*
+     * The noteGet() function records that host asked for file, given the
+     * name before it and up to DEPTH names after it in directory order;
+     * The names after it are prefetched if host is reading in order
+     */
+    void noteGet(const char *host, const char *file, const char *prev,
+                 const char *const *next, int nextCount);
+} // FtPrefetch
+#endif // FTPREFETCH_H
@@ -0,0 +1,557 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftsched.cpp
+ *           Overview: This is the implementation file for the ftserve
+ *                     bandwidth scheduler
+ *
+ *                     Tokens are allowed to go negative; A session may send
+ *                     whenever all of its buckets have a non-negative balance
+ *                     and then waits out the debt, so a chunk larger than a
+ *                     bucket's burst can never stall the transfer
+ *
+ *                     The order is shortest remaining processing time: A
+ *                     session may not charge a bucket while a session with
+ *                     fewer bytes left is waiting for it. A waiting session's
+ *                     remaining bytes count half as much for every AGING_SECS
+ *                     it waits, so a large transfer behind a stream of small
+ *                     ones still gets a chunk within a few seconds. The rule
+ *                     only holds sessions back while a bucket is limiting,
+ *                     so the rate is never left unused
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <cmath>
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
+#include "ftsched.h"
+#include "ftshm.h"
+
+namespace FtSched
+{
+    const double BURST_SECS   = 0.25; // Bucket depth in seconds of its rate
+    const double MAX_WAIT_SEC = 0.05; // Re-check the buckets this often
+    const double TURN_WAIT_SEC = 0.01; // Re-check a session held for its turn
+    const double AGING_SECS   = 0.1; // Waiting this long halves the priority
+    const double STALE_SECS   = 1.0; // A waiter not seen this long is ignored
+
+    /*
+     * A transfer in progress; waitSince is when it began waiting to send, or
+     * 0 while it is not waiting
+     */
+    struct SessionSlot
+    {
+        pid_t     pid;
+        int       client;
+        long long remaining;
+        double    waitSince;
+        double    lastTry;
+    };
+
+    /*
+     * A client host with at least one transfer in progress
+     */
+    struct ClientEntry
+    {
+        char        host[MAX_HOST_LEN];
+        int         refs;
+        TokenBucket bucket;
+    };
+
+    /*
+     * The session table shared by the parent and all child processes
+     */
+    struct SchedTable
+    {
+        pthread_mutex_t lock;
+        TokenBucket     global;
+        double          clientRate;
+        SessionSlot     sessions[MAX_SESSIONS];
+        ClientEntry     clients[MAX_CLIENTS];
+    };
+
+    // Shared table; NULL when no limits are configured
+    static SchedTable *table = NULL;
+
+    /*
+     * Helpers local to this file
+     */
+    static double monoNow();
+    static void initBucket(TokenBucket *tb, double rate, double now);
+    static void refill(TokenBucket *tb, double now);
+    static double debtWait(const TokenBucket *tb);
+    static int findClient(const char *client, double now);
+    static void releaseSlot(int slot);
+    static double priority(const SessionSlot *s, double now);
+    static bool shorterWaiting(int slot, double now);
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initScheduler()
+     *
+     *    Entry: Global and per-client rates in bytes per second; 0 disables
+     *           the corresponding limit
+     *
+     *     Exit: The shared session table is mapped and initialized if any
+     *           limit is set
+     *
+     *  Purpose: Create the scheduler state before the server forks children
+     *
+     *
+     *   *   *   *   *   *   */
+    void initScheduler(long long globalRate, long long clientRate)
+    {
+        if (globalRate <= 0 && clientRate <= 0)
+        {
+            return;
+        }
+
+        void *mem = FtShm::mapShared(sizeof(SchedTable));
+        if (mem == NULL)
+        {
+            std::cerr << "Scheduler mmap: " << std::strerror(errno) << "\n";
+            return;
+        }
+        table = static_cast<SchedTable *>(mem);
+        FtShm::initLock(&table->lock);
+
+        initBucket(&table->global, (globalRate > 0 ? globalRate : 0),
+                   monoNow());
+        table->clientRate = (clientRate > 0 ? clientRate : 0);
+
+        std::cout << "Rate limits: global " << globalRate << " B/s, client "
+                  << clientRate << " B/s\n";
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: registerSession()
+     *
+     *    Entry: The client host name and the expected transfer size in bytes
+     *           or -1 if unknown
+     *
+     *     Exit: Returns the session slot or -1 if the session is not tracked
+     *
+     *  Purpose: Add the calling process to the shared session table; The
+     *           expected size is the transfer's remaining bytes for the
+     *           shortest first order
+     *
+     *
+     *   *   *   *   *   *   */
+    int registerSession(const char *client, long long expectedBytes)
+    {
+        if (table == NULL)
+        {
+            return (-1);
+        }
+
+        double now = monoNow();
+        FtShm::lock(&table->lock);
+
+        // Reclaim slots left by children that died without unregistering
+        for (int i = 0; i < MAX_SESSIONS; i++)
+        {
+            if (table->sessions[i].pid != 0
+                && kill(table->sessions[i].pid, 0) == -1 && errno == ESRCH)
+            {
+                releaseSlot(i);
+            }
+        }
+
+        // Find a free session slot
+        int slot = -1;
+        for (int i = 0; i < MAX_SESSIONS && slot == -1; i++)
+        {
+            if (table->sessions[i].pid == 0)
+            {
+                slot = i;
+            }
+        }
+
+        int clientIdx = -1;
+        if (slot != -1)
+        {
+            clientIdx = findClient(client, now);
+        }
+
+        if (slot == -1 || clientIdx == -1)
+        {
+            // Table is full; the transfer runs unscheduled
+            pthread_mutex_unlock(&table->lock);
+            return (-1);
+        }
+
+        SessionSlot *s = &table->sessions[slot];
+        s->pid = getpid();
+        s->client = clientIdx;
+        s->remaining = (expectedBytes >= 0 ? expectedBytes : UNKNOWN_XFER);
+        s->waitSince = 0;
+        s->lastTry = now;
+        table->clients[clientIdx].refs++;
+
+        pthread_mutex_unlock(&table->lock);
+
+        return (slot);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: unregisterSession()
+     *
+     *    Entry: The slot returned by registerSession()
+     *
+     *     Exit: The slot and its client reference are released
+     *
+     *  Purpose: Remove a finished transfer from the session table
+     *
+     *
+     *   *   *   *   *   *   */
+    void unregisterSession(int slot)
+    {
+        if (table == NULL || slot < 0 || slot >= MAX_SESSIONS)
+        {
+            return;
+        }
+
+        FtShm::lock(&table->lock);
+        if (table->sessions[slot].pid == getpid())
+        {
+            releaseSlot(slot);
+        }
+        pthread_mutex_unlock(&table->lock);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: acquireBytes()
+     *
+     *    Entry: The session slot and the number of bytes about to be sent
+     *
+     *     Exit: Returns once the bytes have been charged to every bucket
+     *
+     *  Purpose: Pace a transfer by sleeping off the waits tryAcquireBytes()
+     *           reports
+     *
+     *
+     *   *   *   *   *   *   */
+    void acquireBytes(int slot, int bytes)
+    {
+        double wait;
+        while ((wait = tryAcquireBytes(slot, bytes)) > 0)
+        {
+            struct timespec ts;
+            ts.tv_sec = 0;
+            ts.tv_nsec = static_cast<long>(wait * 1e9);
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: tryAcquireBytes()
+     *
+     *    Entry: The session slot and the number of bytes about to be sent
+     *
+     *     Exit: Returns 0 if the bytes were charged to every bucket, or the
+     *           seconds to wait before trying again
+     *
+     *  Purpose: Pace a transfer without blocking; Each call is a chance
+     *           for one slice of the transfer, which is granted when the
+     *           buckets allow it and it is this session's turn
+     *
+     *
+     *   *   *   *   *   *   */
+    double tryAcquireBytes(int slot, int bytes)
+    {
+        if (table == NULL || slot < 0 || slot >= MAX_SESSIONS)
+        {
+            return (0);
+        }
+
+        double now = monoNow();
+        FtShm::lock(&table->lock);
+
+        SessionSlot *s = &table->sessions[slot];
+        ClientEntry *c = &table->clients[s->client];
+
+        refill(&table->global, now);
+        refill(&c->bucket, now);
+
+        double wait = debtWait(&table->global);
+        double w = debtWait(&c->bucket);
+        if (w > wait)
+        {
+            wait = w;
+        }
+
+        // The buckets allow it; Let a shorter waiting transfer go first
+        if (wait <= 0 && shorterWaiting(slot, now))
+        {
+            wait = TURN_WAIT_SEC;
+        }
+
+        if (wait <= 0)
+        {
+            s->remaining -= bytes;
+            if (s->remaining < 0)
+            {
+                s->remaining = 0;
+            }
+            s->waitSince = 0;
+
+            // Charge the bytes to every limiting bucket
+            if (table->global.rate > 0)
+            {
+                table->global.tokens -= bytes;
+            }
+            if (c->bucket.rate > 0)
+            {
+                c->bucket.tokens -= bytes;
+            }
+            pthread_mutex_unlock(&table->lock);
+            return (0);
+        }
+
+        if (s->waitSince == 0)
+        {
+            s->waitSince = now;
+        }
+        s->lastTry = now;
+        pthread_mutex_unlock(&table->lock);
+
+        // Try again early in case the order changed
+        if (wait > MAX_WAIT_SEC)
+        {
+            wait = MAX_WAIT_SEC;
+        }
+
+        return (wait);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: monoNow()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns the monotonic clock in seconds
+     *
+     *  Purpose: Time source for the token buckets
+     *
+     *
+     *   *   *   *   *   *   */
+    static double monoNow()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (ts.tv_sec + ts.tv_nsec / 1e9);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initBucket()
+     *
+     *    Entry: The bucket, its rate in bytes per second, and the current time
+     *
+     *     Exit: The bucket starts full
+     *
+     *  Purpose: Initialize a token bucket
+     *
+     *
+     *   *   *   *   *   *   */
+    static void initBucket(TokenBucket *tb, double rate, double now)
+    {
+        tb->rate = rate;
+        tb->burst = rate * BURST_SECS;
+        tb->tokens = tb->burst;
+        tb->last = now;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: refill()
+     *
+     *    Entry: The bucket and the current time
+     *
+     *     Exit: Tokens earned since the last refill are added up to the burst
+     *
+     *  Purpose: Advance a token bucket to the current time
+     *
+     *
+     *   *   *   *   *   *   */
+    static void refill(TokenBucket *tb, double now)
+    {
+        if (tb->rate > 0)
+        {
+            tb->tokens += (now - tb->last) * tb->rate;
+            if (tb->tokens > tb->burst)
+            {
+                tb->tokens = tb->burst;
+            }
+        }
+        tb->last = now;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: debtWait()
+     *
+     *    Entry: A refilled bucket
+     *
+     *     Exit: Returns the seconds until the balance is non-negative
+     *
+     *  Purpose: Compute how long a bucket blocks the sender
+     *
+     *
+     *   *   *   *   *   *   */
+    static double debtWait(const TokenBucket *tb)
+    {
+        if (tb->rate <= 0 || tb->tokens >= 0)
+        {
+            return (0);
+        }
+
+        return (-tb->tokens / tb->rate);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: findClient()
+     *
+     *    Entry: The client host name and the current time; The table lock
+     *           must be held
+     *
+     *     Exit: Returns the client entry index or -1 if the table is full
+     *
+     *  Purpose: Look up the bucket shared by every session of one client
+     *
+     *
+     *   *   *   *   *   *   */
+    static int findClient(const char *client, double now)
+    {
+        int freeIdx = -1;
+
+        for (int i = 0; i < MAX_CLIENTS; i++)
+        {
+            ClientEntry *c = &table->clients[i];
+            if (c->refs > 0 && strncmp(c->host, client, MAX_HOST_LEN - 1) == 0)
+            {
+                return (i);
+            }
+            if (c->refs == 0 && freeIdx == -1)
+            {
+                freeIdx = i;
+            }
+        }
+
+        if (freeIdx != -1)
+        {
+            ClientEntry *c = &table->clients[freeIdx];
+            strncpy(c->host, client, MAX_HOST_LEN - 1);
+            c->host[MAX_HOST_LEN - 1] = '\0';
+            initBucket(&c->bucket, table->clientRate, now);
+        }
+
+        return (freeIdx);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: releaseSlot()
+     *
+     *    Entry: A session slot; The table lock must be held
+     *
+     *     Exit: The slot is free and its client ref is dropped
+     *
+     *  Purpose: Release a session slot
+     *
+     *
+     *   *   *   *   *   *   */
+    static void releaseSlot(int slot)
+    {
+        SessionSlot *s = &table->sessions[slot];
+
+        table->clients[s->client].refs--;
+        memset(s, 0, sizeof(SessionSlot));
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: priority()
+     *
+     *    Entry: A session slot and the current time
+     *
+     *     Exit: Returns the session's aged remaining bytes; Lower goes first
+     *
+     *  Purpose: Halve the remaining bytes for every AGING_SECS the session
+     *           has waited, so a starved transfer's turn always comes
+     *
+     *
+     *   *   *   *   *   *   */
+    static double priority(const SessionSlot *s, double now)
+    {
+        double rem = static_cast<double>(s->remaining);
+
+        if (s->waitSince > 0)
+        {
+            rem *= std::exp2(-(now - s->waitSince) / AGING_SECS);
+        }
+
+        return (rem);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: shorterWaiting()
+     *
+     *    Entry: The calling session's slot and the current time; The table
+     *           lock must be held
+     *
+     *     Exit: Returns true if a session ahead of it is waiting for a
+     *           bucket it needs
+     *
+     *  Purpose: Enforce the shortest first order; A waiter held by its own
+     *           client's bucket does not hold back other clients, so the
+     *           global rate is not left idle for it
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool shorterWaiting(int slot, double now)
+    {
+        SessionSlot *s = &table->sessions[slot];
+        double mine = priority(s, now);
+
+        for (int i = 0; i < MAX_SESSIONS; i++)
+        {
+            SessionSlot *o = &table->sessions[i];
+            if (i == slot || o->pid == 0 || o->waitSince == 0
+                || now - o->lastTry > STALE_SECS)
+            {
+                continue;
+            }
+
+            ClientEntry *oc = &table->clients[o->client];
+            refill(&oc->bucket, now);
+            bool competes = (o->client == s->client && oc->bucket.rate > 0)
+                            || (table->global.rate > 0
+                                && debtWait(&oc->bucket) <= 0);
+
+            if (competes && priority(o, now) < mine)
+            {
+                return (true);
+            }
+        }
+
+        return (false);
+    }
+} // FtSched
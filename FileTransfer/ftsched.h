@@ -0,0 +1,77 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftsched.h
+ *           Overview: This is the header file for the ftserve bandwidth
+ *                     scheduler. The scheduler keeps a table of the active
+ *                     transfers in memory shared by all of the forked child
+ *                     processes and paces each transfer with a global token
+ *                     bucket and a per-client token bucket. Sessions that
+ *                     compete for a bucket are served one chunk at a time,
+ *                     shortest remaining transfer first, with aging so long
+ *                     transfers are never starved
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTSCHED_H
+#define FTSCHED_H
+
+#include <sys/types.h>
+
+namespace FtSched
+{
+    const int MAX_SESSIONS       = 64; // Maximum tracked transfers
+    const int MAX_CLIENTS        = 64; // Maximum tracked client hosts
+    const int MAX_HOST_LEN       = 64; // Maximum stored client host name
+    const long long UNKNOWN_XFER = 1LL << 40; // Remaining bytes if unknown
+
+    /*
+     * Token bucket refilled at rate bytes per second up to burst bytes; A rate
+     * of 0 means the bucket never limits
+     */
+    struct TokenBucket
+    {
+        double rate;
+        double burst;
+        double tokens;
+        double last;
+    };
+
+    /*
+     * The initScheduler() function maps the shared session table; It must be
+     * called by the parent before any fork(); Rates are bytes per second and
+     * 0 disables the limit
+     */
+    void initScheduler(long long globalRate, long long clientRate);
+
+    /*
+     * The registerSession() function adds the calling process to the session
+     * table as a transfer for the client host; expectedBytes is the size of
+     * the transfer or -1 if unknown; Returns the slot or -1 if not tracked
+     */
+    int registerSession(const char *client, long long expectedBytes);
+
+    /*
+     * The unregisterSession() function removes a session from the table
+     */
+    void unregisterSession(int slot);
+
+    /*
+     * The acquireBytes() function blocks until the session may send the
+     * number of bytes given without exceeding its client's rate or the
+     * global rate, and no shorter transfer is waiting for the same bucket
+     */
+    void acquireBytes(int slot, int bytes);
+
+    /*
+     * The tryAcquireBytes() function charges the bytes and returns 0 if the
+     * session may send them now; Otherwise it returns the seconds to wait
+     * before trying again
+     */
+    double tryAcquireBytes(int slot, int bytes);
+} // FtSched
+#endif // FTSCHED_H
@@ -1,12 +1,131 @@
 /*
  *             Author: Michael Marven
  *       Date Created: 03/05/16
- * Last Date Modified: 03/05/16
+ * Last Date Modified: 10/19/26
  *          File Name: ftserve.cpp
  *           Overview: The program partially satisfies the requirements for 
  *                     Project 2. This is the server program for the project
  *
- *                     Usage: ./ftserve port#
+ *                     Usage: ./ftserve port# [-rate B/s] [-clientrate B/s]
+ *                                          [-ctl path] [-takeover path]
+ *                                          [-cmdtimeout s] [-acktimeout s]
+ *                                          [-conntimeout s] [-minrate B/s]
+ *                                          [-local path] [-io backend]
+ *                                          [-sessions model] [-trace path]
+ *                                          [-tracesample n] [-chunk bytes]
+ *                                          [-archive path] [-cpus list]
+ *
+ *                     Options: -rate       - Global send rate limit
+ *                              -clientrate - Send rate limit per client host
+ *                              -ctl        - Control socket for handoff
+ *                              -takeover   - Take the listener from the
+ *                                            server at the control socket
+ *                              -cmdtimeout - Seconds to wait for a command
+ *                              -acktimeout - Seconds to wait for an ack
+ *                              -conntimeout - Seconds to connect to the
+ *                                            client's data port
+ *                              -minrate    - Minimum transfer rate
+ *                              -local      - Unix socket for local clients
+ *                              -io         - I/O backend, classic or uring
+ *                              -sessions   - Session model, fork or loop
+ *                              -trace      - Chrome trace file of requests
+ *                              -tracesample - Trace one request in n
+ *                              -chunk      - Fixed chunk size, 0 = adapt
+ *                              -archive    - Packed archive to serve
+ *                              -cpus       - CPUs to run sessions on
+ *
+ *                     Timeouts - The parent keeps a timer per child on a
+ *                     timing wheel and kills any child that stays too long
+ *                     in one phase of its request or sends slower than the
+ *                     minimum rate, so stuck clients cannot hold a process
+ *
+ *                     Local fast path - Clients on the same host can connect
+ *                     to the -local Unix socket and send "g file" or "l". The
+ *                     server answers "ready <bytes>" with a read-only
+ *                     descriptor for the file, or for a memfd holding the
+ *                     listing, attached with SCM_RIGHTS. The client reads
+ *                     the data itself and nothing crosses the TCP stack
+ *
+ *                     I/O backends - The classic backend makes one blocking
+ *                     system call per operation. The uring backend runs
+ *                     accept, recv, send, and file reads through an io_uring,
+ *                     and sends each chunk of a regular file as one batch: the
+ *                     header, a splice of the data through a pipe, and the
+ *                     receive of the client's ack, all in one system call
+ *
+ *                     Session models - By default each connection gets a
+ *                     forked child. With -sessions loop every session is a
+ *                     coroutine on one epoll event loop; The request code
+ *                     still reads as a sequence of steps, and each step that
+ *                     would block suspends the session instead of the thread
+ *
+ *                     Conditional get - "c port file hash" sends the file
+ *                     like "g" unless its SHA-256 is the client's hash, when
+ *                     the server answers "NOT MODIFIED". The hashes are kept
+ *                     by (inode, size, mtime) and computed in the background,
+ *                     so the answer never reads the file; "ready <hash>"
+ *                     gives the client the hash once it is known
+ *
+ *                     Ranged get - "r port file offset length" sends only
+ *                     length bytes of the file from offset, in the same
+ *                     chunks as "g", so a client can fetch one file over
+ *                     several connections at once
+ *
+ *                     Sparse get - "s port file" sends the file like "g",
+ *                     but each hole found with SEEK_DATA and SEEK_HOLE is
+ *                     sent as one record, "HOLE" and its length padded to
+ *                     20 characters, instead of its zeros
+ *
+ *                     UDP get - "u port file" sends the file as UDP
+ *                     datagrams to the client's UDP port while the control
+ *                     connection stays TCP. The server paces the datagrams,
+ *                     raising the rate until the client reports loss, and
+ *                     resends the packets in the client's "nack" lines until
+ *                     the client sends "done"
+ *
+ *                     Filtered listing - "l port term ..." sends only the
+ *                     names passing terms such as glob=*.log, prefix=,
+ *                     minsize=, maxsize=, newer=, and older=, tested as the
+ *                     directory is read. limit=n sends the first n in sorted
+ *                     order and answers "ready more" if more follow; The
+ *                     last name sent is the cursor, as after=name
+ *
+ *                     Chunk sizes - Each chunk waits for an ack, so each
+ *                     transfer sizes its chunks to its client: larger while
+ *                     the goodput improves, smaller when the data socket's
+ *                     RTT rises, within what the 4 character header holds
+ *
+ *                     Prefetch - When a client host gets the file after the
+ *                     last one it got in sorted order, the next files are
+ *                     read into the page cache by a thread in the parent
+ *                     while the transfer runs
+ *
+ *                     Packed archive - With -archive the files are served
+ *                     from one archive built by ftmkpack and mapped before
+ *                     any fork: a listing walks its sorted index and a get
+ *                     binary searches it, so neither makes a system call
+ *                     per file. The archive is not hashed, so "c" sends the
+ *                     file as "g" does
+ *
+ *                     Placement - With -cpus the server runs only on the
+ *                     listed CPUs. Each child is pinned to the CPU that
+ *                     received its connection's packets, or to a listed CPU
+ *                     on the same NUMA node, and allocates its buffers on
+ *                     that node; The tables shared by all children are
+ *                     interleaved across the listed nodes. Each session
+ *                     prints where it ran and the totals are printed at exit
+ *
+ *                     Tracing - With -trace each sampled request records the
+ *                     time it spends in every phase, from the reverse lookup
+ *                     to the last ack, and appends it as Chrome trace events
+ *                     to one file shared by all sessions
+ *
+ *                     Restart - A new ftserve started with -takeover
+ *                     receives the listening socket over the old server's
+ *                     control socket with SCM_RIGHTS. The old server stops
+ *                     accepting, lets its children finish their transfers,
+ *                     and exits. SIGTERM drains the same way without a
+ *                     successor.
  *
  *                     This program is adapted from my submission for Project 1
  *                     and examples provided at these pages:
@@ -32,47 +151,179 @@
 #include <cstdio>
 #include <cerrno>
 #include <cstring>
+#include <climits>
 #include <csignal>
-#include <sstream>
-#include <iterator>
+#include <charconv>
 #include <vector>
-#include <fstream>
+#include <deque>
 #include <algorithm>
+#include <mutex>
+#include <condition_variable>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
 #include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include "ftsched.h"
+#include "ftunix.h"
+#include "ftwatch.h"
+#include "ftarena.h"
+#include "ftio.h"
+#include "ftco.h"
+#include "fttrace.h"
+#include "fthash.h"
+#include "ftflight.h"
+#include "ftchunk.h"
+#include "ftpack.h"
+#include "ftprefetch.h"
+#include "ftudp.h"
+#include "ftnuma.h"
+#include "ftlist.h"
+#include "ftshm.h"
 
 
-const int ARGS_NUM          = 2; // Correct number of command line arguments
+const int ARGS_NUM          = 2; // Minimum number of command line arguments
 const int MAX_PORT_NUM      = 65535; // Maximum port number allowed
 const int BACKLOG           = 5; // Maximum number of connections
 const int MAX_OUT_MSG       = 512; // Maximum outgoing message size
 const int MAX_TRANS_MSG     = 512; // Maximum transmitted message size
-const int MAX_FILE_CHUNK    = 4092; // Maximum transmitted data size
-const int MAX_PACK_SIZE     = 4096; // Maximum size of transmitted packet
+const int MAX_FILE_CHUNK    = 4092; // Size of each shared pool chunk
+const int MAX_PACK_SIZE     = 4 + FtChunk::MAX_CHUNK; // Largest packet
 const int ERR_MSG_SIZE      = 15; // Size of FILE NOT FOUND msg
 const int OK_MSG_SIZE       = 6; // Size of ready msg
+const int MAX_CTL_PATH      = 108; // Maximum control socket path length
+const int DRAIN_POLL_USEC   = 100000; // Child exit check interval when draining
+const int CMD_TIMEOUT       = 10; // Default seconds to receive the command
+const int ACK_TIMEOUT       = 30; // Default seconds to receive an ack
+const int CONN_TIMEOUT      = 10; // Default seconds to connect the data port
+const int MIN_RATE          = 1024; // Default minimum transfer rate in B/s
+const int RATE_WINDOW       = 30; // Seconds per minimum rate check
+const int HANDOFF_MSG_LEN   = 16; // Fixed size of each handoff message
+const int HEADER_SIZE       = 4; // Size of the byte count before each chunk
+const int HOLE_LEN_SIZE     = 20; // Size of the length in a hole record
+const int HOLE_SIZE         = HEADER_SIZE + HOLE_LEN_SIZE; // Hole record
+const int CMD_LEN           = 8; // Maximum command token size
+const int DIR_START_CAP     = 64; // Initial capacity of a directory list
+const int SESSION_ARENA     = 65536; // Size of each session arena block
+
+const char ERR_MSG[]        = "FILE NOT FOUND"; // Sent for a missing file
+const char OK_MSG[]         = "ready"; // Sent when ready to transmit
+const char NOT_MOD_MSG[]    = "NOT MODIFIED"; // Sent for an unchanged file
+const char HOLE_TAG[]       = "HOLE"; // Header of a hole record
+const char MORE_MSG[]       = "ready more"; // Ready for a cut short page
 
 const char *host = "localhost";
 
 struct CmdData
 {
-	std::string command;
-	std::string file;
+	char command[CMD_LEN];
+	char file[MAX_TRANS_MSG];
+	char hash[FtHash::HASH_HEX + 1];
+	long long offset;
+	long long length;
 	int dataPort;	
+	FtList::Filter filter;
+};
+
+/*
+ * Structure for a directory listing; The names and the array are owned by
+ * the session arena, or names is NULL when the listing is the archive's
+ * index. more is set when a page is cut short of the matching names
+ */
+struct DirList
+{
+    const char **names;
+    int          count;
+    bool         more;
+};
+
+/*
+ * Structure for a directory read queued for the loop's helper thread; The
+ * helper fills dir and writes to doneFd, an eventfd the session waits on
+ */
+struct DirJob
+{
+    FtArena::Arena       *arena;
+    const FtList::Filter *filter;
+    DirList              dir;
+    int                  doneFd;
+};
+
+/*
+ * Structure for the directory reads waiting for the loop's helper thread
+ */
+struct DirQueue
+{
+    std::mutex              lock;
+    std::condition_variable ready;
+    std::deque<DirJob *>    jobs;
+};
+
+/*
+ * Structure for the server options given after the port number; Rates are in
+ * bytes per second and 0 means unlimited
+ */
+struct ServerOpts
+{
+    long long       rate;
+    long long       clientRate;
+    std::string     ctlPath;
+    std::string     takeover;
+    std::string     localPath;
+    FtIo::Backend   ioBackend;
+    bool            loopSessions;
+    std::string     tracePath;
+    int             traceEvery;
+    int             chunkSize;
+    std::string     archivePath;
+    std::string     cpuList;
+    FtWatch::Limits limits;
 };
 
 // Declare a variable for the child process pid
 pid_t spawnPid = -5;
 
+// Declare a variable for the child's bandwidth scheduler slot
+int schedSlot = -1;
+
+// Declare the child's request trace
+FtTrace::Request reqTrace;
+
+// Declare variables for the children still running and a pending drain
+volatile sig_atomic_t activeChildren = 0;
+volatile sig_atomic_t drainRequested = 0;
+
+// Declare the signal mask the parent waits with; SIGTERM is blocked at all
+// other times, so it always lands in a wait that sees the drain flag after
+sigset_t waitMask;
+
+// Declare the control socket path; Kept in a char array for signal handlers
+char ctlSockPath[MAX_CTL_PATH] = "";
+
+// Declare the loop's directory queue; It is never destroyed, since exit()
+// would otherwise wait for the helper thread sleeping on it
+DirQueue *dirQueue = NULL;
+
 /*
  * The validateCommArgsQuant function accepts an int as a parameter for the
  * quantity of command line arguments and validates that the value is correct
  */
 void validateArgsNum(int argsEnt, int args, std::string prog);
 
+/*
+ * The parseOptions() function parses the option flags following the port
+ * number into a ServerOpts struct
+ */
+ServerOpts parseOptions(int argc, char *argv[]);
+
 /*
  * The printCommError function prints an error message explaining the correct
  * format for command line argument entry and exits the program
@@ -102,18 +353,51 @@ void sigchld_handler(int s);
  */
 void sigint_handler(int s);
 
+/*
+ * The sigterm_handler() function requests that the server stop accepting and
+ * exit once its children finish
+ */
+void sigterm_handler(int s);
+
 /*
  * The setUpConn() function sets up the parameters for the socket and connection 
  * then binds to the socket
  */
 void setUpConn(const char *host, const char *port, int *sock_fd);
 
+/*
+ * The takeoverListener() function receives the listening socket, and the
+ * local listening socket if the running server has one, from the running
+ * server at the control socket path
+ */
+void takeoverListener(const char *path, const char *port, int *sock_fd,
+                      int *local_fd);
+
+/*
+ * The handOffListener() function passes the listening sockets to a new server
+ * that connected to the control socket; Returns true if the new server took
+ * them
+ */
+bool handOffListener(int ctl_fd, int sock_fd, int local_fd);
+
+/*
+ * The spawnChild() function forks a child for the connection on new_fd; The
+ * child closes the listeners, takes its CPU, and reports to the watchdog
+ */
+pid_t spawnChild(int sock_fd, int ctl_fd, int local_fd, int new_fd);
+
+/*
+ * The drainAndExit() function waits for all children to finish their
+ * transfers and exits the program
+ */
+void drainAndExit();
+
 /*
  * The recvMsg() function receives the incoming message and stores it in the 
- * inMsg parameter; The function exits the program if the client closes the 
- * connection
+ * inMsg parameter and returns its length; The function exits the program if
+ * the client closes the connection
  */
-void recvMsg(void *inMsg, int *new_fd);
+int recvMsg(void *inMsg, int *new_fd);
 
 /*
  * The sendMsg() function sends the message stored in the outMsg parameter
@@ -121,28 +405,306 @@ void recvMsg(void *inMsg, int *new_fd);
 void sendMsg(void *outMsg, int *new_fd, int msgLen);
 
 /*
- * The buildDir() function returns a vector witha  list of the files in the 
- * current working directory
+ * The buildDir() function returns a list of the files in the current working
+ * directory that pass filter, allocated in the session arena
+ */
+DirList buildDir(FtArena::Arena &arena, const FtList::Filter &filter);
+
+/*
+ * The filterArchive() function returns the archive's files that pass filter
+ */
+DirList filterArchive(FtArena::Arena &arena, const FtList::Filter &filter);
+
+/*
+ * The addDirName() function appends a name to a listing, growing its array
+ * in the arena
+ */
+void addDirName(FtArena::Arena &arena, DirList *dir, int *capacity,
+                const char *name);
+
+/*
+ * The nameLess() function orders names as strcmp() does
+ */
+bool nameLess(const char *a, const char *b);
+
+/*
+ * The inDir() function checks whether a name is in a directory list
+ */
+bool inDir(const DirList &dir, const char *name);
+
+/*
+ * The dirName() function returns name i of a directory list
+ */
+const char *dirName(const DirList &dir, int i);
+
+/*
+ * The notePrefetch() function tells the prefetcher which file a client asked
+ * for and its neighbors in directory order
+ */
+void notePrefetch(const DirList &dir, const char *file, const char *host);
+
+/*
+ * The nextToken() function finds the next whitespace separated token
+ */
+bool nextToken(const char **cur, const char *end, const char **tok, int *len);
+
+/*
+ * The nextCount() function parses the next token as a byte count
+ */
+bool nextCount(const char **cur, const char *end, long long *count);
+
+/*
+ * The parseCommand() function parses a client command into a CmdData struct
+ */
+bool parseCommand(const char *msg, int len, bool hasPort, CmdData *dst);
+
+/*
+ * The buildReadyMsg() function builds the server's "ready" for a file
+ * request; Returns its length, or 0 if the client's copy is current
+ */
+int buildReadyMsg(CmdData *dst, char *outMsg);
+
+/*
+ * The isFileCmd() function checks for a command that sends a file
+ */
+bool isFileCmd(const CmdData *dst);
+
+/*
+ * The xferSize() function returns the expected number of bytes the request
+ * will send, or -1 if unknown
+ */
+long long xferSize(CmdData *dst);
+
+/*
+ * The releaseSched() function releases the child's scheduler slot at exit
+ */
+void releaseSched();
+
+/*
+ * The finishTrace() function writes the child's request trace at exit
+ */
+void finishTrace();
+
+/*
+ * The reportPlacement() function prints and traces where a session runs
+ * when -cpus is in use
+ */
+void reportPlacement(int new_fd, const void *buf, const char *host,
+                     FtTrace::Request &trace);
+
+/*
+ * The completeLocalRequest() function completes a request from a client on
+ * the local Unix socket by passing it a descriptor for the data
+ */
+void completeLocalRequest(int *new_fd, FtArena::Arena &arena);
+
+/*
+ * The answerLocalRequest() function answers a parsed local request with the
+ * directory listing built for it
+ */
+void answerLocalRequest(const CmdData &dst, const DirList &dirListing,
+                        int *new_fd, FtArena::Arena &arena);
+
+/*
+ * The packedFileFd() function copies a packed file into a memfd for a local
+ * client
+ */
+int packedFileFd(const char *file);
+
+/*
+ * The sealMemfd() function seals a memfd so the client it is passed to
+ * cannot change it
+ */
+void sealMemfd(int fd);
+
+/*
+ * The waitClientReady() function waits for the client's "ready" message
+ */
+bool waitClientReady(int *new_fd);
+
+/*
+ * The isReadyMsg() function checks for the client's "ready" message
+ */
+bool isReadyMsg(const char *msg, int len);
+
+/*
+ * The connectData() function opens the data connection to the client with a
+ * socket of sockType, SOCK_STREAM or SOCK_DGRAM
  */
-std::vector<std::string> buildDir();
+int connectData(const char *host, int dataPort, int sockType);
+
+/*
+ * The sendFile() function sends len bytes of a file from start over the data
+ * connection in chunks; A len of -1 sends to the end of the file, and a
+ * sparse transfer sends each hole as a record instead of its zeros
+ */
+void sendFile(const char *file, long long start, long long len, bool sparse,
+              int d_sockfd, int *new_fd);
+
+/*
+ * The findExtent() function returns where the hole or data at off ends, no
+ * further than end, in a file whose bytes start at base in fd
+ */
+long long findExtent(int fd, long long base, long long off, long long end,
+                     bool *isHole);
+
+/*
+ * The buildHole() function builds the record for a hole of len bytes and
+ * returns its size
+ */
+int buildHole(char *outPack, long long len);
+
+/*
+ * The sendHole() function sends a hole record and waits for its ack
+ */
+void sendHole(long long len, int d_sockfd, int *new_fd);
+
+/*
+ * The openSendFile() function opens a file to send and returns the
+ * descriptor and where its bytes are, from the archive when one is served
+ */
+int openSendFile(const char *file, long long *base, long long *size);
+
+/*
+ * The sendFileUdp() function sends a file as paced datagrams over the
+ * connected UDP socket and resends what the client reports missing
+ */
+void sendFileUdp(const char *file, int d_sockfd, int *new_fd);
+
+/*
+ * The sendListing() function sends a directory list over the data connection
+ */
+void sendListing(const DirList &dir, int d_sockfd, int *new_fd);
 
 /*
  * The completeRequest() function completes the client request
  */
-void completeRequest(CmdData *dst, std::string port, std::string host, 
-                     int *new_fd);
+void completeRequest(CmdData *dst, const char *port, const char *host, 
+                     int *new_fd, FtArena::Arena &arena);
+
+/*
+ * The runLoop() function serves every connection from one thread with
+ * coroutine sessions on an event loop; It exits the program when drained
+ */
+void runLoop(int sock_fd, int ctl_fd, int local_fd, const ServerOpts &opts,
+             const char *con_port);
+
+/*
+ * The acceptLoop() coroutine starts a session for each TCP connection
+ */
+FtCo::Task<> acceptLoop(FtCo::Loop &loop, int sock_fd, const ServerOpts &opts,
+                        const char *con_port);
+
+/*
+ * The ctlLoop() coroutine hands the listeners to a new server
+ */
+FtCo::Task<> ctlLoop(FtCo::Loop &loop, int ctl_fd, int sock_fd, int local_fd,
+                     bool *handedOff);
+
+/*
+ * The localAcceptLoop() coroutine starts a session for each local connection
+ */
+FtCo::Task<> localAcceptLoop(FtCo::Loop &loop, int local_fd,
+                             const ServerOpts &opts);
+
+/*
+ * The localSession() coroutine answers one local request
+ */
+FtCo::Task<> localSession(FtCo::Loop &loop, int new_fd, const ServerOpts &opts);
+
+/*
+ * The tcpSession() coroutine runs one TCP request from command to close
+ */
+FtCo::Task<> tcpSession(FtCo::Loop &loop, int new_fd,
+                        struct sockaddr_storage their_addr, socklen_t sin_size,
+                        const ServerOpts &opts, const char *con_port);
+
+/*
+ * The completeRequestAsync() coroutine completes the client request
+ */
+FtCo::Task<> completeRequestAsync(FtCo::Loop &loop, CmdData *dst,
+                                  const char *con_port, const char *host,
+                                  const struct sockaddr *peer,
+                                  socklen_t peerLen, int new_fd,
+                                  FtArena::Arena &arena,
+                                  const FtWatch::Limits &limits, int slot,
+                                  FtTrace::Request &trace);
+
+/*
+ * The connectDataAsync() coroutine opens the data connection to the dataPort
+ * of the client at peer with a socket of sockType
+ */
+FtCo::Task<int> connectDataAsync(FtCo::Loop &loop, const struct sockaddr *peer,
+                                 socklen_t peerLen, const char *host,
+                                 int dataPort, int sockType,
+                                 long long timeoutMs,
+                                 FtTrace::Request &trace);
+
+/*
+ * The startDirWorker() function starts the thread that reads the directory
+ * for loop sessions
+ */
+void startDirWorker();
+
+/*
+ * The dirWorker() function reads the directory for each queued job
+ */
+void *dirWorker(void *arg);
+
+/*
+ * The buildDirAsync() coroutine returns buildDir() run on the helper thread,
+ * so a large directory does not stall the other sessions
+ */
+FtCo::Task<DirList> buildDirAsync(FtCo::Loop &loop, FtArena::Arena &arena,
+                                  const FtList::Filter &filter);
+
+/*
+ * The sendFileAsync() coroutine sends len bytes of a file from start over the
+ * data connection; A len of -1 sends to the end of the file
+ */
+FtCo::Task<> sendFileAsync(FtCo::Loop &loop, const char *file,
+                           long long start, long long len, bool sparse,
+                           int d_sockfd, int new_fd, const char *host,
+                           long long timeoutMs, int slot,
+                           FtTrace::Request &trace);
+
+/*
+ * The sendFileUdpAsync() coroutine sends a file as paced datagrams without
+ * blocking the loop
+ */
+FtCo::Task<> sendFileUdpAsync(FtCo::Loop &loop, const char *file,
+                              int d_sockfd, int new_fd, const char *host,
+                              long long timeoutMs, int slot,
+                              FtTrace::Request &trace);
+
+/*
+ * The sendListingAsync() coroutine sends a directory list over the data
+ * connection
+ */
+FtCo::Task<> sendListingAsync(FtCo::Loop &loop, const DirList &dir,
+                              int d_sockfd, int new_fd, const char *host,
+                              long long timeoutMs, int slot,
+                              FtTrace::Request &trace);
+
+/*
+ * The reportLoopError() function prints why a loop session failed
+ */
+void reportLoopError(const char *host, const char *phase);
 
 int main(int argc, char *argv[])
 {
     // Validate the command line arguments
     validateArgsNum(argc, ARGS_NUM, argv[0]);
     isValidPort(argv[1], argv[0]);
+    ServerOpts opts = parseOptions(argc, argv);
     
     // Declare variables and structs
     int sockfd, newfd;  // listen on sockfd, new connection on newfd
+    int ctlfd;  // handoff requests from a new server on ctlfd
+    int localfd = -1;  // same-host clients on localfd
     struct sockaddr_storage their_addr; // connector's address information
     socklen_t sin_size;
-    struct sigaction sa_chld, sa_int;
+    struct sigaction sa_chld, sa_int, sa_term;
     
     // Set up signal handler for SIGINT
     sa_int.sa_handler = sigint_handler; 
@@ -153,8 +715,138 @@ int main(int argc, char *argv[])
         exit(1);
     }
     
-    // Set up the connection, bind to the port, and listen for connections
-    setUpConn(host, argv[1], &sockfd);
+    // Set up signal handler for SIGTERM; No SA_RESTART so ppoll() wakes up
+    sa_term.sa_handler = sigterm_handler; 
+    sigemptyset(&sa_term.sa_mask);
+    sa_term.sa_flags = 0;
+    if (sigaction(SIGTERM, &sa_term, NULL) == -1) {
+        error("Sigaction - SIGTERM: ");
+        exit(1);
+    }
+    
+    // Block SIGTERM except in ppoll() and epoll_pwait(); Otherwise one that
+    // arrives after the drain check but before an idle wait is lost until
+    // the next connection
+    sigset_t termSet;
+    sigemptyset(&termSet);
+    sigaddset(&termSet, SIGTERM);
+    sigprocmask(SIG_BLOCK, &termSet, &waitMask);
+    sigdelset(&waitMask, SIGTERM);
+    
+    // Set up the connection, bind to the port, and listen for connections,
+    // or take the listener over from the running server
+    if (opts.takeover.empty())
+    {
+        setUpConn(host, argv[1], &sockfd);
+    }
+    else
+    {
+        takeoverListener(opts.takeover.c_str(), argv[1], &sockfd, &localfd);
+    }
+    
+    // Open the local fast path unless it was taken over; A taken over
+    // listener keeps its path, which is needed to remove it at shutdown
+    if (localfd != -1)
+    {
+        struct sockaddr_un local_addr;
+        socklen_t local_len = sizeof local_addr;
+        if (getsockname(localfd, (struct sockaddr *)&local_addr,
+                        &local_len) == 0)
+        {
+            opts.localPath = local_addr.sun_path;
+        }
+        std::cout << "Local clients on " << opts.localPath << "\n";
+    }
+    else if (!opts.localPath.empty())
+    {
+        localfd = FtUnix::unixListen(opts.localPath.c_str(), BACKLOG, false);
+        if (localfd == -1)
+        {
+            error("Local socket: ");
+            exit(1);
+        }
+        std::cout << "Local clients on " << opts.localPath << "\n";
+    }
+    
+    // Keep to the listed CPUs before any shared table is mapped, so the
+    // tables are spread across the nodes of the list
+    if (!opts.cpuList.empty())
+    {
+        if (!FtNuma::initPlacement(opts.cpuList.c_str()))
+        {
+            error("CPU list: ");
+            exit(1);
+        }
+        std::cout << "Placing sessions on CPUs " << opts.cpuList << "\n";
+    }
+    
+    // Set up the I/O backend; Fall back to blocking calls without io_uring
+    if (!FtIo::initIo(opts.ioBackend))
+    {
+        error("io_uring unavailable, using classic I/O: ");
+    }
+    
+    // Set up the session watchdog before any children are forked
+    FtWatch::initWatch(opts.limits);
+    
+    // Start the content hash cache before any children are forked
+    if (!FtHash::initHashCache())
+    {
+        error("Hash cache, conditional gets will send every file: ");
+    }
+    
+    // Start the prefetcher before any children are forked
+    if (!FtPrefetch::initPrefetch())
+    {
+        error("Prefetcher, files will not be read ahead: ");
+    }
+    
+    // Size chunks per transfer unless the size is fixed
+    FtChunk::initChunks(opts.chunkSize);
+    
+    // Map the archive once for every session before any children are forked
+    if (!opts.archivePath.empty())
+    {
+        if (!FtPack::openArchive(opts.archivePath.c_str()))
+        {
+            error("Archive: ");
+            exit(1);
+        }
+        std::cout << "Serving " << FtPack::count() << " files from "
+                  << opts.archivePath << "\n";
+    }
+    
+    // Set up the shared chunk pool before any children are forked
+    if (!FtFlight::initFlight(MAX_FILE_CHUNK))
+    {
+        error("Chunk pool, each transfer will read its own file: ");
+    }
+    
+    // Open the trace file before any children are forked
+    if (!opts.tracePath.empty())
+    {
+        if (!FtTrace::initTrace(opts.tracePath.c_str(), opts.traceEvery))
+        {
+            error("Trace file: ");
+            exit(1);
+        }
+        std::cout << "Tracing 1 in " << opts.traceEvery << " requests to "
+                  << opts.tracePath << "\n";
+    }
+    
+    // Open the control socket a future server will take the listener from
+    // A live socket there is the old server's only when taking over from it
+    strncpy(ctlSockPath, opts.ctlPath.c_str(), MAX_CTL_PATH - 1);
+    ctlfd = FtUnix::unixListen(ctlSockPath, 1,
+                               opts.ctlPath == opts.takeover);
+    if (ctlfd == -1)
+    {
+        error("Control socket: ");
+        exit(1);
+    }
+    
+    // Set up the shared bandwidth scheduler before any children are forked
+    FtSched::initScheduler(opts.rate, opts.clientRate);
     
     // Set up signal handler and clean up any zombie processes
     sa_chld.sa_handler = sigchld_handler; 
@@ -165,18 +857,111 @@ int main(int argc, char *argv[])
         exit(1);
     }
     
+    // Serve from one thread if asked; runLoop() does not return
+    if (opts.loopSessions)
+    {
+        runLoop(sockfd, ctlfd, localfd, opts, argv[1]);
+    }
+    
     // Main accept() loop
     while(1) 
     {  
-        sin_size = sizeof their_addr;
-        newfd = accept(sockfd, (struct sockaddr *)&their_addr, &sin_size);
-        if (newfd == -1) {
+        // Wait for a client connection or a handoff request; A negative fd
+        // is ignored by poll() when there is no local listener
+        struct pollfd pfds[3];
+        pfds[0].fd = sockfd;
+        pfds[0].events = POLLIN;
+        pfds[1].fd = ctlfd;
+        pfds[1].events = POLLIN;
+        pfds[2].fd = localfd;
+        pfds[2].events = POLLIN;
+        
+        if (drainRequested)
+        {
+            close(sockfd);
+            close(ctlfd);
+            unlink(ctlSockPath);
+            if (localfd != -1)
+            {
+                close(localfd);
+                unlink(opts.localPath.c_str());
+            }
+            drainAndExit();
+        }
+        
+        int waitMs = FtWatch::pollTimeoutMs();
+        struct timespec ts;
+        ts.tv_sec = waitMs / 1000;
+        ts.tv_nsec = (waitMs % 1000) * 1000000L;
+        int ready = ppoll(pfds, 3, waitMs == -1 ? NULL : &ts, &waitMask);
+        
+        // Enforce the deadlines of the children
+        FtWatch::tick();
+        
+        if (ready == -1)
+        {
+            if (errno != EINTR)
+            {
+                error("Poll: ");
+            }
+            continue;
+        }
+        
+        if (pfds[1].revents & POLLIN)
+        {
+            // A new server wants the listener; Stop accepting once it has it
+            if (handOffListener(ctlfd, sockfd, localfd))
+            {
+                close(sockfd);
+                close(ctlfd);
+                if (localfd != -1)
+                {
+                    close(localfd);
+                }
+                drainAndExit();
+            }
+            continue;
+        }
+        
+        if (pfds[2].revents & POLLIN)
+        {
+            // Same-host client; Pass it a descriptor instead of the data
+            newfd = FtIo::acceptConn(localfd, NULL, NULL);
+            if (newfd == -1) {
+                error("Local accept: ");
+                continue;
+            }
+            
+            spawnPid = spawnChild(sockfd, ctlfd, localfd, newfd);
+            if (spawnPid == 0)
+            {
+                FtArena::Arena arena(SESSION_ARENA);
+                completeLocalRequest(&newfd, arena);
+                close(newfd);
+                exit(0);
+            }
+            close(newfd);
+            continue;
+        }
+        
+        if (!(pfds[0].revents & POLLIN))
+        {
+            continue;
+        }
+        
+        sin_size = sizeof their_addr;
+        newfd = FtIo::acceptConn(sockfd, (struct sockaddr *)&their_addr,
+                                 &sin_size);
+        if (newfd == -1) {
             error("Accept: ");
             continue;
         }
         
+        // Decide whether to trace the request while the count is shared
+        long long traceId = FtTrace::sample();
+        
         // Fork the process and assign the pid of the child to spawnPid
-        spawnPid = fork();
+        spawnPid = spawnChild(sockfd, ctlfd, localfd, newfd);
         
         // Check which process is running
         if (spawnPid == 0) 
@@ -187,28 +972,41 @@ int main(int argc, char *argv[])
             char inMsgBuf[MAX_TRANS_MSG];
             char host[1024];
             char service[20];
-            memset(&inMsgBuf, '\0', MAX_TRANS_MSG);
             CmdData dst;
+            FtArena::Arena arena(SESSION_ARENA);
             
-            
-            close(sockfd); // Child doesn't need the listener
+            // Start the request trace; It is written however the child exits
+            reqTrace.start(traceId);
+            atexit(finishTrace);
             
             // Get host name
+            reqTrace.enter(FtTrace::TR_REVERSE_LOOKUP);
             getnameinfo((struct sockaddr *)&their_addr, sin_size, host, 
                         sizeof host, service, sizeof service, NI_NOFQDN);
             
             std::cout << "Connection from " << host << "\n";
             
             // Receive message
-            recvMsg(&inMsgBuf, &newfd);
+            reqTrace.enter(FtTrace::TR_CMD_READ);
+            int inLen = recvMsg(&inMsgBuf, &newfd);
+            reqTrace.enter(FtTrace::TR_WORK);
+            reportPlacement(newfd, inMsgBuf, host, reqTrace);
             
             // Parse message for command, port, and file name if present
-            // std::string inMsg(inMsgBuf);
-            std::istringstream inMsg(inMsgBuf);
-            inMsg >> dst.command >> dst.dataPort >> dst.file;
+            if (!parseCommand(inMsgBuf, inLen, true, &dst))
+            {
+                std::cout << "Malformed command from " << host << "\n";
+                close(newfd);
+                exit(0);
+            }
+            reqTrace.setRequest(dst.command, dst.file, host);
+            
+            // Join the bandwidth scheduler for the length of the request
+            schedSlot = FtSched::registerSession(host, xferSize(&dst));
+            atexit(releaseSched);
             
             // Complete the client request
-            completeRequest(&dst, argv[1], host, &newfd);
+            completeRequest(&dst, argv[1], host, &newfd, arena);
             
             // Close control port connection and quit
             close(newfd);
@@ -243,12 +1041,164 @@ int main(int argc, char *argv[])
 void validateArgsNum(int argsEnt, int args, std::string prog)
 {
     // Validate that the quantity of command line arguments is correct
-    if (argsEnt != args)
+    // Each option after the port number is a flag and value pair
+    if (argsEnt < args || (argsEnt - args) % 2 != 0)
     {
         printCommError(prog);
     }
 }
 
+/*   *   *   *   *   *   *
+ * 
+ * Function: parseOptions()
+ * 
+ *    Entry: The command line argument count and array
+ *
+ *     Exit: Returns a ServerOpts struct with the options entered or defaults
+ *
+ *  Purpose: Parse the option flag and value pairs after the port number
+ *
+ *
+ *   *   *   *   *   *   */
+ServerOpts parseOptions(int argc, char *argv[])
+{
+    ServerOpts opts;
+    opts.rate = 0;
+    opts.clientRate = 0;
+    opts.limits.cmdSecs = CMD_TIMEOUT;
+    opts.limits.ackSecs = ACK_TIMEOUT;
+    opts.limits.connSecs = CONN_TIMEOUT;
+    opts.limits.minRate = MIN_RATE;
+    opts.limits.rateWindowSecs = RATE_WINDOW;
+    opts.ioBackend = FtIo::IO_CLASSIC;
+    opts.loopSessions = false;
+    opts.traceEvery = 1;
+    opts.chunkSize = 0;
+    opts.ctlPath = std::string("/tmp/ftserve.") + argv[1] + ".sock";
+    
+    for (int i = ARGS_NUM; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        
+        // Options with path values
+        if (flag == "-ctl" || flag == "-takeover" || flag == "-local")
+        {
+            if (std::strlen(argv[i + 1]) >= MAX_CTL_PATH)
+            {
+                printCommError(argv[0]);
+            }
+            if (flag == "-local")
+            {
+                opts.localPath = argv[i + 1];
+                continue;
+            }
+            if (flag == "-takeover")
+            {
+                opts.takeover = argv[i + 1];
+            }
+            opts.ctlPath = argv[i + 1];
+            continue;
+        }
+        
+        if (flag == "-io")
+        {
+            std::string name = argv[i + 1];
+            if (name == "uring")
+            {
+                opts.ioBackend = FtIo::IO_URING;
+            }
+            else if (name != "classic")
+            {
+                printCommError(argv[0]);
+            }
+            continue;
+        }
+        
+        if (flag == "-sessions")
+        {
+            std::string name = argv[i + 1];
+            if (name == "loop")
+            {
+                opts.loopSessions = true;
+            }
+            else if (name != "fork")
+            {
+                printCommError(argv[0]);
+            }
+            continue;
+        }
+        
+        if (flag == "-trace")
+        {
+            opts.tracePath = argv[i + 1];
+            continue;
+        }
+        
+        if (flag == "-archive")
+        {
+            opts.archivePath = argv[i + 1];
+            continue;
+        }
+        
+        if (flag == "-cpus")
+        {
+            opts.cpuList = argv[i + 1];
+            continue;
+        }
+        
+        char *end;
+        long long value = std::strtoll(argv[i + 1], &end, 10);
+        if (*end != '\0' || value < 0)
+        {
+            printCommError(argv[0]);
+        }
+        
+        if (flag == "-rate")
+        {
+            opts.rate = value;
+        }
+        else if (flag == "-clientrate")
+        {
+            opts.clientRate = value;
+        }
+        else if (flag == "-cmdtimeout")
+        {
+            opts.limits.cmdSecs = value;
+        }
+        else if (flag == "-acktimeout")
+        {
+            opts.limits.ackSecs = value;
+        }
+        else if (flag == "-conntimeout")
+        {
+            opts.limits.connSecs = value;
+        }
+        else if (flag == "-minrate")
+        {
+            opts.limits.minRate = value;
+        }
+        else if (flag == "-tracesample")
+        {
+            opts.traceEvery = value;
+        }
+        else if (flag == "-chunk")
+        {
+            if (value != 0 && (value < FtChunk::MIN_CHUNK
+                               || value > FtChunk::MAX_CHUNK))
+            {
+                printCommError(argv[0]);
+            }
+            opts.chunkSize = value;
+        }
+        else
+        {
+            printCommError(argv[0]);
+        }
+    }
+    
+    return (opts);
+}
+
 /*   *   *   *   *   *   *
  * 
  * Function: printCommError()
@@ -265,9 +1215,35 @@ void validateArgsNum(int argsEnt, int args, std::string prog)
 void printCommError(std::string prog)
 {
     // Print error message explaining correct command line format
-    std::cerr << "Usage: " << prog << " port#\n\n"
+    std::cerr << "Usage: " << prog << " port# [-rate B/s] [-clientrate B/s]\n"
+              << "       [-ctl path] [-takeover path]\n"
+              << "       [-cmdtimeout s] [-acktimeout s] [-conntimeout s]\n"
+              << "       [-minrate B/s] [-local path] [-io backend]\n"
+              << "       [-sessions model] [-trace path] [-tracesample n]\n"
+              << "       [-chunk bytes] [-archive path] [-cpus list]\n\n"
               << "Description: port number between 1 and 65535 must be provided\n"
-              << "Example: " << prog << " 29658\n\n";
+              << "             -rate limits the total send rate in bytes/sec\n"
+              << "             -clientrate limits the send rate per client\n"
+              << "             -ctl sets the control socket for restarts\n"
+              << "             -takeover takes the listener from the server\n"
+              << "             at the given control socket\n"
+              << "             -cmdtimeout, -acktimeout, and -conntimeout set\n"
+              << "             the seconds allowed for each phase (0 = none)\n"
+              << "             -minrate closes transfers slower than B/s\n"
+              << "             -local opens a Unix socket for local clients\n"
+              << "             -io selects the classic or uring I/O backend\n"
+              << "             -sessions loop serves every session from one\n"
+              << "             thread instead of forking a child for each\n"
+              << "             -trace appends per-phase request timings to a\n"
+              << "             Chrome trace file; -tracesample traces one\n"
+              << "             request in n (0 = none, default 1)\n"
+              << "             -chunk fixes the chunk size at 1024 to 9999\n"
+              << "             bytes (0 = adapt to each client, default)\n"
+              << "             -archive serves the files packed by ftmkpack\n"
+              << "             instead of the current directory\n"
+              << "             -cpus runs sessions only on the listed CPUs,\n"
+              << "             such as 0-3,8, each near its NIC queue\n"
+              << "Example: " << prog << " 29658 -rate 10485760\n\n";
     
     std::exit(1);
 }
@@ -336,7 +1312,13 @@ void sigchld_handler(int s)
     // waitpid() might overwrite errno, so we save and restore it:
     int saved_errno = errno;
 
-    while(waitpid(-1, NULL, WNOHANG) > 0);
+    pid_t pid;
+    while((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+    {
+        activeChildren = activeChildren - 1;
+        FtWatch::reapChild(pid);
+        FtFlight::reapChild(pid);
+    }
 
     errno = saved_errno;
 }
@@ -368,6 +1350,25 @@ void sigint_handler(int sig)
 
     exit(0);
 }
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: sigterm_handler()
+ * 
+ *    Entry: Input parameter is an int representing the signal number which 
+ *           is expected to be SIGTERM
+ *
+ *     Exit: Sets the drain flag checked by the accept loop
+ *
+ *  Purpose: Works with sigaction() so SIGTERM stops new connections and lets
+ *           the transfers in progress finish before the server exits
+ *
+ *
+ *   *   *   *   *   *   */
+void sigterm_handler(int sig)
+{
+    drainRequested = 1;
+}
  
 /*   *   *   *   *   *   *
  * 
@@ -449,6 +1450,210 @@ void setUpConn(const char *host, const char *port, int *sock_fd)
     std::cout << "Server open on " << port << "\n";
 }
 
+/*   *   *   *   *   *   *
+ * 
+ * Function: takeoverListener()
+ * 
+ *    Entry: Input parameters are the control socket path of the running
+ *           server, the port number, and int pointers for the socket file
+ *           descriptors
+ *
+ *     Exit: Value of parameter sock_fd will be the running server's listener
+ *           and local_fd its local listener or -1
+ *
+ *  Purpose: Receive the listening socket over the control socket so the port
+ *           is never closed during a restart; The running server keeps
+ *           accepting until it reads the "ok" sent here
+ *
+ *
+ *   *   *   *   *   *   */
+void takeoverListener(const char *path, const char *port, int *sock_fd,
+                      int *local_fd)
+{
+    char msg[HANDOFF_MSG_LEN];
+    
+    int ctl = FtUnix::unixConnect(path);
+    if (ctl == -1)
+    {
+        error("Takeover connect: ");
+        exit(1);
+    }
+    
+    if (FtUnix::recvFd(ctl, msg, sizeof msg, sock_fd) <= 0 || *sock_fd == -1)
+    {
+        std::cerr << "Takeover: no listener received\n";
+        exit(1);
+    }
+    
+    // The second message carries the local listener if there is one
+    if (FtUnix::recvFd(ctl, msg, sizeof msg, local_fd) <= 0)
+    {
+        std::cerr << "Takeover: handoff incomplete\n";
+        exit(1);
+    }
+    
+    // Tell the old server it can stop accepting
+    sendMsg((void *)"ok", &ctl, 3);
+    close(ctl);
+    
+    std::cout << "Server open on " << port << " (took over listener)\n";
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: handOffListener()
+ * 
+ *    Entry: Input parameters are the control socket, listening socket, and
+ *           local listening socket file descriptors
+ *
+ *     Exit: Returns true once the new server confirms it has the listeners
+ *
+ *  Purpose: Pass the listening sockets to a new server with SCM_RIGHTS; Each
+ *           message has a fixed size so the two descriptors stay separate
+ *
+ *
+ *   *   *   *   *   *   */
+bool handOffListener(int ctl_fd, int sock_fd, int local_fd)
+{
+    char ack[MAX_TRANS_MSG];
+    char msg[HANDOFF_MSG_LEN];
+    int fd;
+    bool handedOff = false;
+    int sent;
+    
+    int conn = accept(ctl_fd, NULL, NULL);
+    if (conn == -1)
+    {
+        error("Control accept: ");
+        return (false);
+    }
+    
+    memset(msg, '\0', sizeof msg);
+    strcpy(msg, "listener");
+    sent = FtUnix::sendFd(conn, sock_fd, msg, sizeof msg);
+    if (sent != -1)
+    {
+        memset(msg, '\0', sizeof msg);
+        if (local_fd != -1)
+        {
+            strcpy(msg, "local");
+            sent = FtUnix::sendFd(conn, local_fd, msg, sizeof msg);
+        }
+        else
+        {
+            strcpy(msg, "nolocal");
+            sent = send(conn, msg, sizeof msg, MSG_NOSIGNAL);
+        }
+    }
+    
+    if (sent == -1)
+    {
+        error("Handoff: ");
+    }
+    else if (FtUnix::recvFd(conn, ack, sizeof ack, &fd) > 0
+             && strncmp(ack, "ok", 2) == 0)
+    {
+        handedOff = true;
+        std::cout << "Listener handed off to new server\n";
+    }
+    
+    close(conn);
+    
+    return (handedOff);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: spawnChild()
+ * 
+ *    Entry: Input parameters are the listening, control, and local listening
+ *           socket file descriptors and the new connection's descriptor
+ *
+ *     Exit: Returns 0 in the child and the child's pid or -1 in the parent
+ *
+ *  Purpose: Fork a child for a new connection; The child drops the
+ *           listeners, moves to its CPU before allocating anything of its
+ *           own, and reports its phases to the parent's watchdog
+ *
+ *
+ *   *   *   *   *   *   */
+pid_t spawnChild(int sock_fd, int ctl_fd, int local_fd, int new_fd)
+{
+    // Hold SIGCHLD until the child's pid is in its watch slot, so a child
+    // that exits at once is not reaped before its slot can be freed
+    sigset_t chldSet, oldSet;
+    sigemptyset(&chldSet);
+    sigaddset(&chldSet, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chldSet, &oldSet);
+    
+    // Flush first so the child does not repeat buffered console output
+    int watchSlot = FtWatch::reserveSlot();
+    std::cout.flush();
+    pid_t pid = fork();
+    
+    if (pid == 0)
+    {
+        close(sock_fd); // Child doesn't need the listeners
+        close(ctl_fd);
+        if (local_fd != -1)
+        {
+            close(local_fd);
+        }
+        
+        // Only the parent needs SIGTERM and SIGCHLD blocked
+        sigprocmask(SIG_SETMASK, &waitMask, NULL);
+        
+        // Run near the connection's packets; The ring is then local too
+        FtNuma::placeSession(new_fd);
+        
+        // The parent's ring stays with the parent
+        FtIo::initChild();
+        
+        // Report request phases to the parent's watchdog
+        FtWatch::attach(watchSlot);
+        atexit(FtWatch::finish);
+    }
+    else
+    {
+        if (pid > 0)
+        {
+            activeChildren = activeChildren + 1;
+        }
+        FtWatch::trackChild(watchSlot, pid);
+        sigprocmask(SIG_SETMASK, &oldSet, NULL);
+    }
+    
+    return (pid);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: drainAndExit()
+ * 
+ *    Entry: None
+ *
+ *     Exit: Exits the program once no children are running
+ *
+ *  Purpose: Let the transfers in progress finish; The listener must already
+ *           be closed so no new children are forked
+ *
+ *
+ *   *   *   *   *   *   */
+void drainAndExit()
+{
+    std::cout << "Draining " << activeChildren << " active session(s)\n";
+    
+    while (activeChildren > 0)
+    {
+        usleep(DRAIN_POLL_USEC);
+        FtWatch::tick();
+    }
+    
+    FtNuma::printTotals();
+    std::cout << "Drained; exiting\n";
+    exit(0);
+}
+
 /*   *   *   *   *   *   *
  * 
  * Function: recvMsg()
@@ -456,20 +1661,20 @@ void setUpConn(const char *host, const char *port, int *sock_fd)
  *    Entry: Input parameters are a char array for the message, 
  *           and an int pointer for the new socket file descriptor
  *
- *     Exit: Value of parameter inMsg
+ *     Exit: Value of parameter inMsg; Returns the message length or -1
  *
  *  Purpose: Receives a message from the client and ends the child process if 
  *           the client closes the connection
  *
  *
  *   *   *   *   *   *   */
-void recvMsg(void *inMsg, int *new_fd)
+int recvMsg(void *inMsg, int *new_fd)
 {
     // Declare variables
     int inMsgLen;
     
     // Receive the message; Will block until msg arrives;
-    inMsgLen = recv(*new_fd, inMsg, MAX_TRANS_MSG, 0);
+    inMsgLen = FtIo::recvData(*new_fd, inMsg, MAX_TRANS_MSG);
     if (inMsgLen == -1)
     {
         error("Receive: ");
@@ -479,6 +1684,8 @@ void recvMsg(void *inMsg, int *new_fd)
         // If message length == 0, the connection has been terminated
         exit(0);
     }
+    
+    return (inMsgLen);
 }
 
 /*   *   *   *   *   *   *
@@ -500,7 +1707,7 @@ void sendMsg(void *outMsg, int *new_fd, int msgLen)
     int bytesSent;
     
     // Receive message
-    bytesSent = send(*new_fd, outMsg, msgLen, 0);
+    bytesSent = FtIo::sendData(*new_fd, outMsg, msgLen);
     
     if (bytesSent == -1)
     {
@@ -517,29 +1724,74 @@ void sendMsg(void *outMsg, int *new_fd, int msgLen)
  * 
  * Function: buildDir()
  * 
- *    Entry: None
+ *    Entry: The session arena and the listing's filter
  *
- *     Exit: Returns a vector of strings with the contents of the current
- *           working directory 
+ *     Exit: Returns a DirList with the names in the current working
+ *           directory that pass the filter, excluding "." and ".."; The
+ *           names and the array live in the arena. With an archive the list
+ *           is its index, and the directory is not read
  *
- *  Purpose: Return the contents of the current directory 
+ *  Purpose: Return the contents of the current directory; An unfiltered
+ *           listing is in directory order and a filtered one is sorted, so
+ *           a page's last name is a cursor for the next page
  *
  *
  *   *   *   *   *   *   */
-std::vector<std::string> buildDir()
+DirList buildDir(FtArena::Arena &arena, const FtList::Filter &filter)
 {
-    // Declare directory stream, struct, and vector
+    // Declare directory stream, struct, and list
     DIR *dp;
     struct dirent *ep;
-    std::vector<std::string> dir;
+    struct stat st;
+    DirList dir = {NULL, 0, false};
+    int capacity = 0;
+    bool paged = (filter.limit != -1);
+    bool needsStat = FtList::needsStat(filter);
+    FtList::Page page(filter.limit);
+    
+    // The archive's index is already a sorted list
+    if (FtPack::isOpen())
+    {
+        if (FtList::isActive(filter))
+        {
+            return (filterArchive(arena, filter));
+        }
+        dir.count = FtPack::count();
+        return dir;
+    }
     
-    // Populate the struct with the directory contents
+    // Populate the list with the directory contents
     dp = opendir("./");
     if (dp != NULL)
     {
         while ((ep = readdir(dp)))
         {
-            dir.push_back(ep->d_name);
+            if (strcmp(ep->d_name, ".") == 0 || strcmp(ep->d_name, "..") == 0)
+            {
+                continue;
+            }
+            
+            // Test the name first; Only a name that passes is stat()ed
+            if (!FtList::matchName(filter, ep->d_name))
+            {
+                continue;
+            }
+            if (needsStat
+                && (fstatat(dirfd(dp), ep->d_name, &st, 0) == -1
+                    || !FtList::matchStat(filter, st.st_size, st.st_mtime)))
+            {
+                continue;
+            }
+            
+            // A page keeps only its own names however many match
+            if (paged)
+            {
+                page.add(ep->d_name);
+                continue;
+            }
+            
+            addDirName(arena, &dir, &capacity,
+                       arena.copyStr(ep->d_name, strlen(ep->d_name)));
         }
         (void) closedir(dp);
     }
@@ -549,300 +1801,2447 @@ std::vector<std::string> buildDir()
         exit(0);
     }
     
-    return dir;
-}
-
-/*   *   *   *   *   *   *
- * 
- * Function: completeRequest()
+    if (paged)
+    {
+        std::vector<std::string> names;
+        page.take(&names);
+        for (std::size_t i = 0; i < names.size(); i++)
+        {
+            addDirName(arena, &dir, &capacity,
+                       arena.copyStr(names[i].data(), names[i].size()));
+        }
+        dir.more = page.isCut();
+    }
+    else if (FtList::isActive(filter))
+    {
+        std::sort(dir.names, dir.names + dir.count, nameLess);
+    }
+    
+    return dir;
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: filterArchive()
+ * 
+ *    Entry: The session arena and the listing's filter
+ *
+ *     Exit: Returns a DirList of the archive's names that pass the filter;
+ *           The names point into the archive
+ *
+ *  Purpose: Walk only the part of the sorted index that can match; The
+ *           walk starts past the prefix and cursor by binary search and
+ *           stops at the end of the prefix or of the page. The archive has
+ *           one modification time, which every file shares
+ *
+ *
+ *   *   *   *   *   *   */
+DirList filterArchive(FtArena::Arena &arena, const FtList::Filter &filter)
+{
+    DirList dir = {NULL, 0, false};
+    int capacity = 0;
+    std::size_t prefixLen = strlen(filter.prefix);
+    
+    struct stat st;
+    long long mtime = (fstat(FtPack::getFd(), &st) == 0 ? st.st_mtime : 0);
+    
+    int i = std::max(FtPack::lowerBound(filter.prefix),
+                     FtPack::lowerBound(filter.after));
+    for (; i < FtPack::count(); i++)
+    {
+        const char *name = FtPack::name(i);
+        if (strncmp(name, filter.prefix, prefixLen) != 0)
+        {
+            break;
+        }
+        if (!FtList::matchName(filter, name)
+            || !FtList::matchStat(filter, FtPack::size(i), mtime))
+        {
+            continue;
+        }
+        if (dir.count == filter.limit)
+        {
+            dir.more = true;
+            break;
+        }
+        addDirName(arena, &dir, &capacity, name);
+    }
+    
+    return dir;
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: addDirName()
+ * 
+ *    Entry: The session arena, a listing, its capacity, and a name that
+ *           outlives the listing
+ *
+ *     Exit: The name is the listing's last
+ *
+ *  Purpose: Grow the array inside the arena; The old array is abandoned
+ *
+ *
+ *   *   *   *   *   *   */
+void addDirName(FtArena::Arena &arena, DirList *dir, int *capacity,
+                const char *name)
+{
+    if (dir->count == *capacity)
+    {
+        *capacity = (*capacity == 0 ? DIR_START_CAP : *capacity * 2);
+        const char **names = static_cast<const char **>(
+            arena.alloc(*capacity * sizeof(char *), alignof(char *)));
+        if (dir->count > 0)
+        {
+            memcpy(names, dir->names, dir->count * sizeof(char *));
+        }
+        dir->names = names;
+    }
+    
+    dir->names[dir->count++] = name;
+}
+
+bool nameLess(const char *a, const char *b)
+{
+    return (strcmp(a, b) < 0);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: inDir()
+ * 
+ *    Entry: A DirList and a file name
+ *
+ *     Exit: Returns true if the name is in the list
+ *
+ *  Purpose: Check that a requested file is in the served directory; An
+ *           archive's index is binary searched
+ *
+ *
+ *   *   *   *   *   *   */
+bool inDir(const DirList &dir, const char *name)
+{
+    if (dir.names == NULL && dir.count > 0)
+    {
+        return (FtPack::find(name) != -1);
+    }
+    
+    for (int i = 0; i < dir.count; i++)
+    {
+        if (strcmp(dir.names[i], name) == 0)
+        {
+            return (true);
+        }
+    }
+    
+    return (false);
+}
+
+const char *dirName(const DirList &dir, int i)
+{
+    return (dir.names != NULL ? dir.names[i] : FtPack::name(i));
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: notePrefetch()
+ * 
+ *    Entry: A DirList, a file in it, and the client host name
+ *
+ *     Exit: The prefetcher has the name before the file and up to
+ *           FtPrefetch::DEPTH names after it in sorted order
+ *
+ *  Purpose: Let the prefetcher follow a client through the directory; The
+ *           archive's index is already sorted, and readdir() order is not,
+ *           so the directory's neighbors are found in one pass of compares
+ *
+ *
+ *   *   *   *   *   *   */
+void notePrefetch(const DirList &dir, const char *file, const char *host)
+{
+    const char *prev = NULL;
+    const char *next[FtPrefetch::DEPTH];
+    int nextCount = 0;
+    
+    if (dir.names == NULL)
+    {
+        int member = FtPack::find(file);
+        if (member == -1)
+        {
+            return;
+        }
+        if (member > 0)
+        {
+            prev = FtPack::name(member - 1);
+        }
+        for (int i = member + 1; i < dir.count && nextCount < FtPrefetch::DEPTH;
+             i++)
+        {
+            next[nextCount++] = FtPack::name(i);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < dir.count; i++)
+        {
+            const char *name = dir.names[i];
+            int cmp = strcmp(name, file);
+            if (cmp < 0)
+            {
+                if (prev == NULL || strcmp(name, prev) > 0)
+                {
+                    prev = name;
+                }
+                continue;
+            }
+            if (cmp == 0 || (nextCount == FtPrefetch::DEPTH
+                             && strcmp(name, next[nextCount - 1]) >= 0))
+            {
+                continue;
+            }
+            
+            // Insert in order, dropping the largest when full
+            int j = (nextCount == FtPrefetch::DEPTH ? nextCount - 1
+                                                    : nextCount++);
+            while (j > 0 && strcmp(name, next[j - 1]) < 0)
+            {
+                next[j] = next[j - 1];
+                j--;
+            }
+            next[j] = name;
+        }
+    }
+    
+    FtPrefetch::noteGet(host, file, prev, next, nextCount);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: nextToken()
+ * 
+ *    Entry: A cursor into a message, the end of the message, and pointers
+ *           for the token and its length
+ *
+ *     Exit: Returns false if no token is left; Otherwise the token is stored
+ *           and the cursor moved past it
+ *
+ *  Purpose: Split a message on whitespace without copying it
+ *
+ *
+ *   *   *   *   *   *   */
+bool nextToken(const char **cur, const char *end, const char **tok, int *len)
+{
+    const char *p = *cur;
+    
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+    {
+        p++;
+    }
+    if (p == end || *p == '\0')
+    {
+        return (false);
+    }
+    
+    *tok = p;
+    while (p < end && *p != '\0' && *p != ' ' && *p != '\n' && *p != '\r'
+           && *p != '\t')
+    {
+        p++;
+    }
+    *len = p - *tok;
+    *cur = p;
+    
+    return (true);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: nextCount()
+ * 
+ *    Entry: A cursor into a message, the end of the message, and a pointer
+ *           for the count
+ *
+ *     Exit: Returns false if the next token is not a count of 0 or more
+ *
+ *  Purpose: Parse an offset or length of a ranged get with std::from_chars
+ *
+ *
+ *   *   *   *   *   *   */
+bool nextCount(const char **cur, const char *end, long long *count)
+{
+    const char *tok;
+    int tokLen;
+    
+    if (!nextToken(cur, end, &tok, &tokLen))
+    {
+        return (false);
+    }
+    std::from_chars_result r = std::from_chars(tok, tok + tokLen, *count);
+    
+    return (r.ec == std::errc() && r.ptr == tok + tokLen && *count >= 0);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: parseCommand()
+ * 
+ *    Entry: The received message and its length, whether the command carries
+ *           a data port, and the CmdData struct to fill
+ *
+ *     Exit: Returns false if the message is malformed
+ *
+ *  Purpose: Parse "cmd [port] [file] [hash]", "r port file offset
+ *           length", or "l [port] [term ...]", in place with
+ *           std::from_chars
+ *
+ *
+ *   *   *   *   *   *   */
+bool parseCommand(const char *msg, int len, bool hasPort, CmdData *dst)
+{
+    const char *cur = msg;
+    const char *end = msg + len;
+    const char *tok;
+    int tokLen;
+    
+    dst->command[0] = '\0';
+    dst->file[0] = '\0';
+    dst->hash[0] = '\0';
+    dst->offset = 0;
+    dst->length = -1;
+    dst->dataPort = 0;
+    FtList::clearFilter(&dst->filter);
+    
+    if (!nextToken(&cur, end, &tok, &tokLen) || tokLen >= CMD_LEN)
+    {
+        return (false);
+    }
+    memcpy(dst->command, tok, tokLen);
+    dst->command[tokLen] = '\0';
+    
+    if (hasPort)
+    {
+        if (!nextToken(&cur, end, &tok, &tokLen))
+        {
+            return (false);
+        }
+        std::from_chars_result r = std::from_chars(tok, tok + tokLen,
+                                                   dst->dataPort);
+        if (r.ec != std::errc() || r.ptr != tok + tokLen)
+        {
+            return (false);
+        }
+    }
+    
+    // A listing ends with its filter terms instead of a file
+    if (strcmp(dst->command, "l") == 0)
+    {
+        while (nextToken(&cur, end, &tok, &tokLen))
+        {
+            if (!FtList::parseTerm(tok, tokLen, &dst->filter))
+            {
+                return (false);
+            }
+        }
+        return (true);
+    }
+    
+    if (nextToken(&cur, end, &tok, &tokLen))
+    {
+        if (tokLen >= MAX_TRANS_MSG)
+        {
+            return (false);
+        }
+        memcpy(dst->file, tok, tokLen);
+        dst->file[tokLen] = '\0';
+    }
+    
+    // A ranged get ends with the offset and length instead of a hash
+    if (strcmp(dst->command, "r") == 0)
+    {
+        if (!nextCount(&cur, end, &dst->offset)
+            || !nextCount(&cur, end, &dst->length))
+        {
+            return (false);
+        }
+        if (dst->length > LLONG_MAX - dst->offset)
+        {
+            dst->length = LLONG_MAX - dst->offset;
+        }
+        return (true);
+    }
+    
+    if (nextToken(&cur, end, &tok, &tokLen))
+    {
+        if (tokLen > FtHash::HASH_HEX)
+        {
+            return (false);
+        }
+        memcpy(dst->hash, tok, tokLen);
+        dst->hash[tokLen] = '\0';
+    }
+    
+    return (true);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: isFileCmd()
+ * 
+ *    Entry: CmdData struct with the parsed client command
+ *
+ *     Exit: Returns true for "g", "c", "r", "s", and "u"
+ *
+ *  Purpose: Tell the file commands from a listing
+ *
+ *
+ *   *   *   *   *   *   */
+bool isFileCmd(const CmdData *dst)
+{
+    return (strcmp(dst->command, "g") == 0 || strcmp(dst->command, "c") == 0
+            || strcmp(dst->command, "r") == 0
+            || strcmp(dst->command, "s") == 0
+            || strcmp(dst->command, "u") == 0);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: xferSize()
+ * 
+ *    Entry: CmdData struct with the parsed client command
+ *
+ *     Exit: Returns the expected bytes to send, 0 for a listing, or -1 if the
+ *           size is unknown
+ *
+ *  Purpose: Classify the request for the bandwidth scheduler
+ *
+ *
+ *   *   *   *   *   *   */
+long long xferSize(CmdData *dst)
+{
+    struct stat st;
+    long long fileSize = -1;
+    
+    if (strcmp(dst->command, "l") == 0)
+    {
+        return (0);
+    }
+    else if (isFileCmd(dst) && FtPack::isOpen())
+    {
+        // The index holds the size; Nothing is stat()ed
+        int member = FtPack::find(dst->file);
+        fileSize = (member == -1 ? -1 : FtPack::size(member));
+    }
+    else if (isFileCmd(dst) && stat(dst->file, &st) == 0)
+    {
+        fileSize = st.st_size;
+        
+        // Holes are not sent, so count only the allocated blocks
+        if (strcmp(dst->command, "s") == 0 && st.st_blocks * 512LL < fileSize)
+        {
+            fileSize = st.st_blocks * 512LL;
+        }
+    }
+    
+    if (fileSize >= 0)
+    {
+        // Only the part of the file in the range is sent
+        long long size = fileSize - dst->offset;
+        if (size < 0)
+        {
+            size = 0;
+        }
+        if (dst->length >= 0 && dst->length < size)
+        {
+            size = dst->length;
+        }
+        return (size);
+    }
+    
+    return (-1);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: buildReadyMsg()
+ * 
+ *    Entry: CmdData struct for a "g" or "c" request and a buffer of
+ *           MAX_OUT_MSG chars
+ *
+ *     Exit: Returns the length of the message to send, including its
+ *           terminator, or 0 if the file matches the client's hash
+ *
+ *  Purpose: Answer a conditional get from the hash cache; The file is only
+ *           stat()ed, and a miss queues it to be hashed for next time
+ *
+ *
+ *   *   *   *   *   *   */
+int buildReadyMsg(CmdData *dst, char *outMsg)
+{
+    char hex[FtHash::HASH_HEX + 1];
+    struct stat st;
+    
+    // Packed files are not hashed, so a conditional get sends the file
+    memcpy(outMsg, OK_MSG, OK_MSG_SIZE);
+    if (strcmp(dst->command, "c") != 0 || FtPack::isOpen()
+        || stat(dst->file, &st) == -1
+        || !FtHash::lookup(dst->file, st, hex))
+    {
+        return (OK_MSG_SIZE);
+    }
+    
+    if (strcmp(hex, dst->hash) == 0)
+    {
+        return (0);
+    }
+    
+    // "ready <hash>" so the client can send it next time
+    outMsg[OK_MSG_SIZE - 1] = ' ';
+    memcpy(outMsg + OK_MSG_SIZE, hex, FtHash::HASH_HEX + 1);
+    return (OK_MSG_SIZE + FtHash::HASH_HEX + 1);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: releaseSched()
+ * 
+ *    Entry: None
+ *
+ *     Exit: The child's scheduler slot is released
+ *
+ *  Purpose: Registered with atexit() so every exit path frees the slot
+ *
+ *
+ *   *   *   *   *   *   */
+void releaseSched()
+{
+    FtSched::unregisterSession(schedSlot);
+    schedSlot = -1;
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: finishTrace()
+ * 
+ *    Entry: None
+ *
+ *     Exit: The child's request trace is appended to the trace file
+ *
+ *  Purpose: Registered with atexit() so failed requests are traced too
+ *
+ *
+ *   *   *   *   *   *   */
+void finishTrace()
+{
+    reqTrace.finish();
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: reportPlacement()
+ * 
+ *    Entry: The control connection, a buffer the session has written, the
+ *           client host name, and the request trace
+ *
+ *     Exit: The placement is printed, traced, and counted
+ *
+ *  Purpose: Show whether a session runs where its packets arrive and its
+ *           buffers are; -1 is unknown
+ *
+ *
+ *   *   *   *   *   *   */
+void reportPlacement(int new_fd, const void *buf, const char *host,
+                     FtTrace::Request &trace)
+{
+    if (!FtNuma::isActive())
+    {
+        return;
+    }
+    
+    FtNuma::Placement p = FtNuma::notePlacement(new_fd, buf);
+    trace.setPlacement(p.cpu, p.node, p.nicCpu, p.bufNode);
+    std::cout << "Session for " << host << " on CPU " << p.cpu << " (node "
+              << p.node << "), NIC queue CPU " << p.nicCpu
+              << ", buffer on node " << p.bufNode << "\n";
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: completeLocalRequest()
+ * 
+ *    Entry: An int pointer for the connection on the local Unix socket and
+ *           the session arena
+ *
+ *     Exit: Passes a read-only descriptor for the file or a memfd with the
+ *           directory listing to the client, or sends the error message
+ *
+ *  Purpose: Complete a same-host request without copying the data; The
+ *           descriptor is passed at offset 0, so the client can read() it
+ *           from the start
+ *
+ *
+ *   *   *   *   *   *   */
+void completeLocalRequest(int *new_fd, FtArena::Arena &arena)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    CmdData dst;
+    
+    int inLen = recvMsg(&inMsgBuf, new_fd);
+    if (parseCommand(inMsgBuf, inLen, false, &dst))
+    {
+        answerLocalRequest(dst, buildDir(arena, dst.filter), new_fd, arena);
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: answerLocalRequest()
+ * 
+ *    Entry: The request parsed from the local Unix socket, the listing
+ *           built for it, an int pointer for the connection, and the session
+ *           arena
+ *
+ *     Exit: Passes the descriptor or sends the error message
+ *
+ *  Purpose: Answer a same-host request once it has been received
+ *
+ *
+ *   *   *   *   *   *   */
+void answerLocalRequest(const CmdData &dst, const DirList &dirListing,
+                        int *new_fd, FtArena::Arena &arena)
+{
+    char outMsg[MAX_OUT_MSG];
+    int fd = -1;
+    struct stat st;
+    
+    if (strcmp(dst.command, "g") == 0)
+    {
+        std::cout << "Local file \"" << dst.file << "\" requested.\n";
+        
+        // Only names in the served directory may be opened
+        if (FtPack::isOpen())
+        {
+            fd = packedFileFd(dst.file);
+        }
+        else if (inDir(dirListing, dst.file))
+        {
+            // Pass only regular files; A directory's descriptor would let
+            // the client openat() names that were never listed. O_NONBLOCK
+            // keeps a FIFO from stalling the open before it is checked
+            fd = open(dst.file, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+            if (fd != -1 && (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)))
+            {
+                close(fd);
+                fd = -1;
+            }
+            else if (fd != -1)
+            {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+            }
+        }
+    }
+    else if (strcmp(dst.command, "l") == 0)
+    {
+        std::cout << "Local directory listing requested.\n";
+        
+        // Synthesize the listing in an anonymous memory file
+        fd = memfd_create("ftserve-listing", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd != -1)
+        {
+            std::size_t total = 0;
+            for (int i = 0; i < dirListing.count; i++)
+            {
+                total += strlen(dirName(dirListing, i)) + 1;
+            }
+            
+            char *listing = static_cast<char *>(arena.alloc(total + 1, 1));
+            char *p = listing;
+            for (int i = 0; i < dirListing.count; i++)
+            {
+                const char *name = dirName(dirListing, i);
+                std::size_t len = strlen(name);
+                memcpy(p, name, len);
+                p[len] = '\n';
+                p += len + 1;
+            }
+            
+            if (write(fd, listing, total) != static_cast<ssize_t>(total))
+            {
+                close(fd);
+                fd = -1;
+            }
+            else
+            {
+                sealMemfd(fd);
+            }
+        }
+    }
+    
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        sendMsg((void *)ERR_MSG, new_fd, ERR_MSG_SIZE);
+        return;
+    }
+    
+    // Build "ready <bytes>" without a stream; A cut short page adds " more"
+    memcpy(outMsg, "ready ", 6);
+    std::to_chars_result r = std::to_chars(outMsg + 6, outMsg + MAX_OUT_MSG - 1,
+                                           static_cast<long long>(st.st_size));
+    if (dirListing.more)
+    {
+        memcpy(r.ptr, " more", 5);
+        r.ptr += 5;
+    }
+    *r.ptr = '\0';
+    
+    // Writing a memfd leaves its offset at the end, and the client shares it
+    lseek(fd, 0, SEEK_SET);
+    if (FtUnix::sendFd(*new_fd, fd, outMsg, (r.ptr - outMsg) + 1) == -1)
+    {
+        error("Local send: ");
+    }
+    close(fd);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: packedFileFd()
+ * 
+ *    Entry: A file name
+ *
+ *     Exit: Returns a read-only descriptor holding the packed file, or -1
+ *           if it is not in the archive
+ *
+ *  Purpose: A local client reads its descriptor from the start, and the
+ *           archive's own descriptor would show it every file
+ *
+ *
+ *   *   *   *   *   *   */
+int packedFileFd(const char *file)
+{
+    int member = FtPack::find(file);
+    if (member == -1)
+    {
+        return (-1);
+    }
+    
+    int fd = memfd_create("ftserve-packed", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1)
+    {
+        return (-1);
+    }
+    
+    const char *data = FtPack::data(member);
+    long long left = FtPack::size(member);
+    while (left > 0)
+    {
+        ssize_t n = write(fd, data, left);
+        if (n == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n == -1)
+        {
+            close(fd);
+            return (-1);
+        }
+        data += n;
+        left -= n;
+    }
+    
+    sealMemfd(fd);
+    return (fd);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: sealMemfd()
+ * 
+ *    Entry: A memfd created with MFD_ALLOW_SEALING and fully written
+ *
+ *     Exit: The memfd can no longer be written, resized, or unsealed
+ *
+ *  Purpose: The client gets the only copy through a writable descriptor,
+ *           so the seals are what keep it from changing the data
+ *
+ *
+ *   *   *   *   *   *   */
+void sealMemfd(int fd)
+{
+    fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_GROW | F_SEAL_SHRINK
+                           | F_SEAL_SEAL);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: waitClientReady()
+ * 
+ *    Entry: An int pointer for the control connection
+ *
+ *     Exit: Returns true if the client answered "ready"
+ *
+ *  Purpose: Wait for the client to open its data port
+ *
+ *
+ *   *   *   *   *   *   */
+bool waitClientReady(int *new_fd)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    
+    FtWatch::setPhase(FtWatch::PHASE_ACK_WAIT);
+    reqTrace.enter(FtTrace::TR_READY_WAIT);
+    int inLen = recvMsg(&inMsgBuf, new_fd);
+    reqTrace.enter(FtTrace::TR_WORK);
+    
+    return (isReadyMsg(inMsgBuf, inLen));
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: isReadyMsg()
+ * 
+ *    Entry: A message from the client and its length
+ *
+ *     Exit: Returns true if the message is "ready"
+ *
+ *  Purpose: Check the client's answer to the server's "ready"
+ *
+ *
+ *   *   *   *   *   *   */
+bool isReadyMsg(const char *msg, int len)
+{
+    const char *cur = msg;
+    const char *tok;
+    int tokLen;
+    
+    return (len > 0 && nextToken(&cur, msg + len, &tok, &tokLen)
+            && tokLen == OK_MSG_SIZE - 1
+            && memcmp(tok, OK_MSG, OK_MSG_SIZE - 1) == 0);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: connectData()
+ * 
+ *    Entry: The client host name and data port, and the socket type
+ *
+ *     Exit: Returns the connected data socket; Exits the child on failure
+ *
+ *  Purpose: Open the data connection to the client
+ *
+ *
+ *   *   *   *   *   *   */
+int connectData(const char *host, int dataPort, int sockType)
+{
+    // Declare variables and structs
+    int d_sockfd = -1;  
+    struct addrinfo hints, *servinfo, *p;
+    int dStatus;
+    
+    // Convert integer port number to a string without a stream
+    char data_port[8];
+    std::to_chars_result r = std::to_chars(data_port, data_port + 7, dataPort);
+    *r.ptr = '\0';
+    
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_INET; // Specify IPv4
+    hints.ai_socktype = sockType; // TCP stream, or UDP for a "u" get
+    
+    // Specify localhost as IP and port from CmdData struct
+    reqTrace.enter(FtTrace::TR_RESOLVE);
+    if ((dStatus = getaddrinfo(host, data_port, &hints, &servinfo)) != 0) 
+    {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(dStatus));
+        exit(1);
+    }
+    
+    // Loop through all the results and connect to the first we can
+    FtWatch::setPhase(FtWatch::PHASE_DATA_CONNECT);
+    reqTrace.enter(FtTrace::TR_DATA_CONNECT);
+    for(p = servinfo; p != NULL; p = p->ai_next) 
+    {
+        if ((d_sockfd = socket(p->ai_family, p->ai_socktype,
+                p->ai_protocol)) == -1) 
+        {
+            error("client: socket");
+            continue;
+        }
+
+        if (connect(d_sockfd, p->ai_addr, p->ai_addrlen) == -1) 
+        {
+            close(d_sockfd);
+            error("client: connect");
+            continue;
+        }
+
+        break;
+    }
+    
+    if (p == NULL) 
+    {
+        fprintf(stderr, "client: failed to connect\n");
+        exit(1);
+    }
+    
+    // Each chunk is one send that waits for its ack, so Nagle would only
+    // hold it until the client's delayed ACK of the one before
+    int on = 1;
+    if (sockType == SOCK_STREAM)
+    {
+        setsockopt(d_sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    }
+    
+    // Free the linked list
+    freeaddrinfo(servinfo);
+    reqTrace.enter(FtTrace::TR_WORK);
+    
+    return (d_sockfd);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: sendFile()
+ * 
+ *    Entry: The file name, the offset and length of the range to send, or
+ *           -1 for the rest of the file, true to send holes as records, the
+ *           data socket, and an int pointer for the control connection
+ *
+ *     Exit: Sends the range in chunks, waiting for an ack after each
+ *
+ *  Purpose: Run the chunk loop; It reads straight into the packet buffer
+ *           behind the 4 character header, so no per-chunk allocations are
+ *           made; Debug builds check this with the allocation counter. With
+ *           the uring backend a regular file is spliced instead, and each
+ *           chunk and its ack take a single system call. The Sizer picks
+ *           the size of each chunk from the acks of the ones before
+ *
+ *
+ *   *   *   *   *   *   */
+void sendFile(const char *file, long long start, long long len, bool sparse,
+              int d_sockfd, int *new_fd)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    char outPack[MAX_PACK_SIZE];
+    int bytesRead = 0;
+    long long end = (len < 0 ? LLONG_MAX : start + len);
+    long long base = 0;
+    int member = -1;
+    int fd;
+    
+    if (FtPack::isOpen())
+    {
+        // A packed file is a range of the archive, which stays open
+        member = FtPack::find(file);
+        fd = (member == -1 ? -1 : FtPack::getFd());
+        if (member != -1)
+        {
+            base = FtPack::offset(member);
+            end = std::min(end, FtPack::size(member));
+        }
+    }
+    else
+    {
+        fd = open(file, O_RDONLY | O_CLOEXEC);
+    }
+    if (fd == -1) // File was unable to be opened
+    {
+        error("File open: ");
+        exit(1);
+    }
+    
+    /*
+     * Number of characters read is prepended to the beginning of the 
+     * outgoing message and sent to client. Client reads the number, 
+     * then receives the message. If the total number of characters
+     * received does not match, client will continue to recv()
+     */
+    
+    long long allocsBefore = FtArena::heapAllocs();
+    long long chunks = 0;
+    FtChunk::Sizer sizer;
+    struct stat st;
+    
+    // A sparse transfer needs the end of the file to find its last hole
+    if (sparse && member == -1 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+        && st.st_size < end)
+    {
+        end = st.st_size;
+    }
+    
+    // Chunks stop at the end of the data they are in; Without holes that
+    // is the end of the range
+    long long extentEnd = (sparse ? start : end);
+    bool inHole = false;
+    
+    if (FtIo::beginChunks(fd, d_sockfd, *new_fd))
+    {
+        if (member == -1 && fstat(fd, &st) == 0 && st.st_size < end)
+        {
+            end = st.st_size;
+        }
+        extentEnd = std::min(extentEnd, end);
+        
+        // Send from the file's size; The data never enters outPack
+        for (long long off = start; off < end; off += bytesRead)
+        {
+            if (sparse && off >= extentEnd)
+            {
+                extentEnd = findExtent(fd, base, off, end, &inHole);
+            }
+            if (inHole)
+            {
+                sendHole(extentEnd - off, d_sockfd, new_fd);
+                off = extentEnd;
+                inHole = false;
+                bytesRead = 0;
+                continue;
+            }
+            
+            bytesRead = sizer.getSize();
+            if (extentEnd - off < bytesRead)
+            {
+                bytesRead = extentEnd - off;
+            }
+            memset(outPack, ' ', HEADER_SIZE);
+            std::to_chars(outPack, outPack + HEADER_SIZE, bytesRead);
+            
+            FtWatch::setPhase(FtWatch::PHASE_SEND);
+            reqTrace.enter(FtTrace::TR_RATE_WAIT);
+            FtSched::acquireBytes(schedSlot, bytesRead + HEADER_SIZE);
+            
+            // The send and the ack are one operation; Time it as the ack,
+            // and trace the read, send, and ack of the batch as the send
+            FtWatch::setPhase(FtWatch::PHASE_ACK_WAIT);
+            reqTrace.enter(FtTrace::TR_SEND);
+            if (FtIo::sendChunk(outPack, HEADER_SIZE, base + off, bytesRead,
+                                inMsgBuf, MAX_TRANS_MSG) == -1)
+            {
+                error("Chunk send: ");
+                exit(1);
+            }
+            FtWatch::addBytes(bytesRead + HEADER_SIZE);
+            reqTrace.addBytes(bytesRead + HEADER_SIZE);
+            sizer.sent(d_sockfd, bytesRead);
+            chunks++;
+        }
+        
+        FtIo::endChunks();
+    }
+    else
+    {
+        // Concurrent transfers of a regular file share its chunks
+        bool shared = (member == -1 && fstat(fd, &st) == 0
+                       && FtFlight::canShare(st));
+        bool positional = (member == -1 && !shared);
+        long long off = start;
+        if (positional && start > 0 && lseek(fd, start, SEEK_SET) == -1)
+        {
+            error("File seek: ");
+            exit(1);
+        }
+        
+        // Enter read, send, receive acknowledgement loop until EOF
+        while (off < end)
+        {
+            if (sparse && off >= extentEnd)
+            {
+                extentEnd = findExtent(fd, base, off, end, &inHole);
+                
+                // Finding the extent moved the file offset
+                if (positional && lseek(fd, inHole ? extentEnd : off,
+                                        SEEK_SET) == -1)
+                {
+                    error("File seek: ");
+                    exit(1);
+                }
+            }
+            if (inHole)
+            {
+                sendHole(extentEnd - off, d_sockfd, new_fd);
+                off = extentEnd;
+                inHole = false;
+                continue;
+            }
+            
+            int want = sizer.getSize();
+            if (extentEnd - off < want)
+            {
+                want = extentEnd - off;
+            }
+            
+            reqTrace.enter(FtTrace::TR_DISK_READ);
+            if (member != -1)
+            {
+                // Copy from the mapping; No read() is made
+                memcpy(outPack + HEADER_SIZE, FtPack::data(member) + off,
+                       want);
+                bytesRead = want;
+            }
+            else if (shared)
+            {
+                bytesRead = FtFlight::readChunk(fd, st, off,
+                                                outPack + HEADER_SIZE, want);
+            }
+            else
+            {
+                bytesRead = FtIo::readFile(fd, outPack + HEADER_SIZE, want);
+            }
+            if (bytesRead <= 0)
+            {
+                break;
+            }
+            off += bytesRead;
+            
+            // Header is the byte count padded with spaces to 4 characters
+            memset(outPack, ' ', HEADER_SIZE);
+            std::to_chars(outPack, outPack + HEADER_SIZE, bytesRead);
+            
+            // Wait for the scheduler to allow the chunk, then send it
+            FtWatch::setPhase(FtWatch::PHASE_SEND);
+            reqTrace.enter(FtTrace::TR_RATE_WAIT);
+            FtSched::acquireBytes(schedSlot, bytesRead + HEADER_SIZE);
+            reqTrace.enter(FtTrace::TR_SEND);
+            sendMsg(outPack, &d_sockfd, (bytesRead + HEADER_SIZE));
+            FtWatch::addBytes(bytesRead + HEADER_SIZE);
+            reqTrace.addBytes(bytesRead + HEADER_SIZE);
+            
+            // Wait for acknowledgement from client on control port
+            FtWatch::setPhase(FtWatch::PHASE_ACK_WAIT);
+            reqTrace.enter(FtTrace::TR_ACK_WAIT);
+            recvMsg(&inMsgBuf, new_fd);
+            sizer.sent(d_sockfd, bytesRead);
+            chunks++;
+            
+            // If acknowledgement was received, send the next chunk
+        }
+    }
+    
+    reqTrace.enter(FtTrace::TR_WORK);
+    reqTrace.setChunks(sizer.getMin(), sizer.getMax(), sizer.getSize(),
+                       sizer.getResizes());
+    
+    if (bytesRead == -1)
+    {
+        error("File read: ");
+    }
+    
+#ifdef FT_ALLOC_DEBUG
+    long long allocs = FtArena::heapAllocs() - allocsBefore;
+    std::cout << "Chunk loop: " << chunks << " chunks, " << allocs
+              << " heap allocations\n";
+    if (allocs != 0)
+    {
+        std::cerr << "Heap allocation in the chunk loop\n";
+        abort();
+    }
+#else
+    (void) allocsBefore;
+#endif
+    
+    if (member == -1)
+    {
+        close(fd);
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: findExtent()
+ * 
+ *    Entry: The file, where its bytes start, an offset in it, the end of
+ *           the range, and a pointer for whether off is in a hole
+ *
+ *     Exit: Returns the end of the hole or data at off, no further than end;
+ *           The file offset is moved
+ *
+ *  Purpose: Walk the holes of a sparse file with SEEK_DATA and SEEK_HOLE;
+ *           A file system without them reports the file as all data
+ *
+ *
+ *   *   *   *   *   *   */
+long long findExtent(int fd, long long base, long long off, long long end,
+                     bool *isHole)
+{
+    off_t data = lseek(fd, base + off, SEEK_DATA);
+    if (data == -1)
+    {
+        // ENXIO means no data is left before the end of the file
+        *isHole = (errno == ENXIO);
+        return (end);
+    }
+    if (data > base + off)
+    {
+        *isHole = true;
+        return (std::min(end, static_cast<long long>(data) - base));
+    }
+    
+    off_t hole = lseek(fd, base + off, SEEK_HOLE);
+    *isHole = false;
+    return (hole == -1 ? end
+                       : std::min(end, static_cast<long long>(hole) - base));
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: buildHole()
+ * 
+ *    Entry: A buffer of HOLE_SIZE chars and the length of the hole
+ *
+ *     Exit: Returns the size of the record in the buffer
+ *
+ *  Purpose: A hole record is "HOLE" in place of a chunk's byte count,
+ *           followed by the hole's length padded with spaces to 20
+ *           characters; It is acked like a chunk
+ *
+ *
+ *   *   *   *   *   *   */
+int buildHole(char *outPack, long long len)
+{
+    memcpy(outPack, HOLE_TAG, HEADER_SIZE);
+    memset(outPack + HEADER_SIZE, ' ', HOLE_LEN_SIZE);
+    std::to_chars(outPack + HEADER_SIZE, outPack + HOLE_SIZE, len);
+    
+    return (HOLE_SIZE);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: sendHole()
+ * 
+ *    Entry: The length of the hole, the data socket, and an int pointer for
+ *           the control connection
+ *
+ *     Exit: The hole record is sent and acked
+ *
+ *  Purpose: Send a hole of any length as one small record
+ *
+ *
+ *   *   *   *   *   *   */
+void sendHole(long long len, int d_sockfd, int *new_fd)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    char record[HOLE_SIZE];
+    int recordLen = buildHole(record, len);
+    
+    FtWatch::setPhase(FtWatch::PHASE_SEND);
+    reqTrace.enter(FtTrace::TR_RATE_WAIT);
+    FtSched::acquireBytes(schedSlot, recordLen);
+    reqTrace.enter(FtTrace::TR_SEND);
+    sendMsg(record, &d_sockfd, recordLen);
+    FtWatch::addBytes(recordLen);
+    reqTrace.addBytes(recordLen);
+    
+    FtWatch::setPhase(FtWatch::PHASE_ACK_WAIT);
+    reqTrace.enter(FtTrace::TR_ACK_WAIT);
+    recvMsg(&inMsgBuf, new_fd);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: openSendFile()
+ * 
+ *    Entry: The file name and pointers for the offset of its bytes in the
+ *           descriptor and its size
+ *
+ *     Exit: Returns the descriptor, or -1 with errno set; The archive's
+ *           descriptor is shared and must not be closed
+ *
+ *  Purpose: Find the bytes of a file in the directory or the archive
+ *
+ *
+ *   *   *   *   *   *   */
+int openSendFile(const char *file, long long *base, long long *size)
+{
+    struct stat st;
+    
+    if (FtPack::isOpen())
+    {
+        int member = FtPack::find(file);
+        if (member == -1)
+        {
+            errno = ENOENT;
+            return (-1);
+        }
+        *base = FtPack::offset(member);
+        *size = FtPack::size(member);
+        return (FtPack::getFd());
+    }
+    
+    int fd = open(file, O_RDONLY | O_CLOEXEC);
+    if (fd != -1 && fstat(fd, &st) == -1)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return (-1);
+    }
+    *base = 0;
+    *size = (fd == -1 ? 0 : st.st_size);
+    
+    return (fd);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: sendFileUdp()
+ * 
+ *    Entry: The file name, the connected UDP socket, and an int pointer
+ *           for the control connection
+ *
+ *     Exit: Sends the file until the client sends "done"
+ *
+ *  Purpose: Sleep in ppoll() on the control connection until the Sender
+ *           may send its next batch, so the pacing is finer than the
+ *           scheduler's; Each "nack" line read while waiting queues its
+ *           packets for the next batch
+ *
+ *
+ *   *   *   *   *   *   */
+void sendFileUdp(const char *file, int d_sockfd, int *new_fd)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    long long base, size;
+    int fd = openSendFile(file, &base, &size);
+    if (fd == -1)
+    {
+        error("File open: ");
+        exit(1);
+    }
+    
+    FtUdp::Sender sender(d_sockfd, fd, base, size, 0);
+    FtUdp::Feed fed = FtUdp::FEED_MORE;
+    bool sending = false;
+    while (fed == FtUdp::FEED_MORE)
+    {
+        // Everything sent; Only a "nack" or "done" can come next
+        long long wait = sender.waitUs(FtUdp::monoUs());
+        if ((wait != -1) != sending)
+        {
+            sending = (wait != -1);
+            FtWatch::setPhase(sending ? FtWatch::PHASE_SEND
+                                      : FtWatch::PHASE_ACK_WAIT);
+            reqTrace.enter(sending ? FtTrace::TR_SEND
+                                   : FtTrace::TR_ACK_WAIT);
+        }
+        
+        struct pollfd pfd;
+        pfd.fd = *new_fd;
+        pfd.events = POLLIN;
+        struct timespec ts;
+        ts.tv_sec = wait / 1000000;
+        ts.tv_nsec = (wait % 1000000) * 1000;
+        if (ppoll(&pfd, 1, wait == -1 ? NULL : &ts, NULL) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            error("Control poll: ");
+            exit(1);
+        }
+        
+        if (pfd.revents != 0)
+        {
+            int inLen = recvMsg(&inMsgBuf, new_fd);
+            if (inLen == 0) // Client closed before it had the whole file
+            {
+                break;
+            }
+            fed = sender.feed(inMsgBuf, inLen);
+        }
+        
+        int sent = sender.pump(FtUdp::monoUs());
+        if (sent == -1)
+        {
+            error("Datagram send: ");
+            exit(1);
+        }
+        if (sent > 0)
+        {
+            // Charged after the batch; The next one waits for the debt
+            FtSched::acquireBytes(schedSlot, sent);
+            FtWatch::addBytes(sent);
+            reqTrace.addBytes(sent);
+        }
+    }
+    reqTrace.enter(FtTrace::TR_WORK);
+    
+    if (fed == FtUdp::FEED_BAD)
+    {
+        std::cout << "Bad control message from client; stopping\n";
+    }
+    std::cout << "UDP rate " << sender.getRate() << " B/s, "
+              << sender.getResent() << " packets resent"
+              << (sender.usedGso() ? ", GSO" : "") << "\n";
+    
+    if (!FtPack::isOpen())
+    {
+        close(fd);
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: sendListing()
+ * 
+ *    Entry: The directory list, the data socket, and an int pointer for the
+ *           control connection
+ *
+ *     Exit: Sends each name, waiting for an ack after each
+ *
+ *  Purpose: Send the directory contents from the arena strings
+ *
+ *
+ *   *   *   *   *   *   */
+void sendListing(const DirList &dir, int d_sockfd, int *new_fd)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    
+    for (int i = 0; i < dir.count; i++)
+    {
+        const char *name = dirName(dir, i);
+        int len = strlen(name);
+        
+        FtWatch::setPhase(FtWatch::PHASE_SEND);
+        reqTrace.enter(FtTrace::TR_RATE_WAIT);
+        FtSched::acquireBytes(schedSlot, len);
+        reqTrace.enter(FtTrace::TR_SEND);
+        sendMsg((void *)name, &d_sockfd, len);
+        FtWatch::addBytes(len);
+        reqTrace.addBytes(len);
+        
+        // Wait for acknowledgement from client
+        FtWatch::setPhase(FtWatch::PHASE_ACK_WAIT);
+        reqTrace.enter(FtTrace::TR_ACK_WAIT);
+        recvMsg(&inMsgBuf, new_fd);
+        
+        // If acknowledgement was received, send the next file listing
+    }
+    reqTrace.enter(FtTrace::TR_WORK);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: completeRequest()
+ * 
+ *    Entry: CmdData struct with the command, data port, and file name if 
+ *           needed, the control port and client host names, an int pointer
+ *           for the control connection, and the session arena
+ *
+ *     Exit: Sends the directory information or the file 
+ *
+ *  Purpose: Sends the directory or the file 
+ *
+ *
+ *   *   *   *   *   *   */
+void completeRequest(CmdData *dst, const char *con_port, const char *host, 
+                     int *new_fd, FtArena::Arena &arena)
+{
+    // List contents of the directory
+    reqTrace.enter(FtTrace::TR_BUILD_DIR);
+    DirList dirListing = buildDir(arena, dst->filter);
+    reqTrace.enter(FtTrace::TR_WORK);
+    
+    // Check command 
+    if (isFileCmd(dst)) // Send file over data port
+    {
+        // Print status to console window
+        std::cout << "File \"" << dst->file << "\"\nrequested on port "
+                  << con_port << ".\n";
+                  
+        // Check if file is present in directory
+        if (!inDir(dirListing, dst->file))
+        {
+            // Print status to console window
+            std::cout << "File not found. Sending\n" << "error message to\n"
+                      << host << ":" << dst->dataPort << "\n";
+                      
+            // Send error to client on control connection
+            sendMsg((void *)ERR_MSG, new_fd, ERR_MSG_SIZE);
+            
+            exit(0);
+        }
+        
+        // Warm the files a client reading in order will ask for next
+        notePrefetch(dirListing, dst->file, host);
+        
+        // Tell a conditional get that its copy is current
+        char okMsg[MAX_OUT_MSG];
+        int okLen = buildReadyMsg(dst, okMsg);
+        if (okLen == 0)
+        {
+            std::cout << "File \"" << dst->file << "\" not modified.\n";
+            sendMsg((void *)NOT_MOD_MSG, new_fd, sizeof NOT_MOD_MSG);
+            exit(0);
+        }
+        
+        // Inform client that the server is ready to transmit
+        sendMsg(okMsg, new_fd, okLen);
+        
+        // Receive message that client is ready to receive the file
+        if (waitClientReady(new_fd)) // Open connection to client to send data
+        {
+            bool udp = (strcmp(dst->command, "u") == 0);
+            int d_sockfd = connectData(host, dst->dataPort,
+                                       udp ? SOCK_DGRAM : SOCK_STREAM);
+            
+            // Send the requested file
+            std::cout << "Sending \"" << dst->file << "\"\n" << "to " 
+                      << host << ":" << dst->dataPort << "\n";
+            if (udp)
+            {
+                sendFileUdp(dst->file, d_sockfd, new_fd);
+            }
+            else
+            {
+                sendFile(dst->file, dst->offset, dst->length,
+                         strcmp(dst->command, "s") == 0, d_sockfd, new_fd);
+            }
+            
+            // Close the connection
+            close(d_sockfd);
+        }
+    }
+    else if (strcmp(dst->command, "l") == 0) // Send directory contents
+    {
+        std::cout << "List directory requested\non port " << dst->dataPort
+                  << ".\n";
+        
+        // Inform client that the server is ready to transmit, and whether
+        // a page of the listing has more names after it
+        if (dirListing.more)
+        {
+            sendMsg((void *)MORE_MSG, new_fd, sizeof MORE_MSG);
+        }
+        else
+        {
+            sendMsg((void *)OK_MSG, new_fd, OK_MSG_SIZE);
+        }
+        
+        // Receive message that client is ready to receive directory
+        if (waitClientReady(new_fd)) // Open connection to client to send data
+        {
+            int d_sockfd = connectData(host, dst->dataPort, SOCK_STREAM);
+            
+            // Send the directory contents
+            std::cout << "Sending directory\ncontents to " << host << ":"
+                      << dst->dataPort << "\n";
+            sendListing(dirListing, d_sockfd, new_fd);
+            
+            // Close the connection
+            close(d_sockfd);
+        }
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: runLoop()
+ * 
+ *    Entry: The listening, control, and local listening sockets, the server
+ *           options, and the control port name
+ *
+ *     Exit: Exits the program once drained or handed off
+ *
+ *  Purpose: Serve every connection from this thread; Each session is a
+ *           coroutine that suspends where the forked child would block
+ *
+ *
+ *   *   *   *   *   *   */
+void runLoop(int sock_fd, int ctl_fd, int local_fd, const ServerOpts &opts,
+             const char *con_port)
+{
+    FtCo::Loop loop;
+    bool handedOff = false;
+    bool stopped = false;
+    
+    // Every session runs on this thread, so it takes the first listed CPU
+    FtNuma::placeLoop();
+    
+    // Directory reads run beside the loop, so a large one stalls no session
+    startDirWorker();
+    
+    // Listeners are shared with a successor, so make them non-blocking
+    fcntl(sock_fd, F_SETFL, fcntl(sock_fd, F_GETFL) | O_NONBLOCK);
+    loop.spawn(acceptLoop(loop, sock_fd, opts, con_port));
+    loop.spawn(ctlLoop(loop, ctl_fd, sock_fd, local_fd, &handedOff));
+    if (local_fd != -1)
+    {
+        fcntl(local_fd, F_SETFL, fcntl(local_fd, F_GETFL) | O_NONBLOCK);
+        loop.spawn(localAcceptLoop(loop, local_fd, opts));
+    }
+    
+    while (loop.getTasks() > 0)
+    {
+        if ((drainRequested || handedOff) && !stopped)
+        {
+            // Stop accepting; The sessions in progress run to completion
+            stopped = true;
+            loop.cancel(sock_fd);
+            loop.cancel(ctl_fd);
+            close(sock_fd);
+            close(ctl_fd);
+            if (!handedOff)
+            {
+                unlink(ctlSockPath);
+            }
+            if (local_fd != -1)
+            {
+                loop.cancel(local_fd);
+                close(local_fd);
+                if (!handedOff)
+                {
+                    unlink(opts.localPath.c_str());
+                }
+            }
+            std::cout << "Draining " << loop.getTasks()
+                      << " active session(s)\n";
+            
+            // Cancelling the listeners may have ended the last task, and a
+            // wait with nothing left to wake it would never return
+            continue;
+        }
+        
+        loop.runOnce(&waitMask);
+    }
+    
+    FtNuma::printTotals();
+    std::cout << "Drained; exiting\n";
+    exit(0);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: acceptLoop()
+ * 
+ *    Entry: The event loop, the listening socket, the server options, and
+ *           the control port name
+ *
+ *     Exit: Returns when the listener is cancelled
+ *
+ *  Purpose: Start a session for each TCP connection
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> acceptLoop(FtCo::Loop &loop, int sock_fd, const ServerOpts &opts,
+                        const char *con_port)
+{
+    while (1)
+    {
+        struct sockaddr_storage their_addr;
+        socklen_t sin_size = sizeof their_addr;
+        
+        int newfd = co_await FtCo::AcceptOp(loop, sock_fd,
+                                            (struct sockaddr *)&their_addr,
+                                            &sin_size);
+        if (newfd == -1)
+        {
+            if (errno == ECANCELED)
+            {
+                co_return;
+            }
+            error("Accept: ");
+            continue;
+        }
+        
+        loop.spawn(tcpSession(loop, newfd, their_addr, sin_size, opts,
+                              con_port));
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: ctlLoop()
+ * 
+ *    Entry: The event loop, the control, listening, and local listening
+ *           sockets, and a flag to set once they are handed off
+ *
+ *     Exit: Returns when the listeners are handed off or cancelled
+ *
+ *  Purpose: Pass the listeners to a new server that asks for them
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> ctlLoop(FtCo::Loop &loop, int ctl_fd, int sock_fd, int local_fd,
+                     bool *handedOff)
+{
+    while (!*handedOff)
+    {
+        long ready = co_await FtCo::ReadyOp(loop, ctl_fd, 0);
+        if (ready == -1)
+        {
+            co_return;
+        }
+        
+        *handedOff = handOffListener(ctl_fd, sock_fd, local_fd);
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: localAcceptLoop()
+ * 
+ *    Entry: The event loop, the local listening socket, and the options
+ *
+ *     Exit: Returns when the listener is cancelled
+ *
+ *  Purpose: Start a session for each same-host connection
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> localAcceptLoop(FtCo::Loop &loop, int local_fd,
+                             const ServerOpts &opts)
+{
+    while (1)
+    {
+        int newfd = co_await FtCo::AcceptOp(loop, local_fd, NULL, NULL);
+        if (newfd == -1)
+        {
+            if (errno == ECANCELED)
+            {
+                co_return;
+            }
+            error("Local accept: ");
+            continue;
+        }
+        
+        loop.spawn(localSession(loop, newfd, opts));
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: localSession()
+ * 
+ *    Entry: The event loop, the local connection, and the options
+ *
+ *     Exit: The request is answered and the connection closed
+ *
+ *  Purpose: Wait for a same-host request without blocking the loop
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> localSession(FtCo::Loop &loop, int new_fd, const ServerOpts &opts)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    CmdData dst;
+    FtArena::Arena arena(SESSION_ARENA);
+    
+    long inLen = co_await FtCo::RecvOp(loop, new_fd, inMsgBuf, MAX_TRANS_MSG,
+                                       opts.limits.cmdSecs * 1000LL);
+    if (inLen > 0 && parseCommand(inMsgBuf, inLen, false, &dst))
+    {
+        DirList dirListing = co_await buildDirAsync(loop, arena, dst.filter);
+        answerLocalRequest(dst, dirListing, &new_fd, arena);
+    }
+    else if (inLen == -1)
+    {
+        reportLoopError("local client", "command read");
+    }
+    
+    close(new_fd);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: tcpSession()
+ * 
+ *    Entry: The event loop, the control connection and its peer address,
+ *           the options, and the control port name
+ *
+ *     Exit: The request is complete and the connection closed
+ *
+ *  Purpose: The loop's version of the forked child
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> tcpSession(FtCo::Loop &loop, int new_fd,
+                        struct sockaddr_storage their_addr, socklen_t sin_size,
+                        const ServerOpts &opts, const char *con_port)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    char host[1024];
+    char service[20];
+    CmdData dst;
+    FtArena::Arena arena(SESSION_ARENA);
+    FtTrace::Request trace;
+    
+    // Name the client by its address; A reverse lookup would block every
+    // session on the loop until it answered
+    trace.start(FtTrace::sample());
+    trace.enter(FtTrace::TR_REVERSE_LOOKUP);
+    getnameinfo((struct sockaddr *)&their_addr, sin_size, host, sizeof host,
+                service, sizeof service, NI_NUMERICHOST | NI_NUMERICSERV);
+    std::cout << "Connection from " << host << "\n";
+    
+    trace.enter(FtTrace::TR_CMD_READ);
+    long inLen = co_await FtCo::RecvOp(loop, new_fd, inMsgBuf, MAX_TRANS_MSG,
+                                       opts.limits.cmdSecs * 1000LL);
+    trace.enter(FtTrace::TR_WORK);
+    reportPlacement(new_fd, inMsgBuf, host, trace);
+    if (inLen <= 0)
+    {
+        if (inLen == -1)
+        {
+            reportLoopError(host, "command read");
+        }
+    }
+    else if (!parseCommand(inMsgBuf, inLen, true, &dst))
+    {
+        std::cout << "Malformed command from " << host << "\n";
+    }
+    else
+    {
+        int slot = FtSched::registerSession(host, xferSize(&dst));
+        trace.setRequest(dst.command, dst.file, host);
+        co_await completeRequestAsync(loop, &dst, con_port, host,
+                                      (struct sockaddr *)&their_addr, sin_size,
+                                      new_fd, arena, opts.limits, slot, trace);
+        FtSched::unregisterSession(slot);
+    }
+    
+    close(new_fd);
+    trace.finish();
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: completeRequestAsync()
+ * 
+ *    Entry: The event loop, the parsed command, the control port and client
+ *           host names, the client's address and its length, the control
+ *           connection, the session arena, the phase limits, the scheduler
+ *           slot, and the request trace
+ *
+ *     Exit: Sends the directory information or the file
+ *
+ *  Purpose: The same steps as completeRequest(); Each wait suspends the
+ *           session and a failure ends it instead of the process
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> completeRequestAsync(FtCo::Loop &loop, CmdData *dst,
+                                  const char *con_port, const char *host,
+                                  const struct sockaddr *peer,
+                                  socklen_t peerLen, int new_fd,
+                                  FtArena::Arena &arena,
+                                  const FtWatch::Limits &limits, int slot,
+                                  FtTrace::Request &trace)
+{
+    trace.enter(FtTrace::TR_BUILD_DIR);
+    DirList dirListing = co_await buildDirAsync(loop, arena, dst->filter);
+    trace.enter(FtTrace::TR_WORK);
+    bool isGet = isFileCmd(dst);
+    char okMsg[MAX_OUT_MSG];
+    int okLen = OK_MSG_SIZE;
+    memcpy(okMsg, OK_MSG, OK_MSG_SIZE);
+    
+    if (isGet)
+    {
+        std::cout << "File \"" << dst->file << "\"\nrequested on port "
+                  << con_port << ".\n";
+        
+        if (!inDir(dirListing, dst->file))
+        {
+            std::cout << "File not found. Sending\n" << "error message to\n"
+                      << host << ":" << dst->dataPort << "\n";
+            long sent = co_await FtCo::SendOp(loop, new_fd, ERR_MSG,
+                                              ERR_MSG_SIZE, 0,
+                                              limits.ackSecs * 1000LL);
+            if (sent == -1)
+            {
+                reportLoopError(host, "send");
+            }
+            co_return;
+        }
+        
+        notePrefetch(dirListing, dst->file, host);
+        okLen = buildReadyMsg(dst, okMsg);
+        if (okLen == 0)
+        {
+            std::cout << "File \"" << dst->file << "\" not modified.\n";
+            long sent = co_await FtCo::SendOp(loop, new_fd, NOT_MOD_MSG,
+                                              sizeof NOT_MOD_MSG, 0,
+                                              limits.ackSecs * 1000LL);
+            if (sent == -1)
+            {
+                reportLoopError(host, "send");
+            }
+            co_return;
+        }
+    }
+    else
+    {
+        std::cout << "List directory requested\non port " << dst->dataPort
+                  << ".\n";
+        if (dirListing.more)
+        {
+            okLen = sizeof MORE_MSG;
+            memcpy(okMsg, MORE_MSG, okLen);
+        }
+    }
+    
+    // Inform client that the server is ready to transmit
+    long sent = co_await FtCo::SendOp(loop, new_fd, okMsg, okLen, 0,
+                                      limits.ackSecs * 1000LL);
+    if (sent == -1)
+    {
+        reportLoopError(host, "ack wait");
+        co_return;
+    }
+    
+    // Receive message that client is ready to receive the data
+    char inMsgBuf[MAX_TRANS_MSG];
+    trace.enter(FtTrace::TR_READY_WAIT);
+    long inLen = co_await FtCo::RecvOp(loop, new_fd, inMsgBuf, MAX_TRANS_MSG,
+                                       limits.ackSecs * 1000LL);
+    trace.enter(FtTrace::TR_WORK);
+    if (inLen == -1)
+    {
+        reportLoopError(host, "ack wait");
+    }
+    if (!isReadyMsg(inMsgBuf, inLen))
+    {
+        co_return;
+    }
+    
+    bool udp = (strcmp(dst->command, "u") == 0);
+    int d_sockfd = co_await connectDataAsync(loop, peer, peerLen, host,
+                                             dst->dataPort,
+                                             udp ? SOCK_DGRAM : SOCK_STREAM,
+                                             limits.connSecs * 1000LL, trace);
+    if (d_sockfd == -1)
+    {
+        co_return;
+    }
+    
+    if (udp)
+    {
+        std::cout << "Sending \"" << dst->file << "\"\n" << "to " 
+                  << host << ":" << dst->dataPort << "\n";
+        co_await sendFileUdpAsync(loop, dst->file, d_sockfd, new_fd, host,
+                                  limits.ackSecs * 1000LL, slot, trace);
+    }
+    else if (isGet)
+    {
+        std::cout << "Sending \"" << dst->file << "\"\n" << "to " 
+                  << host << ":" << dst->dataPort << "\n";
+        co_await sendFileAsync(loop, dst->file, dst->offset, dst->length,
+                               strcmp(dst->command, "s") == 0, d_sockfd,
+                               new_fd, host, limits.ackSecs * 1000LL, slot,
+                               trace);
+    }
+    else
+    {
+        std::cout << "Sending directory\ncontents to " << host << ":"
+                  << dst->dataPort << "\n";
+        co_await sendListingAsync(loop, dirListing, d_sockfd, new_fd, host,
+                                  limits.ackSecs * 1000LL, slot, trace);
+    }
+    
+    close(d_sockfd);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: connectDataAsync()
+ * 
+ *    Entry: The event loop, the client's address and its length, the
+ *           client host name, the data port, the socket type, the connect
+ *           deadline in milliseconds, and the request trace
+ *
+ *     Exit: Returns the connected data socket or -1
+ *
+ *  Purpose: Open the data connection without blocking the loop; It goes
+ *           back to the address the control connection came from, since
+ *           resolving the host name again would block every session
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<int> connectDataAsync(FtCo::Loop &loop, const struct sockaddr *peer,
+                                 socklen_t peerLen, const char *host,
+                                 int dataPort, int sockType,
+                                 long long timeoutMs,
+                                 FtTrace::Request &trace)
+{
+    struct sockaddr_storage addr;
+    memcpy(&addr, peer, peerLen);
+    if (addr.ss_family == AF_INET)
+    {
+        ((struct sockaddr_in *)&addr)->sin_port = htons(dataPort);
+    }
+    else if (addr.ss_family == AF_INET6)
+    {
+        ((struct sockaddr_in6 *)&addr)->sin6_port = htons(dataPort);
+    }
+    else
+    {
+        co_return (-1);
+    }
+    
+    trace.enter(FtTrace::TR_DATA_CONNECT);
+    int d_sockfd = socket(addr.ss_family,
+                          sockType | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (d_sockfd == -1)
+    {
+        error("client: socket");
+        trace.enter(FtTrace::TR_WORK);
+        co_return (-1);
+    }
+    
+    long conn = co_await FtCo::ConnectOp(loop, d_sockfd,
+                                         (struct sockaddr *)&addr, peerLen,
+                                         timeoutMs);
+    trace.enter(FtTrace::TR_WORK);
+    if (conn == -1)
+    {
+        reportLoopError(host, "data connect");
+        close(d_sockfd);
+        co_return (-1);
+    }
+    
+    // As in connectData(); The header's MSG_MORE still joins it to the chunk
+    int on = 1;
+    if (sockType == SOCK_STREAM)
+    {
+        setsockopt(d_sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    }
+    
+    co_return (d_sockfd);
+}
+
+/*   *   *   *   *   *   *
  * 
- *    Entry: CmdData struct with the command, data port, and file name if 
- *           needed, and a string for the control port
+ * Function: startDirWorker()
+ * 
+ *    Entry: None
  *
- *     Exit: Sends the directory information or the file 
+ *     Exit: The directory helper thread is running, or the queue is NULL
+ *           and sessions read the directory themselves
  *
- *  Purpose: Sends the directory or the file 
+ *  Purpose: Give the loop one thread for directory reads
  *
  *
  *   *   *   *   *   *   */
-void completeRequest(CmdData *dst, std::string con_port, std::string host, 
-                     int *new_fd)
+void startDirWorker()
 {
-    // List contents of the directory
-    std::vector<std::string> dirListing = buildDir();
-    
-    // Check command 
-    if (dst->command == "g") // Send file over data port
+    dirQueue = new DirQueue();
+    if (!FtShm::startWorker(dirWorker, NULL))
     {
-        // Print status to console window
-        std::cout << "File \"" << dst->file << "\"\nrequested on port "
-                  << con_port << ".\n";
-                  
-        // Check if file is present in directory
-        bool isPresent = false;
-        for (unsigned int i = 0; i < dirListing.size(); i++)
+        error("Directory thread, listings will block the loop: ");
+        delete dirQueue;
+        dirQueue = NULL;
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: dirWorker()
+ * 
+ *    Entry: Unused thread argument
+ *
+ *     Exit: Never returns
+ *
+ *  Purpose: Build the listing of each queued job in its session's arena and
+ *           wake the session through the job's eventfd; The session is
+ *           suspended until then, so nothing else touches its arena
+ *
+ *
+ *   *   *   *   *   *   */
+void *dirWorker(void *arg)
+{
+    while (1)
+    {
+        DirJob *job;
         {
-            if (dirListing[i] == dst->file)
+            std::unique_lock<std::mutex> hold(dirQueue->lock);
+            while (dirQueue->jobs.empty())
             {
-                isPresent = true;
+                dirQueue->ready.wait(hold);
             }
+            job = dirQueue->jobs.front();
+            dirQueue->jobs.pop_front();
         }
-        if (!isPresent)
+        
+        job->dir = buildDir(*job->arena, *job->filter);
+        
+        uint64_t one = 1;
+        if (write(job->doneFd, &one, sizeof one) == -1)
         {
-            // Print status to console window
-            std::cout << "File not found. Sending\n" << "error message to\n"
-                      << host << ":" << dst->dataPort << "\n";
-                      
-            // Send error to client on control connection
-            std::string outStr = "FILE NOT FOUND";
-            char *outMsg = new char[MAX_OUT_MSG];
-            strcpy(outMsg, outStr.c_str());
-            sendMsg(outMsg, new_fd, ERR_MSG_SIZE);
-            delete [] outMsg;
-            
-            exit(0);
+            error("Directory worker: ");
+        }
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: buildDirAsync()
+ * 
+ *    Entry: The event loop, the session arena, and the listing's filter
+ *
+ *     Exit: Returns the listing buildDir() builds
+ *
+ *  Purpose: Read the directory on the helper thread while the session
+ *           waits on the loop; Without the thread or an eventfd it is read
+ *           here
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<DirList> buildDirAsync(FtCo::Loop &loop, FtArena::Arena &arena,
+                                  const FtList::Filter &filter)
+{
+    DirJob job;
+    job.arena = &arena;
+    job.filter = &filter;
+    job.doneFd = (dirQueue != NULL ? eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)
+                                   : -1);
+    if (job.doneFd == -1)
+    {
+        co_return (buildDir(arena, filter));
+    }
+    
+    {
+        std::lock_guard<std::mutex> hold(dirQueue->lock);
+        dirQueue->jobs.push_back(&job);
+    }
+    dirQueue->ready.notify_one();
+    
+    // The job lives in this frame, so the helper must be done with it first
+    while (co_await FtCo::ReadyOp(loop, job.doneFd, 0) == -1)
+    {
+        continue;
+    }
+    close(job.doneFd);
+    
+    co_return (job.dir);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: sendFileAsync()
+ * 
+ *    Entry: The event loop, the file name, the offset and length of the
+ *           range to send, or -1 for the rest of the file, true to send
+ *           holes as records, the data socket, the control connection, the
+ *           client host name, the ack deadline in milliseconds, the
+ *           scheduler slot, and the request trace
+ *
+ *     Exit: Sends the range in chunks, waiting for an ack after each
+ *
+ *  Purpose: The chunk loop of sendFile(); The header is sent with MSG_MORE
+ *           and the data with sendfile(), so it is never copied to the
+ *           server, and the scheduler's waits are timers on the loop
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> sendFileAsync(FtCo::Loop &loop, const char *file,
+                           long long start, long long len, bool sparse,
+                           int d_sockfd, int new_fd, const char *host,
+                           long long timeoutMs, int slot,
+                           FtTrace::Request &trace)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    char header[HOLE_SIZE];
+    struct stat st;
+    long long base = 0;
+    int member = -1;
+    int fd;
+    
+    if (FtPack::isOpen())
+    {
+        // Send the packed file's range of the archive, which stays open
+        member = FtPack::find(file);
+        fd = (member == -1 ? -1 : FtPack::getFd());
+        if (member != -1)
+        {
+            base = FtPack::offset(member);
+            st.st_size = FtPack::size(member);
+        }
+    }
+    else
+    {
+        fd = open(file, O_RDONLY | O_CLOEXEC);
+        if (fd != -1 && fstat(fd, &st) == -1)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd == -1)
+    {
+        error("File open: ");
+        co_return;
+    }
+    
+    long long end = (len < 0 ? LLONG_MAX : start + len);
+    if (st.st_size < end)
+    {
+        end = st.st_size;
+    }
+    
+    // Offsets are in the descriptor, past base for a packed file
+    FtChunk::Sizer sizer;
+    off_t off = base + start;
+    end += base;
+    long long extentEnd = (sparse ? off : end);
+    bool inHole = false;
+    while (off < end)
+    {
+        // A hole is one record with no data after it
+        if (sparse && off >= extentEnd)
+        {
+            extentEnd = findExtent(fd, 0, off, end, &inHole);
+        }
+        int bytes = 0;
+        int headerLen = HEADER_SIZE;
+        if (inHole)
+        {
+            headerLen = buildHole(header, extentEnd - off);
+        }
+        else
+        {
+            bytes = sizer.getSize();
+            if (extentEnd - off < bytes)
+            {
+                bytes = extentEnd - off;
+            }
+            memset(header, ' ', HEADER_SIZE);
+            std::to_chars(header, header + HEADER_SIZE, bytes);
         }
         
-        // Inform client that the server is ready to transmit
-        std::string outStr = "ready";
-        char *outMsg = new char[MAX_OUT_MSG];
-        strcpy(outMsg, outStr.c_str());
-        sendMsg(outMsg, new_fd, OK_MSG_SIZE);
+        trace.enter(FtTrace::TR_RATE_WAIT);
+        double wait;
+        while ((wait = FtSched::tryAcquireBytes(slot, bytes + headerLen)) > 0)
+        {
+            co_await FtCo::SleepOp(loop, static_cast<long long>(wait * 1000));
+        }
         
-        // Receive message that client is ready to receive directory
-        char inMsgBuf[MAX_TRANS_MSG];
-        recvMsg(&inMsgBuf, new_fd);
-        std::string cliStatus;  
+        // sendfile() reads the file as it sends, so both are traced as send
+        trace.enter(FtTrace::TR_SEND);
+        long sent = co_await FtCo::SendOp(loop, d_sockfd, header, headerLen,
+                                          inHole ? 0 : MSG_MORE, timeoutMs);
+        if (sent != -1 && !inHole)
+        {
+            sent = co_await FtCo::SendfileOp(loop, d_sockfd, fd, &off, bytes,
+                                             timeoutMs);
+        }
+        if (sent == -1)
+        {
+            reportLoopError(host, "send");
+            break;
+        }
+        trace.addBytes(bytes + headerLen);
+        if (inHole)
+        {
+            off = extentEnd;
+            inHole = false;
+        }
         
-        // Parse message for client status
-        std::istringstream inMsg(inMsgBuf);
-        inMsg >> cliStatus;
-        if (cliStatus == "ready") // Open connection to client to send data
+        // Wait for acknowledgement from client on control port
+        trace.enter(FtTrace::TR_ACK_WAIT);
+        long inLen = co_await FtCo::RecvOp(loop, new_fd, inMsgBuf,
+                                           MAX_TRANS_MSG, timeoutMs);
+        if (inLen <= 0)
         {
-            // Declare variables and structs
-            int d_sockfd;  
-            struct addrinfo hints, *servinfo, *p;
-            int dStatus;
-            
-            // Convert integer port number to const char
-            std::string data_port;
-            std::stringstream  temp;
-            temp << dst->dataPort;
-            data_port = temp.str();
-            
-            memset(&hints, 0, sizeof hints);
-            hints.ai_family = AF_INET; // Specify IPv4
-            hints.ai_socktype = SOCK_STREAM; // Specify TCP stream sockets
-            
-            // Specify localhost as IP and port from CmdData struct
-            if ((dStatus = getaddrinfo(host.c_str(), data_port.c_str(), &hints, 
-                 &servinfo)) != 0) 
+            if (inLen == -1)
             {
-                fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(dStatus));
-                exit(1);
+                reportLoopError(host, "ack wait");
             }
-            
-            // Loop through all the results and connect to the first we can
-            for(p = servinfo; p != NULL; p = p->ai_next) 
-            {
-                if ((d_sockfd = socket(p->ai_family, p->ai_socktype,
-                        p->ai_protocol)) == -1) 
-                {
-                    error("client: socket");
-                    continue;
-                }
-
-                if (connect(d_sockfd, p->ai_addr, p->ai_addrlen) == -1) 
-                {
-                    close(d_sockfd);
-                    error("client: connect");
-                    continue;
-                }
+            break;
+        }
+        if (bytes > 0)
+        {
+            sizer.sent(d_sockfd, bytes);
+        }
+    }
+    trace.enter(FtTrace::TR_WORK);
+    trace.setChunks(sizer.getMin(), sizer.getMax(), sizer.getSize(),
+                    sizer.getResizes());
+    
+    if (member == -1)
+    {
+        close(fd);
+    }
+}
 
+/*   *   *   *   *   *   *
+ * 
+ * Function: sendFileUdpAsync()
+ * 
+ *    Entry: The event loop, the file name, the connected UDP socket, the
+ *           control connection, the client host name, the ack deadline in
+ *           milliseconds, the scheduler slot, and the request trace
+ *
+ *     Exit: Sends the file until the client sends "done"
+ *
+ *  Purpose: The loop of sendFileUdp(); The waits between batches are
+ *           readiness waits on the control connection, so they end on a
+ *           "nack" or at the next tick of the loop's timers, and the
+ *           Sender saves up to one tick of its rate for the next batch
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> sendFileUdpAsync(FtCo::Loop &loop, const char *file,
+                              int d_sockfd, int new_fd, const char *host,
+                              long long timeoutMs, int slot,
+                              FtTrace::Request &trace)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    long long base, size;
+    int fd = openSendFile(file, &base, &size);
+    if (fd == -1)
+    {
+        error("File open: ");
+        co_return;
+    }
+    
+    FtUdp::Sender sender(d_sockfd, fd, base, size, 0);
+    FtUdp::Feed fed = FtUdp::FEED_MORE;
+    while (fed == FtUdp::FEED_MORE)
+    {
+        long long wait = sender.waitUs(FtUdp::monoUs());
+        trace.enter(wait == -1 ? FtTrace::TR_ACK_WAIT : FtTrace::TR_SEND);
+        long ready = co_await FtCo::ReadyOp(loop, new_fd,
+                                            wait == -1 ? timeoutMs
+                                                       : wait / 1000 + 1);
+        if (ready == -1 && (errno != ETIMEDOUT || wait == -1))
+        {
+            reportLoopError(host, "ack wait");
+            break;
+        }
+        
+        if (ready != -1)
+        {
+            long inLen = recv(new_fd, inMsgBuf, MAX_TRANS_MSG, MSG_DONTWAIT);
+            if (inLen == 0)
+            {
                 break;
             }
-            
-            if (p == NULL) 
+            if (inLen == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
             {
-                fprintf(stderr, "client: failed to connect\n");
-                exit(1);
+                reportLoopError(host, "ack wait");
+                break;
             }
-            
-            // Free the linked list
-            freeaddrinfo(servinfo);
-            
-            // Send the requested file
-            std::cout << "Sending \"" << dst->file << "\"\n" << "to " 
-                      << host << ":" << dst->dataPort << "\n";
-            
-            // Declare buffer and open file stream
-            char outChunkBuf[MAX_FILE_CHUNK];
-            std::ifstream file(dst->file, std::ios_base::in);
-            if (!file) // File was unable to be opened
+            if (inLen > 0)
             {
-                error("File open: ");
-                exit(1);
+                fed = sender.feed(inMsgBuf, inLen);
             }
-            int bytesRead;
-            std::string outPackBuf;
-            char outPack[MAX_PACK_SIZE];
-            
-            /*
-             * Number of characters read is prepended to the beginning of the 
-             * outgoing message and sent to client. Client reads the number, 
-             * then receives the message. If the total number of characters
-             * received does not match, client will continue to recv()
-             */
-            
-            // Enter read, send, receive acknowledgement loop until EOF
-            while (1)
-            {
-                // TODO: Clean this up and remove break statement
-                // do while loop?
-                file.read(outChunkBuf, MAX_FILE_CHUNK);
-                // Get bytes read and prepend the number to the outgoing data
-                // Pad with spaces for numbers < 4 digits
-                bytesRead = file.gcount();
-                if (bytesRead == 0)
-                {
-                    break;
-                }
-
-                std::string bytes = std::to_string(static_cast<long long>(bytesRead));
-                // Static cast is required - see page below for details
-                // http://stackoverflow.com/questions/10664699/stdto-string-more-than-instance-of-overloaded-function-matches-the-argument
-                
-                if (bytesRead < 10)
-                {
-                    outPackBuf = bytes + "   " + std::string(outChunkBuf);
-                }
-                else if (bytesRead < 100)
-                {
-                    outPackBuf = bytes + "  " + std::string(outChunkBuf);
-                }
-                else if (bytesRead < 1000)
-                {
-                    outPackBuf = bytes + " " + std::string(outChunkBuf);
-                }
-                else 
-                {
-                    outPackBuf = bytes + std::string(outChunkBuf);
-                    
-                }
-
-                
-                // Copy string to char array without terminating w/null char
-                memcpy(outPack, outPackBuf.c_str(), MAX_PACK_SIZE);
-                
-                
-                // Send message
-                sendMsg(outPack, &d_sockfd, (bytesRead + 4));
-                
-                // Wait for acknowledgement from client on control port
-                recvMsg(&inMsgBuf, new_fd);
-                
-                // If acknowledgement was received, send the next file listing
+        }
+        
+        int sent = sender.pump(FtUdp::monoUs());
+        if (sent == -1)
+        {
+            reportLoopError(host, "send");
+            break;
+        }
+        if (sent > 0)
+        {
+            trace.addBytes(sent);
+            trace.enter(FtTrace::TR_RATE_WAIT);
+            double rateWait;
+            while ((rateWait = FtSched::tryAcquireBytes(slot, sent)) > 0)
+            {
+                co_await FtCo::SleepOp(loop,
+                                       static_cast<long long>(rateWait
+                                                              * 1000));
             }
-            
-            // Close the connection
-            close(d_sockfd);
-            delete [] outMsg;
         }
     }
-    else if (dst->command == "l") // Send directory contents over data port
+    trace.enter(FtTrace::TR_WORK);
+    
+    if (fed == FtUdp::FEED_BAD)
+    {
+        std::cout << "Bad control message from " << host << "; stopping\n";
+    }
+    std::cout << "UDP rate " << sender.getRate() << " B/s, "
+              << sender.getResent() << " packets resent"
+              << (sender.usedGso() ? ", GSO" : "") << "\n";
+    
+    if (!FtPack::isOpen())
     {
-        std::cout << "List directory requested\non port " << dst->dataPort
-                  << ".\n";
-        
-        // Inform client that the server is ready to transmit
-        std::string outStr = "ready";
-        char *outMsg = new char[MAX_OUT_MSG];
-        strcpy(outMsg, outStr.c_str());
-        sendMsg(outMsg, new_fd, OK_MSG_SIZE);
-        // memset(&outMsg, '\0', MAX_OUT_MSG);
+        close(fd);
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: sendListingAsync()
+ * 
+ *    Entry: The event loop, the directory list, the data socket, the
+ *           control connection, the client host name, the ack deadline in
+ *           milliseconds, the scheduler slot, and the request trace
+ *
+ *     Exit: Sends each name, waiting for an ack after each
+ *
+ *  Purpose: The loop of sendListing() without blocking the loop
+ *
+ *
+ *   *   *   *   *   *   */
+FtCo::Task<> sendListingAsync(FtCo::Loop &loop, const DirList &dir,
+                              int d_sockfd, int new_fd, const char *host,
+                              long long timeoutMs, int slot,
+                              FtTrace::Request &trace)
+{
+    char inMsgBuf[MAX_TRANS_MSG];
+    
+    for (int i = 0; i < dir.count; i++)
+    {
+        const char *name = dirName(dir, i);
+        int len = strlen(name);
         
+        trace.enter(FtTrace::TR_RATE_WAIT);
+        double wait;
+        while ((wait = FtSched::tryAcquireBytes(slot, len)) > 0)
+        {
+            co_await FtCo::SleepOp(loop, static_cast<long long>(wait * 1000));
+        }
         
-        // Receive message that client is ready to receive directory
-        char inMsgBuf[MAX_TRANS_MSG];
-        recvMsg(&inMsgBuf, new_fd);
-        std::string cliStatus;  
+        trace.enter(FtTrace::TR_SEND);
+        long sent = co_await FtCo::SendOp(loop, d_sockfd, name, len, 0,
+                                          timeoutMs);
+        if (sent == -1)
+        {
+            reportLoopError(host, "send");
+            co_return;
+        }
+        trace.addBytes(len);
         
-        // Parse message for client status
-        std::istringstream inMsg(inMsgBuf);
-        inMsg >> cliStatus;
-        if (cliStatus == "ready") // Open connection to client to send data
+        trace.enter(FtTrace::TR_ACK_WAIT);
+        long inLen = co_await FtCo::RecvOp(loop, new_fd, inMsgBuf,
+                                           MAX_TRANS_MSG, timeoutMs);
+        if (inLen <= 0)
         {
-            // Declare variables and structs
-            int d_sockfd;  
-            struct addrinfo hints, *servinfo, *p;
-            int dStatus;
-            
-            // Convert integer port number to const char
-            std::string data_port;
-            std::stringstream  temp;
-            temp << dst->dataPort;
-            data_port = temp.str();
-            
-            memset(&hints, 0, sizeof hints);
-            hints.ai_family = AF_INET; // Specify IPv4
-            hints.ai_socktype = SOCK_STREAM; // Specify TCP stream sockets
-            
-            // Specify localhost as IP and port from CmdData struct
-            if ((dStatus = getaddrinfo(host.c_str(), data_port.c_str(), &hints, 
-                 &servinfo)) != 0) 
-            {
-                fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(dStatus));
-                exit(1);
-            }
-            
-            // Loop through all the results and connect to the first we can
-            for(p = servinfo; p != NULL; p = p->ai_next) 
-            {
-                if ((d_sockfd = socket(p->ai_family, p->ai_socktype,
-                        p->ai_protocol)) == -1) 
-                {
-                    error("client: socket");
-                    continue;
-                }
-
-                if (connect(d_sockfd, p->ai_addr, p->ai_addrlen) == -1) 
-                {
-                    close(d_sockfd);
-                    error("client: connect");
-                    continue;
-                }
-
-                break;
-            }
-            
-            if (p == NULL) 
-            {
-                fprintf(stderr, "client: failed to connect\n");
-                exit(1);
-            }
-            
-            // Free the linked list
-            freeaddrinfo(servinfo);
-            
-            // Send the directory contents
-            std::cout << "Sending directory\ncontents to " << host << ":"
-                      << dst->dataPort << "\n";
-            for (unsigned int i = 2; i < dirListing.size(); i++)
+            if (inLen == -1)
             {
-                // Copy element of dirListing array and send
-                strcpy(outMsg, dirListing[i].c_str());
-                sendMsg(outMsg, &d_sockfd, dirListing[i].size());
-                
-                // Wait for acknowledgement from client
-                recvMsg(&inMsgBuf, new_fd);
-                
-                // If acknowledgement was received, send the next file listing
+                reportLoopError(host, "ack wait");
             }
-            
-            // Close the connection
-            close(d_sockfd);
-            delete [] outMsg;
+            co_return;
         }
     }
+    trace.enter(FtTrace::TR_WORK);
 }
 
+/*   *   *   *   *   *   *
+ * 
+ * Function: reportLoopError()
+ * 
+ *    Entry: The client host name and the phase that failed
+ *
+ *     Exit: Prints why the session is ending
+ *
+ *  Purpose: Report a missed deadline like the watchdog, and other errors
+ *           with strerror()
+ *
+ *
+ *   *   *   *   *   *   */
+void reportLoopError(const char *host, const char *phase)
+{
+    if (errno == ETIMEDOUT)
+    {
+        std::cout << "Session from " << host << " timed out in " << phase
+                  << "; closing\n";
+    }
+    else
+    {
+        error(std::string("Session from ") + host + ", " + phase + ": ");
+    }
+}
@@ -0,0 +1,176 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftshm.cpp
+ *           Overview: This is the implementation file for the ftserve shared
+ *                     memory helpers
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <cerrno>
+#include <ctime>
+#include <csignal>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "ftshm.h"
+
+namespace FtShm
+{
+    /*   *   *   *   *   *   *
+     *
+     * Function: mapShared()
+     *
+     *    Entry: The size of the table in bytes
+     *
+     *     Exit: Returns the mapping or NULL
+     *
+     *  Purpose: An anonymous shared mapping is inherited by every forked
+     *           child and its pages start zeroed
+     *
+     *
+     *   *   *   *   *   *   */
+    void *mapShared(std::size_t size)
+    {
+        void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+        {
+            return (NULL);
+        }
+
+        return (mem);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initLock()
+     *
+     *    Entry: A mutex in shared memory
+     *
+     *     Exit: The mutex is initialized
+     *
+     *  Purpose: The lock must survive a child dying while holding it
+     *
+     *
+     *   *   *   *   *   *   */
+    void initLock(pthread_mutex_t *lock)
+    {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initCond()
+     *
+     *    Entry: A condition variable in shared memory
+     *
+     *     Exit: The condition variable is initialized
+     *
+     *  Purpose: Let processes wait on each other; Waits are timed on the
+     *           monotonic clock so a change of the time of day cannot
+     *           stretch them
+     *
+     *
+     *   *   *   *   *   *   */
+    void initCond(pthread_cond_t *cond)
+    {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(cond, &attr);
+        pthread_condattr_destroy(&attr);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: lock()
+     *
+     *    Entry: A mutex from initLock()
+     *
+     *     Exit: The mutex is held
+     *
+     *  Purpose: Lock a shared table, recovering it if the previous owner
+     *           died; The table may be part way through an update, which
+     *           each module's checks tolerate
+     *
+     *
+     *   *   *   *   *   *   */
+    void lock(pthread_mutex_t *lock)
+    {
+        if (pthread_mutex_lock(lock) == EOWNERDEAD)
+        {
+            pthread_mutex_consistent(lock);
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: timedWait()
+     *
+     *    Entry: A condition from initCond(), its held mutex, and the longest
+     *           wait in nanoseconds
+     *
+     *     Exit: Returns with the mutex held after a wakeup or the timeout
+     *
+     *  Purpose: Wait for another process without missing its death
+     *
+     *
+     *   *   *   *   *   *   */
+    void timedWait(pthread_cond_t *cond, pthread_mutex_t *lock, long nsec)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += nsec / 1000000000L;
+        ts.tv_nsec += nsec % 1000000000L;
+        if (ts.tv_nsec >= 1000000000L)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+
+        if (pthread_cond_timedwait(cond, lock, &ts) == EOWNERDEAD)
+        {
+            pthread_mutex_consistent(lock);
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: startWorker()
+     *
+     *    Entry: The thread's function and its argument
+     *
+     *     Exit: Returns true if the thread is running
+     *
+     *  Purpose: The thread blocks every signal so they reach the main
+     *           thread and interrupt its wait
+     *
+     *
+     *   *   *   *   *   *   */
+    bool startWorker(void *(*run)(void *), void *arg)
+    {
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &old);
+        pthread_t tid;
+        int rc = pthread_create(&tid, NULL, run, arg);
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        if (rc != 0)
+        {
+            return (false);
+        }
+        pthread_detach(tid);
+
+        return (true);
+    }
+} // FtShm
@@ -0,0 +1,62 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftshm.h
+ *           Overview: This is the header file for the ftserve shared memory
+ *                     helpers. A table shared by the parent and every forked
+ *                     child is mapped before the first fork and guarded by a
+ *                     lock that survives a child dying while holding it; A
+ *                     worker thread in the parent leaves signals to the main
+ *                     thread, and a process waiting on another wakes at least
+ *                     every timed wait, so it notices that the other has died
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTSHM_H
+#define FTSHM_H
+
+#include <cstddef>
+#include <pthread.h>
+
+namespace FtShm
+{
+    /*
+     * The mapShared() function maps size bytes of zeroed memory that every
+     * child forked afterwards shares; Returns NULL on failure
+     */
+    void *mapShared(std::size_t size);
+
+    /*
+     * The initLock() function initializes a robust process-shared mutex
+     */
+    void initLock(pthread_mutex_t *lock);
+
+    /*
+     * The initCond() function initializes a process-shared condition
+     * variable that times its waits on the monotonic clock
+     */
+    void initCond(pthread_cond_t *cond);
+
+    /*
+     * The lock() function locks a mutex from initLock(), recovering it if
+     * its owner died
+     */
+    void lock(pthread_mutex_t *lock);
+
+    /*
+     * The timedWait() function waits on cond for at most nsec nanoseconds
+     * and returns with lock held, recovering it as lock() does
+     */
+    void timedWait(pthread_cond_t *cond, pthread_mutex_t *lock, long nsec);
+
+    /*
+     * The startWorker() function starts a detached thread running run(arg)
+     * with every signal blocked; Returns false if it could not be created
+     */
+    bool startWorker(void *(*run)(void *), void *arg);
+} // FtShm
+#endif // FTSHM_H
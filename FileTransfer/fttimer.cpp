@@ -0,0 +1,106 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: fttimer.cpp
+ *           Overview: This is the implementation file for the TimerWheel
+ *                     class
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <vector>
+#include "fttimer.h"
+
+namespace FtTimer
+{
+    TimerWheel::TimerWheel(int numSlots, long long tickMsInput,
+                           long long nowMs)
+        : slots(numSlots), tickMs(tickMsInput), curTick(nowMs / tickMsInput),
+          count(0)
+    {/*Body intentionally empty*/}
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: schedule
+     *
+     *    Entry: The timer id and its expiry time in milliseconds
+     *
+     *     Exit: The timer is placed in the slot for its expiry tick
+     *
+     *  Purpose: Add a timer; Timers further out than one revolution share a
+     *           slot with nearer ones and are skipped until their time comes
+     *
+     *
+     *   *   *   *   *   *   */
+    void TimerWheel::schedule(int id, long long expireMs)
+    {
+        // Round up so the timer is due by the time its slot is visited
+        long long tick = (expireMs + tickMs - 1) / tickMs;
+        if (tick <= curTick)
+        {
+            tick = curTick + 1;
+        }
+
+        Entry e = {id, expireMs};
+        slots[tick % slots.size()].push_back(e);
+        count++;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: advance
+     *
+     *    Entry: The current time in milliseconds and a vector for the ids
+     *
+     *     Exit: Expired timers are removed and their ids appended to expired
+     *
+     *  Purpose: Visit each slot passed since the last advance and fire the
+     *           timers that are due
+     *
+     *
+     *   *   *   *   *   *   */
+    void TimerWheel::advance(long long nowMs, std::vector<int> &expired)
+    {
+        long long nowTick = nowMs / tickMs;
+
+        // A long stall only needs one full revolution to see every slot
+        if (nowTick - curTick > static_cast<long long>(slots.size()))
+        {
+            curTick = nowTick - slots.size();
+        }
+
+        while (curTick < nowTick)
+        {
+            curTick++;
+            std::vector<Entry> &slot = slots[curTick % slots.size()];
+
+            for (unsigned int i = 0; i < slot.size(); )
+            {
+                if (slot[i].expireMs <= nowMs)
+                {
+                    expired.push_back(slot[i].id);
+                    slot[i] = slot.back();
+                    slot.pop_back();
+                    count--;
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+    }
+
+    bool TimerWheel::empty()
+    {
+        return (count == 0);
+    }
+
+    long long TimerWheel::getTickMs()
+    {
+        return (tickMs);
+    }
+} // FtTimer
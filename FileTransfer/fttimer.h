@@ -0,0 +1,62 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: fttimer.h
+ *           Overview: This is the header file for the TimerWheel class, a
+ *                     hashed timing wheel; Timers are small integer ids that
+ *                     expire at a time in milliseconds; Scheduling is O(1)
+ *                     and each tick only looks at one wheel slot
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTTIMER_H
+#define FTTIMER_H
+
+#include <vector>
+
+namespace FtTimer
+{
+    /*
+     * Class for a hashed timing wheel
+     */
+    class TimerWheel
+    {
+    public:
+        TimerWheel(int numSlots, long long tickMs, long long nowMs);
+        /*
+         * Initializes a wheel of numSlots slots each covering tickMs
+         * milliseconds, starting at nowMs
+         */
+
+        void schedule(int id, long long expireMs);
+        /*
+         * Adds a timer for id that expires at expireMs; Expiry times in the
+         * past fire on the next advance()
+         */
+
+        void advance(long long nowMs, std::vector<int> &expired);
+        /*
+         * Moves the wheel to nowMs and appends the ids of all expired
+         * timers to expired
+         */
+
+        bool empty();
+        long long getTickMs();
+    private:
+        struct Entry
+        {
+            int       id;
+            long long expireMs;
+        };
+
+        std::vector< std::vector<Entry> > slots;
+        long long tickMs;
+        long long curTick;
+        int count;
+    };
+} // FtTimer
+#endif // FTTIMER_H
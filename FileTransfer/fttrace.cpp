@@ -0,0 +1,414 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: fttrace.cpp
+ *           Overview: This is the implementation file for the ftserve
+ *                     request tracer
+ *
+ *                     The file starts with "[" and each record is a line of
+ *                     events ending with ",", the array format the trace
+ *                     viewers accept without a closing "]". Every record is
+ *                     appended with one write() to a file opened O_APPEND, so
+ *                     forked children never interleave their records
+ *              Input: None
+ *             Output: The trace file
+ *
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdarg>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fttrace.h"
+
+namespace FtTrace
+{
+    const int RECORD_SIZE = 8192; // Largest record written at once
+
+    // Names of the phases in the trace, in Phase order
+    static const char *PHASE_NAMES[TR_PHASES] = {
+        "work", "reverse_lookup", "cmd_read", "build_dir", "ready_wait",
+        "resolve", "data_connect", "disk_read", "rate_wait", "send",
+        "ack_wait"
+    };
+
+    // The trace file, the sampling interval, and the requests seen
+    static int traceFd = -1;
+    static int every = 1;
+    static long long seen = 0;
+
+    /*
+     * Helpers local to this file
+     */
+    static long long monoNs();
+    static void copyName(char *dst, const char *src, int size);
+    static void append(char *buf, int *len, const char *fmt, ...);
+    static void appendString(char *buf, int *len, const char *str);
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initTrace()
+     *
+     *    Entry: The trace file path and the sampling interval
+     *
+     *     Exit: Returns true if the file is open for appending
+     *
+     *  Purpose: Open the trace file before any fork(); A new file gets the
+     *           opening "[" and an existing one is appended to
+     *
+     *
+     *   *   *   *   *   *   */
+    bool initTrace(const char *path, int sampleEvery)
+    {
+        traceFd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (traceFd == -1)
+        {
+            return (false);
+        }
+
+        struct stat st;
+        if (fstat(traceFd, &st) == 0 && st.st_size == 0)
+        {
+            if (write(traceFd, "[\n", 2) != 2)
+            {
+                close(traceFd);
+                traceFd = -1;
+                return (false);
+            }
+        }
+
+        every = sampleEvery;
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: sample()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns a trace id, or 0 if the request is not traced
+     *
+     *  Purpose: Pick one request in every sampleEvery; The parent calls it
+     *           before fork() so the count is kept in one process
+     *
+     *
+     *   *   *   *   *   *   */
+    long long sample()
+    {
+        if (traceFd == -1 || every <= 0)
+        {
+            return (0);
+        }
+
+        seen++;
+        if (seen % every != 0)
+        {
+            return (0);
+        }
+        return (seen);
+    }
+
+    Request::Request()
+        : id(0), startNs(0), phaseNs(0), cur(TR_WORK), sent(0), chunkMin(0),
+          chunkMax(0), chunkLast(0), chunkResizes(0), placed(false), cpu(-1),
+          node(-1), nicCpu(-1), bufNode(-1)
+    {
+        command[0] = '\0';
+        file[0] = '\0';
+        host[0] = '\0';
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: start()
+     *
+     *    Entry: The trace id from sample()
+     *
+     *     Exit: The record is cleared and the request clock started
+     *
+     *  Purpose: Begin the record of a request
+     *
+     *
+     *   *   *   *   *   *   */
+    void Request::start(long long idInput)
+    {
+        id = idInput;
+        if (id == 0)
+        {
+            return;
+        }
+
+        for (int i = 0; i < TR_PHASES; i++)
+        {
+            firstNs[i] = 0;
+            totalNs[i] = 0;
+            count[i] = 0;
+        }
+        startNs = monoNs();
+        phaseNs = startNs;
+        cur = TR_WORK;
+        count[TR_WORK] = 1;
+        firstNs[TR_WORK] = startNs;
+        sent = 0;
+        chunkLast = 0;
+        placed = false;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: setRequest()
+     *
+     *    Entry: The command, file, and client host names
+     *
+     *     Exit: The names are copied into the record
+     *
+     *  Purpose: Label the record; Long names are truncated
+     *
+     *
+     *   *   *   *   *   *   */
+    void Request::setRequest(const char *commandInput, const char *fileInput,
+                             const char *hostInput)
+    {
+        if (id == 0)
+        {
+            return;
+        }
+
+        copyName(command, commandInput, sizeof command);
+        copyName(file, fileInput, NAME_LEN);
+        copyName(host, hostInput, NAME_LEN);
+    }
+
+    void Request::setChunks(int minSize, int maxSize, int lastSize,
+                            int resizes)
+    {
+        chunkMin = minSize;
+        chunkMax = maxSize;
+        chunkLast = lastSize;
+        chunkResizes = resizes;
+    }
+
+    void Request::setPlacement(int cpuInput, int nodeInput, int nicCpuInput,
+                               int bufNodeInput)
+    {
+        placed = true;
+        cpu = cpuInput;
+        node = nodeInput;
+        nicCpu = nicCpuInput;
+        bufNode = bufNodeInput;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: mark()
+     *
+     *    Entry: The phase being entered
+     *
+     *     Exit: The time since the last change is added to the current
+     *           phase and phase becomes current
+     *
+     *  Purpose: Record a phase change of a traced request
+     *
+     *
+     *   *   *   *   *   *   */
+    void Request::mark(Phase phase)
+    {
+        if (phase == cur)
+        {
+            return;
+        }
+
+        long long now = monoNs();
+        totalNs[cur] += now - phaseNs;
+        phaseNs = now;
+        cur = phase;
+
+        if (count[phase] == 0)
+        {
+            firstNs[phase] = now;
+        }
+        count[phase]++;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: finish()
+     *
+     *    Entry: None
+     *
+     *     Exit: The record is appended to the trace file
+     *
+     *  Purpose: Write the request as a span with the total time and entry
+     *           count of each phase in its args, and a nested span for each
+     *           phase entered only once; Phases repeated for every chunk are
+     *           only summed, which keeps the record one small write
+     *
+     *
+     *   *   *   *   *   *   */
+    void Request::finish()
+    {
+        if (id == 0)
+        {
+            return;
+        }
+
+        long long now = monoNs();
+        totalNs[cur] += now - phaseNs;
+
+        char buf[RECORD_SIZE];
+        int len = 0;
+        int pid = getpid();
+
+        append(buf, &len, "{\"name\":\"%s", command[0] ? command : "?");
+        if (file[0])
+        {
+            append(buf, &len, " ");
+            appendString(buf, &len, file);
+        }
+        append(buf, &len, "\",\"cat\":\"request\",\"ph\":\"X\",\"ts\":%.3f,"
+               "\"dur\":%.3f,\"pid\":%d,\"tid\":%lld,\"args\":{\"host\":\"",
+               startNs / 1000.0, (now - startNs) / 1000.0, pid, id);
+        appendString(buf, &len, host);
+        append(buf, &len, "\",\"bytes\":%lld", sent);
+        if (chunkLast > 0)
+        {
+            append(buf, &len, ",\"chunk_min\":%d,\"chunk_max\":%d,"
+                   "\"chunk_last\":%d,\"chunk_resizes\":%d", chunkMin,
+                   chunkMax, chunkLast, chunkResizes);
+        }
+        if (placed)
+        {
+            append(buf, &len, ",\"cpu\":%d,\"node\":%d,\"nic_cpu\":%d,"
+                   "\"buf_node\":%d", cpu, node, nicCpu, bufNode);
+        }
+        for (int i = 0; i < TR_PHASES; i++)
+        {
+            if (count[i] > 0)
+            {
+                append(buf, &len, ",\"%s_us\":%.3f,\"%s_n\":%d",
+                       PHASE_NAMES[i], totalNs[i] / 1000.0, PHASE_NAMES[i],
+                       count[i]);
+            }
+        }
+        append(buf, &len, "}},\n");
+
+        // Phases entered once do not overlap, so they nest as spans
+        for (int i = TR_WORK + 1; i < TR_PHASES; i++)
+        {
+            if (count[i] == 1)
+            {
+                append(buf, &len, "{\"name\":\"%s\",\"cat\":\"phase\","
+                       "\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,"
+                       "\"tid\":%lld},\n", PHASE_NAMES[i],
+                       firstNs[i] / 1000.0, totalNs[i] / 1000.0, pid, id);
+            }
+        }
+
+        if (write(traceFd, buf, len) != len)
+        {
+            perror("Trace write");
+        }
+        id = 0;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: monoNs()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns the monotonic clock in nanoseconds
+     *
+     *  Purpose: Time phases without wall clock jumps
+     *
+     *
+     *   *   *   *   *   *   */
+    static long long monoNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec * 1000000000LL + ts.tv_nsec);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: copyName()
+     *
+     *    Entry: The destination, the source string, and the destination size
+     *
+     *     Exit: The source is copied and terminated, truncated if too long
+     *
+     *  Purpose: Keep a name in the record without allocating
+     *
+     *
+     *   *   *   *   *   *   */
+    static void copyName(char *dst, const char *src, int size)
+    {
+        strncpy(dst, src, size - 1);
+        dst[size - 1] = '\0';
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: append()
+     *
+     *    Entry: The record buffer, its length so far, and a printf format
+     *           with its arguments
+     *
+     *     Exit: The text is added and the length updated; Text that does
+     *           not fit is dropped
+     *
+     *  Purpose: Build the record in a fixed buffer
+     *
+     *
+     *   *   *   *   *   *   */
+    static void append(char *buf, int *len, const char *fmt, ...)
+    {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf + *len, RECORD_SIZE - *len, fmt, args);
+        va_end(args);
+
+        if (n > 0 && *len + n < RECORD_SIZE)
+        {
+            *len += n;
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: appendString()
+     *
+     *    Entry: The record buffer, its length so far, and a string
+     *
+     *     Exit: The string is added with JSON escapes
+     *
+     *  Purpose: Keep client supplied names from breaking the JSON
+     *
+     *
+     *   *   *   *   *   *   */
+    static void appendString(char *buf, int *len, const char *str)
+    {
+        for (const unsigned char *p = (const unsigned char *)str; *p; p++)
+        {
+            if (*p == '"' || *p == '\\')
+            {
+                append(buf, len, "\\%c", *p);
+            }
+            else if (*p < 0x20)
+            {
+                append(buf, len, "\\u%04x", *p);
+            }
+            else
+            {
+                append(buf, len, "%c", *p);
+            }
+        }
+    }
+} // FtTrace
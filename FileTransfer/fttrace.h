@@ -0,0 +1,135 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: fttrace.h
+ *           Overview: This is the header file for the ftserve request tracer.
+ *                     A Request records how long a request spends in each
+ *                     phase with the monotonic clock and, when it finishes,
+ *                     appends one record to a Chrome trace-event JSON file
+ *                     that chrome://tracing and Perfetto can open. Only one
+ *                     request in every sampleEvery is traced; An untraced
+ *                     request costs one branch per phase change
+ *              Input: None
+ *             Output: The trace file
+ *
+ *
+ */
+
+#ifndef FTTRACE_H
+#define FTTRACE_H
+
+namespace FtTrace
+{
+    /*
+     * Phases of a traced request; The time between phase changes is added
+     * to the phase entered last
+     */
+    enum Phase
+    {
+        TR_WORK = 0,
+        TR_REVERSE_LOOKUP,
+        TR_CMD_READ,
+        TR_BUILD_DIR,
+        TR_READY_WAIT,
+        TR_RESOLVE,
+        TR_DATA_CONNECT,
+        TR_DISK_READ,
+        TR_RATE_WAIT,
+        TR_SEND,
+        TR_ACK_WAIT,
+        TR_PHASES
+    };
+
+    /*
+     * The initTrace() function opens the trace file and sets the sampling
+     * interval; Returns false if the file cannot be opened
+     */
+    bool initTrace(const char *path, int sampleEvery);
+
+    /*
+     * The sample() function is called once per request before it starts;
+     * Returns the id for the trace of the request, or 0 if it is not traced
+     */
+    long long sample();
+
+    /*
+     * Class for the trace record of one request
+     */
+    class Request
+    {
+    public:
+        Request();
+
+        void start(long long idInput);
+        /*
+         * Starts the record with an id from sample(); An id of 0 leaves the
+         * request untraced
+         */
+
+        void setRequest(const char *command, const char *file,
+                        const char *host);
+        /*
+         * Names the request in the record
+         */
+
+        void enter(Phase phase)
+        {
+            if (id != 0)
+            {
+                mark(phase);
+            }
+        }
+        /*
+         * Ends the current phase and starts phase
+         */
+
+        void addBytes(long long bytes)
+        {
+            sent += bytes;
+        }
+
+        void setChunks(int minSize, int maxSize, int lastSize, int resizes);
+        /*
+         * Records the chunk sizes a file transfer used
+         */
+
+        void setPlacement(int cpuInput, int nodeInput, int nicCpuInput,
+                          int bufNodeInput);
+        /*
+         * Records the CPU and node the request ran on, the CPU that
+         * received its packets, and the node of its buffer
+         */
+
+        void finish();
+        /*
+         * Appends the record to the trace file; Later calls do nothing
+         */
+    private:
+        static const int NAME_LEN = 256; // Longest file or host name kept
+
+        long long id;
+        long long startNs;
+        long long phaseNs;
+        Phase     cur;
+        long long sent;
+        int       chunkMin;
+        int       chunkMax;
+        int       chunkLast;
+        int       chunkResizes;
+        bool      placed;
+        int       cpu;
+        int       node;
+        int       nicCpu;
+        int       bufNode;
+        long long firstNs[TR_PHASES];
+        long long totalNs[TR_PHASES];
+        int       count[TR_PHASES];
+        char      command[8];
+        char      file[NAME_LEN];
+        char      host[NAME_LEN];
+
+        void mark(Phase phase);
+    };
+} // FtTrace
+#endif // FTTRACE_H
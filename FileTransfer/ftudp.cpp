@@ -0,0 +1,946 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftudp.cpp
+ *           Overview: This is the implementation file for the UDP bulk
+ *                     transfer mode
+ *
+ *                     A datagram is "FTU1", 4 reserved bytes, the packet
+ *                     number and the file size as big-endian 64 bit values,
+ *                     and PAYLOAD_SIZE bytes of the file, fewer in the last
+ *                     packet. The rate starts low and doubles every interval
+ *                     until the first interval that loses more than
+ *                     LOSS_LIMIT over the base loss, then grows by a
+ *                     sixteenth per clean interval and loses a quarter per
+ *                     lossy one. The base loss is the average loss of every
+ *                     interval, up to MAX_BASE_LOSS, so a link that drops
+ *                     packets at any rate does not hold the rate at its
+ *                     floor, while a cut that ends a burst of loss keeps it
+ *                     from raising the base much
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <endian.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include "ftudp.h"
+
+namespace FtUdp
+{
+    const char      MAGIC[4]      = {'F', 'T', 'U', '1'};
+    const double    START_RATE    = 4.0 * 1024 * 1024; // Bytes per second
+    const double    MIN_RATE      = 256.0 * 1024; // Lowest rate after cuts
+    const long long INTERVAL_US   = 20000; // Rate adjustment interval
+    const long long MAX_WAIT_US   = 200000; // Longest wait for a sample
+    const int       MIN_SAMPLE    = 100; // Packets to judge loss on
+    const long long PACE_US       = 1000; // Sending saved up between sends
+    const long long MAX_BURST_US  = 10000; // Unsent rate that may be saved
+    const double    LOSS_LIMIT    = 0.05; // Loss over the base that cuts
+    const double    MAX_BASE_LOSS = 0.25; // Most loss taken as the link's
+    const int       MAX_LINE      = 4096; // Longest control line
+    const int       MAX_RESEND    = 65536; // Ranges queued to resend
+    const int       LINE_RANGES   = 32; // Ranges per "nack" line
+    const int       MAX_RANGES    = 1024; // Ranges per takeNack() call
+    const int       RECV_BATCH    = 64; // Datagrams per recvmmsg()
+    const int       SOCK_BUF      = 4 * 1024 * 1024; // Socket buffer wanted
+
+    /*
+     * Helpers local to this file
+     */
+    static long long payloadLen(long long num, long long size);
+    static bool hasPacket(const std::vector<unsigned char> &bits,
+                          long long num);
+
+    long long packetCount(long long size)
+    {
+        return (size <= 0 ? 1 : (size + PAYLOAD_SIZE - 1) / PAYLOAD_SIZE);
+    }
+
+    long long monoUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec * 1000000LL + ts.tv_nsec / 1000);
+    }
+
+    Sender::Sender(int sockInput, int fdInput, long long baseInput,
+                   long long sizeInput, long long maxRateInput)
+        : sock(sockInput), fd(fdInput), base(baseInput), size(sizeInput),
+          packets(packetCount(sizeInput)), next(0), maxRate(maxRateInput),
+          rate(START_RATE), tokens(0), lastUs(-1), intervalUs(-1),
+          intervalSent(0), intervalLost(0), baseLoss(0), slowStart(true),
+          gso(false),
+          resent(0), buf(BATCH * DATAGRAM_SIZE)
+    {
+#ifdef UDP_SEGMENT
+        gso = true;
+#endif
+        if (maxRate > 0 && rate > maxRate)
+        {
+            rate = maxRate;
+        }
+
+        // A batch saved up over a loop tick must fit in the socket
+        int bufSize = SOCK_BUF;
+        setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof bufSize);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: pump()
+     *
+     *    Entry: The monotonic clock in microseconds
+     *
+     *     Exit: Returns the bytes sent, or -1 with errno set
+     *
+     *  Purpose: Spend the bytes the rate has allowed since the last call,
+     *           one batch at a time; Packets the socket could not take are
+     *           sent first next time
+     *
+     *
+     *   *   *   *   *   *   */
+    int Sender::pump(long long nowUs)
+    {
+        if (lastUs < 0)
+        {
+            lastUs = nowUs;
+            intervalUs = nowUs;
+            tokens = DATAGRAM_SIZE;
+        }
+        tokens += rate * (nowUs - lastUs) / 1000000.0;
+        lastUs = nowUs;
+        double cap = std::max(double(BATCH * DATAGRAM_SIZE),
+                              rate * MAX_BURST_US / 1000000.0);
+        tokens = std::min(tokens, cap);
+        adjustRate(nowUs);
+
+        long long nums[BATCH];
+        int total = 0;
+        while (tokens >= DATAGRAM_SIZE)
+        {
+            int fromResend = 0;
+            int want = std::min(BATCH, int(tokens / DATAGRAM_SIZE));
+            int count = fill(nums, want, &fromResend);
+            if (count == 0)
+            {
+                break;
+            }
+
+            int sent = sendBatch(nums, count);
+            if (sent == -1)
+            {
+                return (-1);
+            }
+            if (sent < count)
+            {
+                requeue(nums + sent, count - sent);
+            }
+            resent += std::min(sent, fromResend);
+            intervalSent += sent;
+            tokens -= double(sent) * DATAGRAM_SIZE;
+            total += sent * DATAGRAM_SIZE;
+
+            // A full socket buffer sends the rest next time
+            if (sent < count)
+            {
+                break;
+            }
+        }
+
+        return (total);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: feed()
+     *
+     *    Entry: Bytes read from the control connection
+     *
+     *     Exit: Returns FEED_DONE once the receiver sends "done", FEED_BAD
+     *           for a line that is not understood, or FEED_MORE
+     *
+     *  Purpose: Split the control stream into lines; A line may arrive in
+     *           pieces, so the partial one is kept
+     *
+     *
+     *   *   *   *   *   *   */
+    Feed Sender::feed(const char *data, int len)
+    {
+        line.append(data, len);
+
+        std::size_t start = 0;
+        std::size_t end;
+        while ((end = line.find('\n', start)) != std::string::npos)
+        {
+            const char *cur = line.data() + start;
+            const char *lineEnd = line.data() + end;
+            start = end + 1;
+
+            if (lineEnd - cur == 4 && memcmp(cur, "done", 4) == 0)
+            {
+                return (FEED_DONE);
+            }
+            if (lineEnd - cur < 4 || memcmp(cur, "nack", 4) != 0
+                || !parseNack(cur + 4, lineEnd))
+            {
+                return (FEED_BAD);
+            }
+        }
+        line.erase(0, start);
+
+        return (line.size() > std::size_t(MAX_LINE) ? FEED_BAD : FEED_MORE);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: waitUs()
+     *
+     *    Entry: The monotonic clock in microseconds
+     *
+     *     Exit: Returns the microseconds until a batch can be sent, or -1 if
+     *           nothing is left to send
+     *
+     *  Purpose: Let the caller sleep between batches instead of spinning;
+     *           A slow sender sends smaller batches, so the receiver never
+     *           waits long enough to think the transfer stalled
+     *
+     *
+     *   *   *   *   *   *   */
+    long long Sender::waitUs(long long nowUs) const
+    {
+        if (next >= packets && resend.empty())
+        {
+            return (-1);
+        }
+        if (lastUs < 0)
+        {
+            return (0);
+        }
+
+        // A batch at a time, but no less often than every PACE_US
+        double want = std::min(double(BATCH * DATAGRAM_SIZE),
+                               std::max(double(DATAGRAM_SIZE),
+                                        rate * PACE_US / 1000000.0));
+        double need = want - tokens - rate * (nowUs - lastUs) / 1000000.0;
+        return (need <= 0 ? 0 : (long long)(need / rate * 1000000.0) + 1);
+    }
+
+    long long Sender::getRate() const
+    {
+        return ((long long)rate);
+    }
+
+    long long Sender::getResent() const
+    {
+        return (resent);
+    }
+
+    bool Sender::usedGso() const
+    {
+        return (gso);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: fill()
+     *
+     *    Entry: An array for up to max packet numbers and a pointer for how
+     *           many of them are resends
+     *
+     *     Exit: Returns the packets to send next, resends first
+     *
+     *  Purpose: Choose a batch; The short last packet ends a batch, since
+     *           only the last segment of a GSO send may be short
+     *
+     *
+     *   *   *   *   *   *   */
+    int Sender::fill(long long *nums, int max, int *fromResend)
+    {
+        int count = 0;
+        while (count < max && (!resend.empty() || next < packets))
+        {
+            long long num;
+            if (!resend.empty())
+            {
+                num = resend.front().first;
+                if (resend.front().first == resend.front().second)
+                {
+                    resend.pop_front();
+                }
+                else
+                {
+                    resend.front().first++;
+                }
+                (*fromResend)++;
+            }
+            else
+            {
+                num = next++;
+            }
+            nums[count++] = num;
+
+            if (payloadLen(num, size) < PAYLOAD_SIZE)
+            {
+                break;
+            }
+        }
+
+        return (count);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: sendBatch()
+     *
+     *    Entry: The packet numbers to send and their count
+     *
+     *     Exit: Returns the packets the socket took, or -1 with errno set
+     *
+     *  Purpose: Lay the datagrams out back to back in one buffer, reading
+     *           each run of consecutive packets with one preadv(), and send
+     *           them with one GSO sendmsg(), or one sendmmsg() without GSO
+     *
+     *
+     *   *   *   *   *   *   */
+    int Sender::sendBatch(const long long *nums, int count)
+    {
+        struct iovec iov[BATCH];
+        int total = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            char *dgram = buf.data() + i * DATAGRAM_SIZE;
+            unsigned long long num = htobe64(nums[i]);
+            unsigned long long fileSize = htobe64(size);
+            memcpy(dgram, MAGIC, sizeof MAGIC);
+            memset(dgram + 4, 0, 4);
+            memcpy(dgram + 8, &num, 8);
+            memcpy(dgram + 16, &fileSize, 8);
+
+            iov[i].iov_base = dgram + HEADER_SIZE;
+            iov[i].iov_len = payloadLen(nums[i], size);
+            total += HEADER_SIZE + iov[i].iov_len;
+        }
+
+        // One read per run of consecutive packets
+        for (int i = 0; i < count; )
+        {
+            int j = i + 1;
+            long long want = iov[i].iov_len;
+            while (j < count && nums[j] == nums[j - 1] + 1)
+            {
+                want += iov[j].iov_len;
+                j++;
+            }
+
+            ssize_t n = 0;
+            if (want > 0)
+            {
+                n = preadv(fd, iov + i, j - i,
+                           base + nums[i] * PAYLOAD_SIZE);
+                if (n == -1)
+                {
+                    return (-1);
+                }
+            }
+
+            // A file cut short while it is sent reads as zeros
+            for (int k = i; k < j; k++)
+            {
+                long long got = std::min<long long>(n, iov[k].iov_len);
+                memset((char *)iov[k].iov_base + got, 0,
+                       iov[k].iov_len - got);
+                n -= got;
+            }
+            i = j;
+        }
+
+#ifdef UDP_SEGMENT
+        if (gso && count > 1)
+        {
+            struct iovec whole;
+            whole.iov_base = buf.data();
+            whole.iov_len = total;
+
+            char control[CMSG_SPACE(sizeof(unsigned short))];
+            memset(control, 0, sizeof control);
+            struct msghdr msg;
+            memset(&msg, 0, sizeof msg);
+            msg.msg_iov = &whole;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof control;
+
+            struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(unsigned short));
+            unsigned short segment = DATAGRAM_SIZE;
+            memcpy(CMSG_DATA(cm), &segment, sizeof segment);
+
+            if (sendmsg(sock, &msg, 0) != -1)
+            {
+                return (count);
+            }
+            if (errno == EAGAIN || errno == ENOBUFS)
+            {
+                return (0);
+            }
+            if (errno != EIO && errno != EINVAL && errno != ENOPROTOOPT
+                && errno != EOPNOTSUPP)
+            {
+                return (-1);
+            }
+
+            // The kernel or the route cannot segment; Stop trying
+            gso = false;
+        }
+#endif
+
+        struct iovec dgramIov[BATCH];
+        struct mmsghdr msgs[BATCH];
+        memset(msgs, 0, sizeof msgs);
+        for (int i = 0; i < count; i++)
+        {
+            dgramIov[i].iov_base = buf.data() + i * DATAGRAM_SIZE;
+            dgramIov[i].iov_len = HEADER_SIZE + iov[i].iov_len;
+            msgs[i].msg_hdr.msg_iov = &dgramIov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int sent = sendmmsg(sock, msgs, count, 0);
+        if (sent == -1)
+        {
+            return (errno == EAGAIN || errno == ENOBUFS ? 0 : -1);
+        }
+
+        return (sent);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: requeue()
+     *
+     *    Entry: The packets of a batch the socket did not take
+     *
+     *     Exit: They are the next packets fill() returns, in order
+     *
+     *  Purpose: New packets at the end of the batch are unsent by moving
+     *           next back; Resends go back on the front of the queue
+     *
+     *
+     *   *   *   *   *   *   */
+    void Sender::requeue(const long long *nums, int count)
+    {
+        for (int i = count - 1; i >= 0; i--)
+        {
+            if (nums[i] == next - 1)
+            {
+                next--;
+            }
+            else
+            {
+                resend.push_front(std::make_pair(nums[i], nums[i]));
+            }
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: parseNack()
+     *
+     *    Entry: The rest of a "nack" line after the word
+     *
+     *     Exit: Returns false if a range is malformed or past the file
+     *
+     *  Purpose: Queue each "first" or "first-last" range to resend and
+     *           count it as loss for the rate; Packets not sent yet are
+     *           going to be sent anyway, so they are neither
+     *
+     *
+     *   *   *   *   *   *   */
+    bool Sender::parseNack(const char *cur, const char *end)
+    {
+        while (cur < end)
+        {
+            if (*cur == ' ')
+            {
+                cur++;
+                continue;
+            }
+
+            char *stop;
+            long long first = strtoll(cur, &stop, 10);
+            long long last = first;
+            if (stop == cur)
+            {
+                return (false);
+            }
+            cur = stop;
+            if (cur < end && *cur == '-')
+            {
+                last = strtoll(cur + 1, &stop, 10);
+                if (stop == cur + 1)
+                {
+                    return (false);
+                }
+                cur = stop;
+            }
+            if (cur > end || first < 0 || last < first || last >= packets)
+            {
+                return (false);
+            }
+            if (first >= next)
+            {
+                continue;
+            }
+            last = std::min(last, next - 1);
+
+            // A receiver that falls far behind asks again later
+            if (resend.size() < std::size_t(MAX_RESEND))
+            {
+                resend.push_back(std::make_pair(first, last));
+            }
+            intervalLost += last - first + 1;
+        }
+
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: adjustRate()
+     *
+     *    Entry: The monotonic clock in microseconds
+     *
+     *     Exit: The rate is changed once per INTERVAL_US
+     *
+     *  Purpose: Cut the rate on loss above the base, and raise it only
+     *           when the last interval used at least half of it, so an idle
+     *           sender does not earn a rate it never tested
+     *
+     *
+     *   *   *   *   *   *   */
+    void Sender::adjustRate(long long nowUs)
+    {
+        // Too few packets make the loss fraction noise
+        long long elapsed = nowUs - intervalUs;
+        if (elapsed < INTERVAL_US
+            || (intervalSent < MIN_SAMPLE && elapsed < MAX_WAIT_US))
+        {
+            return;
+        }
+
+        double allowed = rate * elapsed / 1000000.0;
+        double sentBytes = double(intervalSent) * DATAGRAM_SIZE;
+        double loss = (intervalSent > 0 ? double(intervalLost) / intervalSent
+                                        : 0);
+        if (loss > baseLoss + LOSS_LIMIT)
+        {
+            rate *= 0.75;
+            slowStart = false;
+        }
+        else if (sentBytes * 2 >= allowed)
+        {
+            rate = (slowStart ? rate * 2 : rate + rate / 16);
+        }
+        if (intervalSent > 0)
+        {
+            baseLoss += (std::min(loss, MAX_BASE_LOSS) - baseLoss) / 8;
+        }
+
+        rate = std::max(rate, MIN_RATE);
+        if (maxRate > 0 && rate > maxRate)
+        {
+            rate = maxRate;
+        }
+        intervalUs = nowUs;
+        intervalSent = 0;
+        intervalLost = 0;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: Receiver()
+     *
+     *    Entry: The bound, non-blocking socket, the descriptor and offset
+     *           to write the file to, and the shim
+     *
+     *     Exit: Initializes the receiver; The file size is learned from the
+     *           first datagram
+     *
+     *  Purpose: Ask for a receive buffer that holds a burst of datagrams
+     *
+     *
+     *   *   *   *   *   *   */
+    Receiver::Receiver(int sockInput, int outFdInput, long long outOffInput,
+                       const Shim &shimInput)
+        : sock(sockInput), outFd(outFdInput), outOff(outOffInput),
+          shim(shimInput), size(-1), packets(0), stored(0), highest(-1),
+          duplicates(0), seed(time(NULL) ^ getpid()),
+          buf(RECV_BATCH * DATAGRAM_SIZE), runStart(0)
+    {
+        int bufSize = SOCK_BUF;
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof bufSize);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: poll()
+     *
+     *    Entry: The monotonic clock in microseconds
+     *
+     *     Exit: Returns the new packets stored, or -1 with errno set
+     *
+     *  Purpose: Drain the socket in batches, pass each datagram through the
+     *           shim, and store the held ones that are due
+     *
+     *
+     *   *   *   *   *   *   */
+    int Receiver::poll(long long nowUs)
+    {
+        long long before = stored;
+        struct iovec iov[RECV_BATCH];
+        struct mmsghdr msgs[RECV_BATCH];
+
+        while (1)
+        {
+            memset(msgs, 0, sizeof msgs);
+            for (int i = 0; i < RECV_BATCH; i++)
+            {
+                iov[i].iov_base = buf.data() + i * DATAGRAM_SIZE;
+                iov[i].iov_len = DATAGRAM_SIZE;
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int n = recvmmsg(sock, msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+            if (n == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    break;
+                }
+                return (-1);
+            }
+
+            for (int i = 0; i < n; i++)
+            {
+                const char *data = (const char *)iov[i].iov_base;
+                int len = msgs[i].msg_len;
+                if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+                {
+                    continue;
+                }
+                if (shim.lossRate > 0
+                    && rand_r(&seed) < shim.lossRate * RAND_MAX)
+                {
+                    continue;
+                }
+                if (shim.delayMs > 0)
+                {
+                    Held h;
+                    h.dueUs = nowUs + shim.delayMs * 1000LL;
+                    h.data.assign(data, data + len);
+                    held.push_back(h);
+                    continue;
+                }
+                if (!accept(data, len))
+                {
+                    return (-1);
+                }
+            }
+
+            // The run points into buf, which the next batch reuses
+            if (!flushRun())
+            {
+                return (-1);
+            }
+            if (n < RECV_BATCH)
+            {
+                break;
+            }
+        }
+
+        while (!held.empty() && held.front().dueUs <= nowUs)
+        {
+            const std::vector<char> &data = held.front().data;
+            if (!accept(data.data(), data.size()) || !flushRun())
+            {
+                return (-1);
+            }
+            held.pop_front();
+        }
+
+        return (stored - before);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: takeNack()
+     *
+     *    Entry: true for every missing packet, false for the new gaps, and
+     *           the string to append lines to
+     *
+     *     Exit: Returns true if lines were appended
+     *
+     *  Purpose: Gaps are reported as soon as a later packet shows them;
+     *           The caller asks for all missing packets when nothing has
+     *           arrived for a while, which covers a lost tail and lost
+     *           resends
+     *
+     *
+     *   *   *   *   *   *   */
+    bool Receiver::takeNack(bool all, std::string *out)
+    {
+        std::size_t before = out->size();
+        int ranges = 0;
+
+        if (packets == 0)
+        {
+            // Nothing has arrived; The first packet carries the size
+            if (all)
+            {
+                out->append("nack 0\n");
+            }
+            gaps.clear();
+            return (all);
+        }
+
+        if (all)
+        {
+            appendMissing(0, packets - 1, &ranges, out);
+        }
+        else
+        {
+            for (std::size_t i = 0; i < gaps.size(); i++)
+            {
+                appendMissing(gaps[i].first, gaps[i].second, &ranges, out);
+            }
+        }
+        gaps.clear();
+        if (ranges > 0)
+        {
+            out->push_back('\n');
+        }
+
+        return (out->size() > before);
+    }
+
+    bool Receiver::isComplete() const
+    {
+        return (packets > 0 && stored == packets);
+    }
+
+    long long Receiver::getSize() const
+    {
+        return (size);
+    }
+
+    long long Receiver::getDuplicates() const
+    {
+        return (duplicates);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: accept()
+     *
+     *    Entry: One datagram and its length
+     *
+     *     Exit: Returns false only if writing the file failed; Stray and
+     *           malformed datagrams are dropped
+     *
+     *  Purpose: Record a new packet and add its payload to the run of
+     *           consecutive packets written with one pwritev()
+     *
+     *
+     *   *   *   *   *   *   */
+    bool Receiver::accept(const char *data, int len)
+    {
+        if (len < HEADER_SIZE || memcmp(data, MAGIC, sizeof MAGIC) != 0)
+        {
+            return (true);
+        }
+
+        unsigned long long rawNum, rawSize;
+        memcpy(&rawNum, data + 8, 8);
+        memcpy(&rawSize, data + 16, 8);
+        long long num = be64toh(rawNum);
+        long long fileSize = be64toh(rawSize);
+
+        if (packets == 0 && fileSize >= 0)
+        {
+            size = fileSize;
+            packets = packetCount(size);
+            have.assign((packets + 7) / 8, 0);
+        }
+        if (fileSize != size || num < 0 || num >= packets
+            || len - HEADER_SIZE != payloadLen(num, size))
+        {
+            return (true);
+        }
+        if (hasPacket(have, num))
+        {
+            duplicates++;
+            return (true);
+        }
+        have[num / 8] |= (1 << (num % 8));
+        stored++;
+
+        if (num > highest + 1)
+        {
+            gaps.push_back(std::make_pair(highest + 1, num - 1));
+        }
+        highest = std::max(highest, num);
+
+        if (len == HEADER_SIZE)
+        {
+            return (true);
+        }
+        if (!run.empty() && (num != runStart + (long long)run.size()
+                             || run.size() == std::size_t(RECV_BATCH)))
+        {
+            if (!flushRun())
+            {
+                return (false);
+            }
+        }
+        if (run.empty())
+        {
+            runStart = num;
+        }
+        struct iovec v;
+        v.iov_base = (void *)(data + HEADER_SIZE);
+        v.iov_len = len - HEADER_SIZE;
+        run.push_back(v);
+
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: flushRun()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns false with errno set if the write failed
+     *
+     *  Purpose: Write the run of consecutive payloads at their offset
+     *
+     *
+     *   *   *   *   *   *   */
+    bool Receiver::flushRun()
+    {
+        std::size_t first = 0;
+        long long off = outOff + runStart * PAYLOAD_SIZE;
+
+        while (first < run.size())
+        {
+            ssize_t n = pwritev(outFd, run.data() + first,
+                                run.size() - first, off);
+            if (n == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return (false);
+            }
+            off += n;
+
+            // Skip what a short write finished
+            while (first < run.size() && std::size_t(n) >= run[first].iov_len)
+            {
+                n -= run[first].iov_len;
+                first++;
+            }
+            if (first < run.size())
+            {
+                run[first].iov_base = (char *)run[first].iov_base + n;
+                run[first].iov_len -= n;
+            }
+        }
+        run.clear();
+
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: appendMissing()
+     *
+     *    Entry: The first and last packet to look at, the ranges appended
+     *           so far, and the string to append to
+     *
+     *     Exit: Each missing range in [from, to] is appended, up to
+     *           MAX_RANGES in all
+     *
+     *  Purpose: Write "nack" lines of LINE_RANGES ranges each
+     *
+     *
+     *   *   *   *   *   *   */
+    void Receiver::appendMissing(long long from, long long to, int *ranges,
+                                 std::string *out)
+    {
+        long long num = from;
+        while (num <= to && *ranges < MAX_RANGES)
+        {
+            if (hasPacket(have, num))
+            {
+                num++;
+                continue;
+            }
+
+            long long last = num;
+            while (last < to && !hasPacket(have, last + 1))
+            {
+                last++;
+            }
+
+            if (*ranges % LINE_RANGES == 0)
+            {
+                if (*ranges > 0)
+                {
+                    out->push_back('\n');
+                }
+                out->append("nack");
+            }
+            out->push_back(' ');
+            out->append(std::to_string(num));
+            if (last > num)
+            {
+                out->push_back('-');
+                out->append(std::to_string(last));
+            }
+            (*ranges)++;
+            num = last + 1;
+        }
+    }
+
+    static long long payloadLen(long long num, long long size)
+    {
+        return (std::min<long long>(PAYLOAD_SIZE, size - num * PAYLOAD_SIZE));
+    }
+
+    static bool hasPacket(const std::vector<unsigned char> &bits,
+                          long long num)
+    {
+        return ((bits[num / 8] & (1 << (num % 8))) != 0);
+    }
+} // FtUdp
@@ -0,0 +1,200 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftudp.h
+ *           Overview: This is the header file for the UDP bulk transfer
+ *                     mode. The control connection stays TCP; Only the file
+ *                     data moves to UDP datagrams, each carrying its packet
+ *                     number and the file size. The Sender paces datagrams
+ *                     at a rate it raises while no loss is reported and cuts
+ *                     when the Receiver reports gaps, and resends the packets
+ *                     the Receiver names in "nack" lines on the control
+ *                     connection until the Receiver sends "done"
+ *
+ *                     Datagrams are sent in batches, with UDP GSO when the
+ *                     kernel has it and sendmmsg() when it does not, and are
+ *                     received with recvmmsg()
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTUDP_H
+#define FTUDP_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+
+namespace FtUdp
+{
+    const int HEADER_SIZE   = 24; // Magic, packet number, and file size
+    const int PAYLOAD_SIZE  = 1448; // Fills a 1500 byte MTU over IPv4
+    const int DATAGRAM_SIZE = HEADER_SIZE + PAYLOAD_SIZE;
+    const int BATCH         = 32; // Datagrams per system call
+
+    /*
+     * The packetCount() function returns the packets of a file of size
+     * bytes; An empty file is one empty packet, so its size still arrives
+     */
+    long long packetCount(long long size);
+
+    /*
+     * The monoUs() function returns the monotonic clock in microseconds
+     */
+    long long monoUs();
+
+    /*
+     * Outcomes of Sender::feed()
+     */
+    enum Feed
+    {
+        FEED_MORE = 0,
+        FEED_DONE,
+        FEED_BAD
+    };
+
+    /*
+     * Class for the sending side of one transfer; The caller owns the
+     * socket and the file, calls pump() whenever waitUs() has passed, and
+     * passes everything read from the control connection to feed()
+     */
+    class Sender
+    {
+    public:
+        Sender(int sockInput, int fdInput, long long baseInput,
+               long long sizeInput, long long maxRateInput);
+        /*
+         * Initializes a sender of the sizeInput bytes at baseInput in
+         * fdInput over the connected, non-blocking sockInput; A
+         * maxRateInput of 0 leaves the rate unlimited
+         */
+
+        int pump(long long nowUs);
+        /*
+         * Sends the datagrams the rate allows now; Returns the bytes sent,
+         * or -1 with errno set if the socket or the file failed
+         */
+
+        Feed feed(const char *data, int len);
+        /*
+         * Takes control connection bytes; Each whole "nack" line queues its
+         * packets to be sent again
+         */
+
+        long long waitUs(long long nowUs) const;
+        /*
+         * Returns how long until pump() can send again, or -1 if every
+         * packet is sent and none is waiting to be resent
+         */
+
+        long long getRate() const;
+        long long getResent() const;
+        bool usedGso() const;
+    private:
+        int                                         sock;
+        int                                         fd;
+        long long                                   base;
+        long long                                   size;
+        long long                                   packets;
+        long long                                   next;
+        long long                                   maxRate;
+        double                                      rate;
+        double                                      tokens;
+        long long                                   lastUs;
+        long long                                   intervalUs;
+        long long                                   intervalSent;
+        long long                                   intervalLost;
+        double                                      baseLoss;
+        bool                                        slowStart;
+        bool                                        gso;
+        long long                                   resent;
+        std::deque< std::pair<long long, long long> > resend;
+        std::string                                 line;
+        std::vector<char>                           buf;
+
+        int fill(long long *nums, int max, int *fromResend);
+        int sendBatch(const long long *nums, int count);
+        void requeue(const long long *nums, int count);
+        bool parseNack(const char *cur, const char *end);
+        void adjustRate(long long nowUs);
+    };
+
+    /*
+     * Structure for the receive shim; Datagrams are dropped with
+     * probability lossRate and the rest held back for delayMs, so loss and
+     * latency can be tested on loopback
+     */
+    struct Shim
+    {
+        double lossRate;
+        int    delayMs;
+    };
+
+    /*
+     * Class for the receiving side of one transfer; The caller calls
+     * poll() when the socket is readable or a timer passes, and sends the
+     * lines from takeNack() on the control connection
+     */
+    class Receiver
+    {
+    public:
+        Receiver(int sockInput, int outFdInput, long long outOffInput,
+                 const Shim &shimInput);
+        /*
+         * Initializes a receiver writing to outFdInput from outOffInput
+         */
+
+        int poll(long long nowUs);
+        /*
+         * Receives every waiting datagram; Returns the new packets stored,
+         * or -1 with errno set
+         */
+
+        bool takeNack(bool all, std::string *out);
+        /*
+         * Appends "nack" lines to out for the gaps seen since the last
+         * call, or with all for every packet still missing; Returns true
+         * if anything was appended
+         */
+
+        bool isComplete() const;
+        long long getSize() const;
+        long long getDuplicates() const;
+    private:
+        /*
+         * A datagram held back by the shim
+         */
+        struct Held
+        {
+            long long         dueUs;
+            std::vector<char> data;
+        };
+
+        int                                         sock;
+        int                                         outFd;
+        long long                                   outOff;
+        Shim                                        shim;
+        long long                                   size;
+        long long                                   packets;
+        long long                                   stored;
+        long long                                   highest;
+        long long                                   duplicates;
+        unsigned                                    seed;
+        std::vector<unsigned char>                  have;
+        std::vector< std::pair<long long, long long> > gaps;
+        std::deque<Held>                            held;
+        std::vector<char>                           buf;
+        long long                                   runStart;
+        std::vector<struct iovec>                   run;
+
+        bool accept(const char *data, int len);
+        bool flushRun();
+        void appendMissing(long long from, long long to, int *ranges,
+                           std::string *out);
+    };
+} // FtUdp
+#endif // FTUDP_H
@@ -0,0 +1,285 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftunix.cpp
+ *           Overview: This is the implementation file for the ftserve Unix
+ *                     domain socket helpers
+ *
+ *                     Adapted from the SCM_RIGHTS example in the cmsg(3) and
+ *                     unix(7) man pages
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "ftunix.h"
+
+namespace FtUnix
+{
+    /*
+     * Helpers local to this file
+     */
+    static bool fillAddr(const char *path, struct sockaddr_un *addr);
+    static bool clearStale(const char *path, bool replaceLive);
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: unixListen()
+     *
+     *    Entry: The socket path, the listen backlog, and whether a live
+     *           socket at path may be replaced, as in a takeover
+     *
+     *     Exit: Returns the listening socket fd or -1 on error
+     *
+     *  Purpose: Open a Unix stream listener at path
+     *
+     *
+     *   *   *   *   *   *   */
+    int unixListen(const char *path, int backlog, bool replaceLive)
+    {
+        struct sockaddr_un addr;
+        if (!fillAddr(path, &addr))
+        {
+            return (-1);
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+        {
+            return (-1);
+        }
+
+        // A socket file left by a previous server would make bind() fail
+        if (!clearStale(path, replaceLive))
+        {
+            int err = errno;
+            close(fd);
+            errno = err;
+            return (-1);
+        }
+
+        if (bind(fd, (struct sockaddr *)&addr, sizeof addr) == -1
+            || listen(fd, backlog) == -1)
+        {
+            close(fd);
+            return (-1);
+        }
+
+        return (fd);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: unixConnect()
+     *
+     *    Entry: The socket path
+     *
+     *     Exit: Returns the connected socket fd or -1 on error
+     *
+     *  Purpose: Connect to a Unix stream listener at path
+     *
+     *
+     *   *   *   *   *   *   */
+    int unixConnect(const char *path)
+    {
+        struct sockaddr_un addr;
+        if (!fillAddr(path, &addr))
+        {
+            return (-1);
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+        {
+            return (-1);
+        }
+
+        if (connect(fd, (struct sockaddr *)&addr, sizeof addr) == -1)
+        {
+            close(fd);
+            return (-1);
+        }
+
+        return (fd);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: sendFd()
+     *
+     *    Entry: The Unix socket, the descriptor to pass, and the message to
+     *           carry it; At least one byte of message is required
+     *
+     *     Exit: Returns 0 on success or -1 on error
+     *
+     *  Purpose: Pass an open descriptor to the peer process
+     *
+     *
+     *   *   *   *   *   *   */
+    int sendFd(int sock, int fd, const void *msg, int msgLen)
+    {
+        struct msghdr mh;
+        struct iovec iov;
+        union
+        {
+            char           buf[CMSG_SPACE(sizeof(int))];
+            struct cmsghdr align;
+        } ctl;
+
+        memset(&mh, 0, sizeof mh);
+        memset(&ctl, 0, sizeof ctl);
+        iov.iov_base = const_cast<void *>(msg);
+        iov.iov_len = msgLen;
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = ctl.buf;
+        mh.msg_controllen = sizeof ctl.buf;
+
+        struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+
+        if (sendmsg(sock, &mh, MSG_NOSIGNAL) != msgLen)
+        {
+            return (-1);
+        }
+
+        return (0);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: recvFd()
+     *
+     *    Entry: The Unix socket, a buffer and its length, and an int pointer
+     *           for the received descriptor
+     *
+     *     Exit: Returns the bytes received, 0 on close, or -1 on error; fd is
+     *           set to the passed descriptor or -1
+     *
+     *  Purpose: Receive a message and any descriptor passed with it
+     *
+     *
+     *   *   *   *   *   *   */
+    int recvFd(int sock, void *msg, int msgLen, int *fd)
+    {
+        struct msghdr mh;
+        struct iovec iov;
+        union
+        {
+            char           buf[CMSG_SPACE(sizeof(int))];
+            struct cmsghdr align;
+        } ctl;
+
+        *fd = -1;
+        memset(&mh, 0, sizeof mh);
+        iov.iov_base = msg;
+        iov.iov_len = msgLen;
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = ctl.buf;
+        mh.msg_controllen = sizeof ctl.buf;
+
+        int len = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC);
+        if (len <= 0)
+        {
+            return (len);
+        }
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&mh); cm != NULL;
+             cm = CMSG_NXTHDR(&mh, cm))
+        {
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS)
+            {
+                memcpy(fd, CMSG_DATA(cm), sizeof(int));
+            }
+        }
+
+        return (len);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: fillAddr()
+     *
+     *    Entry: The socket path and the address struct to fill
+     *
+     *     Exit: Returns false if the path does not fit in sun_path
+     *
+     *  Purpose: Build a Unix socket address
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool fillAddr(const char *path, struct sockaddr_un *addr)
+    {
+        memset(addr, 0, sizeof(struct sockaddr_un));
+        addr->sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof addr->sun_path)
+        {
+            return (false);
+        }
+        strcpy(addr->sun_path, path);
+
+        return (true);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: clearStale()
+     *
+     *    Entry: The socket path and whether a live socket may be replaced
+     *
+     *     Exit: Returns true if nothing is left at path; Otherwise false,
+     *           with errno EEXIST for a file that is not a socket and
+     *           EADDRINUSE for a socket a server is listening on
+     *
+     *  Purpose: Remove only a socket file whose server has gone, so a typo
+     *           in a path cannot delete a file and a second server cannot
+     *           steal the first one's socket
+     *
+     *
+     *   *   *   *   *   *   */
+    static bool clearStale(const char *path, bool replaceLive)
+    {
+        struct stat st;
+        if (lstat(path, &st) == -1)
+        {
+            return (errno == ENOENT);
+        }
+
+        if (!S_ISSOCK(st.st_mode))
+        {
+            errno = EEXIST;
+            return (false);
+        }
+
+        // Only a refused connection shows the socket has no listener
+        if (!replaceLive)
+        {
+            int fd = unixConnect(path);
+            if (fd != -1)
+            {
+                close(fd);
+                errno = EADDRINUSE;
+                return (false);
+            }
+            if (errno != ECONNREFUSED)
+            {
+                return (false);
+            }
+        }
+
+        return (unlink(path) == 0 || errno == ENOENT);
+    }
+} // FtUnix
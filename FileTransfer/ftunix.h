@@ -0,0 +1,47 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftunix.h
+ *           Overview: This is the header file for the ftserve Unix domain
+ *                     socket helpers. They open and connect Unix stream
+ *                     sockets and pass open file descriptors between
+ *                     processes with SCM_RIGHTS
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTUNIX_H
+#define FTUNIX_H
+
+namespace FtUnix
+{
+    /*
+     * The unixListen() function binds a Unix stream socket to path and
+     * listens on it; A socket file nobody listens on is replaced, and a live
+     * one only if replaceLive is set; Returns the fd or -1 with errno set
+     */
+    int unixListen(const char *path, int backlog, bool replaceLive);
+
+    /*
+     * The unixConnect() function connects a Unix stream socket to path;
+     * Returns the fd or -1
+     */
+    int unixConnect(const char *path);
+
+    /*
+     * The sendFd() function sends msgLen bytes of msg with the descriptor fd
+     * attached; Returns 0 on success or -1
+     */
+    int sendFd(int sock, int fd, const void *msg, int msgLen);
+
+    /*
+     * The recvFd() function receives up to msgLen bytes into msg and stores
+     * an attached descriptor in fd, or -1 if none was attached; Returns the
+     * number of bytes received, 0 on close, or -1 on error
+     */
+    int recvFd(int sock, void *msg, int msgLen, int *fd);
+} // FtUnix
+#endif // FTUNIX_H
@@ -0,0 +1,549 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftwatch.cpp
+ *           Overview: This is the implementation file for the ftserve
+ *                     session watchdog
+ *
+ *                     The parent never scans the table; Each child has one
+ *                     timer on the wheel set to its nearest deadline. When the
+ *                     timer fires the parent reads the child's current phase
+ *                     and either kills it or re-arms for the next deadline
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <csignal>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "fttimer.h"
+#include "ftwatch.h"
+
+namespace FtWatch
+{
+    const int WHEEL_SLOTS      = 512; // Slots on the timing wheel
+    const long long TICK_MS    = 100; // Milliseconds per wheel slot
+    const long long RECHECK_MS = 1000; // Re-arm interval with no deadline
+    const int MAX_GEN          = INT_MAX / MAX_WATCHED; // Timer generations
+
+    /*
+     * A watched child; Written by the child, read by the parent; seq changes
+     * with every phase so the parent can tell a stale read from a stuck child
+     */
+    struct WatchSlot
+    {
+        std::atomic<pid_t>     pid;
+        std::atomic<int>       phase;
+        std::atomic<unsigned>  seq;
+        std::atomic<long long> phaseStartMs;
+        std::atomic<long long> bytes;
+    };
+
+    /*
+     * Parent-only state for the minimum rate check of one slot
+     */
+    struct RateCheck
+    {
+        bool      armed;
+        long long lastBytes;
+        long long lastMs;
+    };
+
+    // Shared phase table, the child's own slot, and the parent's wheel
+    static WatchSlot *table = NULL;
+    static int mySlot = -1;
+    static Limits limits;
+    static FtTimer::TimerWheel *wheel = NULL;
+    static RateCheck rates[MAX_WATCHED];
+
+    // Generation of each slot's timer; A slot freed and reserved again
+    // while its old timer is still on the wheel gets a new one, and the old
+    // timer is ignored when it fires. Timer ids are gen * MAX_WATCHED + slot
+    static int timerGen[MAX_WATCHED];
+
+    /*
+     * Helpers local to this file
+     */
+    static long long monoMs();
+    static int phaseLimitSecs(int phase);
+    static const char *phaseName(int phase);
+    static void freeSlot(int slot);
+    static void expire(int id, long long now);
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: initWatch()
+     *
+     *    Entry: The phase deadlines and minimum rate
+     *
+     *     Exit: The shared table is mapped and the timing wheel created
+     *
+     *  Purpose: Set up the watchdog before the server forks children
+     *
+     *
+     *   *   *   *   *   *   */
+    void initWatch(const Limits &lim)
+    {
+        limits = lim;
+
+        void *mem = mmap(NULL, sizeof(WatchSlot) * MAX_WATCHED,
+                         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                         -1, 0);
+        if (mem == MAP_FAILED)
+        {
+            std::cerr << "Watchdog mmap: " << std::strerror(errno) << "\n";
+            return;
+        }
+
+        // Construct the atomics in place in the shared mapping
+        table = new (mem) WatchSlot[MAX_WATCHED]();
+        wheel = new FtTimer::TimerWheel(WHEEL_SLOTS, TICK_MS, monoMs());
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: reserveSlot()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns a slot in the command read phase or -1
+     *
+     *  Purpose: Claim a slot for a child about to be forked; The phase clock
+     *           starts now so a client that never sends its command is caught.
+     *           A slot whose child has finished is taken without waiting for
+     *           its timer to free it
+     *
+     *
+     *   *   *   *   *   *   */
+    int reserveSlot()
+    {
+        if (table == NULL)
+        {
+            return (-1);
+        }
+
+        for (int i = 0; i < MAX_WATCHED; i++)
+        {
+            int phase = table[i].phase.load();
+            if (phase == PHASE_FREE || phase == PHASE_DONE)
+            {
+                table[i].pid.store(0);
+                table[i].bytes.store(0);
+                table[i].phaseStartMs.store(monoMs());
+                table[i].seq.fetch_add(2);
+                table[i].phase.store(PHASE_CMD_READ);
+                return (i);
+            }
+        }
+
+        std::cerr << "Watchdog: all " << MAX_WATCHED << " slots in use; "
+                  << "session runs without deadlines\n";
+        return (-1);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: trackChild()
+     *
+     *    Entry: The reserved slot and the pid returned by fork()
+     *
+     *     Exit: The child's first deadline is on the wheel
+     *
+     *  Purpose: Start watching a new child; A failed fork frees the slot
+     *
+     *
+     *   *   *   *   *   *   */
+    void trackChild(int slot, pid_t pid)
+    {
+        if (table == NULL || slot < 0)
+        {
+            return;
+        }
+
+        if (pid <= 0)
+        {
+            freeSlot(slot);
+            return;
+        }
+
+        table[slot].pid.store(pid);
+        rates[slot].armed = false;
+        timerGen[slot] = (timerGen[slot] + 1) % MAX_GEN;
+
+        long long first = table[slot].phaseStartMs.load() + RECHECK_MS;
+        if (limits.cmdSecs > 0)
+        {
+            first = table[slot].phaseStartMs.load() + limits.cmdSecs * 1000LL;
+        }
+        wheel->schedule(timerGen[slot] * MAX_WATCHED + slot, first);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: reapChild()
+     *
+     *    Entry: The pid of a child the parent has reaped
+     *
+     *     Exit: The child's slot is free
+     *
+     *  Purpose: Stop watching an exited child; Only the shared table is
+     *           written, so the SIGCHLD handler may call it
+     *
+     *
+     *   *   *   *   *   *   */
+    void reapChild(pid_t pid)
+    {
+        if (table == NULL || pid <= 0)
+        {
+            return;
+        }
+
+        for (int i = 0; i < MAX_WATCHED; i++)
+        {
+            if (table[i].pid.load() == pid)
+            {
+                freeSlot(i);
+                return;
+            }
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: attach()
+     *
+     *    Entry: The slot reserved by the parent
+     *
+     *     Exit: Later phase updates from this process go to the slot
+     *
+     *  Purpose: Bind the child to its slot
+     *
+     *
+     *   *   *   *   *   *   */
+    void attach(int slot)
+    {
+        mySlot = slot;
+
+        // The wheel belongs to the parent
+        delete wheel;
+        wheel = NULL;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: setPhase()
+     *
+     *    Entry: The phase the child is entering
+     *
+     *     Exit: The phase, its start time, and the sequence are published
+     *
+     *  Purpose: Restart the phase clock for the child
+     *
+     *
+     *   *   *   *   *   *   */
+    void setPhase(Phase phase)
+    {
+        if (table == NULL || mySlot < 0)
+        {
+            return;
+        }
+
+        WatchSlot *s = &table[mySlot];
+        s->seq.fetch_add(1);
+        s->phaseStartMs.store(monoMs());
+        s->phase.store(phase);
+        s->seq.fetch_add(1);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: addBytes()
+     *
+     *    Entry: The number of bytes just sent
+     *
+     *     Exit: The child's byte count is increased
+     *
+     *  Purpose: Report transfer progress for the minimum rate check
+     *
+     *
+     *   *   *   *   *   *   */
+    void addBytes(long long bytes)
+    {
+        if (table != NULL && mySlot >= 0)
+        {
+            table[mySlot].bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: finish()
+     *
+     *    Entry: None
+     *
+     *     Exit: The child's slot is marked done
+     *
+     *  Purpose: Tell the parent the child exited on its own
+     *
+     *
+     *   *   *   *   *   *   */
+    void finish()
+    {
+        setPhase(PHASE_DONE);
+        mySlot = -1;
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: tick()
+     *
+     *    Entry: None
+     *
+     *     Exit: Every timer due by now has been handled
+     *
+     *  Purpose: Advance the parent's wheel and enforce the deadlines
+     *
+     *
+     *   *   *   *   *   *   */
+    void tick()
+    {
+        if (wheel == NULL || wheel->empty())
+        {
+            return;
+        }
+
+        std::vector<int> expired;
+        long long now = monoMs();
+        wheel->advance(now, expired);
+
+        for (unsigned int i = 0; i < expired.size(); i++)
+        {
+            expire(expired[i], now);
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: pollTimeoutMs()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns the wheel tick in milliseconds or -1 if idle
+     *
+     *  Purpose: Bound how long the parent blocks between ticks
+     *
+     *
+     *   *   *   *   *   *   */
+    int pollTimeoutMs()
+    {
+        if (wheel == NULL || wheel->empty())
+        {
+            return (-1);
+        }
+
+        return (static_cast<int>(wheel->getTickMs()));
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: expire()
+     *
+     *    Entry: The id of the timer that fired and the current time
+     *
+     *     Exit: The child is killed, its slot freed, or its timer re-armed
+     *
+     *  Purpose: Check one child against its phase deadline and the minimum
+     *           transfer rate; A timer left from an earlier child of the slot,
+     *           or from a child already reaped, is dropped
+     *
+     *
+     *   *   *   *   *   *   */
+    static void expire(int id, long long now)
+    {
+        int slot = id % MAX_WATCHED;
+        if (id / MAX_WATCHED != timerGen[slot]
+            || table[slot].phase.load() == PHASE_FREE)
+        {
+            return;
+        }
+
+        WatchSlot *s = &table[slot];
+        RateCheck *r = &rates[slot];
+        pid_t pid = s->pid.load();
+
+        // Read the phase and its start consistently
+        unsigned seq = s->seq.load();
+        int phase = s->phase.load();
+        long long start = s->phaseStartMs.load();
+        long long bytes = s->bytes.load();
+        bool stable = (seq % 2 == 0 && seq == s->seq.load());
+
+        if (phase == PHASE_DONE || (kill(pid, 0) == -1 && errno == ESRCH))
+        {
+            freeSlot(slot);
+            return;
+        }
+
+        if (!stable)
+        {
+            // The child is mid-update, so it is not stuck
+            wheel->schedule(id, now + TICK_MS);
+            return;
+        }
+
+        long long next = now + RECHECK_MS;
+
+        // Minimum rate over each window once data has started to flow
+        if (limits.minRate > 0 && bytes > 0)
+        {
+            long long windowMs = limits.rateWindowSecs * 1000LL;
+            if (!r->armed)
+            {
+                r->armed = true;
+                r->lastBytes = bytes;
+                r->lastMs = now;
+            }
+            else if (now - r->lastMs >= windowMs)
+            {
+                long long need = limits.minRate * (now - r->lastMs) / 1000;
+                if (bytes - r->lastBytes < need)
+                {
+                    std::cout << "Session " << pid << " below minimum rate; "
+                              << "closing\n";
+                    kill(pid, SIGKILL);
+                    freeSlot(slot);
+                    return;
+                }
+                r->lastBytes = bytes;
+                r->lastMs = now;
+            }
+            next = r->lastMs + windowMs;
+        }
+
+        // Deadline of the current phase
+        int limitSecs = phaseLimitSecs(phase);
+        if (limitSecs > 0)
+        {
+            long long deadline = start + limitSecs * 1000LL;
+            if (now >= deadline)
+            {
+                std::cout << "Session " << pid << " timed out in "
+                          << phaseName(phase) << "; closing\n";
+                kill(pid, SIGKILL);
+                freeSlot(slot);
+                return;
+            }
+            if (deadline < next)
+            {
+                next = deadline;
+            }
+        }
+
+        wheel->schedule(id, next);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: monoMs()
+     *
+     *    Entry: None
+     *
+     *     Exit: Returns the monotonic clock in milliseconds
+     *
+     *  Purpose: Time source for the phase clocks
+     *
+     *
+     *   *   *   *   *   *   */
+    static long long monoMs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (ts.tv_sec * 1000LL + ts.tv_nsec / 1000000);
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: phaseLimitSecs()
+     *
+     *    Entry: A phase
+     *
+     *     Exit: Returns the deadline for the phase in seconds or 0 for none
+     *
+     *  Purpose: Map a phase to its configured deadline
+     *
+     *
+     *   *   *   *   *   *   */
+    static int phaseLimitSecs(int phase)
+    {
+        switch (phase)
+        {
+            case PHASE_CMD_READ:
+                return (limits.cmdSecs);
+            case PHASE_ACK_WAIT:
+                return (limits.ackSecs);
+            case PHASE_DATA_CONNECT:
+                return (limits.connSecs);
+            default:
+                return (0);
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: phaseName()
+     *
+     *    Entry: A phase
+     *
+     *     Exit: Returns a printable name for the phase
+     *
+     *  Purpose: Name a phase for the console messages
+     *
+     *
+     *   *   *   *   *   *   */
+    static const char *phaseName(int phase)
+    {
+        switch (phase)
+        {
+            case PHASE_CMD_READ:
+                return ("command read");
+            case PHASE_ACK_WAIT:
+                return ("ack wait");
+            case PHASE_DATA_CONNECT:
+                return ("data connect");
+            case PHASE_SEND:
+                return ("send");
+            default:
+                return ("unknown phase");
+        }
+    }
+
+    /*   *   *   *   *   *   *
+     *
+     * Function: freeSlot()
+     *
+     *    Entry: A slot no longer watched
+     *
+     *     Exit: The slot can be reserved again
+     *
+     *  Purpose: Release a slot
+     *
+     *
+     *   *   *   *   *   *   */
+    static void freeSlot(int slot)
+    {
+        table[slot].pid.store(0);
+        table[slot].phase.store(PHASE_FREE);
+    }
+} // FtWatch
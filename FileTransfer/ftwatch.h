@@ -0,0 +1,112 @@
+/*
+ *             Author: Michael Marven
+ *       Date Created: 10/19/26
+ * Last Date Modified: 10/19/26
+ *          File Name: ftwatch.h
+ *           Overview: This is the header file for the ftserve session
+ *                     watchdog. Each child publishes the phase of its request
+ *                     and the bytes it has sent in memory shared with the
+ *                     parent. The parent keeps one timer per child on a
+ *                     timing wheel and kills children that overstay a phase
+ *                     deadline or fall below the minimum transfer rate
+ *              Input: None
+ *             Output: None
+ *
+ *
+ */
+
+#ifndef FTWATCH_H
+#define FTWATCH_H
+
+#include <sys/types.h>
+
+namespace FtWatch
+{
+    const int MAX_WATCHED = 256; // Maximum children tracked at once
+
+    /*
+     * Phases of a request; Each phase but PHASE_SEND has its own deadline
+     */
+    enum Phase
+    {
+        PHASE_FREE = 0,
+        PHASE_CMD_READ,
+        PHASE_ACK_WAIT,
+        PHASE_DATA_CONNECT,
+        PHASE_SEND,
+        PHASE_DONE
+    };
+
+    /*
+     * Deadlines in seconds for each phase and the minimum transfer rate in
+     * bytes per second checked over each rate window; 0 disables a limit
+     */
+    struct Limits
+    {
+        int       cmdSecs;
+        int       ackSecs;
+        int       connSecs;
+        long long minRate;
+        int       rateWindowSecs;
+    };
+
+    /*
+     * The initWatch() function maps the shared phase table and creates the
+     * parent's timing wheel; It must be called before any fork()
+     */
+    void initWatch(const Limits &limits);
+
+    /*
+     * The reserveSlot() function is called by the parent before fork() and
+     * returns a slot in the command read phase, or -1 with a warning if none
+     * is free
+     */
+    int reserveSlot();
+
+    /*
+     * The trackChild() function is called by the parent after fork() and
+     * arms the first deadline for the child
+     */
+    void trackChild(int slot, pid_t pid);
+
+    /*
+     * The reapChild() function is called by the parent's SIGCHLD handler for
+     * each child it reaps and frees the child's slot; It only writes the
+     * shared table, so it is safe in a signal handler
+     */
+    void reapChild(pid_t pid);
+
+    /*
+     * The attach() function is called by the child after fork() with the
+     * slot reserved for it
+     */
+    void attach(int slot);
+
+    /*
+     * The setPhase() function is called by the child as its request moves
+     * to a new phase
+     */
+    void setPhase(Phase phase);
+
+    /*
+     * The addBytes() function is called by the child after sending data
+     */
+    void addBytes(long long bytes);
+
+    /*
+     * The finish() function is called by the child as it exits
+     */
+    void finish();
+
+    /*
+     * The tick() function is called by the parent to fire expired timers
+     */
+    void tick();
+
+    /*
+     * The pollTimeoutMs() function returns how long the parent may block
+     * before the next tick(), or -1 if no timers are armed
+     */
+    int pollTimeoutMs();
+} // FtWatch
+#endif // FTWATCH_H
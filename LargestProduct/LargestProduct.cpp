@@ -1,7 +1,7 @@
 /*
  *             Author: Michael Marven
  *       Date Created: 12/04/13
- * Last Date Modified: 12/06/13
+ * Last Date Modified: 10/19/26
  *          File Name: LargestProduct.cpp
  *           Overview: The program allows the user to enter dimensions
  *                     for a table of random numbers, then calculates the
@@ -20,6 +20,7 @@
  *                     **   **   o*   *o   **    **    o*    *o
  *                     ** READ ME ** The program contains C++11 functions and
  *                                   must be compiled with the -std=c++0x flag
+ *                                   and, for the search threads, -pthread
  *              Input: The user inputs the table dimensions as command line args
  *             Output: The table and greatest product are printed to the console
  *                     window
@@ -31,18 +32,35 @@
 #include <string>
 #include <cstdlib>
 #include <cstdio>
+#include <cstddef>
 #include <ctime>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+// The vector kernels are built for x86 processors with GCC or Clang, which
+// can compile a function for an instruction set the rest is not built for
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
 
 
 const int MIN_ROWS_COLS    = 4; // Minimum number of rows or columns
 const int RAND_UPPER_LIMIT = 99; // Add 1 to this value for inclusive range
 const int MIN_COMM_ARGS    = 5; // Minimum number of command line arguments
+const int ORIENTATIONS     = 19; // Orientations of all the Tetris shapes
 
 // Adjust the for loop end values by these values to keep shapes in table
 const int FOUR_BLOCK_ADJ   = 3; // Start position must not shift past total - 3
 const int THREE_BLOCK_ADJ  = 2; // Start position must not shift past total – 2
 const int TWO_BLOCK_ADJ    = 1; // Start position must not shift past total - 1
 
+const int GRID_ALIGN       = 64; // Byte alignment of each row of the grid
+
+const int MIN_BAND_ROWS    = 64; // Fewest starting rows one thread searches
+const int BANDS_PER_THREAD = 4; // Bands per thread, to even out their times
+
 
 /*
  * Structure for the product of 4 integers in a table arranged in the shape of
@@ -65,6 +83,128 @@ struct Tetromino
     std::string shape;
 };
 
+/*
+ * Structure for one orientation of a Tetris shape; Block 1 is the starting
+ * position and the offsets give the row and column of each block from it
+ */
+struct Orientation
+{
+    const char *shape;
+    int         degrees;
+    int         rowOffset[4];
+    int         colOffset[4];
+};
+
+/*
+ * The orientations in the order they are searched; When two have the same
+ * product, the later one is reported
+ */
+const Orientation ORIENTATION_TABLE[ORIENTATIONS] =
+{
+    {"O",   0, {0, 0, 1, 1}, {0,  1,  0,  1}},
+    {"I",   0, {0, 0, 0, 0}, {0,  1,  2,  3}},
+    {"I",  90, {0, 1, 2, 3}, {0,  0,  0,  0}},
+    {"S",   0, {0, 0, 1, 1}, {0,  1, -1,  0}},
+    {"S",  90, {0, 1, 1, 2}, {0,  0,  1,  1}},
+    {"Z",   0, {0, 0, 1, 1}, {0,  1,  1,  2}},
+    {"Z",  90, {0, 1, 1, 2}, {0, -1,  0, -1}},
+    {"J",   0, {0, 0, 0, 1}, {0,  1,  2,  2}},
+    {"J",  90, {0, 1, 2, 2}, {0,  0, -1,  0}},
+    {"J", 180, {0, 1, 1, 1}, {0,  0,  1,  2}},
+    {"J", 270, {0, 0, 1, 2}, {0,  1,  0,  0}},
+    {"L",   0, {0, 0, 0, 1}, {0,  1,  2,  0}},
+    {"L",  90, {0, 0, 1, 2}, {0,  1,  1,  1}},
+    {"L", 180, {0, 1, 1, 1}, {0, -2, -1,  0}},
+    {"L", 270, {0, 1, 2, 2}, {0,  0,  0,  1}},
+    {"T",   0, {0, 0, 0, 1}, {0,  1,  2,  1}},
+    {"T",  90, {0, 1, 1, 2}, {0, -1,  0,  0}},
+    {"T", 180, {0, 1, 1, 1}, {0, -1,  0,  1}},
+    {"T", 270, {0, 1, 1, 2}, {0,  0,  1,  0}}
+};
+
+/*
+ * Structure for the greatest product a search has found so far; The
+ * orientation is an index into ORIENTATION_TABLE, or -1 before any product
+ * greater than 0 is found
+ */
+struct Best
+{
+    int product;
+    int orientation;
+    int row;
+    int col;
+};
+
+/*
+ * The ways the table can be searched
+ */
+enum Kernel
+{
+    KERNEL_PASSES, // One pass over the table for each orientation
+    KERNEL_FUSED,  // One pass over the table for all the orientations
+    KERNEL_SHARED  // One pass building the products from shared pairs
+};
+
+/*
+ * The widest vector instructions the fused kernel may use, if the processor
+ * has them
+ */
+enum Simd
+{
+    SIMD_NONE,   // One starting position at a time
+    SIMD_AVX2,   // 8 starting positions at a time
+    SIMD_AVX512  // 16 starting positions at a time
+};
+
+/*
+ * Structure for the optional command line arguments
+ */
+struct SearchOpts
+{
+    Kernel kernel;
+    Simd   simd;
+    int    threads;
+};
+
+/*
+ * Type of the functions that search the inner starting positions of a row
+ * for the fused kernel
+ */
+typedef void (*InnerScan)(const int *row0, const int *row1, const int *row2,
+                          const int *row3, int row, int first, int end,
+                          Best &best);
+
+/*
+ * Structure for the table of random numbers; The rows are stored one after
+ * another in a single block, and each row is padded to stride ints so that
+ * every row starts on a GRID_ALIGN byte boundary
+ */
+struct Grid
+{
+    int rows;
+    int cols;
+    int stride;
+    int *cells;
+};
+
+/*
+ * Structure for a search split into bands of starting rows; Threads take the
+ * next band from nextBand until none are left, and each band's greatest
+ * product is kept in bandBest at the band's index
+ */
+struct BandSearch
+{
+    int               rows;
+    int               cols;
+    const Grid       *table;
+    Kernel            kernel;
+    InnerScan         scanInner;
+    int               bandRows;
+    int               bands;
+    std::atomic<int>  nextBand;
+    std::vector<Best> bandBest;
+};
+
 /*
  * The validateCommArgsQuant function accepts an int as a parameter for the
  * quantity of command line arguments and validates that the value is correct
@@ -96,6 +236,12 @@ bool areValidRowColNums(int minimum, std::string arg2, std::string arg4);
  */
 void printCommError();
 
+/*
+ * The parseSearchOpts function converts the optional command line arguments
+ * after the rows and columns to a SearchOpts struct
+ */
+SearchOpts parseSearchOpts(int argc, char *argv[]);
+
 /*
  * The convertRowsArg function converts the correct rows command line argument
  * to an int
@@ -111,17 +257,210 @@ int convertColsArg(std::string arg1, std::string arg2,
                       std::string arg3, std::string arg4);
                       
 /*
- * The createArray function creates a 2D array of random integer values in the
+ * The createGrid function creates a grid of random integer values in the
  * range from 0 to the max parameter
  */
-int **createArray(int rows, int cols, int rangeMax);
+Grid createGrid(int rows, int cols, int rangeMax);
+
+/*
+ * The deleteGrid function frees the memory of a grid
+ */
+void deleteGrid(Grid &grid);
+
+/*
+ * The gridRow function returns a pointer to the first int of a row of the grid
+ */
+inline const int *gridRow(const Grid &grid, int row)
+{
+    return (grid.cells + (std::size_t)row * grid.stride);
+}
 
 /*
  * The findGreatestProduct function searches the generated table for the
  * greatest product of 4 numbers arranged in any of the Tetris shapes and
  * returns a Tetromino struct containing the details of the shape
  */
-Tetromino findGreatestProduct(int rows, int cols, int **table);
+Tetromino findGreatestProduct(int rows, int cols, const Grid &table,
+                              SearchOpts opts);
+
+/*
+ * The findGreatestByPasses function searches the table once for each
+ * orientation of each shape and returns the Tetromino with the greatest
+ * product
+ */
+Tetromino findGreatestByPasses(int rows, int cols, const Grid &table);
+
+/*
+ * The defaultThreads function returns the number of threads the processor
+ * can run at once, or 1 if it is not known
+ */
+int defaultThreads();
+
+/*
+ * The searchBands function searches bands of a search until none are left;
+ * Every thread of the search runs it
+ */
+void searchBands(BandSearch *search);
+
+/*
+ * The searchFusedBand function searches the starting positions in the rows
+ * from firstRow to before endRow, computing the product of every orientation
+ * at each, and offers them to the greatest product so far
+ */
+void searchFusedBand(int rows, int cols, const Grid &table,
+                     InnerScan scanInner, int firstRow, int endRow,
+                     Best &best);
+
+/*
+ * The chooseInnerScan function returns the inner row search for the widest
+ * vector instructions the processor has, up to the limit given
+ */
+InnerScan chooseInnerScan(Simd limit);
+
+/*
+ * The scanInnerScalar function searches the starting positions from first to
+ * before end of a row, where every orientation fits, one at a time
+ */
+void scanInnerScalar(const int *row0, const int *row1, const int *row2,
+                     const int *row3, int row, int first, int end,
+                     Best &best);
+
+#ifdef HAVE_X86_SIMD
+/*
+ * The scanInnerAvx2 function searches the inner starting positions of a row
+ * 8 at a time with AVX2 instructions
+ */
+__attribute__((target("avx2")))
+void scanInnerAvx2(const int *row0, const int *row1, const int *row2,
+                   const int *row3, int row, int first, int end, Best &best);
+
+/*
+ * The scanInnerAvx512 function searches the inner starting positions of a
+ * row 16 at a time with AVX-512 instructions
+ */
+__attribute__((target("avx512f")))
+void scanInnerAvx512(const int *row0, const int *row1, const int *row2,
+                     const int *row3, int row, int first, int end,
+                     Best &best);
+
+/*
+ * The maxAvx512 function returns the greater of each pair of lanes of a and b
+ */
+__attribute__((target("avx512f")))
+__m512i maxAvx512(__m512i a, __m512i b);
+#endif
+
+/*
+ * The searchSharedBand function searches the starting positions in the rows
+ * from firstRow to before endRow, building the product of every orientation
+ * from pair and triple products shared between orientations, and offers them
+ * to the greatest product so far
+ */
+void searchSharedBand(int rows, int cols, const Grid &table, int firstRow,
+                      int endRow, Best &best);
+
+/*
+ * The fillPartials function calculates the horizontal pair and triple
+ * products and the vertical pair products that start in one row of the table
+ */
+void fillPartials(int cols, const int *row, const int *below, int *pair2,
+                  int *pair3, int *vert2);
+
+/*
+ * The offerProduct function replaces the greatest product so far with the
+ * product of an orientation at a starting position if it is greater; Of
+ * equal products the later orientation is kept, and of equal products in one
+ * orientation the first in column order is kept, as the passes find them
+ */
+inline void offerProduct(Best &best, int product, int orientation, int row,
+                         int col)
+{
+    if (product > best.product
+        || (product == best.product && product > 0
+            && (orientation > best.orientation
+                || (orientation == best.orientation
+                    && (col < best.col
+                        || (col == best.col && row < best.row))))))
+    {
+        best.product = product;
+        best.orientation = orientation;
+        best.row = row;
+        best.col = col;
+    }
+}
+
+/*
+ * The fusedProducts function calculates the products of all the orientations
+ * at an inner starting position of a row, in the order of ORIENTATION_TABLE
+ */
+inline void fusedProducts(const int *row0, const int *row1, const int *row2,
+                          const int *row3, int i, int products[])
+{
+    // Read the neighborhood; rNcK is row N, column i + K, and rNmK is row N,
+    // column i - K
+    int r0c0 = row0[i], r0c1 = row0[i + 1], r0c2 = row0[i + 2];
+    int r0c3 = row0[i + 3];
+    int r1m2 = row1[i - 2], r1m1 = row1[i - 1], r1c0 = row1[i];
+    int r1c1 = row1[i + 1], r1c2 = row1[i + 2];
+    int r2m1 = row2[i - 1], r2c0 = row2[i], r2c1 = row2[i + 1];
+    int r3c0 = row3[i];
+    
+    products[0]  = r0c0 * r0c1 * r1c0 * r1c1;
+    products[1]  = r0c0 * r0c1 * r0c2 * r0c3;
+    products[2]  = r0c0 * r1c0 * r2c0 * r3c0;
+    products[3]  = r0c0 * r0c1 * r1m1 * r1c0;
+    products[4]  = r0c0 * r1c0 * r1c1 * r2c1;
+    products[5]  = r0c0 * r0c1 * r1c1 * r1c2;
+    products[6]  = r0c0 * r1m1 * r1c0 * r2m1;
+    products[7]  = r0c0 * r0c1 * r0c2 * r1c2;
+    products[8]  = r0c0 * r1c0 * r2m1 * r2c0;
+    products[9]  = r0c0 * r1c0 * r1c1 * r1c2;
+    products[10] = r0c0 * r0c1 * r1c0 * r2c0;
+    products[11] = r0c0 * r0c1 * r0c2 * r1c0;
+    products[12] = r0c0 * r0c1 * r1c1 * r2c1;
+    products[13] = r0c0 * r1m2 * r1m1 * r1c0;
+    products[14] = r0c0 * r1c0 * r2c0 * r2c1;
+    products[15] = r0c0 * r0c1 * r0c2 * r1c1;
+    products[16] = r0c0 * r1m1 * r1c0 * r2c0;
+    products[17] = r0c0 * r1m1 * r1c0 * r1c1;
+    products[18] = r0c0 * r1c0 * r1c1 * r2c0;
+}
+
+/*
+ * The offerCell function offers the products of all the orientations at a
+ * starting position, given in the order of ORIENTATION_TABLE
+ */
+inline void offerCell(Best &best, const int products[], int row, int col)
+{
+    // Find the greatest of the products at this position
+    int cellMax = products[0];
+    for (int k = 1; k < ORIENTATIONS; k++)
+    {
+        cellMax = (products[k] > cellMax ? products[k] : cellMax);
+    }
+    
+    // Compare them one by one only if one can replace the greatest
+    if (cellMax >= best.product)
+    {
+        for (int k = 0; k < ORIENTATIONS; k++)
+        {
+            offerProduct(best, products[k], k, row, col);
+        }
+    }
+}
+
+/*
+ * The offerEdgeCell function offers the product of each orientation that fits
+ * in the table at a starting position, checking each against the edges
+ */
+void offerEdgeCell(int rows, int cols, const Grid &table, int row, int col,
+                   Best &best);
+
+/*
+ * The makeTetromino function converts the greatest product of a search to a
+ * Tetromino struct
+ */
+Tetromino makeTetromino(const Best &best);
 
 /*
  * The greaterOfTwo function compares two Tetromino products and returns
@@ -129,19 +468,32 @@ Tetromino findGreatestProduct(int rows, int cols, int **table);
  */
 Tetromino greaterOfTwo(Tetromino first, Tetromino second);
 
+/*
+ * The isGreater function returns true if a product found at column col of a
+ * row-major scan replaces the greatest so far; An equal product replaces it
+ * only from an earlier column, so the result is the first greatest product in
+ * column order, as a scan down each column in turn would find
+ */
+inline bool isGreater(int product, int col, const Tetromino &greatest)
+{
+    return (product > greatest.product
+            || (product == greatest.product && product > 0
+                && col < greatest.colPosition1));
+}
+
 /*
  * The greatestO function searches the generated table for the
  * greatest product of 4 numbers arranged in the Tetris shape O and
  * returns a Tetromino struct containing the details of the shape
  */
-Tetromino greatestO(int rows, int cols, int **table);
+Tetromino greatestO(int rows, int cols, const Grid &table);
 
 /*
  * The greatestI function searches the generated table for the
  * greatest product of 4 numbers arranged in the Tetris shape I and
  * returns a Tetromino struct containing the details of the shape
  */
-Tetromino greatestI(int rows, int cols, int **table);
+Tetromino greatestI(int rows, int cols, const Grid &table);
 
 /*
  * The calcI0Degrees function searches the generated table for the
@@ -149,7 +501,7 @@ Tetromino greatestI(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcI0Degrees(int rows, int cols, int **table);
+Tetromino calcI0Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcI90Degrees function searches the generated table for the
@@ -157,14 +509,14 @@ Tetromino calcI0Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcI90Degrees(int rows, int cols, int **table);
+Tetromino calcI90Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The greatestS function searches the generated table for the
  * greatest product of 4 numbers arranged in the Tetris shape S and
  * returns a Tetromino struct containing the details of the shape
  */
-Tetromino greatestS(int rows, int cols, int **table);
+Tetromino greatestS(int rows, int cols, const Grid &table);
 
 /*
  * The calcS0Degrees function searches the generated table for the
@@ -172,7 +524,7 @@ Tetromino greatestS(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcS0Degrees(int rows, int cols, int **table);
+Tetromino calcS0Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcS90Degrees function searches the generated table for the
@@ -180,14 +532,14 @@ Tetromino calcS0Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcS90Degrees(int rows, int cols, int **table);
+Tetromino calcS90Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The greatestZ function searches the generated table for the
  * greatest product of 4 numbers arranged in the Tetris shape Z and
  * returns a Tetromino struct containing the details of the shape
  */
-Tetromino greatestZ(int rows, int cols, int **table);
+Tetromino greatestZ(int rows, int cols, const Grid &table);
 
 /*
  * The calcZ0Degrees function searches the generated table for the
@@ -195,7 +547,7 @@ Tetromino greatestZ(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcZ0Degrees(int rows, int cols, int **table);
+Tetromino calcZ0Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcZ90Degrees function searches the generated table for the
@@ -203,14 +555,14 @@ Tetromino calcZ0Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcZ90Degrees(int rows, int cols, int **table);
+Tetromino calcZ90Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The greatestJ function searches the generated table for the
  * greatest product of 4 numbers arranged in the Tetris shape J and
  * returns a Tetromino struct containing the details of the shape
  */
-Tetromino greatestJ(int rows, int cols, int **table);
+Tetromino greatestJ(int rows, int cols, const Grid &table);
 
 /*
  * The calcJ0Degrees function searches the generated table for the
@@ -218,7 +570,7 @@ Tetromino greatestJ(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcJ0Degrees(int rows, int cols, int **table);
+Tetromino calcJ0Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcJ90Degrees function searches the generated table for the
@@ -226,7 +578,7 @@ Tetromino calcJ0Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcJ90Degrees(int rows, int cols, int **table);
+Tetromino calcJ90Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcJ180Degrees function searches the generated table for the
@@ -234,7 +586,7 @@ Tetromino calcJ90Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcJ180Degrees(int rows, int cols, int **table);
+Tetromino calcJ180Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcJ270Degrees function searches the generated table for the
@@ -242,14 +594,14 @@ Tetromino calcJ180Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcJ270Degrees(int rows, int cols, int **table);
+Tetromino calcJ270Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The greatestL function searches the generated table for the
  * greatest product of 4 numbers arranged in the Tetris shape L and
  * returns a Tetromino struct containing the details of the shape
  */
-Tetromino greatestL(int rows, int cols, int **table);
+Tetromino greatestL(int rows, int cols, const Grid &table);
 
 /*
  * The calcL0Degrees function searches the generated table for the
@@ -257,7 +609,7 @@ Tetromino greatestL(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcL0Degrees(int rows, int cols, int **table);
+Tetromino calcL0Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcL90Degrees function searches the generated table for the
@@ -265,7 +617,7 @@ Tetromino calcL0Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcL90Degrees(int rows, int cols, int **table);
+Tetromino calcL90Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcL180Degrees function searches the generated table for the
@@ -273,7 +625,7 @@ Tetromino calcL90Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcL180Degrees(int rows, int cols, int **table);
+Tetromino calcL180Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcL270Degrees function searches the generated table for the
@@ -281,14 +633,14 @@ Tetromino calcL180Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcL270Degrees(int rows, int cols, int **table);
+Tetromino calcL270Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The greatestT function searches the generated table for the
  * greatest product of 4 numbers arranged in the Tetris shape T and
  * returns a Tetromino struct containing the details of the shape
  */
-Tetromino greatestT(int rows, int cols, int **table);
+Tetromino greatestT(int rows, int cols, const Grid &table);
 
 /*
  * The calcT0Degrees function searches the generated table for the
@@ -296,7 +648,7 @@ Tetromino greatestT(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcT0Degrees(int rows, int cols, int **table);
+Tetromino calcT0Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcT90Degrees function searches the generated table for the
@@ -304,7 +656,7 @@ Tetromino calcT0Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcT90Degrees(int rows, int cols, int **table);
+Tetromino calcT90Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcT180Degrees function searches the generated table for the
@@ -312,7 +664,7 @@ Tetromino calcT90Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcT180Degrees(int rows, int cols, int **table);
+Tetromino calcT180Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The calcT270Degrees function searches the generated table for the
@@ -320,7 +672,7 @@ Tetromino calcT180Degrees(int rows, int cols, int **table);
  * orientation and returns a Tetromino struct containing the details of the
  * shape
  */
-Tetromino calcT270Degrees(int rows, int cols, int **table);
+Tetromino calcT270Degrees(int rows, int cols, const Grid &table);
 
 /*
  * The printTetDetails function prints the Tetromino product, position 
@@ -332,7 +684,7 @@ void printTetDetails(Tetromino tet);
  * The printTable function prints the 2D array with the Tetromino with the
  * greatest product highlighted
  */
-void printTable(int **table, int rows, int cols, Tetromino tet);
+void printTable(const Grid &table, int rows, int cols, Tetromino tet);
 
 int main(int argc, char *argv[])
 {
@@ -344,14 +696,17 @@ int main(int argc, char *argv[])
     int rows = convertRowsArg(argv[1], argv[2], argv[3], argv[4]);
     int cols = convertColsArg(argv[1], argv[2], argv[3], argv[4]);
     
-    // Declare a variable and generate the array
-    int **randTable = createArray(rows, cols, RAND_UPPER_LIMIT);
+    // Read the optional arguments that choose how to search
+    SearchOpts opts = parseSearchOpts(argc, argv);
+    
+    // Declare a variable and generate the grid
+    Grid randTable = createGrid(rows, cols, RAND_UPPER_LIMIT);
     
     // Declare a Tetromino struct
     Tetromino maxProdTet;
     
     // Assign it the value of the Tetrmino with the greatest product
-    maxProdTet = findGreatestProduct(rows, cols, randTable);
+    maxProdTet = findGreatestProduct(rows, cols, randTable, opts);
     
     // Print the table with the Tetrmino with max product highlighted
     printTable(randTable, rows, cols, maxProdTet);
@@ -359,12 +714,8 @@ int main(int argc, char *argv[])
     // Print the details of the Tetromino with the greatest product
     printTetDetails(maxProdTet);
     
-    // Delete the dynamically created array
-    for (int i = 0; i < rows; i++)
-    {
-        delete[] randTable[i];
-    }
-    delete[] randTable;
+    // Delete the dynamically created grid
+    deleteGrid(randTable);
 	
     return 0;
 }
@@ -506,14 +857,89 @@ void printCommError()
 {
     // Print error message explaining correct command line format
     std::cout << "\nERROR: Command Line Argument Format Invalid\n\n"
-              << "[-rows integer] [-cols integer]\n\n"
+              << "[-rows integer] [-cols integer]"
+              << " [-kernel passes|fused|shared]\n"
+              << "[-simd avx512|avx2|none] [-threads integer]\n\n"
               << "Description: -rows and -cols flags must be provided and\n"
-              << "followed by integers with values greater or equal to 4.\n\n"
+              << "followed by integers with values greater or equal to 4.\n"
+              << "-kernel chooses one pass over the table for each shape\n"
+              << "orientation, one pass for all of them, the default, or\n"
+              << "one pass building the products from shared pairs.\n"
+              << "-simd limits the vector instructions the fused kernel\n"
+              << "uses; By default it uses the widest the processor has.\n"
+              << "-threads sets how many threads search bands of rows of\n"
+              << "the table; By default there is one for each processor.\n\n"
               << "Example: ./prod -rows 6 -cols 6\n\n";
     
     std::exit(1);
 }
 
+/*   *   *   *   *   *   *
+ * 
+ * Function: parseSearchOpts
+ * 
+ *    Entry: The command line argument count and array
+ *
+ *     Exit: Returns a SearchOpts struct with the options entered or defaults
+ *
+ *  Purpose: Convert the flag and value pairs after the rows and columns
+ *
+ *
+ *   *   *   *   *   *   */
+SearchOpts parseSearchOpts(int argc, char *argv[])
+{
+    // Initialize the options to the defaults
+    SearchOpts opts = {KERNEL_FUSED, SIMD_AVX512, defaultThreads()};
+    
+    // The optional arguments must be flag and value pairs
+    if ((argc - MIN_COMM_ARGS) % 2 != 0)
+    {
+        printCommError();
+    }
+    
+    for (int i = MIN_COMM_ARGS; i < argc; i += 2)
+    {
+        std::string flag  = argv[i];
+        std::string value = argv[i + 1];
+        
+        if (flag == "-kernel" && value == "shared")
+        {
+            opts.kernel = KERNEL_SHARED;
+        }
+        else if (flag == "-kernel" && value == "passes")
+        {
+            opts.kernel = KERNEL_PASSES;
+        }
+        else if (flag == "-kernel" && value == "fused")
+        {
+            opts.kernel = KERNEL_FUSED;
+        }
+        else if (flag == "-simd" && value == "avx512")
+        {
+            opts.simd = SIMD_AVX512;
+        }
+        else if (flag == "-simd" && value == "avx2")
+        {
+            opts.simd = SIMD_AVX2;
+        }
+        else if (flag == "-simd" && value == "none")
+        {
+            opts.simd = SIMD_NONE;
+        }
+        else if (flag == "-threads" && isPositiveInt(value)
+                 && value.size() <= 4 && std::stoi(value) > 0)
+        {
+            opts.threads = std::stoi(value);
+        }
+        else
+        {
+            printCommError();
+        }
+    }
+    
+    return (opts);
+}
+
 /*   *   *   *   *   *   *
  * 
  * Function: convertRowsArg
@@ -578,59 +1004,225 @@ int convertColsArg(std::string arg1, std::string arg2,
 
 /*   *   *   *   *   *   *
  * 
- * Function: createArray
+ * Function: createGrid
  * 
  *    Entry: 3 ints for the rows, columns, and range maximum
  *
- *     Exit: Creates a 2D array of random integer values in the range specified
+ *     Exit: Creates a grid of random integer values in the range specified
  *
- *  Purpose: Creates a 2D array of random integer values    
+ *  Purpose: Creates a grid of random integer values in one aligned block, so
+ *           a row is read from consecutive memory instead of through a
+ *           pointer to a separately allocated array
  *
  *
  *   *   *   *   *   *   */
-int **createArray(int rows, int cols, int rangeMax)
+Grid createGrid(int rows, int cols, int rangeMax)
 {
-    // Declare a pointer variable for the 2D array of ints
-    int **table = new int*[rows];
-    
-    // Fill the initial array with arrays
-    for (int i = 0; i < rows; i++)
+    // Pad each row to a whole number of aligned blocks
+    const int perBlock = GRID_ALIGN / sizeof(int);
+    Grid grid = {rows, cols, (cols + perBlock - 1) / perBlock * perBlock, NULL};
+    
+    // Allocate the rows together in a single aligned block
+    void *block = NULL;
+    if (posix_memalign(&block, GRID_ALIGN,
+                       (std::size_t)rows * grid.stride * sizeof(int)) != 0)
     {
-        table[i] = new int[cols];
+        std::cout << "\nERROR: Not enough memory for the table\n\n";
+        std::exit(1);
     }
+    grid.cells = static_cast<int *>(block);
     
     // Use current time as a seed for the random number generator
     std::srand(std::time(0));
     
-    // Fill the array with random integers
+    // Fill the grid with random integers and the padding with zeros
     for (int i = 0; i < rows; i++)
     {
+        int *row = grid.cells + (std::size_t)i * grid.stride;
         for (int j = 0; j < cols; j++)
         {
             // Generate a random number from 0 to upper limit inclusive
-            table[i][j] = rand() % (rangeMax + 1);
+            row[j] = rand() % (rangeMax + 1);
+        }
+        for (int j = cols; j < grid.stride; j++)
+        {
+            row[j] = 0;
         }
     }
     
-    return (table);
+    return (grid);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: deleteGrid
+ * 
+ *    Entry: A grid from createGrid
+ *
+ *     Exit: Frees the grid's block and clears its pointer
+ *
+ *  Purpose: Releases the memory of a grid with the function that matches
+ *           its aligned allocation
+ *
+ *
+ *   *   *   *   *   *   */
+void deleteGrid(Grid &grid)
+{
+    std::free(grid.cells);
+    grid.cells = NULL;
 }
 
 /*   *   *   *   *   *   *
  * 
  * Function: findGreatestProduct
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, the table grid, and the options
+ *
+ *     Exit: Searches the grid for the greatest product of 4 numbers
+ *           arranged in any of the Tetris shapes and returns a Tetromino struct
+ *           containing the details of the shape
+ *
+ *  Purpose: Search the grid with the kernel chosen in the options; The
+ *           single pass kernels split the starting rows into bands that the
+ *           threads search at the same time. A band reads the 3 rows below
+ *           its last starting row, which the next band starts in, straight
+ *           from the table, as nothing writes to it during the search. The
+ *           greatest products of the bands are compared in band order by the
+ *           same rules as one search, so the result does not depend on the
+ *           number of threads or which thread searched which band
+ *
+ *
+ *   *   *   *   *   *   */
+Tetromino findGreatestProduct(int rows, int cols, const Grid &table,
+                              SearchOpts opts)
+{
+    if (opts.kernel == KERNEL_PASSES)
+    {
+        return (findGreatestByPasses(rows, cols, table));
+    }
+    
+    // Give each thread several bands, but not so many that a band is short
+    int bandRows = (rows + opts.threads * BANDS_PER_THREAD - 1)
+                   / (opts.threads * BANDS_PER_THREAD);
+    if (bandRows < MIN_BAND_ROWS)
+    {
+        bandRows = MIN_BAND_ROWS;
+    }
+    
+    BandSearch search;
+    search.rows      = rows;
+    search.cols      = cols;
+    search.table     = &table;
+    search.kernel    = opts.kernel;
+    search.scanInner = chooseInnerScan(opts.simd);
+    search.bandRows  = bandRows;
+    search.bands     = (rows + bandRows - 1) / bandRows;
+    search.nextBand  = 0;
+    search.bandBest.assign(search.bands, Best());
+    
+    // The calling thread searches bands too, so start one fewer
+    int threads = (opts.threads < search.bands ? opts.threads : search.bands);
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.push_back(std::thread(searchBands, &search));
+    }
+    searchBands(&search);
+    for (std::size_t t = 0; t < workers.size(); t++)
+    {
+        workers[t].join();
+    }
+    
+    // Keep the greatest of the bands
+    Best best = {0, -1, 0, 0};
+    for (int b = 0; b < search.bands; b++)
+    {
+        const Best &band = search.bandBest[b];
+        offerProduct(best, band.product, band.orientation, band.row,
+                     band.col);
+    }
+    
+    return (makeTetromino(best));
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: defaultThreads
+ * 
+ *    Entry: None
+ *
+ *     Exit: Returns the number of threads to search with by default
+ *
+ *  Purpose: Use every processor; The count is 0 where it is not known
+ *
+ *
+ *   *   *   *   *   *   */
+int defaultThreads()
+{
+    int threads = std::thread::hardware_concurrency();
+    
+    return (threads > 0 ? threads : 1);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: searchBands
+ * 
+ *    Entry: The search to take bands from
+ *
+ *     Exit: Each band taken holds its greatest product in the search
+ *
+ *  Purpose: Search the next band not yet taken by any thread until none are
+ *           left, with the kernel chosen for the search
+ *
+ *
+ *   *   *   *   *   *   */
+void searchBands(BandSearch *search)
+{
+    for (int b = search->nextBand++; b < search->bands;
+         b = search->nextBand++)
+    {
+        int firstRow = b * search->bandRows;
+        int endRow   = firstRow + search->bandRows;
+        if (endRow > search->rows)
+        {
+            endRow = search->rows;
+        }
+        
+        // Initialize the band's greatest product to none found
+        Best best = {0, -1, 0, 0};
+        
+        if (search->kernel == KERNEL_SHARED)
+        {
+            searchSharedBand(search->rows, search->cols, *search->table,
+                             firstRow, endRow, best);
+        }
+        else
+        {
+            searchFusedBand(search->rows, search->cols, *search->table,
+                            search->scanInner, firstRow, endRow, best);
+        }
+        
+        search->bandBest[b] = best;
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: findGreatestByPasses
+ * 
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in any of the Tetris shapes and returns a Tetromino struct
  *           containing the details of the shape
  *
  *  Purpose: Search the array for the greatest product of 4 numbers arranged in
- *           a Tetris shape 
+ *           a Tetris shape with one pass over the array for each orientation
  *
  *
  *   *   *   *   *   *   */
-Tetromino findGreatestProduct(int rows, int cols, int **table)
+Tetromino findGreatestByPasses(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp            = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ""};
@@ -659,6 +1251,597 @@ Tetromino findGreatestProduct(int rows, int cols, int **table)
     return (greaterOfTwo(temp, greatestProduct));
 }
 
+/*   *   *   *   *   *   *
+ * 
+ * Function: searchFusedBand
+ * 
+ *    Entry: 2 ints for the rows and columns, the table grid, the inner row
+ *           search, the first row and the row after the last to search, and
+ *           the greatest product so far
+ *
+ *     Exit: The greatest product includes every starting position in the
+ *           rows searched
+ *
+ *  Purpose: Search the rows in a single pass; At each starting
+ *           position away from the edges every orientation fits, so the 4
+ *           rows by 6 columns of numbers around it are read once and all 19
+ *           products are made from them, for several positions at once
+ *           where the processor has vector instructions. Only when the
+ *           greatest of the 19 reaches the greatest so far are they compared
+ *           one by one. The few positions near the edges are checked
+ *           orientation by orientation
+ *
+ *
+ *   *   *   *   *   *   */
+void searchFusedBand(int rows, int cols, const Grid &table,
+                     InnerScan scanInner, int firstRow, int endRow,
+                     Best &best)
+{
+    // Starting positions in these columns of all but the last rows fit all
+    // the orientations; L 180 reaches 2 columns left and I 0 3 to the right
+    const int firstInner = THREE_BLOCK_ADJ;
+    const int endInner   = cols - FOUR_BLOCK_ADJ;
+    
+    // Rows from here on are too close to the bottom for every orientation
+    const int endFull = (endRow < rows - FOUR_BLOCK_ADJ ?
+                         endRow : rows - FOUR_BLOCK_ADJ);
+    
+    // Cycle starting position through the band by rows
+    for (int j = firstRow; j < endFull; j++)
+    {
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        const int *row2 = gridRow(table, j + 2);
+        const int *row3 = gridRow(table, j + 3);
+        
+        for (int i = 0; i < firstInner; i++)
+        {
+            offerEdgeCell(rows, cols, table, j, i, best);
+        }
+        
+        if (endInner > firstInner)
+        {
+            scanInner(row0, row1, row2, row3, j, firstInner, endInner, best);
+        }
+        
+        for (int i = (endInner > firstInner ? endInner : firstInner);
+             i < cols; i++)
+        {
+            offerEdgeCell(rows, cols, table, j, i, best);
+        }
+    }
+    
+    // Check the starting positions in the last rows
+    for (int j = (endFull > firstRow ? endFull : firstRow); j < endRow; j++)
+    {
+        for (int i = 0; i < cols; i++)
+        {
+            offerEdgeCell(rows, cols, table, j, i, best);
+        }
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: chooseInnerScan
+ * 
+ *    Entry: The widest vector instructions allowed
+ *
+ *     Exit: Returns the inner row search to use
+ *
+ *  Purpose: Choose the vector instructions when the program runs, so one
+ *           build runs on any x86 processor and uses what it has; Other
+ *           processors use the scalar search
+ *
+ *
+ *   *   *   *   *   *   */
+InnerScan chooseInnerScan(Simd limit)
+{
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (limit >= SIMD_AVX512 && __builtin_cpu_supports("avx512f"))
+    {
+        return (scanInnerAvx512);
+    }
+    if (limit >= SIMD_AVX2 && __builtin_cpu_supports("avx2"))
+    {
+        return (scanInnerAvx2);
+    }
+#endif
+    
+    return (scanInnerScalar);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: scanInnerScalar
+ * 
+ *    Entry: The 4 rows from the starting row down, the starting row, the
+ *           first and end columns, and the greatest product so far
+ *
+ *     Exit: The greatest product includes the inner starting positions
+ *
+ *  Purpose: Calculate the 19 products one starting position at a time; It
+ *           is the search used without SIMD and the one the others match
+ *
+ *
+ *   *   *   *   *   *   */
+void scanInnerScalar(const int *row0, const int *row1, const int *row2,
+                     const int *row3, int row, int first, int end,
+                     Best &best)
+{
+    // Array for the products of the orientations at one starting position
+    int products[ORIENTATIONS];
+    
+    for (int i = first; i < end; i++)
+    {
+        fusedProducts(row0, row1, row2, row3, i, products);
+        offerCell(best, products, row, i);
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+/*   *   *   *   *   *   *
+ * 
+ * Function: scanInnerAvx2
+ * 
+ *    Entry: The 4 rows from the starting row down, the starting row, the
+ *           first and end columns, and the greatest product so far
+ *
+ *     Exit: The greatest product includes the inner starting positions
+ *
+ *  Purpose: Calculate the 19 products for 8 neighboring starting positions
+ *           per instruction and keep only their greatest for each position;
+ *           The products of the few positions whose greatest reaches the
+ *           greatest so far are calculated again one at a time and offered
+ *           in column order, so the result is the one the scalar search
+ *           finds. The columns left over are searched one at a time
+ *
+ *
+ *   *   *   *   *   *   */
+__attribute__((target("avx2")))
+void scanInnerAvx2(const int *row0, const int *row1, const int *row2,
+                   const int *row3, int row, int first, int end, Best &best)
+{
+    const int width = 8;
+    int products[ORIENTATIONS];
+    int i = first;
+    
+    for (; i + width <= end; i += width)
+    {
+        // Read the neighborhood of each position, as in fusedProducts
+        __m256i r0c0 = _mm256_loadu_si256((const __m256i *)(row0 + i));
+        __m256i r0c1 = _mm256_loadu_si256((const __m256i *)(row0 + i + 1));
+        __m256i r0c2 = _mm256_loadu_si256((const __m256i *)(row0 + i + 2));
+        __m256i r0c3 = _mm256_loadu_si256((const __m256i *)(row0 + i + 3));
+        __m256i r1m2 = _mm256_loadu_si256((const __m256i *)(row1 + i - 2));
+        __m256i r1m1 = _mm256_loadu_si256((const __m256i *)(row1 + i - 1));
+        __m256i r1c0 = _mm256_loadu_si256((const __m256i *)(row1 + i));
+        __m256i r1c1 = _mm256_loadu_si256((const __m256i *)(row1 + i + 1));
+        __m256i r1c2 = _mm256_loadu_si256((const __m256i *)(row1 + i + 2));
+        __m256i r2m1 = _mm256_loadu_si256((const __m256i *)(row2 + i - 1));
+        __m256i r2c0 = _mm256_loadu_si256((const __m256i *)(row2 + i));
+        __m256i r2c1 = _mm256_loadu_si256((const __m256i *)(row2 + i + 1));
+        __m256i r3c0 = _mm256_loadu_si256((const __m256i *)(row3 + i));
+        
+        // Pairs and triples used by several orientations
+        __m256i top = _mm256_mullo_epi32(r0c0, r0c1);
+        __m256i down = _mm256_mullo_epi32(r0c0, r1c0);
+        __m256i top3 = _mm256_mullo_epi32(top, r0c2);
+        __m256i mid = _mm256_mullo_epi32(r1m1, r1c0);
+        __m256i right = _mm256_mullo_epi32(r1c0, r1c1);
+        __m256i down3 = _mm256_mullo_epi32(down, r2c0);
+        
+        // The greatest of the 19 products at each position
+        __m256i cellMax = _mm256_mullo_epi32(top, right);
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(top3, r0c3));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(down3, r3c0));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(top, mid));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(
+                      down, _mm256_mullo_epi32(r1c1, r2c1)));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(
+                      top, _mm256_mullo_epi32(r1c1, r1c2)));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(
+                      _mm256_mullo_epi32(r0c0, mid), r2m1));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(top3, r1c2));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(
+                      down, _mm256_mullo_epi32(r2m1, r2c0)));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(
+                      r0c0, _mm256_mullo_epi32(right, r1c2)));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(top,
+                      _mm256_mullo_epi32(r1c0, r2c0)));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(top3, r1c0));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(
+                      top, _mm256_mullo_epi32(r1c1, r2c1)));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(
+                      _mm256_mullo_epi32(r0c0, r1m2), mid));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(down3, r2c1));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(top3, r1c1));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(
+                      _mm256_mullo_epi32(r0c0, mid), r2c0));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(
+                      _mm256_mullo_epi32(r0c0, mid), r1c1));
+        cellMax = _mm256_max_epi32(cellMax, _mm256_mullo_epi32(
+                      _mm256_mullo_epi32(down, r1c1), r2c0));
+        
+        // Find the positions whose greatest reaches the greatest so far
+        __m256i floor = _mm256_set1_epi32(best.product - 1);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+                       _mm256_cmpgt_epi32(cellMax, floor)));
+        
+        while (mask != 0)
+        {
+            int lane = __builtin_ctz(mask);
+            mask &= mask - 1;
+            fusedProducts(row0, row1, row2, row3, i + lane, products);
+            offerCell(best, products, row, i + lane);
+        }
+    }
+    
+    scanInnerScalar(row0, row1, row2, row3, row, i, end, best);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: scanInnerAvx512
+ * 
+ *    Entry: The 4 rows from the starting row down, the starting row, the
+ *           first and end columns, and the greatest product so far
+ *
+ *     Exit: The greatest product includes the inner starting positions
+ *
+ *  Purpose: Search as scanInnerAvx2 does, 16 starting positions at a time
+ *
+ *
+ *   *   *   *   *   *   */
+__attribute__((target("avx512f")))
+void scanInnerAvx512(const int *row0, const int *row1, const int *row2,
+                     const int *row3, int row, int first, int end,
+                     Best &best)
+{
+    const int width = 16;
+    int products[ORIENTATIONS];
+    int i = first;
+    
+    for (; i + width <= end; i += width)
+    {
+        // Read the neighborhood of each position, as in fusedProducts
+        __m512i r0c0 = _mm512_loadu_si512(row0 + i);
+        __m512i r0c1 = _mm512_loadu_si512(row0 + i + 1);
+        __m512i r0c2 = _mm512_loadu_si512(row0 + i + 2);
+        __m512i r0c3 = _mm512_loadu_si512(row0 + i + 3);
+        __m512i r1m2 = _mm512_loadu_si512(row1 + i - 2);
+        __m512i r1m1 = _mm512_loadu_si512(row1 + i - 1);
+        __m512i r1c0 = _mm512_loadu_si512(row1 + i);
+        __m512i r1c1 = _mm512_loadu_si512(row1 + i + 1);
+        __m512i r1c2 = _mm512_loadu_si512(row1 + i + 2);
+        __m512i r2m1 = _mm512_loadu_si512(row2 + i - 1);
+        __m512i r2c0 = _mm512_loadu_si512(row2 + i);
+        __m512i r2c1 = _mm512_loadu_si512(row2 + i + 1);
+        __m512i r3c0 = _mm512_loadu_si512(row3 + i);
+        
+        // Pairs and triples used by several orientations
+        __m512i top = _mm512_mullo_epi32(r0c0, r0c1);
+        __m512i down = _mm512_mullo_epi32(r0c0, r1c0);
+        __m512i top3 = _mm512_mullo_epi32(top, r0c2);
+        __m512i mid = _mm512_mullo_epi32(r1m1, r1c0);
+        __m512i right = _mm512_mullo_epi32(r1c0, r1c1);
+        __m512i down3 = _mm512_mullo_epi32(down, r2c0);
+        
+        // The greatest of the 19 products at each position
+        __m512i cellMax = _mm512_mullo_epi32(top, right);
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(top3, r0c3));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(down3, r3c0));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(top, mid));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(
+                      down, _mm512_mullo_epi32(r1c1, r2c1)));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(
+                      top, _mm512_mullo_epi32(r1c1, r1c2)));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(
+                      _mm512_mullo_epi32(r0c0, mid), r2m1));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(top3, r1c2));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(
+                      down, _mm512_mullo_epi32(r2m1, r2c0)));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(
+                      r0c0, _mm512_mullo_epi32(right, r1c2)));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(top,
+                      _mm512_mullo_epi32(r1c0, r2c0)));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(top3, r1c0));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(
+                      top, _mm512_mullo_epi32(r1c1, r2c1)));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(
+                      _mm512_mullo_epi32(r0c0, r1m2), mid));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(down3, r2c1));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(top3, r1c1));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(
+                      _mm512_mullo_epi32(r0c0, mid), r2c0));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(
+                      _mm512_mullo_epi32(r0c0, mid), r1c1));
+        cellMax = maxAvx512(cellMax, _mm512_mullo_epi32(
+                      _mm512_mullo_epi32(down, r1c1), r2c0));
+        
+        // Find the positions whose greatest reaches the greatest so far
+        __m512i floor = _mm512_set1_epi32(best.product - 1);
+        int mask = _mm512_cmpgt_epi32_mask(cellMax, floor);
+        
+        while (mask != 0)
+        {
+            int lane = __builtin_ctz(mask);
+            mask &= mask - 1;
+            fusedProducts(row0, row1, row2, row3, i + lane, products);
+            offerCell(best, products, row, i + lane);
+        }
+    }
+    
+    scanInnerScalar(row0, row1, row2, row3, row, i, end, best);
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: maxAvx512
+ * 
+ *    Entry: 2 vectors of 16 ints
+ *
+ *     Exit: Returns the greater of each pair of lanes
+ *
+ *  Purpose: _mm512_max_epi32 passes GCC an undefined source vector, which
+ *           -Wall reports as maybe uninitialized; The masked form with every
+ *           lane selected takes a as its source and gives the same result
+ *
+ *
+ *   *   *   *   *   *   */
+__attribute__((target("avx512f")))
+__m512i maxAvx512(__m512i a, __m512i b)
+{
+    return (_mm512_mask_max_epi32(a, 0xFFFF, a, b));
+}
+#endif
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: searchSharedBand
+ * 
+ *    Entry: 2 ints for the rows and columns, the table grid, the first row
+ *           and the row after the last to search, and the greatest product so
+ *           far
+ *
+ *     Exit: The greatest product includes every starting position in the
+ *           rows searched
+ *
+ *  Purpose: Search the rows in a single pass with fewer
+ *           multiplications; Every orientation splits into two pieces that
+ *           are single numbers or pair or triple products along a row or a
+ *           column, such as O, the pair at the start times the pair below it.
+ *           The pieces for a row are calculated once, into a buffer of the 3
+ *           rows in use that is reused as the search moves down, so each
+ *           product takes one multiplication instead of three
+ *
+ *
+ *   *   *   *   *   *   */
+void searchSharedBand(int rows, int cols, const Grid &table, int firstRow,
+                      int endRow, Best &best)
+{
+    // Array for the products of the orientations at one starting position
+    int products[ORIENTATIONS];
+    
+    // Buffers of the horizontal pairs and triples and the vertical pairs
+    // that start in the current row and the 2 below it
+    const int bufferRows = 3;
+    std::vector<int> pair2Rows(bufferRows * cols);
+    std::vector<int> pair3Rows(bufferRows * cols);
+    std::vector<int> vert2Rows(bufferRows * cols);
+    
+    // Starting positions in these columns of all but the last rows fit all
+    // the orientations; L 180 reaches 2 columns left and I 0 3 to the right
+    const int firstInner = THREE_BLOCK_ADJ;
+    const int endInner   = cols - FOUR_BLOCK_ADJ;
+    
+    // Rows from here on are too close to the bottom for every orientation
+    const int endFull = (endRow < rows - FOUR_BLOCK_ADJ ?
+                         endRow : rows - FOUR_BLOCK_ADJ);
+    
+    // Fill the buffer for the first 2 rows of the band if it searches any
+    // row in full; The loop adds each row after them
+    for (int j = firstRow; j < firstRow + THREE_BLOCK_ADJ && firstRow < endFull;
+         j++)
+    {
+        int slot = j % bufferRows;
+        fillPartials(cols, gridRow(table, j), gridRow(table, j + 1),
+                     &pair2Rows[slot * cols], &pair3Rows[slot * cols],
+                     &vert2Rows[slot * cols]);
+    }
+    
+    // Cycle starting position through the band by rows
+    for (int j = firstRow; j < endFull; j++)
+    {
+        // Add the row 2 below to the buffer in place of the row above
+        int next = (j + THREE_BLOCK_ADJ) % bufferRows;
+        fillPartials(cols, gridRow(table, j + THREE_BLOCK_ADJ),
+                     gridRow(table, j + FOUR_BLOCK_ADJ),
+                     &pair2Rows[next * cols], &pair3Rows[next * cols],
+                     &vert2Rows[next * cols]);
+        
+        const int *row0  = gridRow(table, j);
+        const int *row1  = gridRow(table, j + 1);
+        const int *row2  = gridRow(table, j + 2);
+        const int *pair0 = &pair2Rows[(j % bufferRows) * cols];
+        const int *pair1 = &pair2Rows[((j + 1) % bufferRows) * cols];
+        const int *pair2 = &pair2Rows[((j + 2) % bufferRows) * cols];
+        const int *trip0 = &pair3Rows[(j % bufferRows) * cols];
+        const int *trip1 = &pair3Rows[((j + 1) % bufferRows) * cols];
+        const int *vert0 = &vert2Rows[(j % bufferRows) * cols];
+        const int *vert1 = &vert2Rows[((j + 1) % bufferRows) * cols];
+        const int *vert2 = &vert2Rows[((j + 2) % bufferRows) * cols];
+        
+        for (int i = 0; i < firstInner; i++)
+        {
+            offerEdgeCell(rows, cols, table, j, i, best);
+        }
+        
+        for (int i = firstInner; i < endInner; i++)
+        {
+            // The vertical triple at the start
+            int vert3 = vert0[i] * row2[i];
+            
+            // Calculate the products in the order of ORIENTATION_TABLE
+            products[0]  = pair0[i] * pair1[i];
+            products[1]  = pair0[i] * pair0[i + 2];
+            products[2]  = vert0[i] * vert2[i];
+            products[3]  = pair0[i] * pair1[i - 1];
+            products[4]  = vert0[i] * vert1[i + 1];
+            products[5]  = pair0[i] * pair1[i + 1];
+            products[6]  = vert0[i] * vert1[i - 1];
+            products[7]  = trip0[i] * row1[i + 2];
+            products[8]  = vert0[i] * pair2[i - 1];
+            products[9]  = row0[i] * trip1[i];
+            products[10] = pair0[i] * vert1[i];
+            products[11] = trip0[i] * row1[i];
+            products[12] = pair0[i] * vert1[i + 1];
+            products[13] = row0[i] * trip1[i - 2];
+            products[14] = vert0[i] * pair2[i];
+            products[15] = trip0[i] * row1[i + 1];
+            products[16] = vert3 * row1[i - 1];
+            products[17] = row0[i] * trip1[i - 1];
+            products[18] = vert3 * row1[i + 1];
+            
+            offerCell(best, products, j, i);
+        }
+        
+        for (int i = (endInner > firstInner ? endInner : firstInner);
+             i < cols; i++)
+        {
+            offerEdgeCell(rows, cols, table, j, i, best);
+        }
+    }
+    
+    // Check the starting positions in the last rows
+    for (int j = (endFull > firstRow ? endFull : firstRow); j < endRow; j++)
+    {
+        for (int i = 0; i < cols; i++)
+        {
+            offerEdgeCell(rows, cols, table, j, i, best);
+        }
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: fillPartials
+ * 
+ *    Entry: The columns, a row of the table and the row below it, and the
+ *           buffer rows to fill
+ *
+ *     Exit: pair2 holds the product of each number and the next in the row,
+ *           pair3 of each number and the next 2, and vert2 of each number and
+ *           the one below it
+ *
+ *  Purpose: Calculate the pieces the orientations are built from for one row;
+ *           The pairs and triples that would run past the last column are
+ *           left unset, since no inner starting position reads them
+ *
+ *
+ *   *   *   *   *   *   */
+void fillPartials(int cols, const int *row, const int *below, int *pair2,
+                  int *pair3, int *vert2)
+{
+    for (int i = 0; i < cols; i++)
+    {
+        vert2[i] = row[i] * below[i];
+    }
+    for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
+    {
+        pair2[i] = row[i] * row[i + 1];
+    }
+    for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
+    {
+        pair3[i] = pair2[i] * row[i + 2];
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: offerEdgeCell
+ * 
+ *    Entry: 2 ints for the rows and columns, the table grid, the starting
+ *           position, and the greatest product so far
+ *
+ *     Exit: The greatest product includes each orientation that fits at the
+ *           starting position
+ *
+ *  Purpose: Check the starting positions near the edges, where only some of
+ *           the orientations fit
+ *
+ *
+ *   *   *   *   *   *   */
+void offerEdgeCell(int rows, int cols, const Grid &table, int row, int col,
+                   Best &best)
+{
+    for (int k = 0; k < ORIENTATIONS; k++)
+    {
+        const Orientation &shape = ORIENTATION_TABLE[k];
+        int product = 1;
+        
+        for (int b = 0; b < 4 && product != -1; b++)
+        {
+            int r = row + shape.rowOffset[b];
+            int c = col + shape.colOffset[b];
+            if (r >= rows || c < 0 || c >= cols)
+            {
+                // The orientation does not fit at this position
+                product = -1;
+            }
+            else
+            {
+                product *= gridRow(table, r)[c];
+            }
+        }
+        
+        if (product != -1)
+        {
+            offerProduct(best, product, k, row, col);
+        }
+    }
+}
+
+/*   *   *   *   *   *   *
+ * 
+ * Function: makeTetromino
+ * 
+ *    Entry: The greatest product of a search
+ *
+ *     Exit: Returns a Tetromino struct with the product, the position of
+ *           each block, the shape, and the orientation
+ *
+ *  Purpose: Convert the result of a search; If no product was greater than
+ *           0, the result is the last orientation at position 0, as the
+ *           passes report it
+ *
+ *
+ *   *   *   *   *   *   */
+Tetromino makeTetromino(const Best &best)
+{
+    if (best.orientation == -1)
+    {
+        const Orientation &last = ORIENTATION_TABLE[ORIENTATIONS - 1];
+        Tetromino none = {0, 0, 0, 0, 0, 0, 0, 0, 0, last.degrees, last.shape};
+        return (none);
+    }
+    
+    const Orientation &shape = ORIENTATION_TABLE[best.orientation];
+    Tetromino tet = {best.product, 0, 0, 0, 0, 0, 0, 0, 0, shape.degrees,
+                     shape.shape};
+    tet.rowPosition1 = best.row + shape.rowOffset[0];
+    tet.colPosition1 = best.col + shape.colOffset[0];
+    tet.rowPosition2 = best.row + shape.rowOffset[1];
+    tet.colPosition2 = best.col + shape.colOffset[1];
+    tet.rowPosition3 = best.row + shape.rowOffset[2];
+    tet.colPosition3 = best.col + shape.colOffset[2];
+    tet.rowPosition4 = best.row + shape.rowOffset[3];
+    tet.colPosition4 = best.col + shape.colOffset[3];
+    
+    return (tet);
+}
+
 /*   *   *   *   *   *   *
  * 
  * Function: greaterOfTwo
@@ -691,7 +1874,7 @@ Tetromino greaterOfTwo(Tetromino first, Tetromino second)
  * 
  * Function: greatestO
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris O shape and returns a Tetromino struct
@@ -703,20 +1886,21 @@ Tetromino greaterOfTwo(Tetromino first, Tetromino second)
  *
  *
  *   *   *   *   *   *   */
-Tetromino greatestO(int rows, int cols, int **table)
+Tetromino greatestO(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp      = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "O"};
     Tetromino greatestO = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "O"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j][i + 1] * table[j + 1][i]
-                            * table[j + 1][i + 1]);
-            if (temp.product > greatestO.product)
+            temp.product = (row0[i] * row0[i + 1] * row1[i] * row1[i + 1]);
+            if (isGreater(temp.product, i, greatestO))
             {
                 greatestO.product = temp.product;
                 greatestO.rowPosition1 = j;
@@ -738,7 +1922,7 @@ Tetromino greatestO(int rows, int cols, int **table)
  * 
  * Function: greatestI
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris I shape and returns a Tetromino struct
@@ -752,7 +1936,7 @@ Tetromino greatestO(int rows, int cols, int **table)
  *
  *
  *   *   *   *   *   *   */
-Tetromino greatestI(int rows, int cols, int **table)
+Tetromino greatestI(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp      = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "I"};
@@ -772,7 +1956,7 @@ Tetromino greatestI(int rows, int cols, int **table)
  * 
  * Function: calcI0Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris I shape in the 0 degree orientation and
@@ -784,20 +1968,20 @@ Tetromino greatestI(int rows, int cols, int **table)
  *
  *
  *   *   *   *   *   *   */
-Tetromino calcI0Degrees(int rows, int cols, int **table)
+Tetromino calcI0Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp          = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "I"};
     Tetromino greatestI0Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "I"};
 
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - FOUR_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < rows; j++)
     {
-        for (int j = 0; j < rows; j++)
+        const int *row0 = gridRow(table, j);
+        for (int i = 0; i < (cols - FOUR_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j][i + 1] * table[j][i + 2]
-                            * table[j][i + 3]);                            
-            if (temp.product > greatestI0Deg.product)
+            temp.product = (row0[i] * row0[i + 1] * row0[i + 2] * row0[i + 3]);
+            if (isGreater(temp.product, i, greatestI0Deg))
             {
                 greatestI0Deg.product = temp.product;
                 greatestI0Deg.rowPosition1 = j;
@@ -819,7 +2003,7 @@ Tetromino calcI0Degrees(int rows, int cols, int **table)
  * 
  * Function: calcI90Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris I shape in the 90 degree orientation and
@@ -834,20 +2018,23 @@ Tetromino calcI0Degrees(int rows, int cols, int **table)
  *
  *
  *   *   *   *   *   *   */
-Tetromino calcI90Degrees(int rows, int cols, int **table)
+Tetromino calcI90Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp           = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "I"};
     Tetromino greatestI90Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "I"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < cols; i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - FOUR_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - FOUR_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        const int *row2 = gridRow(table, j + 2);
+        const int *row3 = gridRow(table, j + 3);
+        for (int i = 0; i < cols; i++)
         {
-            temp.product = (table[j][i] * table[j + 1][i] * table[j + 2][i]
-                            * table[j + 3][i]);
-            if (temp.product > greatestI90Deg.product)
+            temp.product = (row0[i] * row1[i] * row2[i] * row3[i]);
+            if (isGreater(temp.product, i, greatestI90Deg))
             {
                 greatestI90Deg.product = temp.product;
                 greatestI90Deg.rowPosition1 = j;
@@ -869,7 +2056,7 @@ Tetromino calcI90Degrees(int rows, int cols, int **table)
  * 
  * Function: greatestS
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris S shape and returns a Tetromino struct
@@ -882,7 +2069,7 @@ Tetromino calcI90Degrees(int rows, int cols, int **table)
  *
  *
  *   *   *   *   *   *   */
-Tetromino greatestS(int rows, int cols, int **table)
+Tetromino greatestS(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp      = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "S"};
@@ -902,7 +2089,7 @@ Tetromino greatestS(int rows, int cols, int **table)
  * 
  * Function: calcS0Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris S shape in the 0 degree orientation and
@@ -914,20 +2101,21 @@ Tetromino greatestS(int rows, int cols, int **table)
  *                                                       **
  *
  *   *   *   *   *   *   */
-Tetromino calcS0Degrees(int rows, int cols, int **table)
+Tetromino calcS0Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp          = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "S"};
     Tetromino greatestS0Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "S"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 1; i < (cols - TWO_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        for (int i = 1; i < (cols - TWO_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j][i + 1] * table[j + 1][i - 1]
-                            * table[j + 1][i]);
-            if (temp.product > greatestS0Deg.product)
+            temp.product = (row0[i] * row0[i + 1] * row1[i - 1] * row1[i]);
+            if (isGreater(temp.product, i, greatestS0Deg))
             {
                 greatestS0Deg.product = temp.product;
                 greatestS0Deg.rowPosition1 = j;
@@ -949,7 +2137,7 @@ Tetromino calcS0Degrees(int rows, int cols, int **table)
  * 
  * Function: calcS90Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris S shape in the 90 degree orientation and
@@ -962,20 +2150,22 @@ Tetromino calcS0Degrees(int rows, int cols, int **table)
  *                                                          *
  *
  *   *   *   *   *   *   */
-Tetromino calcS90Degrees(int rows, int cols, int **table)
+Tetromino calcS90Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp           = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "S"};
     Tetromino greatestS90Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "S"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        const int *row2 = gridRow(table, j + 2);
+        for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j + 1][i] * table[j + 1][i + 1]
-                            * table[j + 2][i + 1]);
-            if (temp.product > greatestS90Deg.product)
+            temp.product = (row0[i] * row1[i] * row1[i + 1] * row2[i + 1]);
+            if (isGreater(temp.product, i, greatestS90Deg))
             {
                 greatestS90Deg.product = temp.product;
                 greatestS90Deg.rowPosition1 = j;
@@ -997,7 +2187,7 @@ Tetromino calcS90Degrees(int rows, int cols, int **table)
  * 
  * Function: greatestZ
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris Z shape and returns a Tetromino struct
@@ -1010,7 +2200,7 @@ Tetromino calcS90Degrees(int rows, int cols, int **table)
  *
  *
  *   *   *   *   *   *   */
-Tetromino greatestZ(int rows, int cols, int **table)
+Tetromino greatestZ(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp      = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "Z"};
@@ -1030,7 +2220,7 @@ Tetromino greatestZ(int rows, int cols, int **table)
  * 
  * Function: calcZ0Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris Z shape in the 0 degree orientation and
@@ -1042,20 +2232,21 @@ Tetromino greatestZ(int rows, int cols, int **table)
  *                                                        **
  *
  *   *   *   *   *   *   */
-Tetromino calcZ0Degrees(int rows, int cols, int **table)
+Tetromino calcZ0Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp          = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "Z"};
     Tetromino greatestZ0Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "Z"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j][i + 1] * table[j + 1][i + 1]
-                            * table[j + 1][i + 2]);
-            if (temp.product > greatestZ0Deg.product)
+            temp.product = (row0[i] * row0[i + 1] * row1[i + 1] * row1[i + 2]);
+            if (isGreater(temp.product, i, greatestZ0Deg))
             {
                 greatestZ0Deg.product = temp.product;
                 greatestZ0Deg.rowPosition1 = j;
@@ -1077,7 +2268,7 @@ Tetromino calcZ0Degrees(int rows, int cols, int **table)
  * 
  * Function: calcZ90Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris Z shape in the 90 degree orientation and
@@ -1090,20 +2281,22 @@ Tetromino calcZ0Degrees(int rows, int cols, int **table)
  *                                                         *
  *
  *   *   *   *   *   *   */
-Tetromino calcZ90Degrees(int rows, int cols, int **table)
+Tetromino calcZ90Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp           = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "Z"};
     Tetromino greatestZ90Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "Z"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 1; i < cols; i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        const int *row2 = gridRow(table, j + 2);
+        for (int i = 1; i < cols; i++)
         {
-            temp.product = (table[j][i] * table[j + 1][i - 1] * table[j + 1][i]
-                            * table[j + 2][i - 1]);
-            if (temp.product > greatestZ90Deg.product)
+            temp.product = (row0[i] * row1[i - 1] * row1[i] * row2[i - 1]);
+            if (isGreater(temp.product, i, greatestZ90Deg))
             {
                 greatestZ90Deg.product = temp.product;
                 greatestZ90Deg.rowPosition1 = j;
@@ -1125,7 +2318,7 @@ Tetromino calcZ90Degrees(int rows, int cols, int **table)
  * 
  * Function: greatestJ
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris J shape and returns a Tetromino struct
@@ -1139,7 +2332,7 @@ Tetromino calcZ90Degrees(int rows, int cols, int **table)
  *
  *
  *   *   *   *   *   *   */
-Tetromino greatestJ(int rows, int cols, int **table)
+Tetromino greatestJ(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp      = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "J"};
@@ -1165,7 +2358,7 @@ Tetromino greatestJ(int rows, int cols, int **table)
  * 
  * Function: calcJ0Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris J shape in the 0 degree orientation and
@@ -1177,20 +2370,21 @@ Tetromino greatestJ(int rows, int cols, int **table)
  *                                                         *
  *
  *   *   *   *   *   *   */
-Tetromino calcJ0Degrees(int rows, int cols, int **table)
+Tetromino calcJ0Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp          = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "J"};
     Tetromino greatestJ0Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "J"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j][i + 1] * table[j][i + 2]
-                            * table[j + 1][i + 2]);
-            if (temp.product > greatestJ0Deg.product)
+            temp.product = (row0[i] * row0[i + 1] * row0[i + 2] * row1[i + 2]);
+            if (isGreater(temp.product, i, greatestJ0Deg))
             {
                 greatestJ0Deg.product = temp.product;
                 greatestJ0Deg.rowPosition1 = j;
@@ -1212,7 +2406,7 @@ Tetromino calcJ0Degrees(int rows, int cols, int **table)
  * 
  * Function: calcJ90Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris J shape in the 90 degree orientation and
@@ -1225,20 +2419,22 @@ Tetromino calcJ0Degrees(int rows, int cols, int **table)
  *                                                         **
  *
  *   *   *   *   *   *   */
-Tetromino calcJ90Degrees(int rows, int cols, int **table)
+Tetromino calcJ90Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp           = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "J"};
     Tetromino greatestJ90Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "J"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 1; i < cols; i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        const int *row2 = gridRow(table, j + 2);
+        for (int i = 1; i < cols; i++)
         {
-            temp.product = (table[j][i] * table[j + 1][i] * table[j + 2][i - 1]
-                            * table[j + 2][i]);
-            if (temp.product > greatestJ90Deg.product)
+            temp.product = (row0[i] * row1[i] * row2[i - 1] * row2[i]);
+            if (isGreater(temp.product, i, greatestJ90Deg))
             {
                 greatestJ90Deg.product = temp.product;
                 greatestJ90Deg.rowPosition1 = j;
@@ -1260,7 +2456,7 @@ Tetromino calcJ90Degrees(int rows, int cols, int **table)
  * 
  * Function: calcJ180Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris J shape in the 180 degree orientation and
@@ -1272,20 +2468,21 @@ Tetromino calcJ90Degrees(int rows, int cols, int **table)
  *                                                         ***
  *
  *   *   *   *   *   *   */
-Tetromino calcJ180Degrees(int rows, int cols, int **table)
+Tetromino calcJ180Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp            = {0, 0, 0, 0, 0, 0, 0, 0, 0, 180, "J"};
     Tetromino greatestJ180Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 180, "J"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j + 1][i] * table[j + 1][i + 1]
-                            * table[j + 1][i + 2]);
-            if (temp.product > greatestJ180Deg.product)
+            temp.product = (row0[i] * row1[i] * row1[i + 1] * row1[i + 2]);
+            if (isGreater(temp.product, i, greatestJ180Deg))
             {
                 greatestJ180Deg.product = temp.product;
                 greatestJ180Deg.rowPosition1 = j;
@@ -1307,7 +2504,7 @@ Tetromino calcJ180Degrees(int rows, int cols, int **table)
  * 
  * Function: calcJ270Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris J shape in the 270 degree orientation and
@@ -1320,20 +2517,22 @@ Tetromino calcJ180Degrees(int rows, int cols, int **table)
  *                                                          *
  *
  *   *   *   *   *   *   */
-Tetromino calcJ270Degrees(int rows, int cols, int **table)
+Tetromino calcJ270Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp            = {0, 0, 0, 0, 0, 0, 0, 0, 0, 270, "J"};
     Tetromino greatestJ270Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 270, "J"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        const int *row2 = gridRow(table, j + 2);
+        for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j][i + 1] * table[j + 1][i]
-                            * table[j + 2][i]);
-            if (temp.product > greatestJ270Deg.product)
+            temp.product = (row0[i] * row0[i + 1] * row1[i] * row2[i]);
+            if (isGreater(temp.product, i, greatestJ270Deg))
             {
                 greatestJ270Deg.product = temp.product;
                 greatestJ270Deg.rowPosition1 = j;
@@ -1355,7 +2554,7 @@ Tetromino calcJ270Degrees(int rows, int cols, int **table)
  * 
  * Function: greatestL
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris L shape and returns a Tetromino struct
@@ -1369,7 +2568,7 @@ Tetromino calcJ270Degrees(int rows, int cols, int **table)
  *
  *
  *   *   *   *   *   *   */
-Tetromino greatestL(int rows, int cols, int **table)
+Tetromino greatestL(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp      = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "L"};
@@ -1395,7 +2594,7 @@ Tetromino greatestL(int rows, int cols, int **table)
  * 
  * Function: calcL0Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris L shape in the 0 degree orientation and
@@ -1407,20 +2606,21 @@ Tetromino greatestL(int rows, int cols, int **table)
  *                                                       *
  *
  *   *   *   *   *   *   */
-Tetromino calcL0Degrees(int rows, int cols, int **table)
+Tetromino calcL0Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp          = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "L"};
     Tetromino greatestL0Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "L"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j][i + 1] * table[j][i + 2]
-                            * table[j + 1][i]);
-            if (temp.product > greatestL0Deg.product)
+            temp.product = (row0[i] * row0[i + 1] * row0[i + 2] * row1[i]);
+            if (isGreater(temp.product, i, greatestL0Deg))
             {
                 greatestL0Deg.product = temp.product;
                 greatestL0Deg.rowPosition1 = j;
@@ -1442,7 +2642,7 @@ Tetromino calcL0Degrees(int rows, int cols, int **table)
  * 
  * Function: calcL90Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris L shape in the 90 degree orientation and
@@ -1455,20 +2655,22 @@ Tetromino calcL0Degrees(int rows, int cols, int **table)
  *                                                          *
  *
  *   *   *   *   *   *   */
-Tetromino calcL90Degrees(int rows, int cols, int **table)
+Tetromino calcL90Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp           = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "L"};
     Tetromino greatestL90Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "L"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        const int *row2 = gridRow(table, j + 2);
+        for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j][i + 1] * table[j + 1][i + 1]
-                            * table[j + 2][i + 1]);
-            if (temp.product > greatestL90Deg.product)
+            temp.product = (row0[i] * row0[i + 1] * row1[i + 1] * row2[i + 1]);
+            if (isGreater(temp.product, i, greatestL90Deg))
             {
                 greatestL90Deg.product = temp.product;
                 greatestL90Deg.rowPosition1 = j;
@@ -1490,7 +2692,7 @@ Tetromino calcL90Degrees(int rows, int cols, int **table)
  * 
  * Function: calcL180Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris L shape in the 180 degree orientation and
@@ -1502,20 +2704,21 @@ Tetromino calcL90Degrees(int rows, int cols, int **table)
  *                                                         ***
  *
  *   *   *   *   *   *   */
-Tetromino calcL180Degrees(int rows, int cols, int **table)
+Tetromino calcL180Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp            = {0, 0, 0, 0, 0, 0, 0, 0, 0, 180, "L"};
     Tetromino greatestL180Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 180, "L"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 2; i < cols; i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        for (int i = 2; i < cols; i++)
         {
-            temp.product = (table[j][i] * table[j + 1][i - 2] 
-                            * table[j + 1][i - 1] * table[j + 1][i]);
-            if (temp.product > greatestL180Deg.product)
+            temp.product = (row0[i] * row1[i - 2] * row1[i - 1] * row1[i]);
+            if (isGreater(temp.product, i, greatestL180Deg))
             {
                 greatestL180Deg.product = temp.product;
                 greatestL180Deg.rowPosition1 = j;
@@ -1537,7 +2740,7 @@ Tetromino calcL180Degrees(int rows, int cols, int **table)
  * 
  * Function: calcL270Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris L shape in the 270 degree orientation and
@@ -1550,20 +2753,22 @@ Tetromino calcL180Degrees(int rows, int cols, int **table)
  *                                                          **
  *
  *   *   *   *   *   *   */
-Tetromino calcL270Degrees(int rows, int cols, int **table)
+Tetromino calcL270Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp            = {0, 0, 0, 0, 0, 0, 0, 0, 0, 270, "L"};
     Tetromino greatestL270Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 270, "L"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        const int *row2 = gridRow(table, j + 2);
+        for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j + 1][i] * table[j + 2][i]
-                            * table[j + 2][i + 1]);
-            if (temp.product > greatestL270Deg.product)
+            temp.product = (row0[i] * row1[i] * row2[i] * row2[i + 1]);
+            if (isGreater(temp.product, i, greatestL270Deg))
             {
                 greatestL270Deg.product = temp.product;
                 greatestL270Deg.rowPosition1 = j;
@@ -1581,7 +2786,7 @@ Tetromino calcL270Degrees(int rows, int cols, int **table)
     return (greatestL270Deg);  
 }
 
-Tetromino greatestT(int rows, int cols, int **table)
+Tetromino greatestT(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp      = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "T"};
@@ -1607,7 +2812,7 @@ Tetromino greatestT(int rows, int cols, int **table)
  * 
  * Function: calcT0Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris T shape in the 0 degree orientation and
@@ -1619,20 +2824,21 @@ Tetromino greatestT(int rows, int cols, int **table)
  *                                                        *
  *
  *   *   *   *   *   *   */
-Tetromino calcT0Degrees(int rows, int cols, int **table)
+Tetromino calcT0Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp          = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "T"};
     Tetromino greatestT0Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, "T"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        for (int i = 0; i < (cols - THREE_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j][i + 1] * table[j][i + 2]
-                            * table[j + 1][i + 1]);
-            if (temp.product > greatestT0Deg.product)
+            temp.product = (row0[i] * row0[i + 1] * row0[i + 2] * row1[i + 1]);
+            if (isGreater(temp.product, i, greatestT0Deg))
             {
                 greatestT0Deg.product = temp.product;
                 greatestT0Deg.rowPosition1 = j;
@@ -1654,7 +2860,7 @@ Tetromino calcT0Degrees(int rows, int cols, int **table)
  * 
  * Function: calcT90Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris T shape in the 90 degree orientation and
@@ -1667,20 +2873,22 @@ Tetromino calcT0Degrees(int rows, int cols, int **table)
  *                                                          *
  *
  *   *   *   *   *   *   */
-Tetromino calcT90Degrees(int rows, int cols, int **table)
+Tetromino calcT90Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp           = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "T"};
     Tetromino greatestT90Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 90, "T"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 1; i < cols; i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        const int *row2 = gridRow(table, j + 2);
+        for (int i = 1; i < cols; i++)
         {
-            temp.product = (table[j][i] * table[j + 1][i - 1] * table[j + 1][i]
-                            * table[j + 2][i]);
-            if (temp.product > greatestT90Deg.product)
+            temp.product = (row0[i] * row1[i - 1] * row1[i] * row2[i]);
+            if (isGreater(temp.product, i, greatestT90Deg))
             {
                 greatestT90Deg.product = temp.product;
                 greatestT90Deg.rowPosition1 = j;
@@ -1702,7 +2910,7 @@ Tetromino calcT90Degrees(int rows, int cols, int **table)
  * 
  * Function: calcT180Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris T shape in the 180 degree orientation and
@@ -1714,20 +2922,21 @@ Tetromino calcT90Degrees(int rows, int cols, int **table)
  *                                                         ***
  *
  *   *   *   *   *   *   */
-Tetromino calcT180Degrees(int rows, int cols, int **table)
+Tetromino calcT180Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp            = {0, 0, 0, 0, 0, 0, 0, 0, 0, 180, "T"};
     Tetromino greatestT180Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 180, "T"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 1; i < (cols - TWO_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - TWO_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        for (int i = 1; i < (cols - TWO_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j + 1][i - 1] * table[j + 1][i]
-                            * table[j + 1][i + 1]);
-            if (temp.product > greatestT180Deg.product)
+            temp.product = (row0[i] * row1[i - 1] * row1[i] * row1[i + 1]);
+            if (isGreater(temp.product, i, greatestT180Deg))
             {
                 greatestT180Deg.product = temp.product;
                 greatestT180Deg.rowPosition1 = j;
@@ -1749,7 +2958,7 @@ Tetromino calcT180Degrees(int rows, int cols, int **table)
  * 
  * Function: calcT270Degrees
  * 
- *    Entry: 3 ints for the rows, columns, and table array
+ *    Entry: 2 ints for the rows and columns, and the table grid
  *
  *     Exit: Searches the 2D array for the greatest product of 4 numbers
  *           arranged in the Tetris T shape in the 270 degree orientation and
@@ -1762,20 +2971,22 @@ Tetromino calcT180Degrees(int rows, int cols, int **table)
  *                                                          *
  *
  *   *   *   *   *   *   */
-Tetromino calcT270Degrees(int rows, int cols, int **table)
+Tetromino calcT270Degrees(int rows, int cols, const Grid &table)
 {
     // Initialize two Tetromino structs, one for temp values and one for return
     Tetromino temp            = {0, 0, 0, 0, 0, 0, 0, 0, 0, 270, "T"};
     Tetromino greatestT270Deg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 270, "T"};
     
-    // Cycle starting position through the array and calculate product
-    for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
+    // Cycle starting position through the grid by rows and calculate product
+    for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
     {
-        for (int j = 0; j < (rows - THREE_BLOCK_ADJ); j++)
+        const int *row0 = gridRow(table, j);
+        const int *row1 = gridRow(table, j + 1);
+        const int *row2 = gridRow(table, j + 2);
+        for (int i = 0; i < (cols - TWO_BLOCK_ADJ); i++)
         {
-            temp.product = (table[j][i] * table[j + 1][i] * table[j + 1][i + 1]
-                            * table[j + 2][i]);
-            if (temp.product > greatestT270Deg.product)
+            temp.product = (row0[i] * row1[i] * row1[i + 1] * row2[i]);
+            if (isGreater(temp.product, i, greatestT270Deg))
             {
                 greatestT270Deg.product = temp.product;
                 greatestT270Deg.rowPosition1 = j;
@@ -1836,7 +3047,7 @@ void printTetDetails(Tetromino tetMax)
  *
  *
  *   *   *   *   *   *   */
-void printTable(int **table, int rows, int cols, Tetromino tet)
+void printTable(const Grid &table, int rows, int cols, Tetromino tet)
 {
     // Print the array table and highlight the four spaces for the Tetrmino
     for (int i = 0; i < rows; i++)
@@ -1848,11 +3059,11 @@ void printTable(int **table, int rows, int cols, Tetromino tet)
                 || (tet.rowPosition3 == i && tet.colPosition3 == j)
                 || (tet.rowPosition4 == i && tet.colPosition4 == j))
             {
-                std::printf("*%*.2d", -4, table[i][j]);
+                std::printf("*%*.2d", -4, gridRow(table, i)[j]);
             }
             else
             {
-                std::printf(" %*.2d", -4, table[i][j]);
+                std::printf(" %*.2d", -4, gridRow(table, i)[j]);
             }
         }
         std::cout << "\n";